@@ -0,0 +1,7 @@
+#!/bin/bash
+
+# The initial conditions are generated in memory, nothing to download.
+../swift -B -s -G -t 16 benchmark.yml 2>&1 | tee output.log
+
+# Over MPI, the box must not be periodic when running with self-gravity:
+# mpirun -np 4 ../swift_mpi -B -s -G -t 16 -P Benchmark:periodic:0 benchmark.yml
@@ -61,6 +61,10 @@ void print_help_message(void) {
 
   printf("Valid options are:\n");
   printf("  %2s %14s %s\n", "-a", "", "Pin runners using processor affinity.");
+  printf("  %2s %14s %s\n", "-B", "",
+         "Benchmark mode. Generate the ICs in memory, run a fixed number of ");
+  printf("  %2s %14s %s\n", "", "",
+         "steps without snapshots and write a report of the timings.");
   printf("  %2s %14s %s\n", "-c", "",
          "Run with cosmological time integration.");
   printf("  %2s %14s %s\n", "-C", "", "Run with cooling.");
@@ -105,7 +109,9 @@ void print_help_message(void) {
   printf("  %2s %14s %s\n", "-v", "[12]", "Increase the level of verbosity:");
   printf("  %2s %14s %s\n", "", "", "1: MPI-rank 0 writes,");
   printf("  %2s %14s %s\n", "", "", "2: All MPI-ranks write.");
-  printf("  %2s %14s %s\n", "-x", "", "Run with structure finding.");
+  printf("  %2s %14s %s\n", "-x", "",
+         "Run with structure finding (friends-of-friends without "
+         "VELOCIraptor).");
   printf("  %2s %14s %s\n", "-y", "{int}",
          "Time-step frequency at which task graphs are dumped.");
   printf("  %2s %14s %s\n", "-Y", "{int}",
@@ -122,11 +128,12 @@ void print_help_message(void) {
  */
 int main(int argc, char *argv[]) {
 
-  struct clocks_time tic, toc;
+  struct clocks_time tic, toc, setup_tic;
   struct engine e;
 
   /* Structs used by the engine. Declare now to make sure these are always in
    * scope.  */
+  struct benchmark_props benchmark_properties;
   struct chemistry_global_data chemistry;
   struct cooling_function_data cooling_func;
   struct cosmology cosmo;
@@ -180,6 +187,7 @@ int main(int argc, char *argv[]) {
   if (myrank == 0) greetings();
 
   int with_aff = 0;
+  int benchmark = 0;
   int dry_run = 0;
   int dump_tasks = 0;
   int dump_threadpool = 0;
@@ -208,7 +216,7 @@ int main(int argc, char *argv[]) {
 
   /* Parse the parameters */
   int c;
-  while ((c = getopt(argc, argv, "acCdDef:FgGhMn:o:P:rsSt:Tv:xy:Y:")) != -1)
+  while ((c = getopt(argc, argv, "aBcCdDef:FgGhMn:o:P:rsSt:Tv:xy:Y:")) != -1)
     switch (c) {
       case 'a':
 #if defined(HAVE_SETAFFINITY) && defined(HAVE_LIBNUMA)
@@ -217,6 +225,9 @@ int main(int argc, char *argv[]) {
         error("Need NUMA support for thread affinity");
 #endif
         break;
+      case 'B':
+        benchmark = 1;
+        break;
       case 'c':
         with_cosmology = 1;
         break;
@@ -306,13 +317,7 @@ int main(int argc, char *argv[]) {
         }
         break;
       case 'x':
-#ifdef HAVE_VELOCIRAPTOR
         with_structure_finding = 1;
-#else
-        error(
-            "Error: (-x) needs to have the code compiled with VELOCIraptor "
-            "linked in.");
-#endif
         break;
       case 'y':
         if (sscanf(optarg, "%d", &dump_tasks) != 1) {
@@ -375,6 +380,12 @@ int main(int argc, char *argv[]) {
     if (myrank == 0) print_help_message();
     return 1;
   }
+  if (benchmark && (restart || with_cosmology)) {
+    if (myrank == 0)
+      printf("Error: Cannot run a benchmark with -r or -c.\n");
+    if (myrank == 0) print_help_message();
+    return 1;
+  }
   if (with_stars && !with_external_gravity && !with_self_gravity) {
     if (myrank == 0)
       printf(
@@ -491,7 +502,7 @@ int main(int argc, char *argv[]) {
   char basename[PARSER_MAX_LINE_SIZE];
   parser_get_param_string(params, "Snapshots:basename", basename);
   const char *dirp = dirname(basename);
-  if (access(dirp, W_OK | X_OK) != 0) {
+  if (!benchmark && access(dirp, W_OK | X_OK) != 0) {
     error("Cannot write snapshots in directory %s (%s)", dirp, strerror(errno));
   }
 
@@ -535,7 +546,7 @@ int main(int argc, char *argv[]) {
                               "restart");
 
   /* The directory must exist. */
-  if (myrank == 0) {
+  if (myrank == 0 && !benchmark) {
     if (access(restart_dir, W_OK | X_OK) != 0) {
       if (restart) {
         error("Cannot restart as no restart subdirectory: %s (%s)", restart_dir,
@@ -670,7 +681,9 @@ int main(int argc, char *argv[]) {
 
     /* Read particles and space information from (GADGET) ICs */
     char ICfileName[200] = "";
-    parser_get_param_string(params, "InitialConditions:file_name", ICfileName);
+    if (!benchmark)
+      parser_get_param_string(params, "InitialConditions:file_name",
+                              ICfileName);
     const int replicate =
         parser_get_opt_param_int(params, "InitialConditions:replicate", 1);
     clean_smoothing_length_values = parser_get_opt_param_int(
@@ -685,7 +698,8 @@ int main(int argc, char *argv[]) {
       error("Can't generate gas if the entropy flag is set in the ICs.");
     if (generate_gas_in_ics && !with_cosmology)
       error("Can't generate gas if the run is not cosmological.");
-    if (myrank == 0) message("Reading ICs from file '%s'", ICfileName);
+    if (myrank == 0 && !benchmark)
+      message("Reading ICs from file '%s'", ICfileName);
     if (myrank == 0 && cleanup_h)
       message("Cleaning up h-factors (h=%f)", cosmo.h);
     if (myrank == 0 && cleanup_sqrt_a)
@@ -696,35 +710,48 @@ int main(int argc, char *argv[]) {
     size_t Ngas = 0, Ngpart = 0, Nspart = 0;
     double dim[3] = {0., 0., 0.};
     int periodic = 0;
+    clocks_gettime(&setup_tic);
     if (myrank == 0) clocks_gettime(&tic);
+    if (benchmark) {
+
+      /* Generate the particles of the benchmark instead. */
+      benchmark_props_init(&benchmark_properties, params);
+      if (myrank == 0) benchmark_props_print(&benchmark_properties);
+      benchmark_generate_ics(&benchmark_properties, dim, &parts, &gparts,
+                             &Ngas, &Ngpart, &periodic, with_hydro,
+                             (with_external_gravity || with_self_gravity),
+                             myrank, nr_nodes, nr_threads);
+    } else {
 #if defined(HAVE_HDF5)
 #if defined(WITH_MPI)
 #if defined(HAVE_PARALLEL_HDF5)
-    read_ic_parallel(ICfileName, &us, dim, &parts, &gparts, &sparts, &Ngas,
+      read_ic_parallel(ICfileName, &us, dim, &parts, &gparts, &sparts, &Ngas,
+                       &Ngpart, &Nspart, &periodic, &flag_entropy_ICs,
+                       with_hydro, (with_external_gravity || with_self_gravity),
+                       with_stars, cleanup_h, cleanup_sqrt_a, cosmo.h, cosmo.a,
+                       myrank, nr_nodes, MPI_COMM_WORLD, MPI_INFO_NULL,
+                       nr_threads, dry_run);
+#else
+      read_ic_serial(ICfileName, &us, dim, &parts, &gparts, &sparts, &Ngas,
                      &Ngpart, &Nspart, &periodic, &flag_entropy_ICs, with_hydro,
                      (with_external_gravity || with_self_gravity), with_stars,
                      cleanup_h, cleanup_sqrt_a, cosmo.h, cosmo.a, myrank,
                      nr_nodes, MPI_COMM_WORLD, MPI_INFO_NULL, nr_threads,
                      dry_run);
-#else
-    read_ic_serial(ICfileName, &us, dim, &parts, &gparts, &sparts, &Ngas,
-                   &Ngpart, &Nspart, &periodic, &flag_entropy_ICs, with_hydro,
-                   (with_external_gravity || with_self_gravity), with_stars,
-                   cleanup_h, cleanup_sqrt_a, cosmo.h, cosmo.a, myrank,
-                   nr_nodes, MPI_COMM_WORLD, MPI_INFO_NULL, nr_threads,
-                   dry_run);
 #endif
 #else
-    read_ic_single(ICfileName, &us, dim, &parts, &gparts, &sparts, &Ngas,
-                   &Ngpart, &Nspart, &periodic, &flag_entropy_ICs, with_hydro,
-                   (with_external_gravity || with_self_gravity), with_stars,
-                   cleanup_h, cleanup_sqrt_a, cosmo.h, cosmo.a, nr_threads,
-                   dry_run);
+      read_ic_single(ICfileName, &us, dim, &parts, &gparts, &sparts, &Ngas,
+                     &Ngpart, &Nspart, &periodic, &flag_entropy_ICs, with_hydro,
+                     (with_external_gravity || with_self_gravity), with_stars,
+                     cleanup_h, cleanup_sqrt_a, cosmo.h, cosmo.a, nr_threads,
+                     dry_run);
 #endif
 #endif
+    }
     if (myrank == 0) {
       clocks_gettime(&toc);
-      message("Reading initial conditions took %.3f %s.",
+      message("%s initial conditions took %.3f %s.",
+              benchmark ? "Generating" : "Reading",
               clocks_diff(&tic, &toc), clocks_getunit());
       fflush(stdout);
     }
@@ -890,6 +917,14 @@ int main(int argc, char *argv[]) {
     engine_config(0, &e, params, nr_nodes, myrank, nr_threads, with_aff,
                   talking, restart_file);
 
+    /* No snapshots, statistics or restart files when benchmarking. */
+    if (benchmark) {
+      e.ti_next_snapshot = 0;
+      e.ti_next_stats = 0;
+      e.restart_dump = 0;
+      e.restart_onexit = 0;
+    }
+
     if (myrank == 0) {
       clocks_gettime(&toc);
       message("engine_init took %.3f %s.", clocks_diff(&tic, &toc),
@@ -949,8 +984,10 @@ int main(int argc, char *argv[]) {
     engine_init_particles(&e, flag_entropy_ICs, clean_smoothing_length_values);
 
     /* Write the state of the system before starting time integration. */
-    engine_dump_snapshot(&e);
-    engine_print_stats(&e);
+    if (!benchmark) {
+      engine_dump_snapshot(&e);
+      engine_print_stats(&e);
+    }
 
     /* Is there a dump before the end of the first time-step? */
     engine_check_for_dumps(&e);
@@ -982,11 +1019,23 @@ int main(int argc, char *argv[]) {
     error("Failed to generate restart filename");
 
   /* dump the parameters as used. */
+  if (!benchmark) {
 
-  /* used parameters */
-  parser_write_params_to_file(params, "used_parameters.yml", 1);
-  /* unused parameters */
-  parser_write_params_to_file(params, "unused_parameters.yml", 0);
+    /* used parameters */
+    parser_write_params_to_file(params, "used_parameters.yml", 1);
+    /* unused parameters */
+    parser_write_params_to_file(params, "unused_parameters.yml", 0);
+  }
+
+  /* Time the steps of the benchmark from here. */
+  struct benchmark_report benchmark_report;
+  bzero(&benchmark_report, sizeof(struct benchmark_report));
+  if (benchmark) {
+    clocks_gettime(&toc);
+    benchmark_report.setup_time = clocks_diff(&setup_tic, &toc);
+    bzero(e.phase_ticks, sizeof(e.phase_ticks));
+    if (nsteps <= 0) nsteps = benchmark_properties.nr_steps;
+  }
 
   /* Main simulation loop */
   /* ==================== */
@@ -1000,6 +1049,16 @@ int main(int argc, char *argv[]) {
     /* Take a step. */
     engine_step(&e);
 
+    /* Collect the measurements of the benchmark. */
+    if (benchmark) {
+      benchmark_report.nr_steps++;
+      benchmark_report.updates += e.updates;
+      benchmark_report.g_updates += e.g_updates;
+      benchmark_report.s_updates += e.s_updates;
+      benchmark_report.wallclock_time += e.wallclock_time;
+      if (benchmark_report.nr_steps == nsteps) break;
+    }
+
     /* Print the timers. */
     if (with_verbose_timers) timers_print(e.step);
 
@@ -1075,6 +1134,12 @@ int main(int argc, char *argv[]) {
         MPI_Barrier(MPI_COMM_WORLD);
       }
 
+      /* The graph of the tasks of each rank, for offline replays. */
+      char graphfile[40];
+      snprintf(graphfile, 40, "task_graph_MPI-rank%d-step%d.dat", myrank,
+               j + 1);
+      scheduler_dump_task_graph(&e.sched, graphfile);
+
 #else
       char dumpfile[30];
       snprintf(dumpfile, 30, "thread_info-step%d.dat", j + 1);
@@ -1099,6 +1164,11 @@ int main(int argc, char *argv[]) {
         }
       }
       fclose(file_thread);
+
+      /* The graph of the tasks, for offline replays. */
+      char graphfile[40];
+      snprintf(graphfile, 40, "task_graph-step%d.dat", j + 1);
+      scheduler_dump_task_graph(&e.sched, graphfile);
 #endif  // WITH_MPI
     }
 #endif  // SWIFT_DEBUG_TASKS
@@ -1151,14 +1221,22 @@ int main(int argc, char *argv[]) {
     fflush(e.file_timesteps);
   }
 
-  /* Write final output. */
-  engine_drift_all(&e);
-  engine_print_stats(&e);
-  engine_dump_snapshot(&e);
+  /* Write final output, or the benchmark report. */
+  if (benchmark) {
+    benchmark_write_report(&benchmark_properties, &benchmark_report, &e);
+  } else {
+    engine_drift_all(&e);
+    engine_print_stats(&e);
+    engine_dump_snapshot(&e);
+  }
+
+  /* Find the friends-of-friends groups at the end of the run. */
+  if (e.fof_properties != NULL) fof_search_tree(e.fof_properties, &e);
 
 #ifdef HAVE_VELOCIRAPTOR
   /* Call VELOCIraptor at the end of the run to find groups. */
-  if (e.policy & engine_policy_structure_finding) {
+  if ((e.policy & engine_policy_structure_finding) &&
+      e.fof_properties == NULL) {
     velociraptor_init(&e);
     velociraptor_invoke(&e);
   }
@@ -1177,6 +1255,7 @@ int main(int argc, char *argv[]) {
   if (with_verbose_timers) timers_close_file();
   if (with_cosmology) cosmology_clean(&cosmo);
   if (with_self_gravity) pm_mesh_clean(&mesh);
+  if (benchmark) benchmark_props_clean(&benchmark_properties);
   engine_clean(&e);
   free(params);
 
@@ -0,0 +1,534 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+/* Config parameters. */
+#include "../config.h"
+
+/* Some standard headers. */
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* MPI headers. */
+#ifdef WITH_MPI
+#include <mpi.h>
+#endif
+
+/* This object's header. */
+#include "benchmark.h"
+
+/* Local includes. */
+#include "clocks.h"
+#include "common_io.h"
+#include "engine.h"
+#include "error.h"
+#include "hydro.h"
+#include "periodic.h"
+#include "threadpool.h"
+
+const char *benchmark_profile_names[benchmark_profile_count] = {
+    "uniform", "glass", "zeldovich", "clustered"};
+
+/**
+ * @brief Mixes the bits of a 64-bit integer (splitmix64 finaliser).
+ */
+static uint64_t benchmark_hash(uint64_t x) {
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+/**
+ * @brief Random number in [0, 1) attached to a key.
+ *
+ * The numbers only depend on the seed, the key and the stream, such that
+ * every rank generates the same particles whatever the decomposition.
+ *
+ * @param bp The #benchmark_props.
+ * @param key The particle or clump this number is for.
+ * @param stream Which of the numbers of that key.
+ */
+static double benchmark_random(const struct benchmark_props *bp, uint64_t key,
+                               int stream) {
+  const uint64_t h =
+      benchmark_hash(benchmark_hash(bp->seed ^ benchmark_hash(key)) + stream);
+  return (h >> 11) * (1. / 9007199254740992.);
+}
+
+/**
+ * @brief Random point in a sphere centred on the origin.
+ *
+ * @param bp The #benchmark_props.
+ * @param key The particle or clump this point is for.
+ * @param stream The first of the three streams of that key to use.
+ * @param r The radius of the sphere.
+ * @param dx (return) The point.
+ */
+static void benchmark_random_in_sphere(const struct benchmark_props *bp,
+                                       uint64_t key, int stream, double r,
+                                       double dx[3]) {
+  const double radius = r * cbrt(benchmark_random(bp, key, stream));
+  const double cos_theta = 2. * benchmark_random(bp, key, stream + 1) - 1.;
+  const double sin_theta = sqrt(1. - cos_theta * cos_theta);
+  const double phi = 2. * M_PI * benchmark_random(bp, key, stream + 2);
+  dx[0] = radius * sin_theta * cos(phi);
+  dx[1] = radius * sin_theta * sin(phi);
+  dx[2] = radius * cos_theta;
+}
+
+/**
+ * @brief Draws the plane waves of the Zel'dovich displacement field.
+ *
+ * The wave vectors are multiples of the fundamental mode of the box, so the
+ * field is periodic. The amplitudes follow a k^-2 power-law normalised such
+ * that the rms displacement is the requested fraction of the lattice spacing.
+ *
+ * @param bp The #benchmark_props.
+ */
+static void benchmark_make_modes(struct benchmark_props *bp) {
+
+  bp->modes = (struct benchmark_mode *)malloc(bp->nr_modes *
+                                              sizeof(struct benchmark_mode));
+  if (bp->modes == NULL) error("Failed to allocate the Zel'dovich modes.");
+
+  /* Largest wave number, well below the Nyquist frequency of the lattice. */
+  long long k_max = bp->particles_per_side / 4;
+  if (k_max > 8) k_max = 8;
+  if (k_max < 1) k_max = 1;
+
+  const double k_fund = 2. * M_PI / bp->box_size;
+  double norm = 0.;
+  for (int m = 0; m < bp->nr_modes; m++) {
+    struct benchmark_mode *mode = &bp->modes[m];
+
+    /* Draw a non-zero wave vector. */
+    long long n[3] = {0, 0, 0};
+    for (int draw = 0; n[0] == 0 && n[1] == 0 && n[2] == 0; draw++)
+      for (int j = 0; j < 3; j++)
+        n[j] = (long long)((2 * k_max + 1) *
+                           benchmark_random(bp, m, 4 * draw + j)) -
+               k_max;
+
+    const double k2 = n[0] * n[0] + n[1] * n[1] + n[2] * n[2];
+    for (int j = 0; j < 3; j++) mode->k[j] = k_fund * n[j];
+    mode->amplitude = 1. / k2;
+    mode->phase = 2. * M_PI * benchmark_random(bp, m, 3);
+    norm += 0.5 * mode->amplitude * mode->amplitude;
+  }
+
+  /* Normalise the rms displacement. */
+  const double spacing = bp->box_size / bp->particles_per_side;
+  const double factor = bp->amplitude * spacing / sqrt(norm);
+  for (int m = 0; m < bp->nr_modes; m++) bp->modes[m].amplitude *= factor;
+}
+
+/**
+ * @brief Initialises the #benchmark_props from the parameter file.
+ *
+ * @param bp The #benchmark_props to initialise.
+ * @param params The parsed parameter file.
+ */
+void benchmark_props_init(struct benchmark_props *bp,
+                          struct swift_params *params) {
+
+  char profile[PARSER_MAX_LINE_SIZE];
+  parser_get_opt_param_string(params, "Benchmark:profile", profile,
+                              benchmark_profile_names[0]);
+  bp->profile = benchmark_profile_count;
+  for (int k = 0; k < benchmark_profile_count; k++)
+    if (strcmp(profile, benchmark_profile_names[k]) == 0)
+      bp->profile = (enum benchmark_profile)k;
+  if (bp->profile == benchmark_profile_count) {
+    message("Invalid choice of benchmark profile '%s'.", profile);
+    error(
+        "Permitted values are: 'uniform', 'glass', 'zeldovich' or "
+        "'clustered'");
+  }
+
+  bp->particles_per_side =
+      parser_get_param_int(params, "Benchmark:particles_per_side");
+  if (bp->particles_per_side < 1)
+    error("The benchmark needs at least one particle per side.");
+  bp->box_size = parser_get_opt_param_double(params, "Benchmark:box_size",
+                                             benchmark_box_size_default);
+  bp->periodic = parser_get_opt_param_int(params, "Benchmark:periodic", 1);
+  bp->density = parser_get_opt_param_double(params, "Benchmark:density",
+                                            benchmark_density_default);
+  bp->internal_energy = parser_get_opt_param_double(
+      params, "Benchmark:internal_energy", benchmark_internal_energy_default);
+  bp->amplitude = parser_get_opt_param_double(params, "Benchmark:amplitude",
+                                              benchmark_amplitude_default);
+  bp->velocity_factor = parser_get_opt_param_double(
+      params, "Benchmark:velocity_factor", benchmark_velocity_factor_default);
+  bp->nr_modes = parser_get_opt_param_int(params, "Benchmark:nr_modes",
+                                          benchmark_nr_modes_default);
+  bp->clustering_levels = parser_get_opt_param_int(
+      params, "Benchmark:clustering_levels",
+      benchmark_clustering_levels_default);
+  bp->clustering_ratio = parser_get_opt_param_double(
+      params, "Benchmark:clustering_ratio", benchmark_clustering_ratio_default);
+  bp->seed = parser_get_opt_param_int(params, "Benchmark:seed", 0);
+  bp->nr_steps = parser_get_opt_param_int(params, "Benchmark:nr_steps",
+                                          benchmark_nr_steps_default);
+  parser_get_opt_param_string(params, "Benchmark:report_file_name",
+                              bp->report_file_name,
+                              benchmark_default_report_file_name);
+
+  if (bp->box_size <= 0.) error("The benchmark box size must be positive.");
+  if (bp->nr_modes < 1) error("The Zel'dovich profile needs some modes.");
+  if (bp->clustering_levels < 0)
+    error("The number of clustering levels cannot be negative.");
+  if (bp->clustering_ratio <= 1.)
+    error("The clustering ratio must be larger than 1.");
+  if (bp->nr_steps < 1) error("The benchmark needs at least one step.");
+
+  bp->modes = NULL;
+  if (bp->profile == benchmark_profile_zeldovich) benchmark_make_modes(bp);
+}
+
+/**
+ * @brief Prints the properties of the benchmark to stdout.
+ *
+ * @param bp The #benchmark_props.
+ */
+void benchmark_props_print(const struct benchmark_props *bp) {
+
+  message("Benchmark profile: '%s'", benchmark_profile_names[bp->profile]);
+  message("Benchmark lattice: %lld^3 particles in a box of size %e.",
+          bp->particles_per_side, bp->box_size);
+  if (bp->profile == benchmark_profile_glass ||
+      bp->profile == benchmark_profile_zeldovich)
+    message("Benchmark displacements: %.3f lattice spacings.", bp->amplitude);
+  if (bp->profile == benchmark_profile_clustered)
+    message("Benchmark clustering: %d levels with a size ratio of %.3f.",
+            bp->clustering_levels, bp->clustering_ratio);
+  message("Benchmark steps: %d, report in '%s'.", bp->nr_steps,
+          bp->report_file_name);
+}
+
+/**
+ * @brief Position and velocity of the particle on a lattice site.
+ *
+ * @param bp The #benchmark_props.
+ * @param i The index of the site.
+ * @param x (return) The position.
+ * @param v (return) The velocity.
+ */
+static void benchmark_particle(const struct benchmark_props *bp, long long i,
+                               double x[3], float v[3]) {
+
+  const long long n = bp->particles_per_side;
+  const long long ind[3] = {i / (n * n), (i / n) % n, i % n};
+  const double spacing = bp->box_size / n;
+  const double dim = bp->box_size;
+
+  for (int j = 0; j < 3; j++) {
+    x[j] = (ind[j] + 0.5) * spacing;
+    v[j] = 0.f;
+  }
+
+  switch (bp->profile) {
+
+    case benchmark_profile_uniform:
+      break;
+
+    case benchmark_profile_glass:
+
+      /* Perturbed lattice */
+      for (int j = 0; j < 3; j++)
+        x[j] += bp->amplitude * spacing * (benchmark_random(bp, i, j) - 0.5);
+      break;
+
+    case benchmark_profile_zeldovich: {
+
+      /* Displace along the gradient of the potential */
+      double psi[3] = {0., 0., 0.};
+      for (int m = 0; m < bp->nr_modes; m++) {
+        const struct benchmark_mode *mode = &bp->modes[m];
+        const double k2 = mode->k[0] * mode->k[0] + mode->k[1] * mode->k[1] +
+                          mode->k[2] * mode->k[2];
+        const double arg = mode->k[0] * x[0] + mode->k[1] * x[1] +
+                           mode->k[2] * x[2] + mode->phase;
+        const double d = mode->amplitude * sin(arg) / sqrt(k2);
+        for (int j = 0; j < 3; j++) psi[j] += d * mode->k[j];
+      }
+      for (int j = 0; j < 3; j++) {
+        x[j] += psi[j];
+        v[j] = bp->velocity_factor * psi[j];
+      }
+    } break;
+
+    case benchmark_profile_clustered: {
+
+      /* The top-level clumps are the coarse cells holding 8^(levels + 1)
+       * lattice sites. Every particle then falls in one of the 8 sub-clumps
+       * of its clump at each level. */
+      long long nr_clumps = n >> (bp->clustering_levels + 1);
+      if (nr_clumps < 1) nr_clumps = 1;
+      const double clump_size = dim / nr_clumps;
+
+      uint64_t clump = 0;
+      for (int j = 0; j < 3; j++) {
+        const long long c = ind[j] * nr_clumps / n;
+        x[j] = (c + 0.5) * clump_size;
+        clump = clump * nr_clumps + c;
+      }
+
+      double r = 0.5 * clump_size;
+      for (int l = 0; l < bp->clustering_levels; l++) {
+
+        /* Pick a sub-clump and move to its centre. */
+        const int k = (int)(8. * benchmark_random(bp, i, 3 + l));
+        clump = benchmark_hash(clump) + k;
+        double dx[3];
+        benchmark_random_in_sphere(bp, clump, 0, r, dx);
+        for (int j = 0; j < 3; j++) x[j] += dx[j];
+        r /= bp->clustering_ratio;
+      }
+
+      /* And place the particle in the last one. */
+      double dx[3];
+      benchmark_random_in_sphere(bp, i, 0, r, dx);
+      for (int j = 0; j < 3; j++) x[j] += dx[j];
+    } break;
+
+    default:
+      error("Unknown benchmark profile.");
+  }
+
+  /* Bring everything back in the box. */
+  for (int j = 0; j < 3; j++) x[j] = box_wrap(x[j], 0., dim);
+}
+
+/**
+ * @brief Data used to generate the particles in parallel.
+ */
+struct benchmark_generate_data {
+
+  const struct benchmark_props *bp;
+  struct part *parts;
+  struct gpart *gparts;
+  long long first;
+  double mass, h;
+};
+
+/**
+ * @brief #threadpool mapper generating the gas particles.
+ */
+static void benchmark_generate_parts_mapper(void *map_data, int num_elements,
+                                            void *extra_data) {
+
+  const struct benchmark_generate_data *data =
+      (struct benchmark_generate_data *)extra_data;
+  struct part *parts = (struct part *)map_data;
+  const ptrdiff_t offset = parts - data->parts;
+
+  for (int k = 0; k < num_elements; k++) {
+    struct part *p = &parts[k];
+    const long long i = data->first + offset + k;
+    benchmark_particle(data->bp, i, p->x, p->v);
+    p->id = i + 1;
+    p->h = data->h;
+    hydro_set_mass(p, data->mass);
+    hydro_set_init_internal_energy(p, data->bp->internal_energy);
+  }
+}
+
+/**
+ * @brief #threadpool mapper generating the dark matter particles.
+ */
+static void benchmark_generate_gparts_mapper(void *map_data, int num_elements,
+                                             void *extra_data) {
+
+  const struct benchmark_generate_data *data =
+      (struct benchmark_generate_data *)extra_data;
+  struct gpart *gparts = (struct gpart *)map_data;
+  const ptrdiff_t offset = gparts - data->gparts;
+
+  for (int k = 0; k < num_elements; k++) {
+    struct gpart *gp = &gparts[k];
+    const long long i = data->first + offset + k;
+    benchmark_particle(data->bp, i, gp->x, gp->v_full);
+    gp->id_or_neg_offset = i + 1;
+    gp->mass = data->mass;
+    gp->type = swift_type_dark_matter;
+  }
+}
+
+/**
+ * @brief Generates the initial conditions of the benchmark.
+ *
+ * Each rank generates its share of the lattice sites, which are later
+ * distributed like particles read from a file. The particles only depend on
+ * the parameters, not on the number of ranks or threads. They are gas
+ * particles when running with hydro and dark matter otherwise.
+ *
+ * @param bp The #benchmark_props.
+ * @param dim (return) The dimensions of the box.
+ * @param parts (return) The gas particles.
+ * @param gparts (return) The gravity particles.
+ * @param Ngas (return) The number of gas particles on this rank.
+ * @param Ngparts (return) The number of gravity particles on this rank.
+ * @param periodic (return) Is the box periodic?
+ * @param with_hydro Are we running with hydro?
+ * @param with_gravity Are we running with gravity?
+ * @param rank The rank of this node.
+ * @param nr_nodes The number of nodes.
+ * @param nr_threads The number of threads to use.
+ */
+void benchmark_generate_ics(const struct benchmark_props *bp, double dim[3],
+                            struct part **parts, struct gpart **gparts,
+                            size_t *Ngas, size_t *Ngparts, int *periodic,
+                            int with_hydro, int with_gravity, int rank,
+                            int nr_nodes, int nr_threads) {
+
+  const long long n = bp->particles_per_side;
+  const long long N = n * n * n;
+  const long long first = N / nr_nodes * rank + N % nr_nodes * rank / nr_nodes;
+  const long long last =
+      N / nr_nodes * (rank + 1) + N % nr_nodes * (rank + 1) / nr_nodes;
+  const size_t count = last - first;
+
+  for (int j = 0; j < 3; j++) dim[j] = bp->box_size;
+  *periodic = bp->periodic;
+
+  struct benchmark_generate_data data;
+  data.bp = bp;
+  data.first = first;
+  data.mass = bp->density * bp->box_size * bp->box_size * bp->box_size / N;
+  data.h = 1.2348 * bp->box_size / n;
+
+  /* Allocate memory to store SPH particles */
+  *Ngas = 0;
+  if (with_hydro) {
+    *Ngas = count;
+    if (posix_memalign((void **)parts, part_align,
+                       *Ngas * sizeof(struct part)) != 0)
+      error("Error while allocating memory for SPH particles");
+    bzero(*parts, *Ngas * sizeof(struct part));
+  }
+
+  /* Allocate memory to store all gravity particles */
+  *Ngparts = 0;
+  if (with_gravity) {
+    *Ngparts = count;
+    if (posix_memalign((void **)gparts, gpart_align,
+                       *Ngparts * sizeof(struct gpart)) != 0)
+      error("Error while allocating memory for gravity particles");
+    bzero(*gparts, *Ngparts * sizeof(struct gpart));
+  }
+  data.parts = *parts;
+  data.gparts = *gparts;
+
+  struct threadpool tp;
+  threadpool_init(&tp, nr_threads);
+
+  /* Generate the particles and link them. */
+  if (with_hydro) {
+    threadpool_map(&tp, benchmark_generate_parts_mapper, *parts, count,
+                   sizeof(struct part), 0, &data);
+    if (with_gravity) io_duplicate_hydro_gparts(&tp, *parts, *gparts, count, 0);
+  } else if (with_gravity) {
+    threadpool_map(&tp, benchmark_generate_gparts_mapper, *gparts, count,
+                   sizeof(struct gpart), 0, &data);
+  }
+
+  threadpool_clean(&tp);
+}
+
+/**
+ * @brief Writes the measurements of the benchmark to the report file.
+ *
+ * The report is a YAML file with the set-up of the run, the particle
+ * updates per second and, for each phase of the time-steps, the maximal
+ * and mean time over the ranks. Needs to be called by all the ranks.
+ *
+ * @param bp The #benchmark_props.
+ * @param report The measurements of this rank.
+ * @param e The #engine.
+ */
+void benchmark_write_report(const struct benchmark_props *bp,
+                            const struct benchmark_report *report,
+                            const struct engine *e) {
+
+  /* Time spent in each phase. */
+  double phase_max[engine_phase_count], phase_sum[engine_phase_count];
+  for (int k = 0; k < engine_phase_count; k++)
+    phase_max[k] = phase_sum[k] = clocks_from_ticks(e->phase_ticks[k]);
+#ifdef WITH_MPI
+  if (MPI_Allreduce(MPI_IN_PLACE, phase_max, engine_phase_count, MPI_DOUBLE,
+                    MPI_MAX, MPI_COMM_WORLD) != MPI_SUCCESS ||
+      MPI_Allreduce(MPI_IN_PLACE, phase_sum, engine_phase_count, MPI_DOUBLE,
+                    MPI_SUM, MPI_COMM_WORLD) != MPI_SUCCESS)
+    error("Failed to reduce the benchmark timings.");
+#endif
+
+  if (e->nodeID != 0) return;
+
+  FILE *file = fopen(bp->report_file_name, "w");
+  if (file == NULL)
+    error("Failed to open the benchmark report '%s'.", bp->report_file_name);
+
+  /* Rates are per second, the times in the clock units. */
+  const double seconds = report->wallclock_time * 1e-3;
+
+  fprintf(file, "Benchmark:\n");
+  fprintf(file, "  profile: %s\n", benchmark_profile_names[bp->profile]);
+  fprintf(file, "  particles_per_side: %lld\n", bp->particles_per_side);
+  fprintf(file, "  gas_particles: %lld\n", e->total_nr_parts);
+  fprintf(file, "  gravity_particles: %lld\n", e->total_nr_gparts);
+  fprintf(file, "  ranks: %d\n", e->nr_nodes);
+  fprintf(file, "  threads_per_rank: %d\n", e->nr_threads);
+  fprintf(file, "  steps: %d\n", report->nr_steps);
+  fprintf(file, "  time_unit: %s\n", clocks_getunit());
+  fprintf(file, "  setup_time: %f\n", report->setup_time);
+  fprintf(file, "  wallclock_time: %f\n", report->wallclock_time);
+  fprintf(file, "  updates: %lld\n", report->updates);
+  fprintf(file, "  g_updates: %lld\n", report->g_updates);
+  fprintf(file, "  s_updates: %lld\n", report->s_updates);
+  fprintf(file, "  updates_per_second: %e\n",
+          seconds > 0. ? report->updates / seconds : 0.);
+  fprintf(file, "  g_updates_per_second: %e\n",
+          seconds > 0. ? report->g_updates / seconds : 0.);
+  fprintf(file, "Phases:\n");
+  for (int k = 0; k < engine_phase_count; k++) {
+    fprintf(file, "  %s:\n", engine_phase_names[k]);
+    fprintf(file, "    max: %f\n", phase_max[k]);
+    fprintf(file, "    mean: %f\n", phase_sum[k] / e->nr_nodes);
+  }
+  fclose(file);
+
+  message("Benchmark: %d steps in %.3f %s, %.3e updates/s, %.3e g-updates/s.",
+          report->nr_steps, report->wallclock_time, clocks_getunit(),
+          seconds > 0. ? report->updates / seconds : 0.,
+          seconds > 0. ? report->g_updates / seconds : 0.);
+  message("Benchmark report written to '%s'.", bp->report_file_name);
+}
+
+/**
+ * @brief Frees the memory allocated for the #benchmark_props.
+ *
+ * @param bp The #benchmark_props.
+ */
+void benchmark_props_clean(struct benchmark_props *bp) {
+  free(bp->modes);
+  bp->modes = NULL;
+}
@@ -0,0 +1,156 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#ifndef SWIFT_BENCHMARK_H
+#define SWIFT_BENCHMARK_H
+
+/* Config parameters. */
+#include "../config.h"
+
+/* Some standard headers. */
+#include <stddef.h>
+
+/* Local includes. */
+#include "parser.h"
+#include "part.h"
+
+/* Avoid cyclic inclusions */
+struct engine;
+
+/* Default values of the benchmark parameters. */
+#define benchmark_box_size_default 1.
+#define benchmark_density_default 1.
+#define benchmark_internal_energy_default 1.
+#define benchmark_amplitude_default 0.2
+#define benchmark_velocity_factor_default 0.
+#define benchmark_nr_modes_default 64
+#define benchmark_clustering_levels_default 3
+#define benchmark_clustering_ratio_default 2.5
+#define benchmark_nr_steps_default 10
+#define benchmark_default_report_file_name "benchmark_report.yml"
+
+/**
+ * @brief The kinds of initial conditions the benchmark can generate.
+ */
+enum benchmark_profile {
+  benchmark_profile_uniform = 0,
+  benchmark_profile_glass,
+  benchmark_profile_zeldovich,
+  benchmark_profile_clustered,
+  benchmark_profile_count
+};
+extern const char *benchmark_profile_names[];
+
+/**
+ * @brief A plane wave of the displacement field of the Zel'dovich profile.
+ */
+struct benchmark_mode {
+
+  /*! Wave vector. */
+  double k[3];
+
+  /*! Amplitude of the displacement along the wave vector. */
+  double amplitude;
+
+  /*! Phase. */
+  double phase;
+};
+
+/**
+ * @brief The properties of the synthetic benchmark.
+ *
+ * The particles start on a cubic lattice of particles_per_side^3 sites,
+ * which is then displaced according to the profile.
+ */
+struct benchmark_props {
+
+  /*! The kind of initial conditions. */
+  enum benchmark_profile profile;
+
+  /*! Number of lattice sites along each side of the box. */
+  long long particles_per_side;
+
+  /*! Size of the box. */
+  double box_size;
+
+  /*! Is the box periodic? */
+  int periodic;
+
+  /*! Mean density, which sets the particle mass. */
+  double density;
+
+  /*! Initial internal energy of the gas. */
+  double internal_energy;
+
+  /*! Displacements in units of the lattice spacing. */
+  double amplitude;
+
+  /*! Ratio of the Zel'dovich velocities to the displacements. */
+  double velocity_factor;
+
+  /*! The plane waves of the Zel'dovich displacement field. */
+  struct benchmark_mode *modes;
+  int nr_modes;
+
+  /*! Number of nested levels of clumps of the clustered profile. */
+  int clustering_levels;
+
+  /*! Ratio of the sizes of two successive levels of clumps. */
+  double clustering_ratio;
+
+  /*! Seed of the random numbers. */
+  long long seed;
+
+  /*! Number of steps to run. */
+  int nr_steps;
+
+  /*! Name of the report. */
+  char report_file_name[PARSER_MAX_LINE_SIZE];
+};
+
+/**
+ * @brief The measurements of a benchmark run.
+ */
+struct benchmark_report {
+
+  /*! Number of steps measured. */
+  int nr_steps;
+
+  /*! Particle updates over all the steps and ranks. */
+  long long updates, g_updates, s_updates;
+
+  /*! Wall-clock time of the steps in ms. */
+  double wallclock_time;
+
+  /*! Time taken to set up the run in ms. */
+  double setup_time;
+};
+
+void benchmark_props_init(struct benchmark_props *bp,
+                          struct swift_params *params);
+void benchmark_props_print(const struct benchmark_props *bp);
+void benchmark_generate_ics(const struct benchmark_props *bp, double dim[3],
+                            struct part **parts, struct gpart **gparts,
+                            size_t *Ngas, size_t *Ngparts, int *periodic,
+                            int with_hydro, int with_gravity, int rank,
+                            int nr_nodes, int nr_threads);
+void benchmark_write_report(const struct benchmark_props *bp,
+                            const struct benchmark_report *report,
+                            const struct engine *e);
+void benchmark_props_clean(struct benchmark_props *bp);
+
+#endif /* SWIFT_BENCHMARK_H */
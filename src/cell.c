@@ -54,6 +54,7 @@
 #include "engine.h"
 #include "error.h"
 #include "gravity.h"
+#include "gravity_cache.h"
 #include "hydro.h"
 #include "hydro_properties.h"
 #include "memswap.h"
@@ -67,20 +68,37 @@
 /* Global variables. */
 int cell_next_tag = 0;
 
+/**
+ * @brief Are the progeny of a cell sent to the other nodes along with it?
+ *
+ * If the tree is truncated, the cells are only sent down to the depth at
+ * which the hydro tasks can still be split. Deeper cells are never used by
+ * the task construction and the foreign sub-tasks treat the last cell sent as
+ * a leaf.
+ *
+ * @param c The #cell.
+ * @param truncate Do we truncate the tree?
+ */
+static int cell_pack_progeny(const struct cell *c, int truncate) {
+  return c->split && (!truncate || cell_can_split_pair_hydro_task(c));
+}
+
 /**
  * @brief Get the size of the cell subtree.
  *
  * @param c The #cell.
+ * @param truncate Do we only count the cells sent to the other nodes when
+ * truncating the tree (see cell_pack())?
  */
-int cell_getsize(struct cell *c) {
+int cell_getsize(struct cell *c, int truncate) {
 
   /* Number of cells in this subtree. */
   int count = 1;
 
   /* Sum up the progeny if split. */
-  if (c->split)
+  if (cell_pack_progeny(c, truncate))
     for (int k = 0; k < 8; k++)
-      if (c->progeny[k] != NULL) count += cell_getsize(c->progeny[k]);
+      if (c->progeny[k] != NULL) count += cell_getsize(c->progeny[k], truncate);
 
   /* Return the final count. */
   return count;
@@ -164,13 +182,19 @@ int cell_link_sparts(struct cell *c, struct spart *sparts) {
 /**
  * @brief Pack the data of the given cell and all it's sub-cells.
  *
+ * The #pcell_size of every packed cell is set to the size of its packed
+ * sub-tree, such that the later exchanges (time-steps, multipoles) stop at
+ * the same depth.
+ *
  * @param c The #cell.
  * @param pc Pointer to an array of packed cells in which the
  *      cells will be packed.
+ * @param truncate Do we stop at the depth used by the hydro tasks?
  *
  * @return The number of packed cells.
  */
-int cell_pack(struct cell *restrict c, struct pcell *restrict pc) {
+int cell_pack(struct cell *restrict c, struct pcell *restrict pc,
+              int truncate) {
 
 #ifdef WITH_MPI
 
@@ -194,10 +218,11 @@ int cell_pack(struct cell *restrict c, struct pcell *restrict pc) {
 
   /* Fill in the progeny, depth-first recursion. */
   int count = 1;
+  const int with_progeny = cell_pack_progeny(c, truncate);
   for (int k = 0; k < 8; k++)
-    if (c->progeny[k] != NULL) {
+    if (with_progeny && c->progeny[k] != NULL) {
       pc->progeny[k] = count;
-      count += cell_pack(c->progeny[k], &pc[count]);
+      count += cell_pack(c->progeny[k], &pc[count], truncate);
     } else
       pc->progeny[k] = -1;
 
@@ -304,12 +329,14 @@ int cell_pack_end_step(struct cell *restrict c,
   pcells[0].ti_gravity_end_max = c->ti_gravity_end_max;
   pcells[0].dx_max_part = c->dx_max_part;
 
-  /* Fill in the progeny, depth-first recursion. */
+  /* Fill in the progeny, depth-first recursion, down to the depth at which
+   * the cell was sent. */
   int count = 1;
-  for (int k = 0; k < 8; k++)
-    if (c->progeny[k] != NULL) {
-      count += cell_pack_end_step(c->progeny[k], &pcells[count]);
-    }
+  if (c->pcell_size > 1)
+    for (int k = 0; k < 8; k++)
+      if (c->progeny[k] != NULL) {
+        count += cell_pack_end_step(c->progeny[k], &pcells[count]);
+      }
 
   /* Return the number of packed values. */
   return count;
@@ -373,12 +400,14 @@ int cell_pack_multipoles(struct cell *restrict c,
   /* Pack this cell's data. */
   pcells[0] = *c->multipole;
 
-  /* Fill in the progeny, depth-first recursion. */
+  /* Fill in the progeny, depth-first recursion, down to the depth at which
+   * the cell was sent. */
   int count = 1;
-  for (int k = 0; k < 8; k++)
-    if (c->progeny[k] != NULL) {
-      count += cell_pack_multipoles(c->progeny[k], &pcells[count]);
-    }
+  if (c->pcell_size > 1)
+    for (int k = 0; k < 8; k++)
+      if (c->progeny[k] != NULL) {
+        count += cell_pack_multipoles(c->progeny[k], &pcells[count]);
+      }
 
   /* Return the number of packed values. */
   return count;
@@ -1376,6 +1405,9 @@ void cell_clean(struct cell *c) {
       c->sort[i] = NULL;
     }
 
+  gravity_cell_cache_free(c->grav_cache);
+  c->grav_cache = NULL;
+
   /* Recurse */
   for (int k = 0; k < 8; k++)
     if (c->progeny[k]) cell_clean(c->progeny[k]);
@@ -1403,23 +1435,18 @@ void cell_activate_drift_part(struct cell *c, struct scheduler *s) {
   c->do_drift = 1;
 
   /* Set the do_sub_drifts all the way up and activate the super drift
-     if this has not yet been done. */
+     if this has not yet been done. Without a drift task, the flags are
+     picked up by cell_drift_part_on_demand(). */
   if (c == c->super_hydro) {
-#ifdef SWIFT_DEBUG_CHECKS
-    if (c->drift_part == NULL)
-      error("Trying to activate un-existing c->drift_part");
-#endif
-    scheduler_activate(s, c->drift_part);
+    if (c->tasks->drift_part != NULL)
+      scheduler_activate(s, c->tasks->drift_part);
   } else {
     for (struct cell *parent = c->parent;
          parent != NULL && !parent->do_sub_drift; parent = parent->parent) {
       parent->do_sub_drift = 1;
       if (parent == c->super_hydro) {
-#ifdef SWIFT_DEBUG_CHECKS
-        if (parent->drift_part == NULL)
-          error("Trying to activate un-existing parent->drift_part");
-#endif
-        scheduler_activate(s, parent->drift_part);
+        if (parent->tasks->drift_part != NULL)
+          scheduler_activate(s, parent->tasks->drift_part);
         break;
       }
     }
@@ -1441,10 +1468,10 @@ void cell_activate_drift_gpart(struct cell *c, struct scheduler *s) {
      if this has not yet been done. */
   if (c == c->super_gravity) {
 #ifdef SWIFT_DEBUG_CHECKS
-    if (c->drift_gpart == NULL)
+    if (c->tasks->drift_gpart == NULL)
       error("Trying to activate un-existing c->drift_gpart");
 #endif
-    scheduler_activate(s, c->drift_gpart);
+    scheduler_activate(s, c->tasks->drift_gpart);
   } else {
     for (struct cell *parent = c->parent;
          parent != NULL && !parent->do_grav_sub_drift;
@@ -1452,10 +1479,10 @@ void cell_activate_drift_gpart(struct cell *c, struct scheduler *s) {
       parent->do_grav_sub_drift = 1;
       if (parent == c->super_gravity) {
 #ifdef SWIFT_DEBUG_CHECKS
-        if (parent->drift_gpart == NULL)
+        if (parent->tasks->drift_gpart == NULL)
           error("Trying to activate un-existing parent->drift_gpart");
 #endif
-        scheduler_activate(s, parent->drift_gpart);
+        scheduler_activate(s, parent->tasks->drift_gpart);
         break;
       }
     }
@@ -1469,9 +1496,10 @@ void cell_activate_sorts_up(struct cell *c, struct scheduler *s) {
 
   if (c == c->super_hydro) {
 #ifdef SWIFT_DEBUG_CHECKS
-    if (c->sorts == NULL) error("Trying to activate un-existing c->sorts");
+    if (c->tasks->sorts == NULL)
+      error("Trying to activate un-existing c->sorts");
 #endif
-    scheduler_activate(s, c->sorts);
+    scheduler_activate(s, c->tasks->sorts);
     if (c->nodeID == engine_rank) cell_activate_drift_part(c, s);
   } else {
 
@@ -1480,10 +1508,10 @@ void cell_activate_sorts_up(struct cell *c, struct scheduler *s) {
       parent->do_sub_sort = 1;
       if (parent == c->super_hydro) {
 #ifdef SWIFT_DEBUG_CHECKS
-        if (parent->sorts == NULL)
+        if (parent->tasks->sorts == NULL)
           error("Trying to activate un-existing parents->sorts");
 #endif
-        scheduler_activate(s, parent->sorts);
+        scheduler_activate(s, parent->tasks->sorts);
         if (parent->nodeID == engine_rank) cell_activate_drift_part(parent, s);
         break;
       }
@@ -1899,18 +1927,21 @@ void cell_activate_grav_mm_task(struct cell *ci, struct cell *cj,
  * @param ci The first #cell we recurse in.
  * @param cj The second #cell we recurse in.
  * @param s The task #scheduler.
+ * @return 1 if the space needs rebuilding, i.e. if a foreign cell of which we
+ * only have the multipole needs a particle-particle interaction.
  */
-void cell_activate_subcell_grav_tasks(struct cell *ci, struct cell *cj,
-                                      struct scheduler *s) {
+int cell_activate_subcell_grav_tasks(struct cell *ci, struct cell *cj,
+                                     struct scheduler *s) {
   /* Some constants */
   const struct space *sp = s->space;
   const struct engine *e = sp->e;
+  int rebuild = 0;
 
   /* Self interaction? */
   if (cj == NULL) {
 
     /* Do anything? */
-    if (ci->gcount == 0 || !cell_is_active_gravity(ci, e)) return;
+    if (ci->gcount == 0 || !cell_is_active_gravity(ci, e)) return 0;
 
     /* Recurse? */
     if (ci->split) {
@@ -1918,11 +1949,12 @@ void cell_activate_subcell_grav_tasks(struct cell *ci, struct cell *cj,
       /* Loop over all progenies and pairs of progenies */
       for (int j = 0; j < 8; j++) {
         if (ci->progeny[j] != NULL) {
-          cell_activate_subcell_grav_tasks(ci->progeny[j], NULL, s);
+          rebuild |=
+              cell_activate_subcell_grav_tasks(ci->progeny[j], NULL, s);
           for (int k = j + 1; k < 8; k++)
             if (ci->progeny[k] != NULL)
-              cell_activate_subcell_grav_tasks(ci->progeny[j], ci->progeny[k],
-                                               s);
+              rebuild |= cell_activate_subcell_grav_tasks(ci->progeny[j],
+                                                          ci->progeny[k], s);
         }
       }
     } else {
@@ -1937,8 +1969,8 @@ void cell_activate_subcell_grav_tasks(struct cell *ci, struct cell *cj,
 
     /* Anything to do here? */
     if (!cell_is_active_gravity(ci, e) && !cell_is_active_gravity(cj, e))
-      return;
-    if (ci->gcount == 0 || cj->gcount == 0) return;
+      return 0;
+    if (ci->gcount == 0 || cj->gcount == 0) return 0;
 
     /* Atomically drift the multipole in ci */
     lock_lock(&ci->mlock);
@@ -1954,7 +1986,7 @@ void cell_activate_subcell_grav_tasks(struct cell *ci, struct cell *cj,
     if (cell_can_use_pair_mm(ci, cj, e, sp)) {
 
       /* Ok, no need to drift anything */
-      return;
+      return 0;
     }
     /* Otherwise, activate the gpart drifts if we are at the bottom. */
     else if (!ci->split && !cj->split) {
@@ -1964,6 +1996,27 @@ void cell_activate_subcell_grav_tasks(struct cell *ci, struct cell *cj,
         if (ci->nodeID == engine_rank) cell_activate_drift_gpart(ci, s);
         if (cj->nodeID == engine_rank) cell_activate_drift_gpart(cj, s);
       }
+
+      /* Has a foreign cell of which we only have the multipole come closer
+       * than expected at the last rebuild? We then need its particles, unless
+       * the pair is beyond the reach of the truncated forces. */
+      if ((ci->mpole_only && cell_is_active_gravity(cj, e)) ||
+          (cj->mpole_only && cell_is_active_gravity(ci, e))) {
+        const struct gravity_tensors *const multi_i = ci->multipole;
+        const struct gravity_tensors *const multi_j = cj->multipole;
+        double dx = multi_i->CoM[0] - multi_j->CoM[0];
+        double dy = multi_i->CoM[1] - multi_j->CoM[1];
+        double dz = multi_i->CoM[2] - multi_j->CoM[2];
+        if (e->mesh->periodic) {
+          dx = nearest(dx, e->mesh->dim[0]);
+          dy = nearest(dy, e->mesh->dim[1]);
+          dz = nearest(dz, e->mesh->dim[2]);
+        }
+        const double r_lr_check = sqrt(dx * dx + dy * dy + dz * dz) -
+                                  (multi_i->r_max + multi_j->r_max);
+        if (!e->mesh->periodic || r_lr_check <= e->mesh->r_cut_max)
+          rebuild = 1;
+      }
     }
     /* Ok, we can still recurse */
     else {
@@ -1980,7 +2033,8 @@ void cell_activate_subcell_grav_tasks(struct cell *ci, struct cell *cj,
           /* Loop over ci's children */
           for (int k = 0; k < 8; k++) {
             if (ci->progeny[k] != NULL)
-              cell_activate_subcell_grav_tasks(ci->progeny[k], cj, s);
+              rebuild |=
+                  cell_activate_subcell_grav_tasks(ci->progeny[k], cj, s);
           }
 
         } else if (cj->split) {
@@ -1988,7 +2042,8 @@ void cell_activate_subcell_grav_tasks(struct cell *ci, struct cell *cj,
           /* Loop over cj's children */
           for (int k = 0; k < 8; k++) {
             if (cj->progeny[k] != NULL)
-              cell_activate_subcell_grav_tasks(ci, cj->progeny[k], s);
+              rebuild |=
+                  cell_activate_subcell_grav_tasks(ci, cj->progeny[k], s);
           }
 
         } else {
@@ -2000,7 +2055,8 @@ void cell_activate_subcell_grav_tasks(struct cell *ci, struct cell *cj,
           /* Loop over cj's children */
           for (int k = 0; k < 8; k++) {
             if (cj->progeny[k] != NULL)
-              cell_activate_subcell_grav_tasks(ci, cj->progeny[k], s);
+              rebuild |=
+                  cell_activate_subcell_grav_tasks(ci, cj->progeny[k], s);
           }
 
         } else if (ci->split) {
@@ -2008,7 +2064,8 @@ void cell_activate_subcell_grav_tasks(struct cell *ci, struct cell *cj,
           /* Loop over ci's children */
           for (int k = 0; k < 8; k++) {
             if (ci->progeny[k] != NULL)
-              cell_activate_subcell_grav_tasks(ci->progeny[k], cj, s);
+              rebuild |=
+                  cell_activate_subcell_grav_tasks(ci->progeny[k], cj, s);
           }
 
         } else {
@@ -2017,6 +2074,8 @@ void cell_activate_subcell_grav_tasks(struct cell *ci, struct cell *cj,
       }
     }
   }
+
+  return rebuild;
 }
 
 /**
@@ -2207,16 +2266,21 @@ int cell_unskip_hydro_tasks(struct cell *c, struct scheduler *s) {
     for (struct link *l = c->force; l != NULL; l = l->next)
       scheduler_activate(s, l->t);
 
-    if (c->extra_ghost != NULL) scheduler_activate(s, c->extra_ghost);
-    if (c->ghost_in != NULL) scheduler_activate(s, c->ghost_in);
-    if (c->ghost_out != NULL) scheduler_activate(s, c->ghost_out);
     if (c->ghost != NULL) scheduler_activate(s, c->ghost);
-    if (c->kick1 != NULL) scheduler_activate(s, c->kick1);
-    if (c->kick2 != NULL) scheduler_activate(s, c->kick2);
-    if (c->timestep != NULL) scheduler_activate(s, c->timestep);
-    if (c->end_force != NULL) scheduler_activate(s, c->end_force);
-    if (c->cooling != NULL) scheduler_activate(s, c->cooling);
-    if (c->sourceterms != NULL) scheduler_activate(s, c->sourceterms);
+
+    /* Tasks only attached to super-cells. */
+    const struct cell_super_tasks *t = c->tasks;
+    if (t != NULL) {
+      if (t->extra_ghost != NULL) scheduler_activate(s, t->extra_ghost);
+      if (t->ghost_in != NULL) scheduler_activate(s, t->ghost_in);
+      if (t->ghost_out != NULL) scheduler_activate(s, t->ghost_out);
+      if (t->kick1 != NULL) scheduler_activate(s, t->kick1);
+      if (t->kick2 != NULL) scheduler_activate(s, t->kick2);
+      if (t->timestep != NULL) scheduler_activate(s, t->timestep);
+      if (t->end_force != NULL) scheduler_activate(s, t->end_force);
+      if (t->cooling != NULL) scheduler_activate(s, t->cooling);
+      if (t->sourceterms != NULL) scheduler_activate(s, t->sourceterms);
+    }
   }
 
   return rebuild;
@@ -2257,9 +2321,9 @@ int cell_unskip_gravity_tasks(struct cell *c, struct scheduler *s) {
           t->subtype == task_subtype_external_grav) {
         cell_activate_subcell_external_grav_tasks(ci, s);
       } else if (t->type == task_type_self && t->subtype == task_subtype_grav) {
-        cell_activate_subcell_grav_tasks(ci, NULL, s);
+        rebuild |= cell_activate_subcell_grav_tasks(ci, NULL, s);
       } else if (t->type == task_type_pair) {
-        cell_activate_subcell_grav_tasks(ci, cj, s);
+        rebuild |= cell_activate_subcell_grav_tasks(ci, cj, s);
       } else if (t->type == task_type_grav_mm) {
         cell_activate_grav_mm_task(ci, cj, s);
       }
@@ -2271,23 +2335,25 @@ int cell_unskip_gravity_tasks(struct cell *c, struct scheduler *s) {
       /* Activate the send/recv tasks. */
       if (ci_nodeID != nodeID) {
 
-        /* If the local cell is active, receive data from the foreign cell. */
-        if (cj_active) {
+        /* If the local cell is active, receive data from the foreign cell,
+           unless we only use its multipoles. */
+        if (cj_active && !ci->mpole_only) {
           scheduler_activate(s, ci->recv_grav);
         }
 
         /* If the foreign cell is active, we want its ti_end values. */
         if (ci_active) scheduler_activate(s, ci->recv_ti);
 
-        /* Is the foreign cell active and will need stuff from us? */
+        /* Is the foreign cell active and will need stuff from us? The
+           foreign node may only need our multipoles. */
         if (ci_active) {
 
-          scheduler_activate_send(s, cj->send_grav, ci_nodeID);
-
           /* Drift the cell which will be sent at the level at which it is
              sent, i.e. drift the cell specified in the send task (l->t)
              itself. */
-          cell_activate_drift_gpart(cj, s);
+          if (scheduler_activate_send_if_any(s, cj->send_grav, ci_nodeID) !=
+              NULL)
+            cell_activate_drift_gpart(cj, s);
         }
 
         /* If the local cell is active, send its ti_end values. */
@@ -2295,23 +2361,25 @@ int cell_unskip_gravity_tasks(struct cell *c, struct scheduler *s) {
 
       } else if (cj_nodeID != nodeID) {
 
-        /* If the local cell is active, receive data from the foreign cell. */
-        if (ci_active) {
+        /* If the local cell is active, receive data from the foreign cell,
+           unless we only use its multipoles. */
+        if (ci_active && !cj->mpole_only) {
           scheduler_activate(s, cj->recv_grav);
         }
 
         /* If the foreign cell is active, we want its ti_end values. */
         if (cj_active) scheduler_activate(s, cj->recv_ti);
 
-        /* Is the foreign cell active and will need stuff from us? */
+        /* Is the foreign cell active and will need stuff from us? The
+           foreign node may only need our multipoles. */
         if (cj_active) {
 
-          scheduler_activate_send(s, ci->send_grav, cj_nodeID);
-
           /* Drift the cell which will be sent at the level at which it is
              sent, i.e. drift the cell specified in the send task (l->t)
              itself. */
-          cell_activate_drift_gpart(ci, s);
+          if (scheduler_activate_send_if_any(s, ci->send_grav, cj_nodeID) !=
+              NULL)
+            cell_activate_drift_gpart(ci, s);
         }
 
         /* If the local cell is active, send its ti_end values. */
@@ -2324,16 +2392,22 @@ int cell_unskip_gravity_tasks(struct cell *c, struct scheduler *s) {
   /* Unskip all the other task types. */
   if (c->nodeID == nodeID && cell_is_active_gravity(c, e)) {
 
-    if (c->init_grav != NULL) scheduler_activate(s, c->init_grav);
     if (c->init_grav_out != NULL) scheduler_activate(s, c->init_grav_out);
-    if (c->kick1 != NULL) scheduler_activate(s, c->kick1);
-    if (c->kick2 != NULL) scheduler_activate(s, c->kick2);
-    if (c->timestep != NULL) scheduler_activate(s, c->timestep);
-    if (c->end_force != NULL) scheduler_activate(s, c->end_force);
-    if (c->grav_down != NULL) scheduler_activate(s, c->grav_down);
     if (c->grav_down_in != NULL) scheduler_activate(s, c->grav_down_in);
-    if (c->grav_mesh != NULL) scheduler_activate(s, c->grav_mesh);
-    if (c->grav_long_range != NULL) scheduler_activate(s, c->grav_long_range);
+
+    /* Tasks only attached to super-cells. */
+    const struct cell_super_tasks *t = c->tasks;
+    if (t != NULL) {
+      if (t->init_grav != NULL) scheduler_activate(s, t->init_grav);
+      if (t->kick1 != NULL) scheduler_activate(s, t->kick1);
+      if (t->kick2 != NULL) scheduler_activate(s, t->kick2);
+      if (t->timestep != NULL) scheduler_activate(s, t->timestep);
+      if (t->end_force != NULL) scheduler_activate(s, t->end_force);
+      if (t->grav_down != NULL) scheduler_activate(s, t->grav_down);
+      if (t->grav_mesh != NULL) scheduler_activate(s, t->grav_mesh);
+      if (t->grav_long_range != NULL)
+        scheduler_activate(s, t->grav_long_range);
+    }
   }
 
   return rebuild;
@@ -2441,9 +2515,10 @@ void cell_set_super_mapper(void *map_data, int num_elements, void *extra_data) {
 int cell_has_tasks(struct cell *c) {
 
 #ifdef WITH_MPI
-  if (c->timestep != NULL || c->recv_ti != NULL) return 1;
+  if ((c->tasks != NULL && c->tasks->timestep != NULL) || c->recv_ti != NULL)
+    return 1;
 #else
-  if (c->timestep != NULL) return 1;
+  if (c->tasks != NULL && c->tasks->timestep != NULL) return 1;
 #endif
 
   if (c->split) {
@@ -2489,6 +2564,8 @@ void cell_drift_part(struct cell *c, const struct engine *e, int force) {
   /* Are we not in a leaf ? */
   if (c->split && (force || c->do_sub_drift)) {
 
+    cell_part_bbox_empty(c);
+
     /* Loop over the progeny and collect their data. */
     for (int k = 0; k < 8; k++) {
       if (c->progeny[k] != NULL) {
@@ -2501,6 +2578,7 @@ void cell_drift_part(struct cell *c, const struct engine *e, int force) {
         dx_max = max(dx_max, cp->dx_max_part);
         dx_max_sort = max(dx_max_sort, cp->dx_max_sort);
         cell_h_max = max(cell_h_max, cp->h_max);
+        cell_part_bbox_merge(c, cp);
       }
     }
 
@@ -2532,6 +2610,8 @@ void cell_drift_part(struct cell *c, const struct engine *e, int force) {
       dt_therm = (ti_current - ti_old_part) * e->time_base;
     }
 
+    cell_part_bbox_empty(c);
+
     /* Loop over all the gas particles in the cell */
     const size_t nr_parts = c->count;
     for (size_t k = 0; k < nr_parts; k++) {
@@ -2599,6 +2679,9 @@ void cell_drift_part(struct cell *c, const struct engine *e, int force) {
       /* Maximal smoothing length */
       cell_h_max = max(cell_h_max, p->h);
 
+      /* Extent of the particles */
+      cell_part_bbox_add(c, p->x);
+
       /* Get ready for a density calculation */
       if (part_is_active(p, e)) {
         hydro_init_part(p, &e->s->hs);
@@ -2606,6 +2689,11 @@ void cell_drift_part(struct cell *c, const struct engine *e, int force) {
       }
     }
 
+    /* Record the particles crossing the lightcone. */
+    if (e->lightcone_properties != NULL)
+      lightcone_check_parts(e->lightcone_properties, e, parts, xparts,
+                            c->count, dt_drift, ti_old_part, ti_current);
+
     /* Now, get the maximal particle motion from its square */
     dx_max = sqrtf(dx2_max);
     dx_max_sort = sqrtf(dx2_max_sort);
@@ -2624,6 +2712,39 @@ void cell_drift_part(struct cell *c, const struct engine *e, int force) {
   c->do_sub_drift = 0;
 }
 
+/**
+ * @brief Drifts the #part of a cell's super-cell if this has not been done
+ * yet in this step.
+ *
+ * Used in place of the drift_part tasks when these are not constructed. The
+ * first task that touches any cell of a super-cell drifts all the #part
+ * flagged for drifting in it, i.e. it does the work of the drift task just
+ * before loading the same particles itself. The other tasks find the flags
+ * cleared and return straight away.
+ *
+ * @param c The #cell.
+ * @param e The #engine (to get ti_current).
+ * @return 1 if the particles were drifted by this call, 0 otherwise.
+ */
+int cell_drift_part_on_demand(struct cell *c, const struct engine *e) {
+
+  struct cell *super = c->super_hydro;
+
+  /* Only the local cells get drifted. */
+  if (super == NULL || super->nodeID != engine_rank) return 0;
+
+  if (lock_lock(&super->tasks->drift_lock) != 0)
+    error("Failed to lock the super-cell drift.");
+
+  const int drifted = super->do_drift || super->do_sub_drift;
+  if (drifted) cell_drift_part(super, e, 0);
+
+  if (lock_unlock(&super->tasks->drift_lock) != 0)
+    error("Failed to unlock the super-cell drift.");
+
+  return drifted;
+}
+
 /**
  * @brief Recursively drifts the #gpart in a cell hierarchy.
  *
@@ -2711,6 +2832,11 @@ void cell_drift_gpart(struct cell *c, const struct engine *e, int force) {
       }
     }
 
+    /* Record the particles crossing the lightcone. */
+    if (e->lightcone_properties != NULL)
+      lightcone_check_gparts(e->lightcone_properties, e, gparts, c->gcount,
+                             dt_drift, ti_old_gpart, ti_current);
+
     /* Loop over all the star particles in the cell */
     const size_t nr_sparts = c->scount;
     for (size_t k = 0; k < nr_sparts; k++) {
@@ -2733,6 +2859,101 @@ void cell_drift_gpart(struct cell *c, const struct engine *e, int force) {
   c->do_grav_sub_drift = 0;
 }
 
+/**
+ * @brief Copy the particles of a cell hierarchy and drift the copies to the
+ * current time, leaving the particles themselves where they are.
+ *
+ * The copies are stored at the same offsets in the given arrays as the
+ * particles in the #space's arrays.
+ *
+ * @param c The #cell.
+ * @param e The #engine (to get ti_current).
+ * @param parts The copy of the #space's #part array.
+ * @param xparts The copy of the #space's #xpart array.
+ * @param gparts The copy of the #space's #gpart array.
+ * @param sparts The copy of the #space's #spart array.
+ */
+void cell_drift_output_copy(const struct cell *c, const struct engine *e,
+                            struct part *parts, struct xpart *xparts,
+                            struct gpart *gparts, struct spart *sparts) {
+
+  const struct space *s = e->s;
+  const integertime_t ti_current = e->ti_current;
+  const int with_cosmology = (e->policy & engine_policy_cosmology);
+
+  /* Are we not in a leaf ? */
+  if (c->split) {
+    for (int k = 0; k < 8; k++)
+      if (c->progeny[k] != NULL)
+        cell_drift_output_copy(c->progeny[k], e, parts, xparts, gparts,
+                               sparts);
+    return;
+  }
+
+  /* Copy and drift the gas particles. */
+  if (c->count > 0) {
+    const ptrdiff_t offset = c->parts - s->parts;
+    struct part *const p_copy = &parts[offset];
+    struct xpart *const xp_copy = &xparts[offset];
+    memcpy(p_copy, c->parts, sizeof(struct part) * c->count);
+    memcpy(xp_copy, c->xparts, sizeof(struct xpart) * c->count);
+
+    const integertime_t ti_old_part = c->ti_old_part;
+    if (ti_current > ti_old_part) {
+      double dt_drift, dt_kick_grav, dt_kick_hydro, dt_therm;
+      if (with_cosmology) {
+        dt_drift =
+            cosmology_get_drift_factor(e->cosmology, ti_old_part, ti_current);
+        dt_kick_grav = cosmology_get_grav_kick_factor(e->cosmology,
+                                                      ti_old_part, ti_current);
+        dt_kick_hydro = cosmology_get_hydro_kick_factor(
+            e->cosmology, ti_old_part, ti_current);
+        dt_therm = cosmology_get_therm_kick_factor(e->cosmology, ti_old_part,
+                                                   ti_current);
+      } else {
+        dt_drift = (ti_current - ti_old_part) * e->time_base;
+        dt_kick_grav = (ti_current - ti_old_part) * e->time_base;
+        dt_kick_hydro = (ti_current - ti_old_part) * e->time_base;
+        dt_therm = (ti_current - ti_old_part) * e->time_base;
+      }
+
+      const float hydro_h_max = e->hydro_properties->h_max;
+      for (int k = 0; k < c->count; k++) {
+        drift_part(&p_copy[k], &xp_copy[k], dt_drift, dt_kick_hydro,
+                   dt_kick_grav, dt_therm, ti_old_part, ti_current);
+        p_copy[k].h = min(p_copy[k].h, hydro_h_max);
+      }
+    }
+  }
+
+  /* Copy and drift the g-particles and star particles. */
+  const integertime_t ti_old_gpart = c->ti_old_gpart;
+  double dt_drift = 0.;
+  if (ti_current > ti_old_gpart) {
+    if (with_cosmology)
+      dt_drift =
+          cosmology_get_drift_factor(e->cosmology, ti_old_gpart, ti_current);
+    else
+      dt_drift = (ti_current - ti_old_gpart) * e->time_base;
+  }
+
+  if (c->gcount > 0) {
+    struct gpart *const gp_copy = &gparts[c->gparts - s->gparts];
+    memcpy(gp_copy, c->gparts, sizeof(struct gpart) * c->gcount);
+    if (ti_current > ti_old_gpart)
+      for (int k = 0; k < c->gcount; k++)
+        drift_gpart(&gp_copy[k], dt_drift, ti_old_gpart, ti_current);
+  }
+
+  if (c->scount > 0) {
+    struct spart *const sp_copy = &sparts[c->sparts - s->sparts];
+    memcpy(sp_copy, c->sparts, sizeof(struct spart) * c->scount);
+    if (ti_current > ti_old_gpart)
+      for (int k = 0; k < c->scount; k++)
+        drift_spart(&sp_copy[k], dt_drift, ti_old_gpart, ti_current);
+  }
+}
+
 /**
  * @brief Recursively drifts all multipoles in a cell hierarchy.
  *
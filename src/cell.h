@@ -27,6 +27,7 @@
 #include "../config.h"
 
 /* Includes. */
+#include <float.h>
 #include <stddef.h>
 
 /* Local includes. */
@@ -42,6 +43,7 @@
 /* Avoid cyclic inclusions */
 struct engine;
 struct scheduler;
+struct gravity_cell_cache;
 
 /* Max tag size set to 2^29 to take into account some MPI implementations
  * that use 2^31 as the upper bound on MPI tags and the fact that
@@ -51,6 +53,10 @@ struct scheduler;
 
 #define cell_align 128
 
+/* Padding of the interaction radius, in units of the cell size, used when
+ * pruning cell pairs with the bounding boxes of their particles. */
+#define cell_part_bbox_margin 1e-5
+
 /* Global variables. */
 extern int cell_next_tag;
 
@@ -150,6 +156,68 @@ struct pcell_step {
   float dx_max_part;
 };
 
+/**
+ * @brief The hierarchical tasks attached to a super-cell.
+ *
+ * Only the cells that are the #super, #super_hydro or #super_gravity cell of
+ * their hierarchy carry one of these. Keeping them out of the #cell struct
+ * keeps the cells, which are mostly walked through by the tree recursions,
+ * small.
+ */
+struct cell_super_tasks {
+
+  /*! The task computing this cell's sorts. */
+  struct task *sorts;
+
+  /*! The multipole initialistation task */
+  struct task *init_grav;
+
+  /*! Dependency implicit task for the ghost  (in->ghost->out)*/
+  struct task *ghost_in;
+
+  /*! Dependency implicit task for the ghost  (in->ghost->out)*/
+  struct task *ghost_out;
+
+  /*! The extra ghost task for complex hydro schemes */
+  struct task *extra_ghost;
+
+  /*! The drift task for parts */
+  struct task *drift_part;
+
+  /*! The drift task for gparts */
+  struct task *drift_gpart;
+
+  /*! The first kick task */
+  struct task *kick1;
+
+  /*! The second kick task */
+  struct task *kick2;
+
+  /*! The task to end the force calculation */
+  struct task *end_force;
+
+  /*! The task to compute time-steps */
+  struct task *timestep;
+
+  /*! Task computing long range non-periodic gravity interactions */
+  struct task *grav_long_range;
+
+  /*! Task propagating the mesh forces to the particles */
+  struct task *grav_mesh;
+
+  /*! Task propagating the multipole to the particles */
+  struct task *grav_down;
+
+  /*! Task for cooling */
+  struct task *cooling;
+
+  /*! Task for source terms */
+  struct task *sourceterms;
+
+  /*! Lock serialising the on-demand drifts of this cell's #part. */
+  swift_lock_type drift_lock;
+};
+
 /**
  * @brief Cell within the tree structure.
  *
@@ -166,6 +234,12 @@ struct cell {
   /*! Max smoothing length in this cell. */
   double h_max;
 
+  /*! Lower corner of the tight bounding box of the #part in this cell. */
+  double part_bbox_min[3];
+
+  /*! Upper corner of the tight bounding box of the #part in this cell. */
+  double part_bbox_max[3];
+
   /*! This cell's multipole. */
   struct gravity_tensors *multipole;
 
@@ -187,6 +261,9 @@ struct cell {
   /*! Pointer for the sorted indices. */
   struct entry *sort[13];
 
+  /*! Per-step copy of the #gpart data used by the leaf gravity interactions. */
+  struct gravity_cell_cache *grav_cache;
+
   /*! Pointers to the next level of cells. */
   struct cell *progeny[8];
 
@@ -216,63 +293,18 @@ struct cell {
   /*! Linked list of the tasks computing this cell's gravity forces. */
   struct link *grav;
 
-  /*! The task computing this cell's sorts. */
-  struct task *sorts;
-
-  /*! The multipole initialistation task */
-  struct task *init_grav;
+  /*! The hierarchical tasks of this cell, only set for super-cells. */
+  struct cell_super_tasks *tasks;
 
   /*! Implicit task for the gravity initialisation */
   struct task *init_grav_out;
 
-  /*! Dependency implicit task for the ghost  (in->ghost->out)*/
-  struct task *ghost_in;
-
-  /*! Dependency implicit task for the ghost  (in->ghost->out)*/
-  struct task *ghost_out;
-
   /*! The ghost task itself */
   struct task *ghost;
 
-  /*! The extra ghost task for complex hydro schemes */
-  struct task *extra_ghost;
-
-  /*! The drift task for parts */
-  struct task *drift_part;
-
-  /*! The drift task for gparts */
-  struct task *drift_gpart;
-
-  /*! The first kick task */
-  struct task *kick1;
-
-  /*! The second kick task */
-  struct task *kick2;
-
-  /*! The task to end the force calculation */
-  struct task *end_force;
-
-  /*! The task to compute time-steps */
-  struct task *timestep;
-
-  /*! Task computing long range non-periodic gravity interactions */
-  struct task *grav_long_range;
-
   /*! Implicit task for the down propagation */
   struct task *grav_down_in;
 
-  /*! Task propagating the mesh forces to the particles */
-  struct task *grav_mesh;
-
-  /*! Task propagating the multipole to the particles */
-  struct task *grav_down;
-
-  /*! Task for cooling */
-  struct task *cooling;
-
-  /*! Task for source terms */
-  struct task *sourceterms;
-
 #ifdef WITH_MPI
 
   /* Task receiving hydro data (positions). */
@@ -446,6 +478,9 @@ struct cell {
   /*! Do any of this cell's sub-cells need to be drifted (gravity)? */
   char do_grav_sub_drift;
 
+  /*! Is this a foreign cell of which we only have the multipoles? */
+  char mpole_only;
+
   /*! Do any of this cell's sub-cells need to be sorted? */
   char do_sub_sort;
 
@@ -482,13 +517,13 @@ int cell_mlocktree(struct cell *c);
 void cell_munlocktree(struct cell *c);
 int cell_slocktree(struct cell *c);
 void cell_sunlocktree(struct cell *c);
-int cell_pack(struct cell *c, struct pcell *pc);
+int cell_pack(struct cell *c, struct pcell *pc, int truncate);
 int cell_unpack(struct pcell *pc, struct cell *c, struct space *s);
 int cell_pack_end_step(struct cell *c, struct pcell_step *pcell);
 int cell_unpack_end_step(struct cell *c, struct pcell_step *pcell);
 int cell_pack_multipoles(struct cell *c, struct gravity_tensors *m);
 int cell_unpack_multipoles(struct cell *c, struct gravity_tensors *m);
-int cell_getsize(struct cell *c);
+int cell_getsize(struct cell *c, int truncate);
 int cell_link_parts(struct cell *c, struct part *parts);
 int cell_link_gparts(struct cell *c, struct gpart *gparts);
 int cell_link_sparts(struct cell *c, struct spart *sparts);
@@ -504,15 +539,19 @@ int cell_unskip_hydro_tasks(struct cell *c, struct scheduler *s);
 int cell_unskip_gravity_tasks(struct cell *c, struct scheduler *s);
 void cell_set_super(struct cell *c, struct cell *super);
 void cell_drift_part(struct cell *c, const struct engine *e, int force);
+int cell_drift_part_on_demand(struct cell *c, const struct engine *e);
 void cell_drift_gpart(struct cell *c, const struct engine *e, int force);
+void cell_drift_output_copy(const struct cell *c, const struct engine *e,
+                            struct part *parts, struct xpart *xparts,
+                            struct gpart *gparts, struct spart *sparts);
 void cell_drift_multipole(struct cell *c, const struct engine *e);
 void cell_drift_all_multipoles(struct cell *c, const struct engine *e);
 void cell_check_timesteps(struct cell *c);
 void cell_store_pre_drift_values(struct cell *c);
 void cell_activate_subcell_hydro_tasks(struct cell *ci, struct cell *cj,
                                        struct scheduler *s);
-void cell_activate_subcell_grav_tasks(struct cell *ci, struct cell *cj,
-                                      struct scheduler *s);
+int cell_activate_subcell_grav_tasks(struct cell *ci, struct cell *cj,
+                                     struct scheduler *s);
 void cell_activate_subcell_external_grav_tasks(struct cell *ci,
                                                struct scheduler *s);
 void cell_activate_drift_part(struct cell *c, struct scheduler *s);
@@ -616,6 +655,99 @@ cell_can_split_self_gravity_task(const struct cell *c) {
   return c->split && c->depth < space_subdepth_grav;
 }
 
+/**
+ * @brief Sets the bounding box of the #part in a cell to the empty box.
+ *
+ * @param c The #cell.
+ */
+__attribute__((always_inline)) INLINE static void cell_part_bbox_empty(
+    struct cell *c) {
+
+  for (int k = 0; k < 3; k++) {
+    c->part_bbox_min[k] = DBL_MAX;
+    c->part_bbox_max[k] = -DBL_MAX;
+  }
+}
+
+/**
+ * @brief Grows the bounding box of the #part in a cell to include a position.
+ *
+ * @param c The #cell.
+ * @param x The position.
+ */
+__attribute__((always_inline)) INLINE static void cell_part_bbox_add(
+    struct cell *c, const double *x) {
+
+  for (int k = 0; k < 3; k++) {
+    c->part_bbox_min[k] = min(c->part_bbox_min[k], x[k]);
+    c->part_bbox_max[k] = max(c->part_bbox_max[k], x[k]);
+  }
+}
+
+/**
+ * @brief Grows the bounding box of the #part in a cell to include the box of
+ * one of its progeny.
+ *
+ * @param c The #cell.
+ * @param cp The progeny.
+ */
+__attribute__((always_inline)) INLINE static void cell_part_bbox_merge(
+    struct cell *c, const struct cell *cp) {
+
+  for (int k = 0; k < 3; k++) {
+    c->part_bbox_min[k] = min(c->part_bbox_min[k], cp->part_bbox_min[k]);
+    c->part_bbox_max[k] = max(c->part_bbox_max[k], cp->part_bbox_max[k]);
+  }
+}
+
+/**
+ * @brief Square of the distance between a position and the bounding box of
+ * the #part in a cell.
+ *
+ * @param c The #cell.
+ * @param x The position, already shifted into the frame of the cell.
+ */
+__attribute__((always_inline)) INLINE static double cell_part_bbox_dist2(
+    const struct cell *c, const double *x) {
+
+  double r2 = 0.;
+  for (int k = 0; k < 3; k++) {
+    const double d = max3(c->part_bbox_min[k] - x[k],
+                          x[k] - c->part_bbox_max[k], 0.);
+    r2 += d * d;
+  }
+  return r2;
+}
+
+/**
+ * @brief Can the #part of a cell pair interact at all given the tight
+ * bounding boxes of the particles ?
+ *
+ * The interaction radius is the largest smoothing length of the two cells,
+ * padded by a small fraction of the cell size to cover the single-precision
+ * distances computed in the interaction loops.
+ *
+ * @param ci The first #cell.
+ * @param cj The second #cell.
+ * @param shift The periodic shift between the cells, as returned by
+ * space_getsid() (i.e. to be added to the positions of cj).
+ */
+__attribute__((always_inline)) INLINE static int cell_can_interact_hydro(
+    const struct cell *ci, const struct cell *cj, const double *shift) {
+
+  const double r_max = kernel_gamma * max(ci->h_max, cj->h_max) +
+                       cell_part_bbox_margin * max(ci->dmin, cj->dmin);
+
+  double r2 = 0.;
+  for (int k = 0; k < 3; k++) {
+    const double d =
+        max3(cj->part_bbox_min[k] + shift[k] - ci->part_bbox_max[k],
+             ci->part_bbox_min[k] - (cj->part_bbox_max[k] + shift[k]), 0.);
+    r2 += d * d;
+  }
+  return r2 < r_max * r_max;
+}
+
 /**
  * @brief Have particles in a pair of cells moved too much and require a rebuild
  * ?
@@ -0,0 +1,335 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+/* Config parameters. */
+#include "../config.h"
+
+/* Some standard headers. */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* This object's header. */
+#include "compress.h"
+
+/* Local includes. */
+#include "error.h"
+
+/* Number of bits of the hash table used to find matches. */
+#define compress_hash_bits 12
+
+/* Minimal length of a match. */
+#define compress_min_match 4
+
+/* Maximal distance between a match and its reference. */
+#define compress_max_offset 65535
+
+/**
+ * @brief Reads 4 bytes from an unaligned address.
+ */
+static uint32_t compress_read32(const unsigned char *p) {
+  uint32_t v;
+  memcpy(&v, p, sizeof(uint32_t));
+  return v;
+}
+
+/**
+ * @brief Hash of 4 bytes used to find the previous occurrence of a sequence.
+ */
+static int compress_hash(uint32_t v) {
+  return (int)((v * 2654435761u) >> (32 - compress_hash_bits));
+}
+
+/**
+ * @brief Writes a length using 255-byte continuation bytes.
+ *
+ * @return The new output position.
+ */
+static unsigned char *compress_write_length(unsigned char *op, size_t len) {
+  while (len >= 255) {
+    *op++ = 255;
+    len -= 255;
+  }
+  *op++ = (unsigned char)len;
+  return op;
+}
+
+/**
+ * @brief Reads a length written by compress_write_length().
+ *
+ * @return The new input position.
+ */
+static const unsigned char *compress_read_length(const unsigned char *ip,
+                                                 const unsigned char *end,
+                                                 size_t *len) {
+  unsigned char b;
+  do {
+    if (ip >= end) error("Corrupted compressed buffer.");
+    b = *ip++;
+    *len += b;
+  } while (b == 255);
+  return ip;
+}
+
+/**
+ * @brief Writes one sequence of literals followed by an optional match.
+ *
+ * The token holds the number of literals in its high nibble and the match
+ * length (minus the minimum) in its low nibble, longer values continuing after
+ * the literals and the offset respectively. The last sequence of a buffer has
+ * no match.
+ *
+ * @return The new output position or NULL if the output is full.
+ */
+static unsigned char *compress_write_sequence(unsigned char *op,
+                                              const unsigned char *op_end,
+                                              const unsigned char *literals,
+                                              size_t nr_literals, size_t offset,
+                                              size_t match_length) {
+
+  /* Worst case size of the sequence. */
+  const size_t needed = 1 + nr_literals / 255 + 1 + nr_literals + 2 +
+                        match_length / 255 + 1;
+  if ((size_t)(op_end - op) < needed) return NULL;
+
+  unsigned char *token = op++;
+  const size_t ml = match_length > 0 ? match_length - compress_min_match : 0;
+  *token = (unsigned char)(((nr_literals < 15 ? nr_literals : 15) << 4) |
+                           (ml < 15 ? ml : 15));
+
+  if (nr_literals >= 15) op = compress_write_length(op, nr_literals - 15);
+  memcpy(op, literals, nr_literals);
+  op += nr_literals;
+
+  if (match_length > 0) {
+    *op++ = (unsigned char)(offset & 0xff);
+    *op++ = (unsigned char)(offset >> 8);
+    if (ml >= 15) op = compress_write_length(op, ml - 15);
+  }
+  return op;
+}
+
+/**
+ * @brief LZ-style compression of a buffer.
+ *
+ * @param in The data to compress.
+ * @param n The size of the data in bytes.
+ * @param out The output buffer.
+ * @param capacity The size of the output buffer.
+ *
+ * @return The compressed size or 0 if it does not fit in the output.
+ */
+static size_t compress_lz(const unsigned char *in, size_t n,
+                          unsigned char *out, size_t capacity) {
+
+  int table[1 << compress_hash_bits];
+  for (int k = 0; k < (1 << compress_hash_bits); k++) table[k] = -1;
+
+  const unsigned char *const op_end = out + capacity;
+  unsigned char *op = out;
+  size_t anchor = 0, ip = 0;
+
+  while (ip + compress_min_match <= n) {
+
+    const uint32_t seq = compress_read32(in + ip);
+    const int h = compress_hash(seq);
+    const int ref = table[h];
+    table[h] = (int)ip;
+
+    /* No usable earlier occurrence of these bytes? */
+    if (ref < 0 || ip - ref > compress_max_offset ||
+        compress_read32(in + ref) != seq) {
+      ip++;
+      continue;
+    }
+
+    /* Extend the match as far as possible. */
+    size_t len = compress_min_match;
+    while (ip + len < n && in[ref + len] == in[ip + len]) len++;
+
+    op = compress_write_sequence(op, op_end, in + anchor, ip - anchor,
+                                 ip - ref, len);
+    if (op == NULL) return 0;
+
+    ip += len;
+    anchor = ip;
+  }
+
+  /* The remaining bytes are literals. */
+  op = compress_write_sequence(op, op_end, in + anchor, n - anchor, 0, 0);
+  if (op == NULL) return 0;
+
+  return op - out;
+}
+
+/**
+ * @brief Decompresses a buffer compressed with compress_lz().
+ *
+ * @param in The compressed data.
+ * @param n The size of the compressed data.
+ * @param out The output buffer.
+ * @param raw_size The size of the decompressed data.
+ */
+static void decompress_lz(const unsigned char *in, size_t n,
+                          unsigned char *out, size_t raw_size) {
+
+  const unsigned char *ip = in;
+  const unsigned char *const ip_end = in + n;
+  size_t op = 0;
+
+  while (ip < ip_end) {
+
+    const unsigned char token = *ip++;
+
+    /* Copy the literals. */
+    size_t nr_literals = token >> 4;
+    if (nr_literals == 15) ip = compress_read_length(ip, ip_end, &nr_literals);
+    if (ip + nr_literals > ip_end || op + nr_literals > raw_size)
+      error("Corrupted compressed buffer.");
+    memcpy(out + op, ip, nr_literals);
+    ip += nr_literals;
+    op += nr_literals;
+
+    /* Last sequence? */
+    if (ip == ip_end) break;
+
+    /* Copy the match, which may overlap with its own output. */
+    if (ip + 2 > ip_end) error("Corrupted compressed buffer.");
+    const size_t offset = ip[0] | ((size_t)ip[1] << 8);
+    ip += 2;
+    size_t len = token & 15;
+    if (len == 15) ip = compress_read_length(ip, ip_end, &len);
+    len += compress_min_match;
+    if (offset == 0 || offset > op || op + len > raw_size)
+      error("Corrupted compressed buffer.");
+    for (size_t k = 0; k < len; k++, op++) out[op] = out[op - offset];
+  }
+
+  if (op != raw_size) error("Corrupted compressed buffer.");
+}
+
+/**
+ * @brief Maximal size of a buffer once compressed, header included.
+ *
+ * @param raw_size The size of the data in bytes.
+ */
+size_t compress_bound(size_t raw_size) {
+  return sizeof(struct compress_header) + raw_size;
+}
+
+/**
+ * @brief Losslessly compresses an array of records.
+ *
+ * Each record is first XOR-ed with the previous one, which zeroes the bytes
+ * they have in common (e.g. the leading bytes of close-by positions or unused
+ * fields). The bytes are then grouped by position in the record so that these
+ * zeros form long runs and the result is LZ-compressed. If this does not make
+ * the data smaller, the records are stored as they are.
+ *
+ * @param in The records.
+ * @param raw_size The size of the records in bytes.
+ * @param record_size The size of one record in bytes.
+ * @param out The output, at least compress_bound(raw_size) bytes.
+ *
+ * @return The size of the output in bytes.
+ */
+size_t compress_buffer(const void *in, size_t raw_size, size_t record_size,
+                       void *out) {
+
+  if (record_size == 0 || raw_size % record_size != 0)
+    error("Data is not made of whole records.");
+
+  struct compress_header *header = (struct compress_header *)out;
+  unsigned char *payload = (unsigned char *)out + sizeof(struct compress_header);
+  const unsigned char *data = (const unsigned char *)in;
+  const size_t nr_records = raw_size / record_size;
+
+  header->raw_size = raw_size;
+  header->record_size = (int)record_size;
+
+  /* Delta-code the records and shuffle their bytes. */
+  unsigned char *planes = (unsigned char *)malloc(raw_size);
+  if (planes == NULL && raw_size > 0)
+    error("Failed to allocate the compression buffer.");
+  for (size_t b = 0; b < record_size; b++) {
+    unsigned char *plane = planes + b * nr_records;
+    unsigned char prev = 0;
+    for (size_t i = 0; i < nr_records; i++) {
+      const unsigned char c = data[i * record_size + b];
+      plane[i] = c ^ prev;
+      prev = c;
+    }
+  }
+
+  /* Compress, or fall back to a copy if that does not pay off. */
+  size_t size = compress_lz(planes, raw_size, payload, raw_size);
+  free(planes);
+  if (size > 0) {
+    header->compressed = 1;
+  } else {
+    memcpy(payload, in, raw_size);
+    size = raw_size;
+    header->compressed = 0;
+  }
+  header->size = size;
+
+  return sizeof(struct compress_header) + size;
+}
+
+/**
+ * @brief Decompresses a buffer created by compress_buffer().
+ *
+ * @param in The compressed buffer, header included.
+ * @param out The output.
+ * @param raw_size The expected size of the output in bytes.
+ */
+void decompress_buffer(const void *in, void *out, size_t raw_size) {
+
+  const struct compress_header *header = (const struct compress_header *)in;
+  const unsigned char *payload =
+      (const unsigned char *)in + sizeof(struct compress_header);
+  unsigned char *data = (unsigned char *)out;
+
+  if (header->raw_size != raw_size)
+    error("Compressed buffer of unexpected size (%zu instead of %zu).",
+          header->raw_size, raw_size);
+
+  if (!header->compressed) {
+    memcpy(out, payload, raw_size);
+    return;
+  }
+
+  const size_t record_size = header->record_size;
+  const size_t nr_records = raw_size / record_size;
+
+  unsigned char *planes = (unsigned char *)malloc(raw_size);
+  if (planes == NULL && raw_size > 0)
+    error("Failed to allocate the decompression buffer.");
+  decompress_lz(payload, header->size, planes, raw_size);
+
+  /* Un-shuffle the bytes and undo the delta-coding. */
+  for (size_t b = 0; b < record_size; b++) {
+    const unsigned char *plane = planes + b * nr_records;
+    unsigned char prev = 0;
+    for (size_t i = 0; i < nr_records; i++) {
+      prev ^= plane[i];
+      data[i * record_size + b] = prev;
+    }
+  }
+  free(planes);
+}
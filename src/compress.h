@@ -0,0 +1,50 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#ifndef SWIFT_COMPRESS_H
+#define SWIFT_COMPRESS_H
+
+/* Config parameters. */
+#include "../config.h"
+
+/* Some standard headers. */
+#include <stddef.h>
+
+/**
+ * @brief The header preceding the payload of a compressed buffer.
+ */
+struct compress_header {
+
+  /*! Size of the data once decompressed in bytes. */
+  size_t raw_size;
+
+  /*! Size of the payload following the header in bytes. */
+  size_t size;
+
+  /*! Size of the records the data is made of in bytes. */
+  int record_size;
+
+  /*! Is the payload compressed or a plain copy of the data? */
+  int compressed;
+};
+
+size_t compress_bound(size_t raw_size);
+size_t compress_buffer(const void *in, size_t raw_size, size_t record_size,
+                       void *out);
+void decompress_buffer(const void *in, void *out, size_t raw_size);
+
+#endif /* SWIFT_COMPRESS_H */
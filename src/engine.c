@@ -111,6 +111,9 @@ const char *engine_policy_names[] = {"none",
                                      "stars",
                                      "structure finding"};
 
+const char *engine_phase_names[engine_phase_count] = {
+    "drift", "prepare", "tasks", "collect", "io"};
+
 /** The rank of the engine as a global variable (for messages). */
 int engine_rank;
 
@@ -171,6 +174,17 @@ void engine_add_ghosts(struct engine *e, struct cell *c, struct task *ghost_in,
   }
 }
 
+/**
+ * @brief Returns the task of a super-cell applying the second half-kick.
+ *
+ * This is the time-step task itself when the kicks are fused into it.
+ *
+ * @param c The super-#cell.
+ */
+static struct task *engine_kick2_task(const struct cell *c) {
+  return c->tasks->kick2 != NULL ? c->tasks->kick2 : c->tasks->timestep;
+}
+
 /**
  * @brief Generate the hydro hierarchical tasks for a hierarchy of cells -
  * i.e. all the O(Npart) tasks -- timestep version
@@ -194,24 +208,29 @@ void engine_make_hierarchical_tasks_common(struct engine *e, struct cell *c) {
     /* Local tasks only... */
     if (c->nodeID == e->nodeID) {
 
-      /* Add the two half kicks */
-      c->kick1 = scheduler_addtask(s, task_type_kick1, task_subtype_none, 0, 0,
-                                   c, NULL);
+      /* Add the two half kicks, unless the time-step task does them */
+      if (!e->fused_end_of_step) {
+        c->tasks->kick1 = scheduler_addtask(s, task_type_kick1,
+                                            task_subtype_none, 0, 0, c, NULL);
 
-      c->kick2 = scheduler_addtask(s, task_type_kick2, task_subtype_none, 0, 0,
-                                   c, NULL);
+        c->tasks->kick2 = scheduler_addtask(s, task_type_kick2,
+                                            task_subtype_none, 0, 0, c, NULL);
+      }
 
       /* Add the time-step calculation task and its dependency */
-      c->timestep = scheduler_addtask(s, task_type_timestep, task_subtype_none,
-                                      0, 0, c, NULL);
+      c->tasks->timestep = scheduler_addtask(s, task_type_timestep,
+                                             task_subtype_none, 0, 0, c, NULL);
 
       /* Add the task finishing the force calculation */
-      c->end_force = scheduler_addtask(s, task_type_end_force,
-                                       task_subtype_none, 0, 0, c, NULL);
-
-      if (!is_with_cooling) scheduler_addunlock(s, c->end_force, c->kick2);
-      scheduler_addunlock(s, c->kick2, c->timestep);
-      scheduler_addunlock(s, c->timestep, c->kick1);
+      c->tasks->end_force = scheduler_addtask(s, task_type_end_force,
+                                              task_subtype_none, 0, 0, c, NULL);
+
+      if (!is_with_cooling)
+        scheduler_addunlock(s, c->tasks->end_force, engine_kick2_task(c));
+      if (!e->fused_end_of_step) {
+        scheduler_addunlock(s, c->tasks->kick2, c->tasks->timestep);
+        scheduler_addunlock(s, c->tasks->timestep, c->tasks->kick1);
+      }
     }
 
   } else { /* We are above the super-cell so need to go deeper */
@@ -246,44 +265,45 @@ void engine_make_hierarchical_tasks_hydro(struct engine *e, struct cell *c) {
   if (c->super_hydro == c) {
 
     /* Add the sort task. */
-    c->sorts =
+    c->tasks->sorts =
         scheduler_addtask(s, task_type_sort, task_subtype_none, 0, 0, c, NULL);
 
     /* Local tasks only... */
     if (c->nodeID == e->nodeID) {
 
-      /* Add the drift task. */
-      c->drift_part = scheduler_addtask(s, task_type_drift_part,
-                                        task_subtype_none, 0, 0, c, NULL);
+      /* Add the drift task, unless the cells get drifted on demand. */
+      if (!e->drift_on_demand)
+        c->tasks->drift_part = scheduler_addtask(
+            s, task_type_drift_part, task_subtype_none, 0, 0, c, NULL);
 
       /* Generate the ghost tasks. */
-      c->ghost_in =
+      c->tasks->ghost_in =
           scheduler_addtask(s, task_type_ghost_in, task_subtype_none, 0,
                             /* implicit = */ 1, c, NULL);
-      c->ghost_out =
+      c->tasks->ghost_out =
           scheduler_addtask(s, task_type_ghost_out, task_subtype_none, 0,
                             /* implicit = */ 1, c, NULL);
-      engine_add_ghosts(e, c, c->ghost_in, c->ghost_out);
+      engine_add_ghosts(e, c, c->tasks->ghost_in, c->tasks->ghost_out);
 
 #ifdef EXTRA_HYDRO_LOOP
       /* Generate the extra ghost task. */
-      c->extra_ghost = scheduler_addtask(s, task_type_extra_ghost,
-                                         task_subtype_none, 0, 0, c, NULL);
+      c->tasks->extra_ghost = scheduler_addtask(
+          s, task_type_extra_ghost, task_subtype_none, 0, 0, c, NULL);
 #endif
 
       /* Cooling task */
       if (is_with_cooling) {
-        c->cooling = scheduler_addtask(s, task_type_cooling, task_subtype_none,
-                                       0, 0, c, NULL);
+        c->tasks->cooling = scheduler_addtask(s, task_type_cooling,
+                                              task_subtype_none, 0, 0, c, NULL);
 
-        scheduler_addunlock(s, c->super->end_force, c->cooling);
-        scheduler_addunlock(s, c->cooling, c->super->kick2);
+        scheduler_addunlock(s, c->super->tasks->end_force, c->tasks->cooling);
+        scheduler_addunlock(s, c->tasks->cooling, engine_kick2_task(c->super));
       }
 
       /* add source terms */
       if (is_with_sourceterms) {
-        c->sourceterms = scheduler_addtask(s, task_type_sourceterms,
-                                           task_subtype_none, 0, 0, c, NULL);
+        c->tasks->sourceterms = scheduler_addtask(
+            s, task_type_sourceterms, task_subtype_none, 0, 0, c, NULL);
       }
     }
 
@@ -321,22 +341,22 @@ void engine_make_hierarchical_tasks_gravity(struct engine *e, struct cell *c) {
     /* Local tasks only... */
     if (c->nodeID == e->nodeID) {
 
-      c->drift_gpart = scheduler_addtask(s, task_type_drift_gpart,
-                                         task_subtype_none, 0, 0, c, NULL);
+      c->tasks->drift_gpart = scheduler_addtask(
+          s, task_type_drift_gpart, task_subtype_none, 0, 0, c, NULL);
 
       if (is_self_gravity) {
 
         /* Initialisation of the multipoles */
-        c->init_grav = scheduler_addtask(s, task_type_init_grav,
-                                         task_subtype_none, 0, 0, c, NULL);
+        c->tasks->init_grav = scheduler_addtask(
+            s, task_type_init_grav, task_subtype_none, 0, 0, c, NULL);
 
         /* Gravity non-neighbouring pm calculations */
-        c->grav_long_range = scheduler_addtask(
+        c->tasks->grav_long_range = scheduler_addtask(
             s, task_type_grav_long_range, task_subtype_none, 0, 0, c, NULL);
 
         /* Gravity recursive down-pass */
-        c->grav_down = scheduler_addtask(s, task_type_grav_down,
-                                         task_subtype_none, 0, 0, c, NULL);
+        c->tasks->grav_down = scheduler_addtask(
+            s, task_type_grav_down, task_subtype_none, 0, 0, c, NULL);
 
         /* Implicit tasks for the up and down passes */
         c->init_grav_out = scheduler_addtask(s, task_type_init_grav_out,
@@ -346,18 +366,20 @@ void engine_make_hierarchical_tasks_gravity(struct engine *e, struct cell *c) {
 
         /* Gravity mesh force propagation */
         if (periodic)
-          c->grav_mesh = scheduler_addtask(s, task_type_grav_mesh,
-                                           task_subtype_none, 0, 0, c, NULL);
+          c->tasks->grav_mesh = scheduler_addtask(
+              s, task_type_grav_mesh, task_subtype_none, 0, 0, c, NULL);
 
-        if (periodic) scheduler_addunlock(s, c->drift_gpart, c->grav_mesh);
-        if (periodic) scheduler_addunlock(s, c->grav_mesh, c->grav_down);
-        scheduler_addunlock(s, c->init_grav, c->grav_long_range);
-        scheduler_addunlock(s, c->grav_long_range, c->grav_down);
-        scheduler_addunlock(s, c->grav_down, c->super->end_force);
+        if (periodic)
+          scheduler_addunlock(s, c->tasks->drift_gpart, c->tasks->grav_mesh);
+        if (periodic)
+          scheduler_addunlock(s, c->tasks->grav_mesh, c->tasks->grav_down);
+        scheduler_addunlock(s, c->tasks->init_grav, c->tasks->grav_long_range);
+        scheduler_addunlock(s, c->tasks->grav_long_range, c->tasks->grav_down);
+        scheduler_addunlock(s, c->tasks->grav_down, c->super->tasks->end_force);
 
         /* Link in the implicit tasks */
-        scheduler_addunlock(s, c->init_grav, c->init_grav_out);
-        scheduler_addunlock(s, c->grav_down_in, c->grav_down);
+        scheduler_addunlock(s, c->tasks->init_grav, c->init_grav_out);
+        scheduler_addunlock(s, c->grav_down_in, c->tasks->grav_down);
       }
     }
   }
@@ -1335,34 +1357,34 @@ void engine_addtasks_send_hydro(struct engine *e, struct cell *ci,
 
 #ifdef EXTRA_HYDRO_LOOP
 
-      scheduler_addunlock(s, t_gradient, ci->super->kick2);
+      scheduler_addunlock(s, t_gradient, engine_kick2_task(ci->super));
 
-      scheduler_addunlock(s, ci->super_hydro->extra_ghost, t_gradient);
+      scheduler_addunlock(s, ci->super_hydro->tasks->extra_ghost, t_gradient);
 
       /* The send_rho task should unlock the super_hydro-cell's extra_ghost
        * task. */
-      scheduler_addunlock(s, t_rho, ci->super_hydro->extra_ghost);
+      scheduler_addunlock(s, t_rho, ci->super_hydro->tasks->extra_ghost);
 
       /* The send_rho task depends on the cell's ghost task. */
-      scheduler_addunlock(s, ci->super_hydro->ghost_out, t_rho);
+      scheduler_addunlock(s, ci->super_hydro->tasks->ghost_out, t_rho);
 
       /* The send_xv task should unlock the super_hydro-cell's ghost task. */
-      scheduler_addunlock(s, t_xv, ci->super_hydro->ghost_in);
+      scheduler_addunlock(s, t_xv, ci->super_hydro->tasks->ghost_in);
 
 #else
       /* The send_rho task should unlock the super_hydro-cell's kick task. */
-      scheduler_addunlock(s, t_rho, ci->super->end_force);
+      scheduler_addunlock(s, t_rho, ci->super->tasks->end_force);
 
       /* The send_rho task depends on the cell's ghost task. */
-      scheduler_addunlock(s, ci->super_hydro->ghost_out, t_rho);
+      scheduler_addunlock(s, ci->super_hydro->tasks->ghost_out, t_rho);
 
       /* The send_xv task should unlock the super_hydro-cell's ghost task. */
-      scheduler_addunlock(s, t_xv, ci->super_hydro->ghost_in);
+      scheduler_addunlock(s, t_xv, ci->super_hydro->tasks->ghost_in);
 
 #endif
 
       /* Drift before you send */
-      scheduler_addunlock(s, ci->super_hydro->drift_part, t_xv);
+      scheduler_addunlock(s, ci->super_hydro->tasks->drift_part, t_xv);
     }
 
     /* Add them to the local cell. */
@@ -1417,10 +1439,10 @@ void engine_addtasks_send_gravity(struct engine *e, struct cell *ci,
                                  0, ci, cj);
 
       /* The sends should unlock the down pass. */
-      scheduler_addunlock(s, t_grav, ci->super_gravity->grav_down);
+      scheduler_addunlock(s, t_grav, ci->super_gravity->tasks->grav_down);
 
       /* Drift before you send */
-      scheduler_addunlock(s, ci->super_gravity->drift_gpart, t_grav);
+      scheduler_addunlock(s, ci->super_gravity->tasks->drift_gpart, t_grav);
     }
 
     /* Add them to the local cell. */
@@ -1477,7 +1499,7 @@ void engine_addtasks_send_timestep(struct engine *e, struct cell *ci,
                                ci, cj);
 
       /* The super-cell's timestep task should unlock the send_ti task. */
-      scheduler_addunlock(s, ci->super->timestep, t_ti);
+      scheduler_addunlock(s, ci->super->tasks->timestep, t_ti);
     }
 
     /* Add them to the local cell. */
@@ -1530,7 +1552,8 @@ void engine_addtasks_recv_hydro(struct engine *e, struct cell *c,
   c->recv_gradient = t_gradient;
 
   /* Add dependencies. */
-  if (c->sorts != NULL) scheduler_addunlock(s, t_xv, c->sorts);
+  if (c->tasks != NULL && c->tasks->sorts != NULL)
+    scheduler_addunlock(s, t_xv, c->tasks->sorts);
 
   for (struct link *l = c->density; l != NULL; l = l->next) {
     scheduler_addunlock(s, t_xv, l->t);
@@ -1654,15 +1677,31 @@ void engine_exchange_cells(struct engine *e) {
   MPI_Status status;
   const ticks tic = getticks();
 
+  /* Collect the reasons for which the cells are sent to the other nodes. The
+   * cells only needed for hydro can be sent without their deeper levels. */
+  int *truncate = (int *)malloc(nr_cells * sizeof(int));
+  if (truncate == NULL) error("Failed to allocate the truncation flags.");
+  bzero(truncate, nr_cells * sizeof(int));
+  for (int k = 0; k < nr_proxies; k++)
+    for (int j = 0; j < e->proxies[k].nr_cells_out; j++)
+      truncate[e->proxies[k].cells_out[j] - cells] |=
+          e->proxies[k].cells_out_type[j];
+  for (int k = 0; k < nr_cells; k++)
+    truncate[k] = e->truncate_foreign_trees &&
+                  !(truncate[k] & proxy_cell_type_gravity);
+
   /* Run through the cells and get the size of the ones that will be sent off.
    */
   int count_out = 0;
   for (int k = 0; k < nr_cells; k++) {
     offset[k] = count_out;
     if (cells[k].sendto)
-      count_out += (cells[k].pcell_size = cell_getsize(&cells[k]));
+      count_out +=
+          (cells[k].pcell_size = cell_getsize(&cells[k], truncate[k]));
   }
 
+  if (e->verbose) message("Sending %d packed cells.", count_out);
+
   /* Allocate the pcells. */
   struct pcell *pcells = NULL;
   if (posix_memalign((void **)&pcells, SWIFT_CACHE_ALIGNMENT,
@@ -1673,9 +1712,10 @@ void engine_exchange_cells(struct engine *e) {
   cell_next_tag = 0;
   for (int k = 0; k < nr_cells; k++)
     if (cells[k].sendto) {
-      cell_pack(&cells[k], &pcells[offset[k]]);
+      cell_pack(&cells[k], &pcells[offset[k]], truncate[k]);
       cells[k].pcell = &pcells[offset[k]];
     }
+  free(truncate);
 
   /* Launch the proxies. */
   for (int k = 0; k < nr_proxies; k++) {
@@ -1720,6 +1760,35 @@ void engine_exchange_cells(struct engine *e) {
   if (MPI_Waitall(nr_proxies, reqs_out, MPI_STATUSES_IGNORE) != MPI_SUCCESS)
     error("MPI_Waitall on sends failed.");
 
+  /* Free the pcell buffer. */
+  free(pcells);
+
+  if (e->verbose)
+    message("took %.3f %s.", clocks_from_ticks(getticks() - tic),
+            clocks_getunit());
+
+#else
+  error("SWIFT was not compiled with MPI support.");
+#endif
+}
+
+/**
+ * @brief Allocate the foreign particle buffers and link the foreign cells to
+ * them.
+ *
+ * Cells only exchanged for gravity that are far enough to only ever be used
+ * through their multipoles do not get any #gpart.
+ *
+ * @param e The #engine.
+ */
+void engine_link_foreign_particles(struct engine *e) {
+
+#ifdef WITH_MPI
+
+  struct space *s = e->s;
+  const int nr_proxies = e->nr_proxies;
+  const ticks tic = getticks();
+
   /* Count the number of particles we need to import and re-allocate
      the buffer if needed. */
   size_t count_parts_in = 0, count_gparts_in = 0, count_sparts_in = 0;
@@ -1727,7 +1796,8 @@ void engine_exchange_cells(struct engine *e) {
     for (int j = 0; j < e->proxies[k].nr_cells_in; j++) {
       if (e->proxies[k].cells_in_type[j] & proxy_cell_type_hydro)
         count_parts_in += e->proxies[k].cells_in[j]->count;
-      if (e->proxies[k].cells_in_type[j] & proxy_cell_type_gravity)
+      if ((e->proxies[k].cells_in_type[j] & proxy_cell_type_gravity) &&
+          !(e->proxies[k].cells_in_type[j] & proxy_cell_type_gravity_mpole))
         count_gparts_in += e->proxies[k].cells_in[j]->gcount;
       count_sparts_in += e->proxies[k].cells_in[j]->scount;
     }
@@ -1765,7 +1835,8 @@ void engine_exchange_cells(struct engine *e) {
         parts = &parts[e->proxies[k].cells_in[j]->count];
       }
 
-      if (e->proxies[k].cells_in_type[j] & proxy_cell_type_gravity) {
+      if ((e->proxies[k].cells_in_type[j] & proxy_cell_type_gravity) &&
+          !(e->proxies[k].cells_in_type[j] & proxy_cell_type_gravity_mpole)) {
         cell_link_gparts(e->proxies[k].cells_in[j], gparts);
         gparts = &gparts[e->proxies[k].cells_in[j]->gcount];
       }
@@ -1778,9 +1849,6 @@ void engine_exchange_cells(struct engine *e) {
   s->nr_gparts_foreign = gparts - s->gparts_foreign;
   s->nr_sparts_foreign = sparts - s->sparts_foreign;
 
-  /* Free the pcell buffer. */
-  free(pcells);
-
   if (e->verbose)
     message("took %.3f %s.", clocks_from_ticks(getticks() - tic),
             clocks_getunit());
@@ -2353,6 +2421,210 @@ void engine_exchange_proxy_multipoles(struct engine *e) {
 #endif
 }
 
+#ifdef WITH_MPI
+/**
+ * @brief Could a pair of cells require particle-particle gravity interactions
+ * before the next rebuild?
+ *
+ * Follows the recursion of runner_dopair_recursive_grav() with the sizes of
+ * the multipoles inflated by #engine_mpole_proxy_margin to account for their
+ * growth as the particles drift. If that is not enough, the activation of the
+ * tasks (cell_activate_subcell_grav_tasks()) asks for a rebuild before the
+ * interaction is computed.
+ *
+ * @param e The #engine.
+ * @param ci The first #cell.
+ * @param cj The second #cell.
+ */
+static int engine_gravity_pair_needs_pp(const struct engine *e,
+                                        const struct cell *ci,
+                                        const struct cell *cj) {
+
+  /* Some constants */
+  const int periodic = e->mesh->periodic;
+  const double dim[3] = {e->mesh->dim[0], e->mesh->dim[1], e->mesh->dim[2]};
+  const double theta_crit2 = e->gravity_properties->theta_crit2;
+  const double max_distance = e->mesh->r_cut_max;
+
+  /* Nothing to interact with? */
+  if (ci->gcount == 0 || cj->gcount == 0) return 0;
+
+  /* Recover the multipole information */
+  const struct gravity_tensors *const multi_i = ci->multipole;
+  const struct gravity_tensors *const multi_j = cj->multipole;
+  const double ri_max = engine_mpole_proxy_margin * multi_i->r_max_rebuild;
+  const double rj_max = engine_mpole_proxy_margin * multi_j->r_max_rebuild;
+
+  /* Get the distance between the CoMs */
+  double dx = multi_i->CoM_rebuild[0] - multi_j->CoM_rebuild[0];
+  double dy = multi_i->CoM_rebuild[1] - multi_j->CoM_rebuild[1];
+  double dz = multi_i->CoM_rebuild[2] - multi_j->CoM_rebuild[2];
+
+  /* Apply BC */
+  if (periodic) {
+    dx = nearest(dx, dim[0]);
+    dy = nearest(dy, dim[1]);
+    dz = nearest(dz, dim[2]);
+  }
+  const double r2 = dx * dx + dy * dy + dz * dz;
+
+  /* Beyond the reach of the truncated forces or far enough for M-M? */
+  if (periodic && sqrt(r2) - (ri_max + rj_max) > max_distance) return 0;
+  if (gravity_M2L_accept(ri_max, rj_max, theta_crit2, r2)) return 0;
+
+  /* Two leaves: P-P it is. */
+  if (!ci->split && !cj->split) return 1;
+
+  /* Split the larger of the two cells, if possible, and try again. */
+  if ((ri_max > rj_max && ci->split) || !cj->split) {
+    for (int k = 0; k < 8; k++)
+      if (ci->progeny[k] != NULL &&
+          engine_gravity_pair_needs_pp(e, ci->progeny[k], cj))
+        return 1;
+  } else {
+    for (int k = 0; k < 8; k++)
+      if (cj->progeny[k] != NULL &&
+          engine_gravity_pair_needs_pp(e, ci, cj->progeny[k]))
+        return 1;
+  }
+  return 0;
+}
+
+/**
+ * @brief Data needed to split the gravity cells of a #proxy.
+ */
+struct engine_split_gravity_proxy_data {
+  const struct engine *e;
+  struct proxy *p;
+};
+
+/**
+ * @brief Mapper function to find the incoming gravity cells of a #proxy that
+ * may need particle-particle interactions with our cells.
+ *
+ * The pairs are evaluated with the cell of lowest top-level index first, such
+ * that both nodes take the same decision from the same multipoles.
+ *
+ * @param map_data The incoming cells of the #proxy.
+ * @param num_elements Chunk size.
+ * @param extra_data Pointer to an #engine_split_gravity_proxy_data.
+ */
+static void engine_split_gravity_proxy_mapper(void *map_data, int num_elements,
+                                              void *extra_data) {
+
+  struct engine_split_gravity_proxy_data *data =
+      (struct engine_split_gravity_proxy_data *)extra_data;
+  const struct engine *e = data->e;
+  struct proxy *p = data->p;
+  struct cell **cells_in = (struct cell **)map_data;
+  const int offset = cells_in - p->cells_in;
+
+  for (int j = offset; j < offset + num_elements; j++) {
+
+    if (!(p->cells_in_type[j] & proxy_cell_type_gravity)) continue;
+    const struct cell *cj = p->cells_in[j];
+
+    for (int k = 0; k < p->nr_cells_out; k++) {
+
+      if (!(p->cells_out_type[k] & proxy_cell_type_gravity)) continue;
+      const struct cell *ci = p->cells_out[k];
+
+      const int needs_pp = (ci < cj) ? engine_gravity_pair_needs_pp(e, ci, cj)
+                                     : engine_gravity_pair_needs_pp(e, cj, ci);
+
+      /* Both cells then need to be exchanged with their particles. */
+      if (needs_pp) {
+        p->cells_in_type[j] &= ~proxy_cell_type_gravity_mpole;
+        if (p->cells_out_type[k] & proxy_cell_type_gravity_mpole)
+          atomic_and(&p->cells_out_type[k], ~proxy_cell_type_gravity_mpole);
+      }
+    }
+  }
+}
+
+/**
+ * @brief Flag a foreign cell and all its progenies as multipole-only.
+ *
+ * @param c The foreign #cell.
+ */
+static void engine_set_mpole_only(struct cell *c) {
+
+  c->mpole_only = 1;
+  if (c->split)
+    for (int k = 0; k < 8; k++)
+      if (c->progeny[k] != NULL) engine_set_mpole_only(c->progeny[k]);
+}
+#endif /* WITH_MPI */
+
+/**
+ * @brief Split the gravity cells of the proxies into the ones that need their
+ * particles and the ones far enough to only ever be used via their
+ * multipoles.
+ *
+ * Must be called after the multipoles of the proxies have been exchanged.
+ * The multipole-only cells do not exchange any #gpart in the time-steps that
+ * follow. They only use their multipoles received at the rebuild and drifted
+ * locally, just as the M-M interactions with any other foreign cell.
+ *
+ * @param e The #engine.
+ */
+void engine_split_gravity_proxies(struct engine *e) {
+
+#ifdef WITH_MPI
+
+  const ticks tic = getticks();
+  int count_mpole_in = 0, count_gravity_in = 0;
+
+  for (int pid = 0; pid < e->nr_proxies; pid++) {
+
+    struct proxy *p = &e->proxies[pid];
+
+    /* Forget about the previous split. */
+    for (int k = 0; k < p->nr_cells_in; k++)
+      p->cells_in_type[k] &= ~proxy_cell_type_gravity_mpole;
+    for (int k = 0; k < p->nr_cells_out; k++)
+      p->cells_out_type[k] &= ~proxy_cell_type_gravity_mpole;
+
+    /* Are we exchanging the particles of all the gravity cells? */
+    if (!e->gravity_properties->mpole_only_proxies) continue;
+
+    /* Start by assuming that all the gravity cells are far... */
+    for (int k = 0; k < p->nr_cells_in; k++)
+      if (p->cells_in_type[k] & proxy_cell_type_gravity)
+        p->cells_in_type[k] |= proxy_cell_type_gravity_mpole;
+    for (int k = 0; k < p->nr_cells_out; k++)
+      if (p->cells_out_type[k] & proxy_cell_type_gravity)
+        p->cells_out_type[k] |= proxy_cell_type_gravity_mpole;
+
+    /* ...and find the ones that might need P-P interactions. */
+    struct engine_split_gravity_proxy_data data = {e, p};
+    threadpool_map(&e->threadpool, engine_split_gravity_proxy_mapper,
+                   p->cells_in, p->nr_cells_in, sizeof(struct cell *), 1,
+                   &data);
+
+    /* Flag the foreign cells of which we will only have the multipoles. */
+    for (int k = 0; k < p->nr_cells_in; k++) {
+      if (!(p->cells_in_type[k] & proxy_cell_type_gravity)) continue;
+      count_gravity_in++;
+      if (p->cells_in_type[k] & proxy_cell_type_gravity_mpole) {
+        engine_set_mpole_only(p->cells_in[k]);
+        count_mpole_in++;
+      }
+    }
+  }
+
+  if (e->verbose && e->gravity_properties->mpole_only_proxies)
+    message("%d out of %d foreign gravity cells are multipole-only.",
+            count_mpole_in, count_gravity_in);
+
+  if (e->verbose)
+    message("took %.3f %s.", clocks_from_ticks(getticks() - tic),
+            clocks_getunit());
+#else
+  error("SWIFT was not compiled with MPI support.");
+#endif
+}
+
 /**
  * @brief Constructs the top-level tasks for the short-range gravity
  * and long-range gravity interactions.
@@ -2660,7 +2932,8 @@ void engine_count_and_link_tasks_mapper(void *map_data, int num_elements,
     if (t_type == task_type_sort) {
       for (struct cell *finger = t->ci->parent; finger != NULL;
            finger = finger->parent)
-        if (finger->sorts != NULL) scheduler_addunlock(sched, t, finger->sorts);
+        if (finger->tasks != NULL && finger->tasks->sorts != NULL)
+          scheduler_addunlock(sched, t, finger->tasks->sorts);
     }
 
     /* Link self tasks to cells. */
@@ -2772,7 +3045,7 @@ void engine_link_gravity_tasks(struct engine *e) {
 
       /* drift ---+-> gravity --> grav_down */
       /* init  --/    */
-      scheduler_addunlock(sched, ci->super_gravity->drift_gpart, t);
+      scheduler_addunlock(sched, ci->super_gravity->tasks->drift_gpart, t);
       scheduler_addunlock(sched, ci->init_grav_out, t);
       scheduler_addunlock(sched, t, ci->grav_down_in);
     }
@@ -2785,8 +3058,8 @@ void engine_link_gravity_tasks(struct engine *e) {
 #endif
 
       /* drift -----> gravity --> end_force */
-      scheduler_addunlock(sched, ci->super_gravity->drift_gpart, t);
-      scheduler_addunlock(sched, t, ci->end_force);
+      scheduler_addunlock(sched, ci->super_gravity->tasks->drift_gpart, t);
+      scheduler_addunlock(sched, t, ci->tasks->end_force);
     }
 
     /* Otherwise, pair interaction? */
@@ -2796,7 +3069,7 @@ void engine_link_gravity_tasks(struct engine *e) {
 
         /* drift ---+-> gravity --> grav_down */
         /* init  --/    */
-        scheduler_addunlock(sched, ci->super_gravity->drift_gpart, t);
+        scheduler_addunlock(sched, ci->super_gravity->tasks->drift_gpart, t);
         scheduler_addunlock(sched, ci->init_grav_out, t);
         scheduler_addunlock(sched, t, ci->grav_down_in);
       }
@@ -2805,7 +3078,7 @@ void engine_link_gravity_tasks(struct engine *e) {
         /* drift ---+-> gravity --> grav_down */
         /* init  --/    */
         if (ci->super_gravity != cj->super_gravity) /* Avoid double unlock */
-          scheduler_addunlock(sched, cj->super_gravity->drift_gpart, t);
+          scheduler_addunlock(sched, cj->super_gravity->tasks->drift_gpart, t);
         scheduler_addunlock(sched, cj->init_grav_out, t);
         scheduler_addunlock(sched, t, cj->grav_down_in);
       }
@@ -2819,7 +3092,7 @@ void engine_link_gravity_tasks(struct engine *e) {
 #endif
       /* drift ---+-> gravity --> grav_down */
       /* init  --/    */
-      scheduler_addunlock(sched, ci->super_gravity->drift_gpart, t);
+      scheduler_addunlock(sched, ci->super_gravity->tasks->drift_gpart, t);
       scheduler_addunlock(sched, ci->init_grav_out, t);
       scheduler_addunlock(sched, t, ci->grav_down_in);
     }
@@ -2833,8 +3106,8 @@ void engine_link_gravity_tasks(struct engine *e) {
 #endif
 
       /* drift -----> gravity --> end_force */
-      scheduler_addunlock(sched, ci->super_gravity->drift_gpart, t);
-      scheduler_addunlock(sched, t, ci->end_force);
+      scheduler_addunlock(sched, ci->super_gravity->tasks->drift_gpart, t);
+      scheduler_addunlock(sched, t, ci->tasks->end_force);
     }
 
     /* Otherwise, sub-pair interaction? */
@@ -2844,7 +3117,7 @@ void engine_link_gravity_tasks(struct engine *e) {
 
         /* drift ---+-> gravity --> grav_down */
         /* init  --/    */
-        scheduler_addunlock(sched, ci->super_gravity->drift_gpart, t);
+        scheduler_addunlock(sched, ci->super_gravity->tasks->drift_gpart, t);
         scheduler_addunlock(sched, ci->init_grav_out, t);
         scheduler_addunlock(sched, t, ci->grav_down_in);
       }
@@ -2853,7 +3126,7 @@ void engine_link_gravity_tasks(struct engine *e) {
         /* drift ---+-> gravity --> grav_down */
         /* init  --/    */
         if (ci->super_gravity != cj->super_gravity) /* Avoid double unlock */
-          scheduler_addunlock(sched, cj->super_gravity->drift_gpart, t);
+          scheduler_addunlock(sched, cj->super_gravity->tasks->drift_gpart, t);
         scheduler_addunlock(sched, cj->init_grav_out, t);
         scheduler_addunlock(sched, t, cj->grav_down_in);
       }
@@ -2896,10 +3169,10 @@ static inline void engine_make_hydro_loops_dependencies(
 
   /* density loop --> ghost --> gradient loop --> extra_ghost */
   /* extra_ghost --> force loop  */
-  scheduler_addunlock(sched, density, c->super_hydro->ghost_in);
-  scheduler_addunlock(sched, c->super_hydro->ghost_out, gradient);
-  scheduler_addunlock(sched, gradient, c->super_hydro->extra_ghost);
-  scheduler_addunlock(sched, c->super_hydro->extra_ghost, force);
+  scheduler_addunlock(sched, density, c->super_hydro->tasks->ghost_in);
+  scheduler_addunlock(sched, c->super_hydro->tasks->ghost_out, gradient);
+  scheduler_addunlock(sched, gradient, c->super_hydro->tasks->extra_ghost);
+  scheduler_addunlock(sched, c->super_hydro->tasks->extra_ghost, force);
 }
 
 #else
@@ -2919,8 +3192,8 @@ static inline void engine_make_hydro_loops_dependencies(struct scheduler *sched,
                                                         struct cell *c,
                                                         int with_cooling) {
   /* density loop --> ghost --> force loop */
-  scheduler_addunlock(sched, density, c->super_hydro->ghost_in);
-  scheduler_addunlock(sched, c->super_hydro->ghost_out, force);
+  scheduler_addunlock(sched, density, c->super_hydro->tasks->ghost_in);
+  scheduler_addunlock(sched, c->super_hydro->tasks->ghost_out, force);
 }
 
 #endif
@@ -2941,20 +3214,23 @@ void engine_make_extra_hydroloop_tasks_mapper(void *map_data, int num_elements,
   struct scheduler *sched = &e->sched;
   const int nodeID = e->nodeID;
   const int with_cooling = (e->policy & engine_policy_cooling);
+  const int with_drift_tasks = !e->drift_on_demand;
 
   for (int ind = 0; ind < num_elements; ind++) {
     struct task *t = &((struct task *)map_data)[ind];
 
     /* Sort tasks depend on the drift of the cell. */
     if (t->type == task_type_sort && t->ci->nodeID == engine_rank) {
-      scheduler_addunlock(sched, t->ci->super_hydro->drift_part, t);
+      if (with_drift_tasks)
+        scheduler_addunlock(sched, t->ci->super_hydro->tasks->drift_part, t);
     }
 
     /* Self-interaction? */
     else if (t->type == task_type_self && t->subtype == task_subtype_density) {
 
       /* Make the self-density tasks depend on the drift only. */
-      scheduler_addunlock(sched, t->ci->super_hydro->drift_part, t);
+      if (with_drift_tasks)
+        scheduler_addunlock(sched, t->ci->super_hydro->tasks->drift_part, t);
 
 #ifdef EXTRA_HYDRO_LOOP
       /* Start by constructing the task for the second  and third hydro loop. */
@@ -2970,7 +3246,7 @@ void engine_make_extra_hydroloop_tasks_mapper(void *map_data, int num_elements,
       /* Now, build all the dependencies for the hydro */
       engine_make_hydro_loops_dependencies(sched, t, t2, t3, t->ci,
                                            with_cooling);
-      scheduler_addunlock(sched, t3, t->ci->super->end_force);
+      scheduler_addunlock(sched, t3, t->ci->super->tasks->end_force);
 #else
 
       /* Start by constructing the task for the second hydro loop */
@@ -2982,7 +3258,7 @@ void engine_make_extra_hydroloop_tasks_mapper(void *map_data, int num_elements,
 
       /* Now, build all the dependencies for the hydro */
       engine_make_hydro_loops_dependencies(sched, t, t2, t->ci, with_cooling);
-      scheduler_addunlock(sched, t2, t->ci->super->end_force);
+      scheduler_addunlock(sched, t2, t->ci->super->tasks->end_force);
 #endif
     }
 
@@ -2990,13 +3266,13 @@ void engine_make_extra_hydroloop_tasks_mapper(void *map_data, int num_elements,
     else if (t->type == task_type_pair && t->subtype == task_subtype_density) {
 
       /* Make all density tasks depend on the drift and the sorts. */
-      if (t->ci->nodeID == engine_rank)
-        scheduler_addunlock(sched, t->ci->super_hydro->drift_part, t);
-      scheduler_addunlock(sched, t->ci->super_hydro->sorts, t);
+      if (with_drift_tasks && t->ci->nodeID == engine_rank)
+        scheduler_addunlock(sched, t->ci->super_hydro->tasks->drift_part, t);
+      scheduler_addunlock(sched, t->ci->super_hydro->tasks->sorts, t);
       if (t->ci->super_hydro != t->cj->super_hydro) {
-        if (t->cj->nodeID == engine_rank)
-          scheduler_addunlock(sched, t->cj->super_hydro->drift_part, t);
-        scheduler_addunlock(sched, t->cj->super_hydro->sorts, t);
+        if (with_drift_tasks && t->cj->nodeID == engine_rank)
+          scheduler_addunlock(sched, t->cj->super_hydro->tasks->drift_part, t);
+        scheduler_addunlock(sched, t->cj->super_hydro->tasks->sorts, t);
       }
 
 #ifdef EXTRA_HYDRO_LOOP
@@ -3017,14 +3293,14 @@ void engine_make_extra_hydroloop_tasks_mapper(void *map_data, int num_elements,
       if (t->ci->nodeID == nodeID) {
         engine_make_hydro_loops_dependencies(sched, t, t2, t3, t->ci,
                                              with_cooling);
-        scheduler_addunlock(sched, t3, t->ci->super->end_force);
+        scheduler_addunlock(sched, t3, t->ci->super->tasks->end_force);
       }
       if (t->cj->nodeID == nodeID) {
         if (t->ci->super_hydro != t->cj->super_hydro)
           engine_make_hydro_loops_dependencies(sched, t, t2, t3, t->cj,
                                                with_cooling);
         if (t->ci->super != t->cj->super)
-          scheduler_addunlock(sched, t3, t->cj->super->end_force);
+          scheduler_addunlock(sched, t3, t->cj->super->tasks->end_force);
       }
 
 #else
@@ -3041,14 +3317,14 @@ void engine_make_extra_hydroloop_tasks_mapper(void *map_data, int num_elements,
       /* that are local and are not descendant of the same super_hydro-cells */
       if (t->ci->nodeID == nodeID) {
         engine_make_hydro_loops_dependencies(sched, t, t2, t->ci, with_cooling);
-        scheduler_addunlock(sched, t2, t->ci->super->end_force);
+        scheduler_addunlock(sched, t2, t->ci->super->tasks->end_force);
       }
       if (t->cj->nodeID == nodeID) {
         if (t->ci->super_hydro != t->cj->super_hydro)
           engine_make_hydro_loops_dependencies(sched, t, t2, t->cj,
                                                with_cooling);
         if (t->ci->super != t->cj->super)
-          scheduler_addunlock(sched, t2, t->cj->super->end_force);
+          scheduler_addunlock(sched, t2, t->cj->super->tasks->end_force);
       }
 
 #endif
@@ -3060,8 +3336,9 @@ void engine_make_extra_hydroloop_tasks_mapper(void *map_data, int num_elements,
              t->subtype == task_subtype_density) {
 
       /* Make all density tasks depend on the drift and sorts. */
-      scheduler_addunlock(sched, t->ci->super_hydro->drift_part, t);
-      scheduler_addunlock(sched, t->ci->super_hydro->sorts, t);
+      if (with_drift_tasks)
+        scheduler_addunlock(sched, t->ci->super_hydro->tasks->drift_part, t);
+      scheduler_addunlock(sched, t->ci->super_hydro->tasks->sorts, t);
 
 #ifdef EXTRA_HYDRO_LOOP
 
@@ -3082,7 +3359,7 @@ void engine_make_extra_hydroloop_tasks_mapper(void *map_data, int num_elements,
       if (t->ci->nodeID == nodeID) {
         engine_make_hydro_loops_dependencies(sched, t, t2, t3, t->ci,
                                              with_cooling);
-        scheduler_addunlock(sched, t3, t->ci->super->end_force);
+        scheduler_addunlock(sched, t3, t->ci->super->tasks->end_force);
       }
 
 #else
@@ -3098,7 +3375,7 @@ void engine_make_extra_hydroloop_tasks_mapper(void *map_data, int num_elements,
       /* that are local and are not descendant of the same super_hydro-cells */
       if (t->ci->nodeID == nodeID) {
         engine_make_hydro_loops_dependencies(sched, t, t2, t->ci, with_cooling);
-        scheduler_addunlock(sched, t2, t->ci->super->end_force);
+        scheduler_addunlock(sched, t2, t->ci->super->tasks->end_force);
       }
 #endif
     }
@@ -3108,13 +3385,13 @@ void engine_make_extra_hydroloop_tasks_mapper(void *map_data, int num_elements,
              t->subtype == task_subtype_density) {
 
       /* Make all density tasks depend on the drift. */
-      if (t->ci->nodeID == engine_rank)
-        scheduler_addunlock(sched, t->ci->super_hydro->drift_part, t);
-      scheduler_addunlock(sched, t->ci->super_hydro->sorts, t);
+      if (with_drift_tasks && t->ci->nodeID == engine_rank)
+        scheduler_addunlock(sched, t->ci->super_hydro->tasks->drift_part, t);
+      scheduler_addunlock(sched, t->ci->super_hydro->tasks->sorts, t);
       if (t->ci->super_hydro != t->cj->super_hydro) {
-        if (t->cj->nodeID == engine_rank)
-          scheduler_addunlock(sched, t->cj->super_hydro->drift_part, t);
-        scheduler_addunlock(sched, t->cj->super_hydro->sorts, t);
+        if (with_drift_tasks && t->cj->nodeID == engine_rank)
+          scheduler_addunlock(sched, t->cj->super_hydro->tasks->drift_part, t);
+        scheduler_addunlock(sched, t->cj->super_hydro->tasks->sorts, t);
       }
 
 #ifdef EXTRA_HYDRO_LOOP
@@ -3138,14 +3415,14 @@ void engine_make_extra_hydroloop_tasks_mapper(void *map_data, int num_elements,
       if (t->ci->nodeID == nodeID) {
         engine_make_hydro_loops_dependencies(sched, t, t2, t3, t->ci,
                                              with_cooling);
-        scheduler_addunlock(sched, t3, t->ci->super->end_force);
+        scheduler_addunlock(sched, t3, t->ci->super->tasks->end_force);
       }
       if (t->cj->nodeID == nodeID) {
         if (t->ci->super_hydro != t->cj->super_hydro)
           engine_make_hydro_loops_dependencies(sched, t, t2, t3, t->cj,
                                                with_cooling);
         if (t->ci->super != t->cj->super)
-          scheduler_addunlock(sched, t3, t->cj->super->end_force);
+          scheduler_addunlock(sched, t3, t->cj->super->tasks->end_force);
       }
 
 #else
@@ -3162,14 +3439,14 @@ void engine_make_extra_hydroloop_tasks_mapper(void *map_data, int num_elements,
       /* that are local and are not descendant of the same super_hydro-cells */
       if (t->ci->nodeID == nodeID) {
         engine_make_hydro_loops_dependencies(sched, t, t2, t->ci, with_cooling);
-        scheduler_addunlock(sched, t2, t->ci->super->end_force);
+        scheduler_addunlock(sched, t2, t->ci->super->tasks->end_force);
       }
       if (t->cj->nodeID == nodeID) {
         if (t->ci->super_hydro != t->cj->super_hydro)
           engine_make_hydro_loops_dependencies(sched, t, t2, t->cj,
                                                with_cooling);
         if (t->ci->super != t->cj->super)
-          scheduler_addunlock(sched, t2, t->cj->super->end_force);
+          scheduler_addunlock(sched, t2, t->cj->super->tasks->end_force);
       }
 #endif
     }
@@ -3289,6 +3566,9 @@ void engine_maketasks(struct engine *e) {
     message("Setting super-pointers took %.3f %s.",
             clocks_from_ticks(getticks() - tic2), clocks_getunit());
 
+  /* Hand out the records holding the tasks of the super-cells. */
+  space_make_super_tasks(s, e->verbose);
+
   /* Append hierarchical tasks to each cell. */
   threadpool_map(&e->threadpool, engine_make_hierarchical_tasks_mapper, cells,
                  nr_cells, sizeof(struct cell), 0, e);
@@ -3341,11 +3621,12 @@ void engine_maketasks(struct engine *e) {
             engine_addtasks_recv_hydro(e, p->cells_in[k], NULL, NULL, NULL);
 
       /* Loop through the proxy's incoming cells and add the
-         recv tasks for the cells in the proxy that have a gravity connection.
-         */
+         recv tasks for the cells in the proxy that have a gravity connection
+         requiring their particles. */
       if (e->policy & engine_policy_self_gravity)
         for (int k = 0; k < p->nr_cells_in; k++)
-          if (p->cells_in_type[k] & proxy_cell_type_gravity)
+          if ((p->cells_in_type[k] & proxy_cell_type_gravity) &&
+              !(p->cells_in_type[k] & proxy_cell_type_gravity_mpole))
             engine_addtasks_recv_gravity(e, p->cells_in[k], NULL);
 
       /* Loop through the proxy's outgoing cells and add the
@@ -3357,11 +3638,12 @@ void engine_maketasks(struct engine *e) {
                                        NULL, NULL);
 
       /* Loop through the proxy's outgoing cells and add the
-         send tasks for the cells in the proxy that have a gravity connection.
-         */
+         send tasks for the cells in the proxy that have a gravity connection
+         requiring their particles. */
       if (e->policy & engine_policy_self_gravity)
         for (int k = 0; k < p->nr_cells_out; k++)
-          if (p->cells_out_type[k] & proxy_cell_type_gravity)
+          if ((p->cells_out_type[k] & proxy_cell_type_gravity) &&
+              !(p->cells_out_type[k] & proxy_cell_type_gravity_mpole))
             engine_addtasks_send_gravity(e, p->cells_out[k], p->cells_in[0],
                                          NULL);
     }
@@ -3466,7 +3748,8 @@ void engine_marktasks_mapper(void *map_data, int num_elements,
       else if (t->type == task_type_self && t->subtype == task_subtype_grav) {
         if (cell_is_active_gravity(ci, e)) {
           scheduler_activate(s, t);
-          cell_activate_subcell_grav_tasks(t->ci, NULL, s);
+          if (cell_activate_subcell_grav_tasks(t->ci, NULL, s))
+            *rebuild_space = 1;
         }
       }
 
@@ -3540,7 +3823,8 @@ void engine_marktasks_mapper(void *map_data, int num_elements,
 
         if (t->type == task_type_pair && t->subtype == task_subtype_grav) {
           /* Activate the gravity drift */
-          cell_activate_subcell_grav_tasks(t->ci, t->cj, s);
+          if (cell_activate_subcell_grav_tasks(t->ci, t->cj, s))
+            *rebuild_space = 1;
         }
 
         else if (t->type == task_type_sub_pair &&
@@ -3650,24 +3934,26 @@ void engine_marktasks_mapper(void *map_data, int num_elements,
         /* Activate the send/recv tasks. */
         if (ci->nodeID != engine_rank) {
 
-          /* If the local cell is active, receive data from the foreign cell. */
-          if (cj_active_gravity) {
+          /* If the local cell is active, receive data from the foreign cell,
+             unless we only use its multipoles. */
+          if (cj_active_gravity && !ci->mpole_only) {
             scheduler_activate(s, ci->recv_grav);
           }
 
           /* If the foreign cell is active, we want its ti_end values. */
           if (ci_active_gravity) scheduler_activate(s, ci->recv_ti);
 
-          /* Is the foreign cell active and will need stuff from us? */
+          /* Is the foreign cell active and will need stuff from us? The
+             foreign node may only need our multipoles. */
           if (ci_active_gravity) {
 
             struct link *l =
-                scheduler_activate_send(s, cj->send_grav, ci->nodeID);
+                scheduler_activate_send_if_any(s, cj->send_grav, ci->nodeID);
 
             /* Drift the cell which will be sent at the level at which it is
                sent, i.e. drift the cell specified in the send task (l->t)
                itself. */
-            cell_activate_drift_gpart(l->t->ci, s);
+            if (l != NULL) cell_activate_drift_gpart(l->t->ci, s);
           }
 
           /* If the local cell is active, send its ti_end values. */
@@ -3676,24 +3962,26 @@ void engine_marktasks_mapper(void *map_data, int num_elements,
 
         } else if (cj->nodeID != engine_rank) {
 
-          /* If the local cell is active, receive data from the foreign cell. */
-          if (ci_active_gravity) {
+          /* If the local cell is active, receive data from the foreign cell,
+             unless we only use its multipoles. */
+          if (ci_active_gravity && !cj->mpole_only) {
             scheduler_activate(s, cj->recv_grav);
           }
 
           /* If the foreign cell is active, we want its ti_end values. */
           if (cj_active_gravity) scheduler_activate(s, cj->recv_ti);
 
-          /* Is the foreign cell active and will need stuff from us? */
+          /* Is the foreign cell active and will need stuff from us? The
+             foreign node may only need our multipoles. */
           if (cj_active_gravity) {
 
             struct link *l =
-                scheduler_activate_send(s, ci->send_grav, cj->nodeID);
+                scheduler_activate_send_if_any(s, ci->send_grav, cj->nodeID);
 
             /* Drift the cell which will be sent at the level at which it is
                sent, i.e. drift the cell specified in the send task (l->t)
                itself. */
-            cell_activate_drift_gpart(l->t->ci, s);
+            if (l != NULL) cell_activate_drift_gpart(l->t->ci, s);
           }
 
           /* If the local cell is active, send its ti_end values. */
@@ -3986,6 +4274,10 @@ void engine_rebuild(struct engine *e, int clean_smoothing_length_values) {
 
   if (e->policy & engine_policy_self_gravity)
     engine_exchange_proxy_multipoles(e);
+
+  if (e->policy & engine_policy_self_gravity) engine_split_gravity_proxies(e);
+
+  engine_link_foreign_particles(e);
 #endif
 
   /* Re-build the tasks. */
@@ -4110,9 +4402,10 @@ void engine_collect_end_of_step_recurse(struct cell *c) {
 
 /* Skip super-cells (Their values are already set) */
 #ifdef WITH_MPI
-  if (c->timestep != NULL || c->recv_ti != NULL) return;
+  if ((c->tasks != NULL && c->tasks->timestep != NULL) || c->recv_ti != NULL)
+    return;
 #else
-  if (c->timestep != NULL) return;
+  if (c->tasks != NULL && c->tasks->timestep != NULL) return;
 #endif /* WITH_MPI */
 
   /* Counters for the different quantities. */
@@ -4381,6 +4674,10 @@ void engine_print_stats(struct engine *e) {
   if (e->nodeID == 0)
     stats_print_to_file(e->file_stats, &global_stats, e->time);
 
+  /* Measure the power spectrum along with the statistics? */
+  if (e->power_spectrum_output && e->power_spectrum_with_stats)
+    engine_dump_power_spectrum(e);
+
   /* Flag that we dumped some statistics */
   e->step_props |= engine_step_prop_statistics;
 
@@ -4708,6 +5005,7 @@ void engine_step(struct engine *e) {
   e->tic_step = getticks();
 #endif
 
+  const ticks tic_print = getticks();
   if (e->nodeID == 0) {
 
     /* Print some information to the screen */
@@ -4727,6 +5025,7 @@ void engine_step(struct engine *e) {
               e->s_updates, e->wallclock_time, e->step_props);
     fflush(e->file_timesteps);
   }
+  e->phase_ticks[engine_phase_io] += getticks() - tic_print;
 
   /* We need some cells to exist but not the whole task stuff. */
   if (e->restarting) space_rebuild(e->s, e->verbose);
@@ -4769,6 +5068,7 @@ void engine_step(struct engine *e) {
     e->forcerebuild = 1;
 
   /* Are we drifting everything (a la Gadget/GIZMO) ? */
+  const ticks tic_drift = getticks();
   if (e->policy & engine_policy_drift_all && !e->forcerebuild)
     engine_drift_all(e);
 
@@ -4780,7 +5080,9 @@ void engine_step(struct engine *e) {
     else
       engine_drift_top_multipoles(e);
   }
+  e->phase_ticks[engine_phase_drift] += getticks() - tic_drift;
 
+  const ticks tic_prepare = getticks();
 #ifdef WITH_MPI
   /* Repartition the space amongst the nodes? */
   engine_repartition_trigger(e);
@@ -4788,6 +5090,7 @@ void engine_step(struct engine *e) {
 
   /* Prepare the tasks to be launched, rebuild or repartition if needed. */
   engine_prepare(e);
+  e->phase_ticks[engine_phase_prepare] += getticks() - tic_prepare;
 
   /* Print the number of active tasks ? */
   if (e->verbose) engine_print_task_counts(e);
@@ -4817,7 +5120,9 @@ void engine_step(struct engine *e) {
 
   /* Start all the tasks. */
   TIMER_TIC;
+  const ticks tic_launch = getticks();
   engine_launch(e);
+  e->phase_ticks[engine_phase_tasks] += getticks() - tic_launch;
   TIMER_TOC(timer_runners);
 
 #ifdef SWIFT_GRAVITY_FORCE_CHECKS
@@ -4827,6 +5132,7 @@ void engine_step(struct engine *e) {
 #endif
 
   /* Collect information about the next time-step */
+  const ticks tic_collect = getticks();
   engine_collect_end_of_step(e, 0);
   e->forcerebuild = e->collect_group1.forcerebuild;
 
@@ -4835,15 +5141,28 @@ void engine_step(struct engine *e) {
   e->updates_since_rebuild += e->collect_group1.updates;
   e->g_updates_since_rebuild += e->collect_group1.g_updates;
   e->s_updates_since_rebuild += e->collect_group1.s_updates;
+  e->phase_ticks[engine_phase_collect] += getticks() - tic_collect;
 
   /********************************************************/
   /* OK, we are done with the regular stuff. Time for i/o */
   /********************************************************/
+  const ticks tic_io = getticks();
+
+  /* Write the lightcone crossings of this step. */
+  if (e->lightcone_properties != NULL)
+    lightcone_flush(e->lightcone_properties);
+
+  /* Write the hardware counts of this step. */
+  if (e->hardware_counters) {
+    timers_hw_print(e->step);
+    timers_hw_reset();
+  }
 
   /* Create a restart file if needed. */
   engine_dump_restarts(e, 0, e->restart_onexit && engine_is_done(e));
 
   engine_check_for_dumps(e);
+  e->phase_ticks[engine_phase_io] += getticks() - tic_io;
 
   TIMER_TOC2(timer_step);
 
@@ -4932,8 +5251,8 @@ void engine_check_for_dumps(struct engine *e) {
         if (!(e->policy & engine_policy_cosmology))
           e->time = e->ti_next_snapshot * e->time_base + e->time_begin;
 
-        /* Drift everyone */
-        engine_drift_all(e);
+        /* Drift everyone, unless the snapshot uses drifted copies */
+        if (!e->snapshot_drift_free) engine_drift_all(e);
 
         /* Dump snapshot */
         engine_dump_snapshot(e);
@@ -4946,8 +5265,8 @@ void engine_check_for_dumps(struct engine *e) {
         if (!(e->policy & engine_policy_cosmology))
           e->time = e->ti_next_snapshot * e->time_base + e->time_begin;
 
-        /* Drift everyone */
-        engine_drift_all(e);
+        /* Drift everyone, unless the snapshot uses drifted copies */
+        if (!e->snapshot_drift_free) engine_drift_all(e);
 
         /* Dump snapshot */
         engine_dump_snapshot(e);
@@ -4977,8 +5296,8 @@ void engine_check_for_dumps(struct engine *e) {
       if (!(e->policy & engine_policy_cosmology))
         e->time = e->ti_next_snapshot * e->time_base + e->time_begin;
 
-      /* Drift everyone */
-      engine_drift_all(e);
+      /* Drift everyone, unless the snapshot uses drifted copies */
+      if (!e->snapshot_drift_free) engine_drift_all(e);
 
       /* Dump... */
       engine_dump_snapshot(e);
@@ -5007,16 +5326,38 @@ void engine_check_for_dumps(struct engine *e) {
     /* Perform structure finding? */
     if (run_stf) {
 
+      /* Find the friends-of-friends groups? */
+      if (e->fof_properties != NULL) {
+
+        /* Let's fake that we are at the structure finding time, unless a
+         * later dump already moved us past it */
+        if (e->stf_output_freq_format == TIME &&
+            e->ti_nextSTF > e->ti_current) {
+          e->ti_current = e->ti_nextSTF;
+          e->max_active_bin = 0;
+          if (!(e->policy & engine_policy_cosmology))
+            e->time = e->ti_nextSTF * e->time_base + e->time_begin;
+        }
+
+        /* Drift everyone */
+        engine_drift_all(e);
+
+        /* Find the groups */
+        fof_search_tree(e->fof_properties, e);
+      }
+
     // MATTHIEU: Add a drift_all here. And check the order with the order i/o
     // options.
 
 #ifdef HAVE_VELOCIRAPTOR
-      velociraptor_init(e);
-      velociraptor_invoke(e);
+      if (e->fof_properties == NULL) {
+        velociraptor_init(e);
+        velociraptor_invoke(e);
+      }
+#endif
 
       /* ... and find the next output time */
       if (e->stf_output_freq_format == TIME) engine_compute_next_stf_time(e);
-#endif
     }
 
     /* We need to see whether whether we are in the pathological case
@@ -5032,13 +5373,12 @@ void engine_check_for_dumps(struct engine *e) {
     if (e->ti_end_min > e->ti_next_snapshot && e->ti_next_snapshot > 0)
       dump_snapshot = 1;
 
-    /* Do we want to perform structure finding? */
+    /* Do we want to perform structure finding? (Only once per step if the
+     * outputs are counted in steps) */
     run_stf = 0;
     if ((e->policy & engine_policy_structure_finding)) {
-      if (e->stf_output_freq_format == STEPS && e->step % e->deltaStepSTF == 0)
-        run_stf = 1;
-      else if (e->stf_output_freq_format == TIME &&
-               e->ti_end_min > e->ti_nextSTF && e->ti_nextSTF > 0)
+      if (e->stf_output_freq_format == TIME && e->ti_end_min > e->ti_nextSTF &&
+          e->ti_nextSTF > 0)
         run_stf = 1;
     }
   }
@@ -5307,9 +5647,283 @@ void engine_reconstruct_multipoles(struct engine *e) {
             clocks_getunit());
 }
 
+#ifdef WITH_MPI
+/**
+ * @brief A local top-level cell and a foreign one it needs a proxy for.
+ */
+struct makeproxies_pair {
+
+  /*! The node of the foreign cell. */
+  int nodeID;
+
+  /*! The local and foreign cells. */
+  int cid, cjd;
+
+  /*! Why is the foreign cell needed (hydro, gravity, ...) ? */
+  int type;
+};
+
+/**
+ * @brief Data needed to find the proxies of the local top-level cells.
+ */
+struct makeproxies_data {
+
+  struct engine *e;
+
+  /*! How many top-level cells away we look along each axis. */
+  int delta[3];
+
+  /*! Largest multipole size and distance of a CoM from its cell centre. */
+  double r_max_max, CoM_offset_max;
+
+  /*! The pairs found so far. */
+  struct makeproxies_pair *pairs;
+  size_t nr_pairs, size_pairs;
+
+  swift_lock_type lock;
+};
+
+/**
+ * @brief Can all the pairs of cells at least some distance apart use M2L?
+ *
+ * @param r2 Lower bound on the square of the distance between the cell
+ * centres.
+ * @param offset Upper bound on the sum of the distances between the CoMs
+ * and their cell centre.
+ * @param size Upper bound on the sum of the sizes of the multipoles.
+ * @param theta_crit2 The square of the critical opening angle.
+ */
+__attribute__((always_inline)) INLINE static int engine_makeproxies_far(
+    double r2, double offset, double size, double theta_crit2) {
+
+  const double r = sqrt(r2) - offset;
+
+  /* Keep a margin so this never disagrees with the exact test. */
+  return r > 0. && r * r * theta_crit2 > 1.0001 * size * size;
+}
+
+/**
+ * @brief #threadpool mapper function finding the foreign cells each local
+ * top-level cell needs a proxy for.
+ *
+ * Whole slabs and columns of neighbours are skipped when they are too far
+ * for any hydro or gravity interaction given the sizes of the top-level
+ * multipoles.
+ *
+ * @param map_data Pointer towards the top-level cells.
+ * @param num_elements The number of cells to treat.
+ * @param extra_data The #makeproxies_data.
+ */
+void engine_makeproxies_mapper(void *map_data, int num_elements,
+                               void *extra_data) {
+
+  struct makeproxies_data *data = (struct makeproxies_data *)extra_data;
+  const struct engine *e = data->e;
+  const struct space *s = e->s;
+  const int nodeID = e->nodeID;
+  const int *cdim = s->cdim;
+  const int periodic = s->periodic;
+  const int *delta = data->delta;
+  const struct cell *cells = s->cells_top;
+  const struct cell *cells_map = (struct cell *)map_data;
+
+  /* Get some info about the physics */
+  const double *dim = s->dim;
+  const double *width = s->width;
+  const double theta_crit2 = e->gravity_properties->theta_crit2;
+  const int with_hydro = (e->policy & engine_policy_hydro);
+  const int with_gravity = (e->policy & engine_policy_self_gravity);
+
+  /* The pairs found by this thread. */
+  struct makeproxies_pair *pairs = NULL;
+  size_t nr_pairs = 0, size_pairs = 0;
+
+  for (int l = 0; l < num_elements; l++) {
+
+    /* Only the local cells need proxies. */
+    const int cid = &cells_map[l] - cells;
+    if (cells[cid].nodeID != nodeID) continue;
+
+    /* Get the cell's location in the grid. */
+    const int ind[3] = {cid / (cdim[1] * cdim[2]), (cid / cdim[2]) % cdim[1],
+                        cid % cdim[2]};
+
+    double CoM_i[3] = {0., 0., 0.};
+    double r_max_i = 0., offset = 0., size = 0.;
+
+    if (with_gravity) {
+
+      /* Get ci's multipole */
+      const struct gravity_tensors *multi_i = cells[cid].multipole;
+      CoM_i[0] = multi_i->CoM[0];
+      CoM_i[1] = multi_i->CoM[1];
+      CoM_i[2] = multi_i->CoM[2];
+      r_max_i = multi_i->r_max;
+
+      /* Bounds used to skip the neighbours that are far enough. */
+      double d2 = 0.;
+      for (int k = 0; k < 3; k++) {
+        const double d =
+            CoM_i[k] - (cells[cid].loc[k] + 0.5 * cells[cid].width[k]);
+        d2 += d * d;
+      }
+      offset = sqrt(d2) + data->CoM_offset_max;
+      size = r_max_i + data->r_max_max;
+    }
+
+    /* Loop over all its neighbours (periodic). */
+    for (int i = -delta[0]; i <= delta[0]; i++) {
+      int ii = ind[0] + i;
+      if (ii >= cdim[0])
+        ii -= cdim[0];
+      else if (ii < 0)
+        ii += cdim[0];
+
+      /* Can anything in this slab of neighbours interact with ci? */
+      const int hydro_i = with_hydro && (abs(ind[0] - ii) <= 1 ||
+                                         abs(ind[0] - ii - cdim[0]) <= 1 ||
+                                         abs(ind[0] - ii + cdim[0]) <= 1);
+      int di = abs(ind[0] - ii);
+      if (periodic) di = min(di, cdim[0] - di);
+      const double r2_i = (di * width[0]) * (di * width[0]);
+      if (!hydro_i && (!with_gravity || engine_makeproxies_far(
+                                            r2_i, offset, size, theta_crit2)))
+        continue;
+
+      for (int j = -delta[1]; j <= delta[1]; j++) {
+        int jj = ind[1] + j;
+        if (jj >= cdim[1])
+          jj -= cdim[1];
+        else if (jj < 0)
+          jj += cdim[1];
+
+        /* Same for this column of neighbours. */
+        const int hydro_j = hydro_i && (abs(ind[1] - jj) <= 1 ||
+                                        abs(ind[1] - jj - cdim[1]) <= 1 ||
+                                        abs(ind[1] - jj + cdim[1]) <= 1);
+        int dj = abs(ind[1] - jj);
+        if (periodic) dj = min(dj, cdim[1] - dj);
+        const double r2_j = r2_i + (dj * width[1]) * (dj * width[1]);
+        if (!hydro_j && (!with_gravity || engine_makeproxies_far(
+                                              r2_j, offset, size, theta_crit2)))
+          continue;
+
+        for (int k = -delta[2]; k <= delta[2]; k++) {
+          int kk = ind[2] + k;
+          if (kk >= cdim[2])
+            kk -= cdim[2];
+          else if (kk < 0)
+            kk += cdim[2];
+
+          /* Get the cell ID. */
+          const int cjd = cell_getid(cdim, ii, jj, kk);
+
+          /* Early abort (same cell or same node) */
+          if (cid == cjd || cells[cjd].nodeID == nodeID) continue;
+
+          int proxy_type = 0;
+
+          /* In the hydro case, only care about direct neighbours */
+          if (hydro_j && (abs(ind[2] - kk) <= 1 ||
+                          abs(ind[2] - kk - cdim[2]) <= 1 ||
+                          abs(ind[2] - kk + cdim[2]) <= 1))
+            proxy_type |= (int)proxy_cell_type_hydro;
+
+          /* In the gravity case, check distances using the MAC. */
+          if (with_gravity) {
+
+            /* Get cj's multipole */
+            const struct gravity_tensors *multi_j = cells[cjd].multipole;
+            const double CoM_j[3] = {multi_j->CoM[0], multi_j->CoM[1],
+                                     multi_j->CoM[2]};
+            const double r_max_j = multi_j->r_max;
+
+            /* Let's compute the current distance between the cell pair*/
+            double dx = CoM_i[0] - CoM_j[0];
+            double dy = CoM_i[1] - CoM_j[1];
+            double dz = CoM_i[2] - CoM_j[2];
+
+            /* Apply BC */
+            if (periodic) {
+              dx = nearest(dx, dim[0]);
+              dy = nearest(dy, dim[1]);
+              dz = nearest(dz, dim[2]);
+            }
+            const double r2 = dx * dx + dy * dy + dz * dz;
+
+            /* Are we too close for M2L? */
+            if (!gravity_M2L_accept(r_max_i, r_max_j, theta_crit2, r2))
+              proxy_type |= (int)proxy_cell_type_gravity;
+          }
+
+          /* Abort if not in range at all */
+          if (proxy_type == proxy_cell_type_none) continue;
+
+          /* Record the pair. */
+          if (nr_pairs == size_pairs) {
+            size_pairs = size_pairs > 0 ? 2 * size_pairs : 256;
+            struct makeproxies_pair *temp = (struct makeproxies_pair *)realloc(
+                pairs, sizeof(struct makeproxies_pair) * size_pairs);
+            if (temp == NULL) error("Failed to allocate the proxy pairs.");
+            pairs = temp;
+          }
+          pairs[nr_pairs].nodeID = cells[cjd].nodeID;
+          pairs[nr_pairs].cid = cid;
+          pairs[nr_pairs].cjd = cjd;
+          pairs[nr_pairs].type = proxy_type;
+          nr_pairs++;
+        }
+      }
+    }
+  }
+
+  /* Add the pairs to the global list. */
+  if (nr_pairs > 0) {
+    lock_lock(&data->lock);
+    if (data->nr_pairs + nr_pairs > data->size_pairs) {
+      while (data->nr_pairs + nr_pairs > data->size_pairs)
+        data->size_pairs = data->size_pairs > 0 ? 2 * data->size_pairs : 1024;
+      struct makeproxies_pair *temp = (struct makeproxies_pair *)realloc(
+          data->pairs, sizeof(struct makeproxies_pair) * data->size_pairs);
+      if (temp == NULL) error("Failed to allocate the proxy pairs.");
+      data->pairs = temp;
+    }
+    memcpy(&data->pairs[data->nr_pairs], pairs,
+           sizeof(struct makeproxies_pair) * nr_pairs);
+    data->nr_pairs += nr_pairs;
+    if (lock_unlock(&data->lock) != 0) error("Failed to unlock the pairs.");
+  }
+  free(pairs);
+}
+
+/**
+ * @brief Sort the proxy pairs by node and foreign cell.
+ */
+static int engine_makeproxies_cmp_in(const void *a, const void *b) {
+  const struct makeproxies_pair *pa = (const struct makeproxies_pair *)a;
+  const struct makeproxies_pair *pb = (const struct makeproxies_pair *)b;
+  if (pa->nodeID != pb->nodeID) return pa->nodeID < pb->nodeID ? -1 : 1;
+  return pa->cjd < pb->cjd ? -1 : (pa->cjd > pb->cjd);
+}
+
+/**
+ * @brief Sort the proxy pairs by node and local cell.
+ */
+static int engine_makeproxies_cmp_out(const void *a, const void *b) {
+  const struct makeproxies_pair *pa = (const struct makeproxies_pair *)a;
+  const struct makeproxies_pair *pb = (const struct makeproxies_pair *)b;
+  if (pa->nodeID != pb->nodeID) return pa->nodeID < pb->nodeID ? -1 : 1;
+  return pa->cid < pb->cid ? -1 : (pa->cid > pb->cid);
+}
+#endif /* WITH_MPI */
+
 /**
  * @brief Create and fill the proxies.
  *
+ * Only the local cells are visited, in parallel. The cells of each proxy are
+ * then stored in order of cell index, such that the incoming list of a proxy
+ * matches the outgoing list of its counterpart on the other node.
+ *
  * @param e The #engine.
  */
 void engine_makeproxies(struct engine *e) {
@@ -5318,13 +5932,9 @@ void engine_makeproxies(struct engine *e) {
   const int nodeID = e->nodeID;
   const struct space *s = e->s;
   const int *cdim = s->cdim;
-  const int periodic = s->periodic;
 
   /* Get some info about the physics */
-  const double *dim = s->dim;
   const struct gravity_props *props = e->gravity_properties;
-  const double theta_crit2 = props->theta_crit2;
-  const int with_hydro = (e->policy & engine_policy_hydro);
   const int with_gravity = (e->policy & engine_policy_self_gravity);
 
   /* Handle on the cells and proxies */
@@ -5352,171 +5962,105 @@ void engine_makeproxies(struct engine *e) {
   if (e->verbose)
     message("Looking for proxies up to %d top-level cells away", delta);
 
-  /* Loop over each cell in the space. */
-  int ind[3];
-  for (ind[0] = 0; ind[0] < cdim[0]; ind[0]++) {
-    for (ind[1] = 0; ind[1] < cdim[1]; ind[1]++) {
-      for (ind[2] = 0; ind[2] < cdim[2]; ind[2]++) {
+  struct makeproxies_data data;
+  data.e = e;
+  data.pairs = NULL;
+  data.nr_pairs = 0;
+  data.size_pairs = 0;
+  lock_init(&data.lock);
 
-        /* Get the cell ID. */
-        const int cid = cell_getid(cdim, ind[0], ind[1], ind[2]);
+  /* Going further than half the box would only visit the same cells again. */
+  for (int k = 0; k < 3; k++) data.delta[k] = min(delta, cdim[k] / 2);
 
-        double CoM_i[3] = {0., 0., 0.};
-        double r_max_i = 0.;
+  /* Get the bounds on the multipoles used to skip the far neighbours. */
+  data.r_max_max = 0.;
+  data.CoM_offset_max = 0.;
+  if (with_gravity) {
+    for (int cid = 0; cid < s->nr_cells; cid++) {
+      const struct gravity_tensors *multi = cells[cid].multipole;
+      double d2 = 0.;
+      for (int k = 0; k < 3; k++) {
+        const double d =
+            multi->CoM[k] - (cells[cid].loc[k] + 0.5 * cells[cid].width[k]);
+        d2 += d * d;
+      }
+      data.r_max_max = max(data.r_max_max, multi->r_max);
+      data.CoM_offset_max = max(data.CoM_offset_max, sqrt(d2));
+    }
+  }
+
+  /* Find the pairs of local and foreign cells needing a proxy. */
+  threadpool_map(&e->threadpool, engine_makeproxies_mapper, cells,
+                 s->nr_cells, sizeof(struct cell), 0, &data);
+
+  /* Buffers for the cell lists of one proxy. */
+  struct cell **cell_list = NULL;
+  int *type_list = NULL;
+  if (data.nr_pairs > 0 &&
+      ((cell_list = (struct cell **)malloc(sizeof(struct cell *) *
+                                           data.nr_pairs)) == NULL ||
+       (type_list = (int *)malloc(sizeof(int) * data.nr_pairs)) == NULL))
+    error("Failed to allocate the proxy cell lists.");
+
+  /* Create the proxies and fill their incoming cells, in order. */
+  qsort(data.pairs, data.nr_pairs, sizeof(struct makeproxies_pair),
+        engine_makeproxies_cmp_in);
+  for (size_t k = 0; k < data.nr_pairs;) {
+    const int node = data.pairs[k].nodeID;
+
+    /* Ok, start a new proxy for this pair of nodes */
+    if (e->nr_proxies == engine_maxproxies)
+      error("Maximum number of proxies exceeded.");
+    proxy_init(&proxies[e->nr_proxies], nodeID, node);
+    e->proxy_ind[node] = e->nr_proxies;
+    const int pid = e->nr_proxies;
+    e->nr_proxies += 1;
+
+    /* Collect its cells, merging the types of the repeated ones. */
+    int count = 0;
+    for (; k < data.nr_pairs && data.pairs[k].nodeID == node; k++) {
+      struct cell *c = &cells[data.pairs[k].cjd];
+      if (count > 0 && cell_list[count - 1] == c) {
+        type_list[count - 1] |= data.pairs[k].type;
+      } else {
+        cell_list[count] = c;
+        type_list[count] = data.pairs[k].type;
+        count++;
+      }
+    }
+    proxy_addcells_in(&proxies[pid], cell_list, type_list, count);
+  }
 
-        if (with_gravity) {
+  /* Same for the outgoing cells. */
+  qsort(data.pairs, data.nr_pairs, sizeof(struct makeproxies_pair),
+        engine_makeproxies_cmp_out);
+  for (size_t k = 0; k < data.nr_pairs;) {
+    const int node = data.pairs[k].nodeID;
+    const int pid = e->proxy_ind[node];
 
-          /* Get ci's multipole */
-          const struct gravity_tensors *multi_i = cells[cid].multipole;
-          CoM_i[0] = multi_i->CoM[0];
-          CoM_i[1] = multi_i->CoM[1];
-          CoM_i[2] = multi_i->CoM[2];
-          r_max_i = multi_i->r_max;
-        }
+    int count = 0;
+    for (; k < data.nr_pairs && data.pairs[k].nodeID == node; k++) {
+      struct cell *c = &cells[data.pairs[k].cid];
+      if (count > 0 && cell_list[count - 1] == c) {
+        type_list[count - 1] |= data.pairs[k].type;
+      } else {
+        cell_list[count] = c;
+        type_list[count] = data.pairs[k].type;
+        count++;
 
-        /* Loop over all its neighbours (periodic). */
-        for (int i = -delta; i <= delta; i++) {
-          int ii = ind[0] + i;
-          if (ii >= cdim[0])
-            ii -= cdim[0];
-          else if (ii < 0)
-            ii += cdim[0];
-          for (int j = -delta; j <= delta; j++) {
-            int jj = ind[1] + j;
-            if (jj >= cdim[1])
-              jj -= cdim[1];
-            else if (jj < 0)
-              jj += cdim[1];
-            for (int k = -delta; k <= delta; k++) {
-              int kk = ind[2] + k;
-              if (kk >= cdim[2])
-                kk -= cdim[2];
-              else if (kk < 0)
-                kk += cdim[2];
-
-              /* Get the cell ID. */
-              const int cjd = cell_getid(cdim, ii, jj, kk);
-
-              /* Early abort (same cell) */
-              if (cid == cjd) continue;
-
-              /* Early abort (both same node) */
-              if (cells[cid].nodeID == nodeID && cells[cjd].nodeID == nodeID)
-                continue;
-
-              /* Early abort (both foreign node) */
-              if (cells[cid].nodeID != nodeID && cells[cjd].nodeID != nodeID)
-                continue;
-
-              int proxy_type = 0;
-
-              /* In the hydro case, only care about neighbours */
-              if (with_hydro) {
-
-                /* This is super-ugly but checks for direct neighbours */
-                /* with periodic BC */
-                if (((abs(ind[0] - ii) <= 1 ||
-                      abs(ind[0] - ii - cdim[0]) <= 1 ||
-                      abs(ind[0] - ii + cdim[0]) <= 1) &&
-                     (abs(ind[1] - jj) <= 1 ||
-                      abs(ind[1] - jj - cdim[1]) <= 1 ||
-                      abs(ind[1] - jj + cdim[1]) <= 1) &&
-                     (abs(ind[2] - kk) <= 1 ||
-                      abs(ind[2] - kk - cdim[2]) <= 1 ||
-                      abs(ind[2] - kk + cdim[2]) <= 1)))
-                  proxy_type |= (int)proxy_cell_type_hydro;
-              }
-
-              /* In the gravity case, check distances using the MAC. */
-              if (with_gravity) {
-
-                /* Get cj's multipole */
-                const struct gravity_tensors *multi_j = cells[cjd].multipole;
-                const double CoM_j[3] = {multi_j->CoM[0], multi_j->CoM[1],
-                                         multi_j->CoM[2]};
-                const double r_max_j = multi_j->r_max;
-
-                /* Let's compute the current distance between the cell pair*/
-                double dx = CoM_i[0] - CoM_j[0];
-                double dy = CoM_i[1] - CoM_j[1];
-                double dz = CoM_i[2] - CoM_j[2];
-
-                /* Apply BC */
-                if (periodic) {
-                  dx = nearest(dx, dim[0]);
-                  dy = nearest(dy, dim[1]);
-                  dz = nearest(dz, dim[2]);
-                }
-                const double r2 = dx * dx + dy * dy + dz * dz;
-
-                /* Are we too close for M2L? */
-                if (!gravity_M2L_accept(r_max_i, r_max_j, theta_crit2, r2))
-                  proxy_type |= (int)proxy_cell_type_gravity;
-              }
-
-              /* Abort if not in range at all */
-              if (proxy_type == proxy_cell_type_none) continue;
-
-              /* Add to proxies? */
-              if (cells[cid].nodeID == nodeID && cells[cjd].nodeID != nodeID) {
-
-                /* Do we already have a relationship with this node? */
-                int pid = e->proxy_ind[cells[cjd].nodeID];
-                if (pid < 0) {
-                  if (e->nr_proxies == engine_maxproxies)
-                    error("Maximum number of proxies exceeded.");
-
-                  /* Ok, start a new proxy for this pair of nodes */
-                  proxy_init(&proxies[e->nr_proxies], e->nodeID,
-                             cells[cjd].nodeID);
-
-                  /* Store the information */
-                  e->proxy_ind[cells[cjd].nodeID] = e->nr_proxies;
-                  pid = e->nr_proxies;
-                  e->nr_proxies += 1;
-                }
-
-                /* Add the cell to the proxy */
-                proxy_addcell_in(&proxies[pid], &cells[cjd], proxy_type);
-                proxy_addcell_out(&proxies[pid], &cells[cid], proxy_type);
-
-                /* Store info about where to send the cell */
-                cells[cid].sendto |= (1ULL << pid);
-              }
-
-              /* Same for the symmetric case? */
-              if (cells[cjd].nodeID == nodeID && cells[cid].nodeID != nodeID) {
-
-                /* Do we already have a relationship with this node? */
-                int pid = e->proxy_ind[cells[cid].nodeID];
-                if (pid < 0) {
-                  if (e->nr_proxies == engine_maxproxies)
-                    error("Maximum number of proxies exceeded.");
-
-                  /* Ok, start a new proxy for this pair of nodes */
-                  proxy_init(&proxies[e->nr_proxies], e->nodeID,
-                             cells[cid].nodeID);
-
-                  /* Store the information */
-                  e->proxy_ind[cells[cid].nodeID] = e->nr_proxies;
-                  pid = e->nr_proxies;
-                  e->nr_proxies += 1;
-                }
-
-                /* Add the cell to the proxy */
-                proxy_addcell_in(&proxies[pid], &cells[cid], proxy_type);
-                proxy_addcell_out(&proxies[pid], &cells[cjd], proxy_type);
-
-                /* Store info about where to send the cell */
-                cells[cjd].sendto |= (1ULL << pid);
-              }
-            }
-          }
-        }
+        /* Store info about where to send the cell */
+        c->sendto |= (1ULL << pid);
       }
     }
+    proxy_addcells_out(&proxies[pid], cell_list, type_list, count);
   }
 
+  /* Clean up. */
+  free(cell_list);
+  free(type_list);
+  free(data.pairs);
+  if (lock_destroy(&data.lock) != 0) error("Failed to destroy lock.");
+
   /* Be clear about the time */
   if (e->verbose)
     message("took %.3f %s.", clocks_from_ticks(getticks() - tic),
@@ -5620,6 +6164,96 @@ void engine_split(struct engine *e, struct partition *initial_partition) {
 #endif
 }
 
+/**
+ * @brief Data needed to build the drifted copies of the particles.
+ */
+struct output_copy_data {
+  const struct engine *e;
+  struct part *parts;
+  struct xpart *xparts;
+  struct gpart *gparts;
+  struct spart *sparts;
+};
+
+/**
+ * @brief #threadpool mapper function to copy and drift the particles of the
+ * local top-level cells.
+ *
+ * @param map_data Pointer towards the top-level cells.
+ * @param num_elements The number of cells to treat.
+ * @param extra_data The #output_copy_data.
+ */
+void engine_make_output_copies_mapper(void *map_data, int num_elements,
+                                      void *extra_data) {
+
+  const struct output_copy_data *data =
+      (const struct output_copy_data *)extra_data;
+  const struct engine *e = data->e;
+  const struct cell *cells = (const struct cell *)map_data;
+
+  for (int ind = 0; ind < num_elements; ind++) {
+    const struct cell *c = &cells[ind];
+    if (c->nodeID == e->nodeID)
+      cell_drift_output_copy(c, e, data->parts, data->xparts, data->gparts,
+                             data->sparts);
+  }
+}
+
+/**
+ * @brief Replace the particles of the #space by copies drifted to the
+ * current time, such that a snapshot can be written without drifting the
+ * particles themselves.
+ *
+ * The copies hold all the local particles at once, so the memory used by
+ * the particles is doubled until they are freed. The caller is responsible
+ * for freeing the copies and restoring the original arrays.
+ *
+ * @param e The #engine.
+ */
+void engine_make_output_copies(struct engine *e) {
+
+  const ticks tic = getticks();
+  struct space *s = e->s;
+
+  struct output_copy_data data;
+  data.e = e;
+  data.parts = NULL;
+  data.xparts = NULL;
+  data.gparts = NULL;
+  data.sparts = NULL;
+  if ((s->nr_parts > 0 &&
+       (posix_memalign((void **)&data.parts, part_align,
+                       sizeof(struct part) * s->nr_parts) != 0 ||
+        posix_memalign((void **)&data.xparts, xpart_align,
+                       sizeof(struct xpart) * s->nr_parts) != 0)) ||
+      (s->nr_gparts > 0 &&
+       posix_memalign((void **)&data.gparts, gpart_align,
+                      sizeof(struct gpart) * s->nr_gparts) != 0) ||
+      (s->nr_sparts > 0 &&
+       posix_memalign((void **)&data.sparts, spart_align,
+                      sizeof(struct spart) * s->nr_sparts) != 0))
+    error("Failed to allocate the particle copies for the snapshot.");
+
+  /* Copy and drift all the particles of the local cells. */
+  threadpool_map(&e->threadpool, engine_make_output_copies_mapper,
+                 s->cells_top, s->nr_cells, sizeof(struct cell), 0, &data);
+
+  /* Make the copies point to each other. */
+  if (s->nr_gparts > 0) {
+    part_relink_parts_to_gparts(data.gparts, s->nr_gparts, data.parts);
+    part_relink_sparts_to_gparts(data.gparts, s->nr_gparts, data.sparts);
+  }
+
+  s->parts = data.parts;
+  s->xparts = data.xparts;
+  s->gparts = data.gparts;
+  s->sparts = data.sparts;
+
+  if (e->verbose)
+    message("took %.3f %s.", clocks_from_ticks(getticks() - tic),
+            clocks_getunit());
+}
+
 /**
  * @brief Writes a snapshot with the current state of the engine
  *
@@ -5634,8 +6268,9 @@ void engine_dump_snapshot(struct engine *e) {
   /* Check that all cells have been drifted to the current time.
    * That can include cells that have not
    * previously been active on this rank. */
-  space_check_drift_point(e->s, e->ti_current,
-                          e->policy & engine_policy_self_gravity);
+  if (!e->snapshot_drift_free)
+    space_check_drift_point(e->s, e->ti_current,
+                            e->policy & engine_policy_self_gravity);
 
   /* Be verbose about this */
   if (e->nodeID == 0) {
@@ -5657,6 +6292,14 @@ void engine_dump_snapshot(struct engine *e) {
   }
 #endif
 
+  /* Write drifted copies of the particles rather than the particles? */
+  struct space *s = e->s;
+  struct part *parts = s->parts;
+  struct xpart *xparts = s->xparts;
+  struct gpart *gparts = s->gparts;
+  struct spart *sparts = s->sparts;
+  if (e->snapshot_drift_free) engine_make_output_copies(e);
+
 /* Dump... */
 #if defined(HAVE_HDF5)
 #if defined(WITH_MPI)
@@ -5675,6 +6318,22 @@ void engine_dump_snapshot(struct engine *e) {
 #endif
 #endif
 
+  /* Measure the power spectrum along with the snapshot? */
+  if (e->power_spectrum_output && !e->power_spectrum_with_stats)
+    engine_dump_power_spectrum(e);
+
+  /* Put the particles back. */
+  if (e->snapshot_drift_free) {
+    free(s->parts);
+    free(s->xparts);
+    free(s->gparts);
+    free(s->sparts);
+    s->parts = parts;
+    s->xparts = xparts;
+    s->gparts = gparts;
+    s->sparts = sparts;
+  }
+
   /* Flag that we dumped a snapshot */
   e->step_props |= engine_step_prop_snapshot;
 
@@ -5684,6 +6343,28 @@ void engine_dump_snapshot(struct engine *e) {
             (float)clocks_diff(&time1, &time2), clocks_getunit());
 }
 
+/**
+ * @brief Writes the matter power spectrum measured on the gravity mesh.
+ *
+ * @param e The #engine.
+ */
+void engine_dump_power_spectrum(struct engine *e) {
+
+  const double time =
+      (e->policy & engine_policy_cosmology)
+          ? exp(e->ti_current * e->time_base) * e->cosmology->a_begin
+          : e->ti_current * e->time_base + e->time_begin;
+
+  char file_name[PARSER_MAX_LINE_SIZE + 32];
+  sprintf(file_name, "%s_%04d.txt", e->power_spectrum_base_name,
+          e->power_spectrum_output_count);
+
+  pm_mesh_compute_power_spectrum(e->mesh, e->s, e->power_spectrum_fold,
+                                 file_name, time, e->nodeID, e->verbose);
+
+  e->power_spectrum_output_count++;
+}
+
 #ifdef HAVE_SETAFFINITY
 /**
  * @brief Returns the initial affinity the main thread is using.
@@ -5817,9 +6498,21 @@ void engine_init(struct engine *e, struct space *s, struct swift_params *params,
     error("Snapshots:label_first must be zero or positive");
   e->snapshot_label_delta =
       parser_get_opt_param_int(params, "Snapshots:label_delta", 1);
+  e->snapshot_drift_free =
+      parser_get_opt_param_int(params, "Snapshots:drift_free", 0);
   e->snapshot_units = (struct unit_system *)malloc(sizeof(struct unit_system));
   units_init_default(e->snapshot_units, params, "Snapshots", internal_units);
   e->snapshot_output_count = 0;
+  e->power_spectrum_output =
+      parser_get_opt_param_int(params, "PowerSpectrum:enable", 0);
+  e->power_spectrum_with_stats =
+      parser_get_opt_param_int(params, "PowerSpectrum:with_statistics", 0);
+  e->power_spectrum_fold =
+      parser_get_opt_param_int(params, "PowerSpectrum:fold_factor", 0);
+  parser_get_opt_param_string(params, "PowerSpectrum:basename",
+                              e->power_spectrum_base_name, "power_spectrum");
+  e->power_spectrum_output_count = 0;
+  e->fof_output_count = 0;
   e->dt_min = parser_get_param_double(params, "TimeIntegration:dt_min");
   e->dt_max = parser_get_param_double(params, "TimeIntegration:dt_max");
   e->dt_max_RMS_displacement = FLT_MAX;
@@ -6362,6 +7055,73 @@ void engine_config(int restart, struct engine *e, struct swift_params *params,
    */
   e->tasks_per_cell =
       parser_get_opt_param_int(params, "Scheduler:tasks_per_cell", 0);
+
+  /* Do we drift the #part in the tasks that first use them instead of
+   * running separate drift tasks? The send tasks need the drift to be a task
+   * of its own, so this is a single-node option. */
+  e->drift_on_demand = parser_get_opt_param_int(
+      params, "Scheduler:drift_on_demand", engine_drift_on_demand_default);
+  if (e->drift_on_demand && e->nr_nodes > 1)
+    error("Scheduler:drift_on_demand cannot be used with more than one node.");
+  if (e->drift_on_demand && e->nodeID == 0)
+    message("Drifting the particles on demand in the hydro tasks.");
+
+  /* Do we only send the foreign cells down to the depth used by the tasks? */
+  e->truncate_foreign_trees =
+      parser_get_opt_param_int(params, "Scheduler:truncate_foreign_trees",
+                               engine_truncate_foreign_trees_default);
+  if (e->truncate_foreign_trees && e->nodeID == 0)
+    message("Truncating the trees of the cells sent for hydro.");
+
+  /* Do we run the second half-kick, the time-step calculation and the next
+   * first half-kick as a single task? */
+  e->fused_end_of_step = parser_get_opt_param_int(
+      params, "Scheduler:fused_end_of_step", engine_fused_end_of_step_default);
+  if (e->fused_end_of_step && e->nodeID == 0)
+    message("Fusing the kicks into the time-step tasks.");
+
+  /* Do we write the particles crossing the past lightcone? */
+  e->lightcone_properties = NULL;
+  if (parser_get_opt_param_int(params, "Lightcone:enable", 0)) {
+    e->lightcone_properties =
+        (struct lightcone_props *)malloc(sizeof(struct lightcone_props));
+    if (e->lightcone_properties == NULL)
+      error("Failed to allocate the lightcone properties.");
+    lightcone_init(e->lightcone_properties, params, e->s, e->nodeID,
+                   e->nr_threads, restart, e->nodeID == 0);
+  }
+
+  /* The power spectrum is measured on the long-range gravity mesh */
+  if (e->power_spectrum_output) {
+    if (!(e->policy & engine_policy_self_gravity) || !e->s->periodic)
+      error("The power spectrum requires periodic self-gravity.");
+    if (e->power_spectrum_fold < 0)
+      error("PowerSpectrum:fold_factor must be zero or positive.");
+    if (e->nodeID == 0)
+      message("Measuring the power spectrum with the %s.",
+              e->power_spectrum_with_stats ? "statistics" : "snapshots");
+  }
+
+  /* Do we find the friends-of-friends groups at the structure finding
+   * times? This is the default without VELOCIraptor. */
+  e->fof_properties = NULL;
+#ifdef HAVE_VELOCIRAPTOR
+  const int with_fof =
+      parser_get_opt_param_int(params, "StructureFinding:fof", 0);
+#else
+  const int with_fof =
+      parser_get_opt_param_int(params, "StructureFinding:fof", 1);
+#endif
+  if ((e->policy & engine_policy_structure_finding) && with_fof) {
+    e->fof_properties = (struct fof_props *)malloc(sizeof(struct fof_props));
+    if (e->fof_properties == NULL)
+      error("Failed to allocate the FoF properties.");
+    fof_init(e->fof_properties, params);
+    if (e->nodeID == 0)
+      message("Finding the friends-of-friends groups at the structure finding "
+              "times.");
+  }
+
   int maxtasks = 0;
   if (restart)
     maxtasks = e->restart_max_tasks;
@@ -6378,6 +7138,22 @@ void engine_config(int restart, struct engine *e, struct swift_params *params,
    */
   e->sched.mpi_message_limit =
       parser_get_opt_param_int(params, "Scheduler:mpi_message_limit", 4) * 1024;
+  e->sched.mpi_compression_limit =
+      parser_get_opt_param_int(params, "Scheduler:mpi_compression_limit", 0) *
+      1024;
+
+  /* Do we count the cycles, instructions and cache misses of each type of
+   * task? (Needs to be known before the runners start) */
+  e->hardware_counters = parser_get_opt_param_int(
+      params, "Scheduler:hardware_counters", engine_hardware_counters_default);
+  if (e->hardware_counters) {
+#ifndef HAVE_LINUX_PERF_EVENT_H
+    error("SWIFT was not compiled with support for the hardware counters.");
+#endif
+    timers_hw_open_file(e->nodeID);
+    if (e->nodeID == 0)
+      message("Writing the hardware counters of each type of task.");
+  }
 
   /* Allocate and init the threads. */
   if (posix_memalign((void **)&e->runners, SWIFT_CACHE_ALIGNMENT,
@@ -6433,6 +7209,11 @@ void engine_config(int restart, struct engine *e, struct swift_params *params,
     cache_init(&e->runners[k].cj_cache, CACHE_SIZE);
 #endif
 
+    /* No kick intervals computed yet. */
+    for (int i = 0; i < 2; i++)
+      for (int bin = 0; bin <= num_time_bins; bin++)
+        e->runners[k].kick_factors[i][bin].ti_current = -1;
+
     if (verbose) {
       if (with_aff)
         message("runner %i on cpuid=%i with qid=%i.", e->runners[k].id,
@@ -6863,6 +7644,12 @@ void engine_clean(struct engine *e) {
     output_list_clean(e->output_list_stf);
     free(e->output_list_stf);
   }
+  if (e->lightcone_properties != NULL) {
+    lightcone_clean(e->lightcone_properties);
+    free(e->lightcone_properties);
+  }
+  free(e->fof_properties);
+  if (e->hardware_counters) timers_hw_close_file();
   free(e->links);
   free(e->cell_loc);
   scheduler_clean(&e->sched);
@@ -38,7 +38,9 @@
 #include "clocks.h"
 #include "collectgroup.h"
 #include "cooling_struct.h"
+#include "fof.h"
 #include "gravity_properties.h"
+#include "lightcone.h"
 #include "mesh_gravity.h"
 #include "parser.h"
 #include "partition.h"
@@ -89,14 +91,32 @@ enum engine_step_properties {
   engine_step_prop_restarts = (1 << 5)
 };
 
+/**
+ * @brief The phases of a time-step timed by engine_step().
+ */
+enum engine_step_phase {
+  engine_phase_drift = 0,
+  engine_phase_prepare,
+  engine_phase_tasks,
+  engine_phase_collect,
+  engine_phase_io,
+  engine_phase_count
+};
+extern const char *engine_phase_names[];
+
 /* Some constants */
 #define engine_maxproxies 64
 #define engine_tasksreweight 1
 #define engine_parts_size_grow 1.05
 #define engine_redistribute_alloc_margin 1.2
+#define engine_mpole_proxy_margin 1.2
 #define engine_default_energy_file_name "energy"
 #define engine_default_timesteps_file_name "timesteps"
 #define engine_max_parts_per_ghost 1000
+#define engine_drift_on_demand_default 0
+#define engine_fused_end_of_step_default 0
+#define engine_truncate_foreign_trees_default 0
+#define engine_hardware_counters_default 0
 
 /**
  * @brief The rank of the engine as a global variable (for messages).
@@ -225,11 +245,20 @@ struct engine {
   int snapshot_compression;
   int snapshot_label_first;
   int snapshot_label_delta;
+  int snapshot_drift_free;
   struct unit_system *snapshot_units;
   int snapshot_output_count;
 
+  /* Power spectrum output information */
+  int power_spectrum_output;
+  int power_spectrum_with_stats;
+  int power_spectrum_fold;
+  char power_spectrum_base_name[PARSER_MAX_LINE_SIZE];
+  int power_spectrum_output_count;
+
   /* Structure finding information */
   int stf_output_freq_format;
+  int fof_output_count;
   double a_first_stf;
   double timeFirstSTFOutput;
   double deltaTimeSTF;
@@ -290,6 +319,9 @@ struct engine {
   /* Wallclock time of the last time-step */
   float wallclock_time;
 
+  /* Time spent in each phase of the time-steps since the last reset. */
+  ticks phase_ticks[engine_phase_count];
+
   /* Are we in the process of restaring a simulation? */
   int restarting;
 
@@ -311,6 +343,26 @@ struct engine {
    * of the various task arrays. */
   size_t tasks_per_cell;
 
+  /* Are the #part drifted by the first task using them rather than by
+   * drift tasks? */
+  int drift_on_demand;
+
+  /* Are the cells sent for hydro only sent down to the depth at which the
+   * hydro tasks can be split? */
+  int truncate_foreign_trees;
+
+  /* Does the time-step task also apply the two half-kicks around it? */
+  int fused_end_of_step;
+
+  /* Do we read the hardware counters around each task? */
+  int hardware_counters;
+
+  /* Properties of the lightcone output (NULL if not written) */
+  struct lightcone_props *lightcone_properties;
+
+  /* Properties of the friends-of-friends group finder (NULL if not used) */
+  struct fof_props *fof_properties;
+
   /* Are we talkative ? */
   int verbose;
 
@@ -384,6 +436,8 @@ void engine_reconstruct_multipoles(struct engine *e);
 void engine_print_stats(struct engine *e);
 void engine_check_for_dumps(struct engine *e);
 void engine_dump_snapshot(struct engine *e);
+void engine_dump_power_spectrum(struct engine *e);
+void engine_make_output_copies(struct engine *e);
 void engine_init_output_lists(struct engine *e, struct swift_params *params);
 void engine_init(struct engine *e, struct space *s, struct swift_params *params,
                  long long Ngas, long long Ngparts, long long Nstars,
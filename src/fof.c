@@ -0,0 +1,1108 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+/* Config parameters. */
+#include "../config.h"
+
+/* Some standard headers. */
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* MPI headers. */
+#ifdef WITH_MPI
+#include <mpi.h>
+#endif
+
+/* This object's header. */
+#include "fof.h"
+
+/* Local includes. */
+#include "atomic.h"
+#include "engine.h"
+#include "error.h"
+#include "periodic.h"
+#include "space.h"
+#include "threadpool.h"
+
+/**
+ * @brief Data shared by the group finding functions.
+ */
+struct fof_search_data {
+
+  /*! The #space. */
+  const struct space *s;
+
+  /*! Index of the parent of each #gpart in its group. */
+  size_t *group_index;
+
+  /*! Square of the linking length. */
+  double l_x2;
+
+  /*! Is the box periodic? */
+  int periodic;
+
+  /*! The rank of this node. */
+  int nodeID;
+};
+
+/**
+ * @brief Find the root of the group of a #gpart.
+ *
+ * The parent of a #gpart always has a lower index, so the search terminates
+ * even if other threads are merging groups at the same time. The path is
+ * halved on the way up to keep the trees shallow.
+ *
+ * @param group_index The parent of each #gpart.
+ * @param i The index of the #gpart.
+ */
+__attribute__((always_inline)) INLINE static size_t fof_find(
+    size_t *group_index, size_t i) {
+
+  while (1) {
+    const size_t parent = ((volatile size_t *)group_index)[i];
+    if (parent == i) return i;
+
+    /* Path halving: point i to its grandparent, which also has a lower
+     * index. Losing the race to another thread is harmless. */
+    const size_t grandparent = ((volatile size_t *)group_index)[parent];
+    if (grandparent != parent) atomic_cas(&group_index[i], parent, grandparent);
+    i = grandparent;
+  }
+}
+
+/**
+ * @brief Merge the groups of two #gpart.
+ *
+ * The root with the higher index is attached to the other one with an
+ * atomic compare-and-swap, and we try again if another thread got there
+ * first.
+ *
+ * @param group_index The parent of each #gpart.
+ * @param i The index of the first #gpart.
+ * @param j The index of the second #gpart.
+ */
+__attribute__((always_inline)) INLINE static void fof_union(
+    size_t *group_index, size_t i, size_t j) {
+
+  while (1) {
+    size_t root_i = fof_find(group_index, i);
+    size_t root_j = fof_find(group_index, j);
+    if (root_i == root_j) return;
+
+    if (root_j < root_i) {
+      const size_t temp = root_i;
+      root_i = root_j;
+      root_j = temp;
+    }
+
+    if (atomic_cas(&group_index[root_j], root_j, root_i) == root_j) return;
+  }
+}
+
+/**
+ * @brief Square of the distance between two #gpart positions.
+ */
+__attribute__((always_inline)) INLINE static double fof_dist2(
+    const double xi[3], const double xj[3], int periodic,
+    const double dim[3]) {
+
+  double r2 = 0.;
+  for (int k = 0; k < 3; k++) {
+    double dx = xi[k] - xj[k];
+    if (periodic) dx = nearest(dx, dim[k]);
+    r2 += dx * dx;
+  }
+  return r2;
+}
+
+/**
+ * @brief Bounding box of the #gpart of a non-empty #cell.
+ *
+ * @param c The #cell.
+ * @param lo (return) The lower corner.
+ * @param hi (return) The upper corner.
+ */
+static void fof_cell_bounds(const struct cell *c, double lo[3],
+                            double hi[3]) {
+
+  for (int k = 0; k < 3; k++) {
+    lo[k] = c->gparts[0].x[k];
+    hi[k] = c->gparts[0].x[k];
+  }
+  for (int i = 1; i < c->gcount; i++)
+    for (int k = 0; k < 3; k++) {
+      lo[k] = min(lo[k], c->gparts[i].x[k]);
+      hi[k] = max(hi[k], c->gparts[i].x[k]);
+    }
+}
+
+/**
+ * @brief Square of the minimal distance between two bounding boxes.
+ */
+static double fof_bounds_dist2(const double lo_i[3], const double hi_i[3],
+                               const double lo_j[3], const double hi_j[3],
+                               int periodic, const double dim[3]) {
+
+  double r2 = 0.;
+  for (int k = 0; k < 3; k++) {
+    double dc = 0.5 * (lo_j[k] + hi_j[k] - lo_i[k] - hi_i[k]);
+    if (periodic) dc = nearest(dc, dim[k]);
+    const double gap =
+        fabs(dc) - 0.5 * (hi_i[k] - lo_i[k]) - 0.5 * (hi_j[k] - lo_j[k]);
+    if (gap > 0.) r2 += gap * gap;
+  }
+  return r2;
+}
+
+/**
+ * @brief Link the #gpart of two cells, recursing down the tree as long as
+ * the cells are within the linking length of each other.
+ *
+ * @param data The #fof_search_data.
+ * @param ci The first #cell.
+ * @param lo_i Lower corner of the bounding box of ci.
+ * @param hi_i Upper corner of the bounding box of ci.
+ * @param cj The second #cell.
+ * @param lo_j Lower corner of the bounding box of cj.
+ * @param hi_j Upper corner of the bounding box of cj.
+ */
+static void fof_search_pair_cell(const struct fof_search_data *data,
+                                 const struct cell *ci, const double lo_i[3],
+                                 const double hi_i[3], const struct cell *cj,
+                                 const double lo_j[3], const double hi_j[3]) {
+
+  const struct space *s = data->s;
+
+  if (fof_bounds_dist2(lo_i, hi_i, lo_j, hi_j, data->periodic, s->dim) >
+      data->l_x2)
+    return;
+
+  /* Split the largest of the two cells if we can. */
+  if (ci->split && (!cj->split || ci->gcount >= cj->gcount)) {
+    for (int k = 0; k < 8; k++) {
+      const struct cell *cp = ci->progeny[k];
+      if (cp == NULL || cp->gcount == 0) continue;
+      double lo[3], hi[3];
+      fof_cell_bounds(cp, lo, hi);
+      fof_search_pair_cell(data, cp, lo, hi, cj, lo_j, hi_j);
+    }
+  } else if (cj->split) {
+    for (int k = 0; k < 8; k++) {
+      const struct cell *cp = cj->progeny[k];
+      if (cp == NULL || cp->gcount == 0) continue;
+      double lo[3], hi[3];
+      fof_cell_bounds(cp, lo, hi);
+      fof_search_pair_cell(data, ci, lo_i, hi_i, cp, lo, hi);
+    }
+  } else {
+
+    /* Two leaves: check all the pairs. */
+    for (int i = 0; i < ci->gcount; i++) {
+      const struct gpart *gpi = &ci->gparts[i];
+      const size_t index_i = gpi - s->gparts;
+      for (int j = 0; j < cj->gcount; j++) {
+        const struct gpart *gpj = &cj->gparts[j];
+        if (fof_dist2(gpi->x, gpj->x, data->periodic, s->dim) < data->l_x2)
+          fof_union(data->group_index, index_i, gpj - s->gparts);
+      }
+    }
+  }
+}
+
+/**
+ * @brief Link the #gpart of a #cell with each other.
+ *
+ * @param data The #fof_search_data.
+ * @param c The #cell.
+ */
+static void fof_search_self_cell(const struct fof_search_data *data,
+                                 const struct cell *c) {
+
+  const struct space *s = data->s;
+
+  if (c->gcount == 0) return;
+
+  if (c->split) {
+
+    /* Bounds of the progeny. */
+    double lo[8][3], hi[8][3];
+    for (int k = 0; k < 8; k++)
+      if (c->progeny[k] != NULL && c->progeny[k]->gcount > 0)
+        fof_cell_bounds(c->progeny[k], lo[k], hi[k]);
+
+    /* Recurse on the progeny and on their pairs. */
+    for (int k = 0; k < 8; k++) {
+      const struct cell *cp = c->progeny[k];
+      if (cp == NULL || cp->gcount == 0) continue;
+      fof_search_self_cell(data, cp);
+      for (int l = k + 1; l < 8; l++) {
+        const struct cell *cq = c->progeny[l];
+        if (cq == NULL || cq->gcount == 0) continue;
+        fof_search_pair_cell(data, cp, lo[k], hi[k], cq, lo[l], hi[l]);
+      }
+    }
+  } else {
+
+    /* A leaf: check all the pairs. */
+    for (int i = 0; i < c->gcount; i++) {
+      const struct gpart *gpi = &c->gparts[i];
+      const size_t index_i = gpi - s->gparts;
+      for (int j = i + 1; j < c->gcount; j++) {
+        const struct gpart *gpj = &c->gparts[j];
+        if (fof_dist2(gpi->x, gpj->x, data->periodic, s->dim) < data->l_x2)
+          fof_union(data->group_index, index_i, gpj - s->gparts);
+      }
+    }
+  }
+}
+
+/**
+ * @brief List the distinct neighbours of a top-level #cell.
+ *
+ * @param s The #space.
+ * @param cid The index of the #cell.
+ * @param list (return) The indices of the neighbours (at most 26).
+ * @return The number of neighbours.
+ */
+static int fof_top_neighbours(const struct space *s, int cid, int *list) {
+
+  const int *cdim = s->cdim;
+  const int i = cid / (cdim[1] * cdim[2]);
+  const int j = (cid / cdim[2]) % cdim[1];
+  const int k = cid % cdim[2];
+  int count = 0;
+
+  for (int ii = i - 1; ii <= i + 1; ii++) {
+    if (!s->periodic && (ii < 0 || ii >= cdim[0])) continue;
+    for (int jj = j - 1; jj <= j + 1; jj++) {
+      if (!s->periodic && (jj < 0 || jj >= cdim[1])) continue;
+      for (int kk = k - 1; kk <= k + 1; kk++) {
+        if (!s->periodic && (kk < 0 || kk >= cdim[2])) continue;
+        const int cjd = cell_getid(cdim, (ii + cdim[0]) % cdim[0],
+                                   (jj + cdim[1]) % cdim[1],
+                                   (kk + cdim[2]) % cdim[2]);
+        if (cjd == cid) continue;
+
+        /* Small grids can see the same neighbour more than once. */
+        int found = 0;
+        for (int l = 0; l < count; l++)
+          if (list[l] == cjd) found = 1;
+        if (!found) list[count++] = cjd;
+      }
+    }
+  }
+
+  return count;
+}
+
+/**
+ * @brief Mapper function linking the #gpart of the local top-level cells
+ * with each other and with those of their local neighbours.
+ *
+ * Each pair of top-level cells is only searched from the cell with the
+ * lowest index.
+ *
+ * @param map_data The indices of the top-level cells.
+ * @param num_elements The number of cells.
+ * @param extra_data The #fof_search_data.
+ */
+static void fof_search_mapper(void *map_data, int num_elements,
+                              void *extra_data) {
+
+  const struct fof_search_data *data =
+      (const struct fof_search_data *)extra_data;
+  const struct space *s = data->s;
+  const int *cells = (const int *)map_data;
+
+  for (int ind = 0; ind < num_elements; ind++) {
+
+    const int cid = cells[ind];
+    const struct cell *ci = &s->cells_top[cid];
+
+    /* Groups within the cell. */
+    fof_search_self_cell(data, ci);
+
+    /* Groups across the local neighbours. */
+    double lo_i[3], hi_i[3];
+    fof_cell_bounds(ci, lo_i, hi_i);
+
+    int neighbours[26];
+    const int nr_neighbours = fof_top_neighbours(s, cid, neighbours);
+    for (int l = 0; l < nr_neighbours; l++) {
+      const int cjd = neighbours[l];
+      const struct cell *cj = &s->cells_top[cjd];
+      if (cjd < cid || cj->nodeID != data->nodeID || cj->gcount == 0) continue;
+
+      double lo_j[3], hi_j[3];
+      fof_cell_bounds(cj, lo_j, hi_j);
+      fof_search_pair_cell(data, ci, lo_i, hi_i, cj, lo_j, hi_j);
+    }
+  }
+}
+
+/**
+ * @brief Add the #gpart of a group to a #fof_group.
+ *
+ * @param g The #fof_group.
+ * @param gp The #gpart.
+ * @param periodic Is the box periodic?
+ * @param dim The size of the box.
+ */
+static void fof_group_add(struct fof_group *g, const struct gpart *gp,
+                          int periodic, const double dim[3]) {
+
+  if (g->size == 0)
+    for (int k = 0; k < 3; k++) g->x_ref[k] = gp->x[k];
+
+  for (int k = 0; k < 3; k++) {
+    double dx = gp->x[k] - g->x_ref[k];
+    if (periodic) dx = nearest(dx, dim[k]);
+    g->mx[k] += gp->mass * dx;
+  }
+  g->mass += gp->mass;
+  g->size++;
+}
+
+/**
+ * @brief Merge two parts of the same #fof_group.
+ *
+ * @param g The #fof_group to merge into.
+ * @param h The other part of the #fof_group.
+ * @param periodic Is the box periodic?
+ * @param dim The size of the box.
+ */
+static void fof_group_merge(struct fof_group *g, const struct fof_group *h,
+                            int periodic, const double dim[3]) {
+
+  for (int k = 0; k < 3; k++) {
+    double dx = h->x_ref[k] - g->x_ref[k];
+    if (periodic) dx = nearest(dx, dim[k]);
+    g->mx[k] += h->mx[k] + h->mass * dx;
+  }
+  g->mass += h->mass;
+  g->size += h->size;
+}
+
+/**
+ * @brief Sort #fof_group by index.
+ */
+static int fof_group_cmp_id(const void *a, const void *b) {
+  const struct fof_group *ga = (const struct fof_group *)a;
+  const struct fof_group *gb = (const struct fof_group *)b;
+  return (ga->id > gb->id) - (ga->id < gb->id);
+}
+
+/**
+ * @brief Sort #fof_group by decreasing size, then by index.
+ */
+static int fof_group_cmp_size(const void *a, const void *b) {
+  const struct fof_group *ga = (const struct fof_group *)a;
+  const struct fof_group *gb = (const struct fof_group *)b;
+  if (ga->size != gb->size)
+    return (ga->size < gb->size) - (ga->size > gb->size);
+  return (ga->id > gb->id) - (ga->id < gb->id);
+}
+
+/**
+ * @brief Sort global group indices.
+ */
+static int fof_id_cmp(const void *a, const void *b) {
+  const long long ia = *(const long long *)a;
+  const long long ib = *(const long long *)b;
+  return (ia > ib) - (ia < ib);
+}
+
+#ifdef WITH_MPI
+
+/**
+ * @brief A #gpart sent to another rank to link groups across ranks.
+ */
+struct fof_mpi_gpart {
+
+  /*! Position of the #gpart. */
+  double x[3];
+
+  /*! Global index of the root of its group. */
+  long long group_id;
+
+  /*! Index of its top-level #cell. */
+  int cid;
+};
+
+/**
+ * @brief A link between two groups on different ranks.
+ */
+struct fof_link {
+  long long group_i, group_j;
+};
+
+/**
+ * @brief Sort #fof_link.
+ */
+static int fof_link_cmp(const void *a, const void *b) {
+  const struct fof_link *la = (const struct fof_link *)a;
+  const struct fof_link *lb = (const struct fof_link *)b;
+  if (la->group_i != lb->group_i)
+    return (la->group_i > lb->group_i) - (la->group_i < lb->group_i);
+  return (la->group_j > lb->group_j) - (la->group_j < lb->group_j);
+}
+
+/**
+ * @brief Growing list of #fof_link.
+ */
+struct fof_link_list {
+  struct fof_link *links;
+  size_t count, size;
+};
+
+/**
+ * @brief Find the links between a block of foreign #gpart and the #gpart of
+ * a local #cell, recursing down the tree of the local #cell.
+ *
+ * @param data The #fof_search_data.
+ * @param block The foreign #gpart.
+ * @param count The number of foreign #gpart.
+ * @param lo_b Lower corner of the bounding box of the foreign #gpart.
+ * @param hi_b Upper corner of the bounding box of the foreign #gpart.
+ * @param c The local #cell.
+ * @param lo_c Lower corner of the bounding box of c.
+ * @param hi_c Upper corner of the bounding box of c.
+ * @param offset Global index of the first local #gpart.
+ * @param list The #fof_link_list to add to.
+ */
+static void fof_link_foreign_cell(const struct fof_search_data *data,
+                                  const struct fof_mpi_gpart *block, int count,
+                                  const double lo_b[3], const double hi_b[3],
+                                  const struct cell *c, const double lo_c[3],
+                                  const double hi_c[3], long long offset,
+                                  struct fof_link_list *list) {
+
+  const struct space *s = data->s;
+
+  if (fof_bounds_dist2(lo_b, hi_b, lo_c, hi_c, data->periodic, s->dim) >
+      data->l_x2)
+    return;
+
+  if (c->split) {
+    for (int k = 0; k < 8; k++) {
+      const struct cell *cp = c->progeny[k];
+      if (cp == NULL || cp->gcount == 0) continue;
+      double lo[3], hi[3];
+      fof_cell_bounds(cp, lo, hi);
+      fof_link_foreign_cell(data, block, count, lo_b, hi_b, cp, lo, hi, offset,
+                            list);
+    }
+    return;
+  }
+
+  for (int i = 0; i < count; i++) {
+    for (int j = 0; j < c->gcount; j++) {
+      const struct gpart *gp = &c->gparts[j];
+      if (fof_dist2(block[i].x, gp->x, data->periodic, s->dim) >= data->l_x2)
+        continue;
+
+      const struct fof_link link = {
+          block[i].group_id,
+          offset + fof_find(data->group_index, gp - s->gparts)};
+
+      /* Skip the obvious repetitions. */
+      if (list->count > 0 &&
+          list->links[list->count - 1].group_i == link.group_i &&
+          list->links[list->count - 1].group_j == link.group_j)
+        continue;
+
+      if (list->count == list->size) {
+        list->size = list->size > 0 ? 2 * list->size : 1024;
+        struct fof_link *temp = (struct fof_link *)realloc(
+            list->links, sizeof(struct fof_link) * list->size);
+        if (temp == NULL) error("Failed to grow the list of FoF links.");
+        list->links = temp;
+      }
+      list->links[list->count++] = link;
+    }
+  }
+}
+
+/**
+ * @brief Join the groups spanning several ranks.
+ *
+ * The #gpart of the local top-level cells touching a foreign one are sent
+ * to its rank, which links them to its own groups. All the links are then
+ * shared and every rank resolves them with the same union-find over the
+ * global group indices.
+ *
+ * @param data The #fof_search_data.
+ * @param offset Global index of the first local #gpart.
+ * @param ids (return) The sorted global indices of the linked groups.
+ * @param labels (return) The final index of each of the linked groups.
+ * @return The number of linked groups.
+ */
+static size_t fof_link_foreign(const struct fof_search_data *data,
+                               long long offset, long long **ids,
+                               long long **labels) {
+
+  const struct space *s = data->s;
+  const int nr_nodes = s->e->nr_nodes;
+  const int nodeID = data->nodeID;
+
+  int *send_counts = (int *)calloc(nr_nodes, sizeof(int));
+  int *recv_counts = (int *)calloc(nr_nodes, sizeof(int));
+  int *send_offsets = (int *)calloc(nr_nodes, sizeof(int));
+  int *recv_offsets = (int *)calloc(nr_nodes, sizeof(int));
+  int *last_cell = (int *)malloc(nr_nodes * sizeof(int));
+  if (send_counts == NULL || recv_counts == NULL || send_offsets == NULL ||
+      recv_offsets == NULL || last_cell == NULL)
+    error("Failed to allocate the FoF exchange counts.");
+
+  /* Count the #gpart to send to each rank, once per local cell. */
+  for (int pass = 0; pass < 2; pass++) {
+
+    struct fof_mpi_gpart *send = NULL;
+    if (pass == 1) {
+      size_t total = 0;
+      for (int r = 0; r < nr_nodes; r++) {
+        send_offsets[r] = total;
+        total += send_counts[r];
+        send_counts[r] = 0;
+      }
+      send = (struct fof_mpi_gpart *)malloc(sizeof(struct fof_mpi_gpart) *
+                                             (total + 1));
+      if (send == NULL) error("Failed to allocate the FoF send buffer.");
+    }
+
+    for (int r = 0; r < nr_nodes; r++) last_cell[r] = -1;
+
+    for (int cid = 0; cid < s->nr_cells; cid++) {
+      const struct cell *ci = &s->cells_top[cid];
+      if (ci->nodeID != nodeID || ci->gcount == 0) continue;
+
+      int neighbours[26];
+      const int nr_neighbours = fof_top_neighbours(s, cid, neighbours);
+      for (int l = 0; l < nr_neighbours; l++) {
+        const int r = s->cells_top[neighbours[l]].nodeID;
+        if (r == nodeID || last_cell[r] == cid) continue;
+        last_cell[r] = cid;
+
+        if (pass == 1) {
+          struct fof_mpi_gpart *out = &send[send_offsets[r] + send_counts[r]];
+          for (int i = 0; i < ci->gcount; i++) {
+            const struct gpart *gp = &ci->gparts[i];
+            for (int k = 0; k < 3; k++) out[i].x[k] = gp->x[k];
+            out[i].group_id = offset + data->group_index[gp - s->gparts];
+            out[i].cid = cid;
+          }
+        }
+        send_counts[r] += ci->gcount;
+      }
+    }
+
+    if (pass == 0) continue;
+
+    /* Exchange the #gpart. */
+    if (MPI_Alltoall(send_counts, 1, MPI_INT, recv_counts, 1, MPI_INT,
+                     MPI_COMM_WORLD) != MPI_SUCCESS)
+      error("Failed to exchange the FoF counts.");
+    size_t nr_recv = 0;
+    for (int r = 0; r < nr_nodes; r++) {
+      recv_offsets[r] = nr_recv;
+      nr_recv += recv_counts[r];
+    }
+    if (nr_recv * sizeof(struct fof_mpi_gpart) > INT_MAX)
+      error("Too many gparts to exchange for the FoF.");
+    struct fof_mpi_gpart *recv = (struct fof_mpi_gpart *)malloc(
+        sizeof(struct fof_mpi_gpart) * (nr_recv + 1));
+    if (recv == NULL) error("Failed to allocate the FoF receive buffer.");
+
+    const int size = sizeof(struct fof_mpi_gpart);
+    for (int r = 0; r < nr_nodes; r++) {
+      send_counts[r] *= size;
+      send_offsets[r] *= size;
+      recv_counts[r] *= size;
+      recv_offsets[r] *= size;
+    }
+    if (MPI_Alltoallv(send, send_counts, send_offsets, MPI_BYTE, recv,
+                      recv_counts, recv_offsets, MPI_BYTE,
+                      MPI_COMM_WORLD) != MPI_SUCCESS)
+      error("Failed to exchange the FoF gparts.");
+    free(send);
+
+    /* Link the received blocks of #gpart with the local neighbours of their
+     * cell. */
+    struct fof_link_list list = {NULL, 0, 0};
+    for (size_t start = 0; start < nr_recv;) {
+      const int cid = recv[start].cid;
+      size_t end = start + 1;
+      while (end < nr_recv && recv[end].cid == cid) end++;
+
+      double lo_b[3], hi_b[3];
+      for (int k = 0; k < 3; k++) lo_b[k] = hi_b[k] = recv[start].x[k];
+      for (size_t i = start + 1; i < end; i++)
+        for (int k = 0; k < 3; k++) {
+          lo_b[k] = min(lo_b[k], recv[i].x[k]);
+          hi_b[k] = max(hi_b[k], recv[i].x[k]);
+        }
+
+      int neighbours[26];
+      const int nr_neighbours = fof_top_neighbours(s, cid, neighbours);
+      for (int l = 0; l < nr_neighbours; l++) {
+        const struct cell *cj = &s->cells_top[neighbours[l]];
+        if (cj->nodeID != nodeID || cj->gcount == 0) continue;
+        double lo_j[3], hi_j[3];
+        fof_cell_bounds(cj, lo_j, hi_j);
+        fof_link_foreign_cell(data, &recv[start], end - start, lo_b, hi_b, cj,
+                              lo_j, hi_j, offset, &list);
+      }
+
+      start = end;
+    }
+    free(recv);
+
+    /* Remove the duplicates. */
+    qsort(list.links, list.count, sizeof(struct fof_link), fof_link_cmp);
+    size_t nr_links = 0;
+    for (size_t i = 0; i < list.count; i++)
+      if (nr_links == 0 || fof_link_cmp(&list.links[i],
+                                        &list.links[nr_links - 1]) != 0)
+        list.links[nr_links++] = list.links[i];
+
+    /* Share all the links. */
+    const int link_size = sizeof(struct fof_link);
+    int my_count = nr_links * link_size;
+    if (MPI_Allgather(&my_count, 1, MPI_INT, recv_counts, 1, MPI_INT,
+                      MPI_COMM_WORLD) != MPI_SUCCESS)
+      error("Failed to gather the number of FoF links.");
+    size_t total = 0;
+    for (int r = 0; r < nr_nodes; r++) {
+      recv_offsets[r] = total;
+      total += recv_counts[r];
+    }
+    if (total > INT_MAX) error("Too many FoF links to exchange.");
+    const size_t nr_all_links = total / link_size;
+    struct fof_link *all_links =
+        (struct fof_link *)malloc(sizeof(struct fof_link) * (nr_all_links + 1));
+    if (all_links == NULL) error("Failed to allocate the FoF links.");
+    if (MPI_Allgatherv(list.links, my_count, MPI_BYTE, all_links, recv_counts,
+                       recv_offsets, MPI_BYTE, MPI_COMM_WORLD) != MPI_SUCCESS)
+      error("Failed to gather the FoF links.");
+    free(list.links);
+
+    /* The distinct groups involved. */
+    long long *id_list =
+        (long long *)malloc(sizeof(long long) * (2 * nr_all_links + 1));
+    if (id_list == NULL) error("Failed to allocate the FoF group list.");
+    for (size_t i = 0; i < nr_all_links; i++) {
+      id_list[2 * i] = all_links[i].group_i;
+      id_list[2 * i + 1] = all_links[i].group_j;
+    }
+    qsort(id_list, 2 * nr_all_links, sizeof(long long), fof_id_cmp);
+    size_t nr_ids = 0;
+    for (size_t i = 0; i < 2 * nr_all_links; i++)
+      if (nr_ids == 0 || id_list[i] != id_list[nr_ids - 1])
+        id_list[nr_ids++] = id_list[i];
+
+    /* Union-find over them, the root being the lowest index. */
+    size_t *parent = (size_t *)malloc(sizeof(size_t) * (nr_ids + 1));
+    if (parent == NULL) error("Failed to allocate the FoF group links.");
+    for (size_t i = 0; i < nr_ids; i++) parent[i] = i;
+    for (size_t i = 0; i < nr_all_links; i++) {
+      const long long *a =
+          (const long long *)bsearch(&all_links[i].group_i, id_list, nr_ids,
+                                     sizeof(long long), fof_id_cmp);
+      const long long *b =
+          (const long long *)bsearch(&all_links[i].group_j, id_list, nr_ids,
+                                     sizeof(long long), fof_id_cmp);
+      fof_union(parent, a - id_list, b - id_list);
+    }
+
+    *ids = id_list;
+    *labels = (long long *)malloc(sizeof(long long) * (nr_ids + 1));
+    if (*labels == NULL) error("Failed to allocate the FoF group labels.");
+    for (size_t i = 0; i < nr_ids; i++)
+      (*labels)[i] = id_list[fof_find(parent, i)];
+
+    free(parent);
+    free(all_links);
+    free(send_counts);
+    free(recv_counts);
+    free(send_offsets);
+    free(recv_offsets);
+    free(last_cell);
+    return nr_ids;
+  }
+
+  return 0;
+}
+
+/**
+ * @brief Send the parts of the groups spanning several ranks to the rank
+ * owning their index.
+ *
+ * @param e The #engine.
+ * @param groups The #fof_group of this rank, replaced by the ones it owns
+ * and the parts it received.
+ * @param nr_groups The number of #fof_group.
+ * @param offset Global index of the first local #gpart.
+ * @return The new number of #fof_group.
+ */
+static size_t fof_gather_groups(const struct engine *e,
+                                struct fof_group **groups, size_t nr_groups,
+                                long long offset) {
+
+  const int nr_nodes = e->nr_nodes;
+  const int nodeID = e->nodeID;
+
+  /* The range of global indices of each rank. */
+  long long my_range[2] = {offset, offset + (long long)e->s->nr_gparts};
+  long long *ranges = (long long *)malloc(sizeof(long long) * 2 * nr_nodes);
+  int *send_counts = (int *)calloc(nr_nodes, sizeof(int));
+  int *recv_counts = (int *)calloc(nr_nodes, sizeof(int));
+  int *send_offsets = (int *)calloc(nr_nodes, sizeof(int));
+  int *recv_offsets = (int *)calloc(nr_nodes, sizeof(int));
+  int *owner = (int *)malloc(sizeof(int) * (nr_groups + 1));
+  if (ranges == NULL || send_counts == NULL || recv_counts == NULL ||
+      send_offsets == NULL || recv_offsets == NULL || owner == NULL)
+    error("Failed to allocate the FoF exchange counts.");
+  if (MPI_Allgather(my_range, 2, MPI_LONG_LONG_INT, ranges, 2,
+                    MPI_LONG_LONG_INT, MPI_COMM_WORLD) != MPI_SUCCESS)
+    error("Failed to gather the FoF ranges.");
+
+  /* Who owns each group? */
+  size_t nr_keep = 0;
+  for (size_t i = 0; i < nr_groups; i++) {
+    const long long id = (*groups)[i].id;
+    owner[i] = -1;
+    for (int r = 0; r < nr_nodes; r++)
+      if (ranges[2 * r] <= id && id < ranges[2 * r + 1]) owner[i] = r;
+    if (owner[i] < 0) error("FoF group without an owner.");
+    if (owner[i] == nodeID)
+      nr_keep++;
+    else
+      send_counts[owner[i]]++;
+  }
+
+  /* Pack the groups to send. */
+  size_t nr_send = 0;
+  for (int r = 0; r < nr_nodes; r++) {
+    send_offsets[r] = nr_send;
+    nr_send += send_counts[r];
+    send_counts[r] = 0;
+  }
+  struct fof_group *send =
+      (struct fof_group *)malloc(sizeof(struct fof_group) * (nr_send + 1));
+  if (send == NULL) error("Failed to allocate the FoF group buffer.");
+  for (size_t i = 0; i < nr_groups; i++)
+    if (owner[i] != nodeID)
+      send[send_offsets[owner[i]] + send_counts[owner[i]]++] = (*groups)[i];
+
+  /* Exchange them. */
+  if (MPI_Alltoall(send_counts, 1, MPI_INT, recv_counts, 1, MPI_INT,
+                   MPI_COMM_WORLD) != MPI_SUCCESS)
+    error("Failed to exchange the FoF group counts.");
+  size_t nr_recv = 0;
+  for (int r = 0; r < nr_nodes; r++) {
+    recv_offsets[r] = nr_recv;
+    nr_recv += recv_counts[r];
+  }
+  struct fof_group *new_groups = (struct fof_group *)malloc(
+      sizeof(struct fof_group) * (nr_keep + nr_recv + 1));
+  if (new_groups == NULL) error("Failed to allocate the FoF groups.");
+  const int size = sizeof(struct fof_group);
+  for (int r = 0; r < nr_nodes; r++) {
+    send_counts[r] *= size;
+    send_offsets[r] *= size;
+    recv_counts[r] *= size;
+    recv_offsets[r] = (recv_offsets[r] + nr_keep) * size;
+  }
+  if (MPI_Alltoallv(send, send_counts, send_offsets, MPI_BYTE, new_groups,
+                    recv_counts, recv_offsets, MPI_BYTE,
+                    MPI_COMM_WORLD) != MPI_SUCCESS)
+    error("Failed to exchange the FoF groups.");
+
+  /* Keep our own groups. */
+  size_t count = 0;
+  for (size_t i = 0; i < nr_groups; i++)
+    if (owner[i] == nodeID) new_groups[count++] = (*groups)[i];
+
+  free(*groups);
+  *groups = new_groups;
+  free(send);
+  free(owner);
+  free(ranges);
+  free(send_counts);
+  free(recv_counts);
+  free(send_offsets);
+  free(recv_offsets);
+  return nr_keep + nr_recv;
+}
+
+#endif /* WITH_MPI */
+
+/**
+ * @brief Write the catalogue of the groups.
+ *
+ * The groups of all the ranks are collected on rank 0, which writes them
+ * sorted by decreasing size.
+ *
+ * @param props The #fof_props.
+ * @param e The #engine.
+ * @param groups The #fof_group of this rank.
+ * @param nr_groups The number of #fof_group.
+ * @param l_x The linking length.
+ */
+static void fof_write_catalogue(const struct fof_props *props,
+                                const struct engine *e,
+                                const struct fof_group *groups,
+                                size_t nr_groups, double l_x) {
+
+  const struct space *s = e->s;
+
+#ifdef WITH_MPI
+  /* Collect the groups on rank 0. */
+  const int size = sizeof(struct fof_group);
+  int my_count = nr_groups * size;
+  int *counts = (int *)malloc(sizeof(int) * e->nr_nodes);
+  int *offsets = (int *)malloc(sizeof(int) * e->nr_nodes);
+  if (counts == NULL || offsets == NULL)
+    error("Failed to allocate the FoF catalogue counts.");
+  if (MPI_Gather(&my_count, 1, MPI_INT, counts, 1, MPI_INT, 0,
+                 MPI_COMM_WORLD) != MPI_SUCCESS)
+    error("Failed to gather the number of FoF groups.");
+  size_t total = 0;
+  if (e->nodeID == 0)
+    for (int r = 0; r < e->nr_nodes; r++) {
+      offsets[r] = total;
+      total += counts[r];
+    }
+  struct fof_group *all_groups = NULL;
+  if (e->nodeID == 0) {
+    all_groups = (struct fof_group *)malloc(total + size);
+    if (all_groups == NULL) error("Failed to allocate the FoF catalogue.");
+  }
+  if (MPI_Gatherv(groups, my_count, MPI_BYTE, all_groups, counts, offsets,
+                  MPI_BYTE, 0, MPI_COMM_WORLD) != MPI_SUCCESS)
+    error("Failed to gather the FoF groups.");
+  free(counts);
+  free(offsets);
+  const size_t nr_all = total / size;
+#else
+  struct fof_group *all_groups =
+      (struct fof_group *)malloc(sizeof(struct fof_group) * (nr_groups + 1));
+  if (all_groups == NULL) error("Failed to allocate the FoF catalogue.");
+  memcpy(all_groups, groups, sizeof(struct fof_group) * nr_groups);
+  const size_t nr_all = nr_groups;
+#endif
+
+  if (e->nodeID == 0) {
+
+    qsort(all_groups, nr_all, sizeof(struct fof_group), fof_group_cmp_size);
+
+    const double time =
+        (e->policy & engine_policy_cosmology)
+            ? exp(e->ti_current * e->time_base) * e->cosmology->a_begin
+            : e->ti_current * e->time_base + e->time_begin;
+
+    char file_name[PARSER_MAX_LINE_SIZE + 40];
+    sprintf(file_name, "%s_%04d.txt", props->base_name,
+            e->fof_output_count);
+    FILE *file = fopen(file_name, "w");
+    if (file == NULL)
+      error("Could not open the FoF catalogue '%s'.", file_name);
+
+    fprintf(file, "# Friends-of-friends groups at time/scale-factor %e\n",
+            time);
+    fprintf(file, "# Linking length: %e, minimal size: %d, groups: %zd\n",
+            l_x, props->min_group_size, nr_all);
+    fprintf(file,
+            "# (0) group, (1) number of particles, (2) mass, (3-5) centre of "
+            "mass\n");
+
+    for (size_t i = 0; i < nr_all; i++) {
+      const struct fof_group *g = &all_groups[i];
+      double x[3];
+      for (int k = 0; k < 3; k++) {
+        x[k] = g->x_ref[k] + g->mx[k] / g->mass;
+        if (s->periodic) x[k] = box_wrap(x[k], 0., s->dim[k]);
+      }
+      fprintf(file, "%zd %lld %e %e %e %e\n", i, g->size, g->mass, x[0], x[1],
+              x[2]);
+    }
+
+    fclose(file);
+  }
+
+  free(all_groups);
+}
+
+/**
+ * @brief Initialises the friends-of-friends group finder.
+ *
+ * @param props The #fof_props to initialise.
+ * @param params The parsed parameters.
+ */
+void fof_init(struct fof_props *props, struct swift_params *params) {
+
+  props->linking_length_ratio = parser_get_opt_param_double(
+      params, "StructureFinding:fof_linking_length_ratio",
+      fof_linking_length_ratio_default);
+  if (props->linking_length_ratio <= 0.)
+    error("The FoF linking length must be positive.");
+  props->min_group_size = parser_get_opt_param_int(
+      params, "StructureFinding:fof_min_group_size",
+      fof_min_group_size_default);
+  char stf_base_name[PARSER_MAX_LINE_SIZE];
+  parser_get_param_string(params, "StructureFinding:basename", stf_base_name);
+  sprintf(props->base_name, "%s_fof", stf_base_name);
+}
+
+/**
+ * @brief Find the friends-of-friends groups of all the #gpart and write
+ * their catalogue.
+ *
+ * The groups are first found within and across the local top-level cells
+ * in parallel, using the cell tree to skip the pairs of cells further
+ * apart than the linking length and a lock-free union-find. Groups
+ * spanning several ranks are then joined and their properties gathered on
+ * the rank of their lowest index. Rank 0 writes the catalogue, sorted by
+ * decreasing size.
+ *
+ * The #gpart are assumed to have been drifted to the current time.
+ *
+ * @param props The #fof_props.
+ * @param e The #engine.
+ */
+void fof_search_tree(struct fof_props *props, struct engine *e) {
+
+  const ticks tic = getticks();
+
+  struct space *s = e->s;
+  const size_t nr_gparts = s->nr_gparts;
+  const int periodic = s->periodic;
+
+  /* The linking length. */
+  const double mean_sep =
+      cbrt(s->dim[0] * s->dim[1] * s->dim[2] / (double)e->total_nr_gparts);
+  const double l_x = props->linking_length_ratio * mean_sep;
+  for (int k = 0; k < 3; k++)
+    if (l_x > s->width[k])
+      error("The FoF linking length (%e) is larger than the top-level cells.",
+            l_x);
+
+  /* Every #gpart starts in its own group. */
+  size_t *group_index = (size_t *)malloc(sizeof(size_t) * (nr_gparts + 1));
+  if (group_index == NULL) error("Failed to allocate the FoF group indices.");
+  for (size_t i = 0; i < nr_gparts; i++) group_index[i] = i;
+
+  struct fof_search_data data;
+  data.s = s;
+  data.group_index = group_index;
+  data.l_x2 = l_x * l_x;
+  data.periodic = periodic;
+  data.nodeID = e->nodeID;
+
+  /* The local top-level cells with #gpart. */
+  int *cells = (int *)malloc(sizeof(int) * (s->nr_cells + 1));
+  if (cells == NULL) error("Failed to allocate the FoF cell list.");
+  int nr_cells = 0;
+  for (int cid = 0; cid < s->nr_cells; cid++)
+    if (s->cells_top[cid].nodeID == e->nodeID && s->cells_top[cid].gcount > 0)
+      cells[nr_cells++] = cid;
+
+  /* Link the local #gpart. */
+  threadpool_map(&e->threadpool, fof_search_mapper, cells, nr_cells,
+                 sizeof(int), 1, &data);
+  free(cells);
+
+  /* Point every #gpart straight at its root. The parent always has a lower
+   * index, so it already points to the root when we get to the child. */
+  for (size_t i = 0; i < nr_gparts; i++)
+    group_index[i] = group_index[group_index[i]];
+
+  if (e->verbose)
+    message("Linking the local gparts took %.3f %s.",
+            clocks_from_ticks(getticks() - tic), clocks_getunit());
+
+  /* Global index of the first local #gpart. */
+  long long offset = 0;
+  size_t nr_ids = 0;
+  long long *ids = NULL, *labels = NULL;
+#ifdef WITH_MPI
+  long long my_count = nr_gparts;
+  if (MPI_Exscan(&my_count, &offset, 1, MPI_LONG_LONG_INT, MPI_SUM,
+                 MPI_COMM_WORLD) != MPI_SUCCESS)
+    error("Failed to compute the FoF offsets.");
+  if (e->nodeID == 0) offset = 0;
+  nr_ids = fof_link_foreign(&data, offset, &ids, &labels);
+#endif
+
+  /* Collect the properties of the local groups. */
+  size_t *root_to_group = (size_t *)malloc(sizeof(size_t) * (nr_gparts + 1));
+  if (root_to_group == NULL) error("Failed to allocate the FoF group map.");
+  size_t nr_groups = 0;
+  for (size_t i = 0; i < nr_gparts; i++)
+    if (group_index[i] == i) root_to_group[i] = nr_groups++;
+  struct fof_group *groups =
+      (struct fof_group *)calloc(nr_groups + 1, sizeof(struct fof_group));
+  if (groups == NULL) error("Failed to allocate the FoF groups.");
+  for (size_t i = 0; i < nr_gparts; i++) {
+    const size_t root = group_index[i];
+    struct fof_group *g = &groups[root_to_group[root]];
+    g->id = offset + root;
+    fof_group_add(g, &s->gparts[i], periodic, s->dim);
+  }
+  free(root_to_group);
+  free(group_index);
+
+  /* Relabel the groups spanning several ranks. */
+  for (size_t i = 0; i < nr_groups && nr_ids > 0; i++) {
+    const long long *found = (const long long *)bsearch(
+        &groups[i].id, ids, nr_ids, sizeof(long long), fof_id_cmp);
+    if (found != NULL) groups[i].id = labels[found - ids];
+  }
+  free(ids);
+  free(labels);
+
+#ifdef WITH_MPI
+  /* Gather the parts of each group on the rank owning its label. */
+  nr_groups = fof_gather_groups(e, &groups, nr_groups, offset);
+#endif
+
+  /* Merge the parts of the same groups and keep the large ones. */
+  qsort(groups, nr_groups, sizeof(struct fof_group), fof_group_cmp_id);
+  size_t nr_final = 0;
+  for (size_t i = 0; i < nr_groups; i++) {
+    if (nr_final > 0 && groups[nr_final - 1].id == groups[i].id)
+      fof_group_merge(&groups[nr_final - 1], &groups[i], periodic, s->dim);
+    else
+      groups[nr_final++] = groups[i];
+  }
+  size_t nr_large = 0;
+  for (size_t i = 0; i < nr_final; i++)
+    if (groups[i].size >= props->min_group_size) groups[nr_large++] = groups[i];
+
+  /* Write the catalogue. */
+  fof_write_catalogue(props, e, groups, nr_large, l_x);
+  free(groups);
+
+  e->fof_output_count++;
+
+  if (e->verbose)
+    message("took %.3f %s.", clocks_from_ticks(getticks() - tic),
+            clocks_getunit());
+}
@@ -0,0 +1,78 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#ifndef SWIFT_FOF_H
+#define SWIFT_FOF_H
+
+/* Config parameters. */
+#include "../config.h"
+
+/* Local headers */
+#include "parser.h"
+
+/* Avoid cyclic inclusions */
+struct engine;
+
+/* Default linking length in units of the mean inter-particle separation. */
+#define fof_linking_length_ratio_default 0.2
+
+/* Default minimal number of particles in a group to be written. */
+#define fof_min_group_size_default 20
+
+/**
+ * @brief A (possibly partial) friends-of-friends group.
+ *
+ * The centre of mass is accumulated relative to a reference particle of the
+ * group so that groups straddling the periodic boundaries are handled.
+ */
+struct fof_group {
+
+  /*! Global index of the root of the group. */
+  long long id;
+
+  /*! Number of particles in the group. */
+  long long size;
+
+  /*! Total mass of the group. */
+  double mass;
+
+  /*! Position of the reference particle. */
+  double x_ref[3];
+
+  /*! Mass-weighted offsets of the particles from the reference. */
+  double mx[3];
+};
+
+/**
+ * @brief The properties of the friends-of-friends group finder.
+ */
+struct fof_props {
+
+  /*! Linking length in units of the mean inter-particle separation. */
+  double linking_length_ratio;
+
+  /*! Minimal number of particles in a group to be written. */
+  int min_group_size;
+
+  /*! Common part of the name of the catalogues. */
+  char base_name[PARSER_MAX_LINE_SIZE + 8];
+};
+
+void fof_init(struct fof_props *props, struct swift_params *params);
+void fof_search_tree(struct fof_props *props, struct engine *e);
+
+#endif /* SWIFT_FOF_H */
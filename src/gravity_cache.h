@@ -26,6 +26,7 @@
 #include "align.h"
 #include "error.h"
 #include "gravity.h"
+#include "timeline.h"
 #include "vector.h"
 
 /**
@@ -72,6 +73,41 @@ struct gravity_cache {
   int count;
 };
 
+/**
+ * @brief A per-cell SoA copy of the #gpart quantities that do not change
+ * during a time-step.
+ *
+ * It is filled by the first leaf-leaf interaction of a cell in a step and then
+ * copied into the #gravity_cache of all the other interactions of that cell,
+ * sparing them the gather from the #gpart array.
+ */
+struct gravity_cell_cache {
+
+  /*! #gpart x position. */
+  float *restrict x SWIFT_CACHE_ALIGN;
+
+  /*! #gpart y position. */
+  float *restrict y SWIFT_CACHE_ALIGN;
+
+  /*! #gpart z position. */
+  float *restrict z SWIFT_CACHE_ALIGN;
+
+  /*! #gpart softening length. */
+  float *restrict epsilon SWIFT_CACHE_ALIGN;
+
+  /*! #gpart mass. */
+  float *restrict m SWIFT_CACHE_ALIGN;
+
+  /*! Is this #gpart active ? */
+  int *restrict active SWIFT_CACHE_ALIGN;
+
+  /*! Cache size */
+  int count;
+
+  /*! Time at which the content was last filled. */
+  integertime_t ti_filled;
+};
+
 /**
  * @brief Frees the memory allocated in a #gravity_cache
  *
@@ -420,6 +456,187 @@ gravity_cache_populate_all_mpole(const timebin_t max_active_bin,
   gravity_cache_zero_output(c, gcount_padded);
 }
 
+/**
+ * @brief Frees a #gravity_cell_cache and its arrays.
+ *
+ * @param cc The #gravity_cell_cache to free (can be NULL).
+ */
+static INLINE void gravity_cell_cache_free(struct gravity_cell_cache *cc) {
+
+  if (cc == NULL) return;
+  free(cc->x);
+  free(cc->y);
+  free(cc->z);
+  free(cc->epsilon);
+  free(cc->m);
+  free(cc->active);
+  free(cc);
+}
+
+/**
+ * @brief Returns the #gravity_cell_cache of a leaf cell, filling it if this
+ * was not yet done in this step.
+ *
+ * The caller must hold the gpart lock of the cell, which is the case of all
+ * the gravity pair tasks. The padding is filled as in
+ * gravity_cache_populate().
+ *
+ * @param c The #cell.
+ * @param max_active_bin The largest active bin in the current time-step.
+ * @param ti_current The current time on the integer time-line.
+ * @param grav_props The global gravity properties.
+ */
+static INLINE const struct gravity_cell_cache *gravity_cell_cache_get(
+    struct cell *c, const timebin_t max_active_bin,
+    const integertime_t ti_current, const struct gravity_props *grav_props) {
+
+  const int gcount = c->gcount;
+  const int gcount_padded = gcount - (gcount % VEC_SIZE) + VEC_SIZE;
+
+  /* (Re-)allocate the cache if it is too small for this cell. */
+  struct gravity_cell_cache *cc = c->grav_cache;
+  if (cc == NULL || cc->count < gcount_padded) {
+    gravity_cell_cache_free(cc);
+    if ((cc = (struct gravity_cell_cache *)malloc(
+             sizeof(struct gravity_cell_cache))) == NULL)
+      error("Couldn't allocate the gravity cell cache.");
+
+    const size_t sizeBytesF = gcount_padded * sizeof(float);
+    const size_t sizeBytesI = gcount_padded * sizeof(int);
+    int e = 0;
+    e += posix_memalign((void **)&cc->x, SWIFT_CACHE_ALIGNMENT, sizeBytesF);
+    e += posix_memalign((void **)&cc->y, SWIFT_CACHE_ALIGNMENT, sizeBytesF);
+    e += posix_memalign((void **)&cc->z, SWIFT_CACHE_ALIGNMENT, sizeBytesF);
+    e += posix_memalign((void **)&cc->epsilon, SWIFT_CACHE_ALIGNMENT,
+                        sizeBytesF);
+    e += posix_memalign((void **)&cc->m, SWIFT_CACHE_ALIGNMENT, sizeBytesF);
+    e +=
+        posix_memalign((void **)&cc->active, SWIFT_CACHE_ALIGNMENT, sizeBytesI);
+    if (e != 0)
+      error("Couldn't allocate gravity cell cache, size: %d", gcount_padded);
+
+    cc->count = gcount_padded;
+    cc->ti_filled = -1;
+    c->grav_cache = cc;
+  }
+
+  /* Already up-to-date? */
+  if (cc->ti_filled == ti_current) return cc;
+
+  /* Make the compiler understand we are in happy vectorization land */
+  swift_declare_aligned_ptr(float, x, cc->x, SWIFT_CACHE_ALIGNMENT);
+  swift_declare_aligned_ptr(float, y, cc->y, SWIFT_CACHE_ALIGNMENT);
+  swift_declare_aligned_ptr(float, z, cc->z, SWIFT_CACHE_ALIGNMENT);
+  swift_declare_aligned_ptr(float, epsilon, cc->epsilon, SWIFT_CACHE_ALIGNMENT);
+  swift_declare_aligned_ptr(float, m, cc->m, SWIFT_CACHE_ALIGNMENT);
+  swift_declare_aligned_ptr(int, active, cc->active, SWIFT_CACHE_ALIGNMENT);
+
+  const struct gpart *restrict gparts = c->gparts;
+  for (int i = 0; i < gcount; ++i) {
+    x[i] = (float)gparts[i].x[0];
+    y[i] = (float)gparts[i].x[1];
+    z[i] = (float)gparts[i].x[2];
+    epsilon[i] = gravity_get_softening(&gparts[i], grav_props);
+    m[i] = gparts[i].mass;
+    active[i] = (int)(gparts[i].time_bin <= max_active_bin);
+  }
+
+  /* Pad with impossible positions of reasonable magnitude */
+  const float pos_padded[3] = {-2.f * (float)c->width[0],
+                               -2.f * (float)c->width[1],
+                               -2.f * (float)c->width[2]};
+  const float eps_padded = epsilon[0];
+  for (int i = gcount; i < gcount_padded; ++i) {
+    x[i] = pos_padded[0];
+    y[i] = pos_padded[1];
+    z[i] = pos_padded[2];
+    epsilon[i] = eps_padded;
+    m[i] = 0.f;
+    active[i] = 0;
+  }
+
+  cc->ti_filled = ti_current;
+  return cc;
+}
+
+/**
+ * @brief Fills a #gravity_cache structure from a #gravity_cell_cache.
+ *
+ * This is equivalent to gravity_cache_populate() with a zero shift, or to
+ * gravity_cache_populate_all_mpole() if all_mpole is set.
+ *
+ * @param allow_mpole Are we allowing the use of multipoles?
+ * @param all_mpole Do all the #gpart use the multipole?
+ * @param periodic Are we using periodic BCs ?
+ * @param dim The size of the simulation volume along each dimension.
+ * @param c The #gravity_cache to fill.
+ * @param cc The #gravity_cell_cache to read from.
+ * @param gcount The number of particles to read.
+ * @param gcount_padded The number of particle to read padded to the next
+ * multiple of the vector length.
+ * @param CoM The position of the multipole.
+ * @param r_max2 The square of the multipole radius.
+ * @param grav_props The global gravity properties.
+ */
+__attribute__((always_inline)) INLINE static void
+gravity_cache_populate_from_cell_cache(
+    const int allow_mpole, const int all_mpole, const int periodic,
+    const float dim[3], struct gravity_cache *c,
+    const struct gravity_cell_cache *cc, const int gcount,
+    const int gcount_padded, const float CoM[3], const float r_max2,
+    const struct gravity_props *grav_props) {
+
+  const float theta_crit2 = grav_props->theta_crit2;
+
+#ifdef SWIFT_DEBUG_CHECKS
+  if (cc->count < gcount_padded) error("Gravity cell cache too small");
+#endif
+
+  /* Make the compiler understand we are in happy vectorization land */
+  swift_declare_aligned_ptr(float, x, c->x, SWIFT_CACHE_ALIGNMENT);
+  swift_declare_aligned_ptr(float, y, c->y, SWIFT_CACHE_ALIGNMENT);
+  swift_declare_aligned_ptr(float, z, c->z, SWIFT_CACHE_ALIGNMENT);
+  swift_declare_aligned_ptr(int, use_mpole, c->use_mpole,
+                            SWIFT_CACHE_ALIGNMENT);
+  swift_assume_size(gcount_padded, VEC_SIZE);
+
+  /* Copy the input caches, padding included */
+  memcpy(x, cc->x, gcount_padded * sizeof(float));
+  memcpy(y, cc->y, gcount_padded * sizeof(float));
+  memcpy(z, cc->z, gcount_padded * sizeof(float));
+  memcpy(c->epsilon, cc->epsilon, gcount_padded * sizeof(float));
+  memcpy(c->m, cc->m, gcount_padded * sizeof(float));
+  memcpy(c->active, cc->active, gcount_padded * sizeof(int));
+
+  /* Check whether we can use the multipole instead of P-P */
+  for (int i = 0; i < gcount; ++i) {
+
+    /* Distance to the CoM of the other cell. */
+    float dx = x[i] - CoM[0];
+    float dy = y[i] - CoM[1];
+    float dz = z[i] - CoM[2];
+
+    /* Apply periodic BC */
+    if (periodic) {
+      dx = nearestf(dx, dim[0]);
+      dy = nearestf(dy, dim[1]);
+      dz = nearestf(dz, dim[2]);
+    }
+    const float r2 = dx * dx + dy * dy + dz * dz;
+    const int accept = gravity_M2P_accept(r_max2, theta_crit2, r2);
+
+#ifdef SWIFT_DEBUG_CHECKS
+    if (all_mpole && !accept) error("Using m-pole where the test fails");
+#endif
+
+    use_mpole[i] = all_mpole || (allow_mpole && accept);
+  }
+  for (int i = gcount; i < gcount_padded; ++i) use_mpole[i] = 0;
+
+  /* Zero the output as well */
+  gravity_cache_zero_output(c, gcount_padded);
+}
+
 /**
  * @brief Write the output cache values back to the active #gpart.
  *
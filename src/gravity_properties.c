@@ -37,6 +37,8 @@
 #define gravity_props_default_r_cut_max 4.5f
 #define gravity_props_default_r_cut_min 0.1f
 #define gravity_props_default_rebuild_frequency 0.01f
+#define gravity_props_default_mpole_only_proxies 0
+#define gravity_props_default_use_cell_caches 0
 
 void gravity_props_init(struct gravity_props *p, struct swift_params *params,
                         const struct cosmology *cosmo, int with_cosmology) {
@@ -58,6 +60,16 @@ void gravity_props_init(struct gravity_props *p, struct swift_params *params,
   p->r_cut_min_ratio = parser_get_opt_param_float(
       params, "Gravity:r_cut_min", gravity_props_default_r_cut_min);
 
+  /* MPI exchanges */
+  p->mpole_only_proxies =
+      parser_get_opt_param_int(params, "Gravity:mpole_only_proxies",
+                               gravity_props_default_mpole_only_proxies);
+
+  /* Leaf-leaf interactions */
+  p->use_cell_caches =
+      parser_get_opt_param_int(params, "Gravity:use_cell_caches",
+                               gravity_props_default_use_cell_caches);
+
   if (p->mesh_size % 2 != 0)
     error("The mesh side-length must be an even number.");
 
@@ -147,6 +159,13 @@ void gravity_props_print(const struct gravity_props *p) {
           kernel_long_gravity_truncation_name);
 
   message("Self-gravity tree update frequency: f=%f", p->rebuild_frequency);
+
+  if (p->use_cell_caches)
+    message("Self-gravity re-uses per-cell particle caches within a step.");
+#ifdef WITH_MPI
+  if (p->mpole_only_proxies)
+    message("Self-gravity only exchanges the multipoles of distant cells.");
+#endif
 }
 
 #if defined(HAVE_HDF5)
@@ -44,6 +44,12 @@ struct gravity_props {
   /*! Periodic long-range mesh side-length */
   int mesh_size;
 
+  /*! Only exchange the multipoles of the distant foreign cells? */
+  int mpole_only_proxies;
+
+  /*! Keep a per-step copy of the leaf #gpart data in each cell? */
+  int use_cell_caches;
+
   /*! Mesh smoothing scale in units of top-level cell size */
   float a_smooth;
 
@@ -0,0 +1,472 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+/* Config parameters. */
+#include "../config.h"
+
+/* Some standard headers. */
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* This object's header. */
+#include "lightcone.h"
+
+/* Local includes. */
+#include "atomic.h"
+#include "cosmology.h"
+#include "engine.h"
+#include "error.h"
+#include "minmax.h"
+#include "space.h"
+
+/* Index of the list of replications of the calling thread. */
+static __thread int lightcone_thread_id = -1;
+
+/**
+ * @brief Get the list of replications of the calling thread.
+ *
+ * The lists are allocated in lightcone_init() and each thread gets its own
+ * the first time it checks some particles.
+ *
+ * @param props The #lightcone_props.
+ */
+static int *lightcone_get_shift_list(struct lightcone_props *props) {
+
+  if (lightcone_thread_id < 0) {
+    const int id = atomic_inc(&props->nr_threads);
+    if (id >= props->nr_shift_lists)
+      error("Too many threads for the lightcone (max %d).",
+            props->nr_shift_lists);
+    lightcone_thread_id = id;
+  }
+  return &props->shift_lists[(size_t)lightcone_thread_id * props->nr_shifts];
+}
+
+/**
+ * @brief Radius of the past lightcone of the observer at a given time.
+ *
+ * This is the comoving distance travelled by light between that time and the
+ * end of the simulation, i.e. c times the integral of dt/a.
+ *
+ * @param e The #engine.
+ * @param ti The integer time.
+ */
+static double lightcone_radius(const struct engine *e, integertime_t ti) {
+
+  const double c = e->physical_constants->const_speed_light_c;
+  if (e->policy & engine_policy_cosmology)
+    return c * cosmology_get_grav_kick_factor(e->cosmology, ti,
+                                              max_nr_timesteps);
+  else
+    return c * (max_nr_timesteps - ti) * e->time_base;
+}
+
+/**
+ * @brief Scale-factor (or time) at a fraction of a drift.
+ *
+ * @param e The #engine.
+ * @param ti_old Start of the drift.
+ * @param ti_current End of the drift.
+ * @param w The fraction of the drift.
+ */
+static double lightcone_time(const struct engine *e, integertime_t ti_old,
+                             integertime_t ti_current, double w) {
+
+  const double ti = ti_old + w * (ti_current - ti_old);
+  if (e->policy & engine_policy_cosmology)
+    return exp(ti * e->time_base) * e->cosmology->a_begin;
+  else
+    return ti * e->time_base + e->time_begin;
+}
+
+/**
+ * @brief Find the replications of the box in which particles within some
+ * bounds can cross the lightcone during a drift.
+ *
+ * @param props The #lightcone_props.
+ * @param box_min Lower corner of the region covered by the particles.
+ * @param box_max Upper corner of the region covered by the particles.
+ * @param r_old Radius of the lightcone at the start of the drift.
+ * @param r_new Radius of the lightcone at the end of the drift.
+ * @param list (return) The indices of the replications to check.
+ * @return The number of replications to check.
+ */
+static int lightcone_find_shifts(const struct lightcone_props *props,
+                                 const double box_min[3],
+                                 const double box_max[3], double r_old,
+                                 double r_new, int *list) {
+
+  const double *o = props->observer_position;
+  int count = 0;
+
+  for (int l = 0; l < props->nr_shifts; l++) {
+
+    /* Distances between the observer and the shifted box. */
+    double dmin2 = 0., dmax2 = 0.;
+    for (int k = 0; k < 3; k++) {
+      const double lo = box_min[k] + props->shifts[l][k] - o[k];
+      const double hi = box_max[k] + props->shifts[l][k] - o[k];
+      const double dmin = lo > 0. ? lo : (hi < 0. ? -hi : 0.);
+      const double dmax = max(fabs(lo), fabs(hi));
+      dmin2 += dmin * dmin;
+      dmax2 += dmax * dmax;
+    }
+
+    /* A crossing needs a particle inside the old sphere and one outside the
+     * new one. */
+    if (dmin2 <= r_old * r_old && dmax2 >= r_new * r_new) list[count++] = l;
+  }
+
+  return count;
+}
+
+/**
+ * @brief Does a particle cross the lightcone in a given replication?
+ *
+ * The distance to the observer and the radius of the lightcone are both
+ * interpolated linearly over the drift.
+ *
+ * @param props The #lightcone_props.
+ * @param shift The shift of the replication.
+ * @param x The position at the end of the drift.
+ * @param dx The displacement during the drift.
+ * @param r_old Radius of the lightcone at the start of the drift.
+ * @param r_new Radius of the lightcone at the end of the drift.
+ * @param x_cross (return) The position at the crossing.
+ * @param w (return) The fraction of the drift at the crossing.
+ */
+static int lightcone_crossing(const struct lightcone_props *props,
+                              const double shift[3], const double x[3],
+                              const double dx[3], double r_old, double r_new,
+                              double x_cross[3], double *w) {
+
+  const double *o = props->observer_position;
+  double d2_old = 0., d2_new = 0.;
+  for (int k = 0; k < 3; k++) {
+    const double d_new = x[k] + shift[k] - o[k];
+    const double d_old = d_new - dx[k];
+    d2_old += d_old * d_old;
+    d2_new += d_new * d_new;
+  }
+
+  /* Inside the lightcone before, outside after? */
+  const double g_old = sqrt(d2_old) - r_old;
+  const double g_new = sqrt(d2_new) - r_new;
+  if (!(g_old < 0. && g_new >= 0.)) return 0;
+
+  *w = g_old / (g_old - g_new);
+  for (int k = 0; k < 3; k++)
+    x_cross[k] = x[k] + shift[k] - (1. - *w) * dx[k];
+  return 1;
+}
+
+/**
+ * @brief Add some crossings to the buffer waiting to be written.
+ *
+ * @param props The #lightcone_props.
+ * @param list The crossings.
+ * @param count The number of crossings.
+ */
+static void lightcone_add(struct lightcone_props *props,
+                          const struct lightcone_particle *list, int count) {
+
+  if (lock_lock(&props->lock) != 0) error("Failed to lock the lightcone.");
+
+  if (props->nr_buffer + count > props->size_buffer) {
+    while (props->nr_buffer + count > props->size_buffer)
+      props->size_buffer = props->size_buffer > 0 ? 2 * props->size_buffer
+                                                  : lightcone_leaf_buffer_size;
+    struct lightcone_particle *temp = (struct lightcone_particle *)realloc(
+        props->buffer, sizeof(struct lightcone_particle) * props->size_buffer);
+    if (temp == NULL) error("Failed to grow the lightcone buffer.");
+    props->buffer = temp;
+  }
+  memcpy(&props->buffer[props->nr_buffer], list,
+         sizeof(struct lightcone_particle) * count);
+  props->nr_buffer += count;
+
+  if (lock_unlock(&props->lock) != 0) error("Failed to unlock the lightcone.");
+}
+
+/**
+ * @brief Initialises the lightcone output.
+ *
+ * @param props The #lightcone_props to initialise.
+ * @param params The parsed parameters.
+ * @param s The #space.
+ * @param nodeID The rank of this node.
+ * @param nr_threads The number of threads of the runners and of the threadpool.
+ * @param restart Are we restarting? If so, append to the existing file.
+ * @param verbose Are we talkative ?
+ */
+void lightcone_init(struct lightcone_props *props, struct swift_params *params,
+                    const struct space *s, int nodeID, int nr_threads,
+                    int restart, int verbose) {
+
+  /* The observer defaults to the centre of the box. */
+  for (int k = 0; k < 3; k++) props->observer_position[k] = 0.5 * s->dim[k];
+  parser_get_opt_param_double_array(params, "Lightcone:observer_position", 3,
+                                    props->observer_position);
+
+  /* List the replications of the box to search. */
+  const int nr_rep =
+      s->periodic ? parser_get_opt_param_int(params,
+                                             "Lightcone:max_replications",
+                                             lightcone_replications_default)
+                  : 0;
+  if (nr_rep < 0 || nr_rep > 100)
+    error("Lightcone:max_replications must be between 0 and 100.");
+  const int n = 2 * nr_rep + 1;
+  props->nr_shifts = n * n * n;
+  props->shifts =
+      (double(*)[3])malloc(sizeof(double) * 3 * (size_t)props->nr_shifts);
+  if (props->shifts == NULL) error("Failed to allocate the lightcone shifts.");
+  int l = 0;
+  for (int i = -nr_rep; i <= nr_rep; i++)
+    for (int j = -nr_rep; j <= nr_rep; j++)
+      for (int k = -nr_rep; k <= nr_rep; k++) {
+        props->shifts[l][0] = i * s->dim[0];
+        props->shifts[l][1] = j * s->dim[1];
+        props->shifts[l][2] = k * s->dim[2];
+        l++;
+      }
+
+  /* The particles are checked by the runners and by the threads of the
+   * threadpool (which includes the main thread). */
+  props->nr_shift_lists = 2 * nr_threads;
+  props->nr_threads = 0;
+  props->shift_lists = (int *)malloc(sizeof(int) * (size_t)props->nr_shifts *
+                                     props->nr_shift_lists);
+  if (props->shift_lists == NULL)
+    error("Failed to allocate the lists of lightcone replications.");
+
+  /* Prepare the buffer. */
+  props->buffer = NULL;
+  props->nr_buffer = 0;
+  props->size_buffer = 0;
+  props->nr_written = 0;
+  lock_init(&props->lock);
+
+  /* Open this rank's file. */
+  char base_name[PARSER_MAX_LINE_SIZE];
+  parser_get_opt_param_string(params, "Lightcone:basename", base_name,
+                              "lightcone");
+  sprintf(props->file_name, "%s_%04d.dat", base_name, nodeID);
+  props->file = fopen(props->file_name, restart ? "a" : "w");
+  if (props->file == NULL)
+    error("Could not open the lightcone file '%s'.", props->file_name);
+
+  if (verbose)
+    message("Writing the lightcone of the observer at [%e %e %e] to '%s'.",
+            props->observer_position[0], props->observer_position[1],
+            props->observer_position[2], props->file_name);
+}
+
+/**
+ * @brief Look for the #part without #gpart crossing the lightcone during their
+ * last drift.
+ *
+ * The particles with a #gpart are written through their #gpart.
+ *
+ * @param props The #lightcone_props.
+ * @param e The #engine.
+ * @param parts The #part, already drifted.
+ * @param xparts The #xpart.
+ * @param count The number of particles.
+ * @param dt_drift The drift factor used.
+ * @param ti_old Start of the drift.
+ * @param ti_current End of the drift.
+ */
+void lightcone_check_parts(struct lightcone_props *props,
+                           const struct engine *e, const struct part *parts,
+                           const struct xpart *xparts, int count,
+                           double dt_drift, integertime_t ti_old,
+                           integertime_t ti_current) {
+
+  if (count == 0 || ti_current <= ti_old) return;
+
+  const double r_old = lightcone_radius(e, ti_old);
+  const double r_new = lightcone_radius(e, ti_current);
+
+  /* Region covered by the particles during the drift. */
+  double box_min[3] = {DBL_MAX, DBL_MAX, DBL_MAX};
+  double box_max[3] = {-DBL_MAX, -DBL_MAX, -DBL_MAX};
+  for (int i = 0; i < count; i++) {
+    if (parts[i].gpart != NULL) continue;
+    for (int k = 0; k < 3; k++) {
+      const double x = parts[i].x[k];
+      const double x_old = x - xparts[i].v_full[k] * dt_drift;
+      box_min[k] = min3(box_min[k], x, x_old);
+      box_max[k] = max3(box_max[k], x, x_old);
+    }
+  }
+  if (box_min[0] > box_max[0]) return;
+
+  /* Which replications can we cross? */
+  int *list = lightcone_get_shift_list(props);
+  const int nr_list =
+      lightcone_find_shifts(props, box_min, box_max, r_old, r_new, list);
+  if (nr_list == 0) return;
+
+  struct lightcone_particle buff[lightcone_leaf_buffer_size];
+  int nr_buff = 0;
+
+  for (int i = 0; i < count; i++) {
+    const struct part *p = &parts[i];
+    const struct xpart *xp = &xparts[i];
+    if (p->gpart != NULL) continue;
+
+    const double dx[3] = {xp->v_full[0] * dt_drift, xp->v_full[1] * dt_drift,
+                          xp->v_full[2] * dt_drift};
+    for (int l = 0; l < nr_list; l++) {
+      double x_cross[3], w;
+      if (!lightcone_crossing(props, props->shifts[list[l]], p->x, dx, r_old,
+                              r_new, x_cross, &w))
+        continue;
+
+      struct lightcone_particle *lp = &buff[nr_buff++];
+      lp->id = p->id;
+      lp->type = swift_type_gas;
+      for (int k = 0; k < 3; k++) {
+        lp->x[k] = x_cross[k];
+        lp->v[k] = xp->v_full[k];
+      }
+      lp->a = lightcone_time(e, ti_old, ti_current, w);
+
+      if (nr_buff == lightcone_leaf_buffer_size) {
+        lightcone_add(props, buff, nr_buff);
+        nr_buff = 0;
+      }
+    }
+  }
+
+  if (nr_buff > 0) lightcone_add(props, buff, nr_buff);
+}
+
+/**
+ * @brief Look for the #gpart crossing the lightcone during their last drift.
+ *
+ * @param props The #lightcone_props.
+ * @param e The #engine.
+ * @param gparts The #gpart, already drifted.
+ * @param count The number of particles.
+ * @param dt_drift The drift factor used.
+ * @param ti_old Start of the drift.
+ * @param ti_current End of the drift.
+ */
+void lightcone_check_gparts(struct lightcone_props *props,
+                            const struct engine *e, const struct gpart *gparts,
+                            int count, double dt_drift, integertime_t ti_old,
+                            integertime_t ti_current) {
+
+  if (count == 0 || ti_current <= ti_old) return;
+
+  const struct space *s = e->s;
+  const double r_old = lightcone_radius(e, ti_old);
+  const double r_new = lightcone_radius(e, ti_current);
+
+  /* Region covered by the particles during the drift. */
+  double box_min[3] = {DBL_MAX, DBL_MAX, DBL_MAX};
+  double box_max[3] = {-DBL_MAX, -DBL_MAX, -DBL_MAX};
+  for (int i = 0; i < count; i++) {
+    for (int k = 0; k < 3; k++) {
+      const double x = gparts[i].x[k];
+      const double x_old = x - gparts[i].v_full[k] * dt_drift;
+      box_min[k] = min3(box_min[k], x, x_old);
+      box_max[k] = max3(box_max[k], x, x_old);
+    }
+  }
+
+  /* Which replications can we cross? */
+  int *list = lightcone_get_shift_list(props);
+  const int nr_list =
+      lightcone_find_shifts(props, box_min, box_max, r_old, r_new, list);
+  if (nr_list == 0) return;
+
+  struct lightcone_particle buff[lightcone_leaf_buffer_size];
+  int nr_buff = 0;
+
+  for (int i = 0; i < count; i++) {
+    const struct gpart *gp = &gparts[i];
+
+    const double dx[3] = {gp->v_full[0] * dt_drift, gp->v_full[1] * dt_drift,
+                          gp->v_full[2] * dt_drift};
+    for (int l = 0; l < nr_list; l++) {
+      double x_cross[3], w;
+      if (!lightcone_crossing(props, props->shifts[list[l]], gp->x, dx, r_old,
+                              r_new, x_cross, &w))
+        continue;
+
+      struct lightcone_particle *lp = &buff[nr_buff++];
+      if (gp->type == swift_type_gas)
+        lp->id = s->parts[-gp->id_or_neg_offset].id;
+      else if (gp->type == swift_type_star)
+        lp->id = s->sparts[-gp->id_or_neg_offset].id;
+      else
+        lp->id = gp->id_or_neg_offset;
+      lp->type = gp->type;
+      for (int k = 0; k < 3; k++) {
+        lp->x[k] = x_cross[k];
+        lp->v[k] = gp->v_full[k];
+      }
+      lp->a = lightcone_time(e, ti_old, ti_current, w);
+
+      if (nr_buff == lightcone_leaf_buffer_size) {
+        lightcone_add(props, buff, nr_buff);
+        nr_buff = 0;
+      }
+    }
+  }
+
+  if (nr_buff > 0) lightcone_add(props, buff, nr_buff);
+}
+
+/**
+ * @brief Write the crossings collected so far to the file.
+ *
+ * @param props The #lightcone_props.
+ */
+void lightcone_flush(struct lightcone_props *props) {
+
+  if (props->nr_buffer == 0) return;
+
+  if (fwrite(props->buffer, sizeof(struct lightcone_particle),
+             props->nr_buffer, props->file) != props->nr_buffer)
+    error("Failed to write to the lightcone file '%s'.", props->file_name);
+  fflush(props->file);
+
+  props->nr_written += props->nr_buffer;
+  props->nr_buffer = 0;
+}
+
+/**
+ * @brief Write the remaining crossings and close the lightcone output.
+ *
+ * @param props The #lightcone_props.
+ */
+void lightcone_clean(struct lightcone_props *props) {
+
+  lightcone_flush(props);
+  fclose(props->file);
+  free(props->buffer);
+  free(props->shifts);
+  free(props->shift_lists);
+  if (lock_destroy(&props->lock) != 0) error("Failed to destroy lock.");
+}
@@ -0,0 +1,121 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#ifndef SWIFT_LIGHTCONE_H
+#define SWIFT_LIGHTCONE_H
+
+/* Config parameters. */
+#include "../config.h"
+
+/* Some standard headers. */
+#include <stdio.h>
+
+/* Local includes. */
+#include "lock.h"
+#include "parser.h"
+#include "part.h"
+#include "timeline.h"
+
+/* Avoid cyclic inclusions */
+struct engine;
+struct space;
+
+/* Default number of replications of the box searched in each direction. */
+#define lightcone_replications_default 1
+
+/* Number of crossings collected in a leaf before they are added to the
+ * global buffer. */
+#define lightcone_leaf_buffer_size 128
+
+/**
+ * @brief A particle crossing the past lightcone of the observer.
+ *
+ * The lightcone files are plain sequences of these records, one file per
+ * rank.
+ */
+struct lightcone_particle {
+
+  /*! The particle ID. */
+  long long id;
+
+  /*! Position at the crossing, including the shift of the replication. */
+  double x[3];
+
+  /*! Velocity at the crossing. */
+  float v[3];
+
+  /*! The particle type. */
+  int type;
+
+  /*! Scale-factor (or time if not cosmological) of the crossing. */
+  double a;
+};
+
+/**
+ * @brief The properties of the lightcone output.
+ *
+ * The observer sits at the end of the simulation, so the radius of its past
+ * lightcone at a given time is the comoving distance light travels from that
+ * time to the end of the run.
+ */
+struct lightcone_props {
+
+  /*! Position of the observer. */
+  double observer_position[3];
+
+  /*! The shifts of the periodic replications of the box to search. */
+  double (*shifts)[3];
+  int nr_shifts;
+
+  /*! One list of the replications to check per thread. */
+  int *shift_lists;
+  int nr_shift_lists;
+
+  /*! Number of threads that were given a list so far. */
+  int nr_threads;
+
+  /*! Crossings waiting to be written. */
+  struct lightcone_particle *buffer;
+  size_t nr_buffer, size_buffer;
+
+  /*! Lock protecting the buffer. */
+  swift_lock_type lock;
+
+  /*! The file of this rank and its name. */
+  FILE *file;
+  char file_name[PARSER_MAX_LINE_SIZE + 32];
+
+  /*! Number of crossings written so far. */
+  long long nr_written;
+};
+
+void lightcone_init(struct lightcone_props *props, struct swift_params *params,
+                    const struct space *s, int nodeID, int nr_threads,
+                    int restart, int verbose);
+void lightcone_check_parts(struct lightcone_props *props,
+                           const struct engine *e, const struct part *parts,
+                           const struct xpart *xparts, int count,
+                           double dt_drift, integertime_t ti_old,
+                           integertime_t ti_current);
+void lightcone_check_gparts(struct lightcone_props *props,
+                            const struct engine *e, const struct gpart *gparts,
+                            int count, double dt_drift, integertime_t ti_old,
+                            integertime_t ti_current);
+void lightcone_flush(struct lightcone_props *props);
+void lightcone_clean(struct lightcone_props *props);
+
+#endif /* SWIFT_LIGHTCONE_H */
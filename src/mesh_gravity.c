@@ -424,6 +424,208 @@ void pm_mesh_compute_potential(struct pm_mesh* mesh, const struct space* s,
 #endif
 }
 
+#ifdef HAVE_FFTW
+
+/**
+ * @brief Accumulate |rho_k|^2 of a transformed density mesh in shells of
+ * integer wave-number.
+ *
+ * The CIC window is de-convolved from each mode. Modes beyond the Nyquist
+ * frequency of the mesh are ignored.
+ *
+ * @param frho The Fourier transform of the density mesh.
+ * @param N The side-length of the mesh.
+ * @param k_sum (return) The sum of |k| (in units of the fundamental mode of
+ * the mesh) of the modes in each shell.
+ * @param p_sum (return) The sum of |rho_k|^2 of the modes in each shell.
+ * @param n_modes (return) The number of modes in each shell.
+ */
+static void mesh_bin_power_spectrum(const fftw_complex* frho, int N,
+                                    double* k_sum, double* p_sum,
+                                    long long* n_modes) {
+
+  const int N_half = N / 2;
+  const double k_fac = M_PI / (double)N;
+
+  for (int i = 0; i < N; ++i) {
+
+    const int kx = (i > N_half ? i - N : i);
+    const double fx = k_fac * kx;
+    const double sinc_kx_inv = (kx != 0) ? fx / sin(fx) : 1.;
+
+    for (int j = 0; j < N; ++j) {
+
+      const int ky = (j > N_half ? j - N : j);
+      const double fy = k_fac * ky;
+      const double sinc_ky_inv = (ky != 0) ? fy / sin(fy) : 1.;
+
+      for (int k = 0; k < N_half + 1; ++k) {
+
+        const int kz = k;
+        const double fz = k_fac * kz;
+        const double sinc_kz_inv = (kz != 0) ? fz / sin(fz) : 1.;
+
+        /* Which shell is this mode in? */
+        const double k_norm = sqrt((double)(kx * kx + ky * ky + kz * kz));
+        const int bin = (int)(k_norm + 0.5);
+        if (bin == 0 || bin > N_half) continue;
+
+        /* The modes with 0 < kz < N/2 stand for their complex conjugate */
+        const int weight = (k == 0 || k == N_half) ? 1 : 2;
+
+        /* De-convolution of the CIC window (squared) */
+        const double CIC_cor = sinc_kx_inv * sinc_ky_inv * sinc_kz_inv;
+        const double CIC_cor2 = CIC_cor * CIC_cor;
+        const double CIC_cor4 = CIC_cor2 * CIC_cor2;
+
+        const int index = N * (N_half + 1) * i + (N_half + 1) * j + k;
+        const double power =
+            frho[index][0] * frho[index][0] + frho[index][1] * frho[index][1];
+
+        k_sum[bin] += weight * k_norm;
+        p_sum[bin] += weight * power * CIC_cor4;
+        n_modes[bin] += weight;
+      }
+    }
+  }
+}
+
+#endif
+
+/**
+ * @brief Measure the matter power spectrum using the long-range gravity mesh
+ * and write it to a file.
+ *
+ * The #gpart are assigned to the mesh with CIC and transformed in the same
+ * way as for the potential. The power is binned in shells of width the
+ * fundamental mode of the box, de-convolved from the CIC window and
+ * corrected for shot-noise. If a folding factor > 1 is given, the positions
+ * are also folded into a box smaller by that factor and a second set of
+ * bins reaching that many times higher wave-numbers is written.
+ *
+ * Note that this uses its own copy of the mesh, the potential used for the
+ * forces is left untouched. Like the potential, the mesh only holds the
+ * #gpart of this node, which are all the #gpart as periodic gravity is not
+ * available over MPI.
+ *
+ * @param mesh The #pm_mesh.
+ * @param s The #space containing the particles.
+ * @param fold The folding factor (0 or 1 for no folding).
+ * @param file_name The name of the file to write to.
+ * @param time The time (or scale-factor) to write in the file.
+ * @param nodeID The rank of this node, only rank 0 writes.
+ * @param verbose Are we talkative?
+ */
+void pm_mesh_compute_power_spectrum(const struct pm_mesh* mesh,
+                                    const struct space* s, int fold,
+                                    const char* file_name, double time,
+                                    int nodeID, int verbose) {
+
+#ifdef HAVE_FFTW
+
+  const ticks tic = getticks();
+
+  const int N = mesh->N;
+  const int N_half = N / 2;
+  const double box_size = s->dim[0];
+  const int nr_folds = (fold > 1) ? 2 : 1;
+
+  /* Total mass and shot-noise of the gparts. */
+  double mass_sum[2] = {0., 0.};
+  for (size_t i = 0; i < s->nr_gparts; ++i) {
+    mass_sum[0] += s->gparts[i].mass;
+    mass_sum[1] += s->gparts[i].mass * s->gparts[i].mass;
+  }
+  if (mass_sum[0] <= 0.) error("Cannot measure the power of an empty box.");
+  const double volume = box_size * box_size * box_size;
+  const double p_fac = volume / (mass_sum[0] * mass_sum[0]);
+  const double shot_noise = volume * mass_sum[1] / (mass_sum[0] * mass_sum[0]);
+
+  /* Memory for the meshes and the bins */
+  double* restrict rho = (double*)fftw_malloc(sizeof(double) * N * N * N);
+  fftw_complex* restrict frho =
+      (fftw_complex*)fftw_malloc(sizeof(fftw_complex) * N * N * (N_half + 1));
+  if (rho == NULL || frho == NULL)
+    error("Error allocating memory for the power spectrum meshes.");
+  double* k_sum = (double*)calloc(nr_folds * (N_half + 1), sizeof(double));
+  double* p_sum = (double*)calloc(nr_folds * (N_half + 1), sizeof(double));
+  long long* n_modes =
+      (long long*)calloc(nr_folds * (N_half + 1), sizeof(long long));
+  if (k_sum == NULL || p_sum == NULL || n_modes == NULL)
+    error("Error allocating memory for the power spectrum bins.");
+
+  fftw_plan forward_plan = fftw_plan_dft_r2c_3d(
+      N, N, N, rho, frho, FFTW_ESTIMATE | FFTW_DESTROY_INPUT);
+
+  for (int f = 0; f < nr_folds; ++f) {
+
+    /* Fold the particles into a box (f > 0 ? fold : 1) times smaller. */
+    const int fac = (f == 0) ? 1 : fold;
+    const double dim[3] = {s->dim[0] / fac, s->dim[1] / fac, s->dim[2] / fac};
+    const double cell_fac = N * fac / box_size;
+
+    /* Do a CIC mesh assignment of the (folded) gparts */
+    bzero(rho, N * N * N * sizeof(double));
+    for (size_t i = 0; i < s->nr_gparts; ++i) {
+      if (fac == 1) {
+        gpart_to_mesh_CIC(&s->gparts[i], rho, N, cell_fac, dim);
+      } else {
+        struct gpart gp = s->gparts[i];
+        for (int k = 0; k < 3; ++k)
+          gp.x[k] = fmod(box_wrap(gp.x[k], 0., s->dim[k]), dim[k]);
+        gpart_to_mesh_CIC(&gp, rho, N, cell_fac, dim);
+      }
+    }
+
+    /* Fourier transform and bin */
+    fftw_execute(forward_plan);
+    mesh_bin_power_spectrum(frho, N, &k_sum[f * (N_half + 1)],
+                            &p_sum[f * (N_half + 1)],
+                            &n_modes[f * (N_half + 1)]);
+  }
+
+  /* Write the bins */
+  if (nodeID == 0) {
+    FILE* file = fopen(file_name, "w");
+    if (file == NULL)
+      error("Could not open the power spectrum file '%s'.", file_name);
+
+    fprintf(file, "# Matter power spectrum at time/scale-factor %e\n", time);
+    fprintf(file, "# Mesh size: %d, box size: %e, shot-noise: %e\n", N,
+            box_size, shot_noise);
+    fprintf(file, "# (0) k, (1) P(k), (2) number of modes, (3) fold\n");
+
+    for (int f = 0; f < nr_folds; ++f) {
+      const int fac = (f == 0) ? 1 : fold;
+      const double k_unit = 2. * M_PI * fac / box_size;
+      for (int bin = 1; bin <= N_half; ++bin) {
+        const int b = f * (N_half + 1) + bin;
+        if (n_modes[b] == 0) continue;
+        fprintf(file, "%e %e %lld %d\n", k_unit * k_sum[b] / n_modes[b],
+                p_fac * p_sum[b] / n_modes[b] - shot_noise, n_modes[b], fac);
+      }
+    }
+
+    fclose(file);
+  }
+
+  /* Clean-up the mess */
+  fftw_destroy_plan(forward_plan);
+  fftw_free(rho);
+  fftw_free(frho);
+  free(k_sum);
+  free(p_sum);
+  free(n_modes);
+
+  if (verbose)
+    message("Measuring the power spectrum took %.3f %s.",
+            clocks_from_ticks(getticks() - tic), clocks_getunit());
+
+#else
+  error("No FFTW library found. Cannot compute the power spectrum.");
+#endif
+}
+
 /**
  * @brief Interpolate the forces and potential from the mesh to the #gpart.
  *
@@ -68,6 +68,10 @@ void pm_mesh_init(struct pm_mesh *mesh, const struct gravity_props *props,
 void pm_mesh_init_no_mesh(struct pm_mesh *mesh, double dim[3]);
 void pm_mesh_compute_potential(struct pm_mesh *mesh, const struct space *s,
                                int verbose);
+void pm_mesh_compute_power_spectrum(const struct pm_mesh *mesh,
+                                    const struct space *s, int fold,
+                                    const char *file_name, double time,
+                                    int nodeID, int verbose);
 void pm_mesh_interpolate_forces(const struct pm_mesh *mesh,
                                 const struct engine *e, struct gpart *gparts,
                                 int gcount);
@@ -214,6 +214,96 @@ void proxy_addcell_out(struct proxy *p, struct cell *c, int type) {
   p->nr_cells_out += 1;
 }
 
+/**
+ * @brief Add a list of cells to the given proxy's input list.
+ *
+ * The cells must be distinct and not already in the proxy, this
+ * skips the search for duplicates done by proxy_addcell_in().
+ *
+ * @param p The #proxy.
+ * @param cells The #cell%s.
+ * @param types Why is each cell in the proxy (hydro, gravity, ...) ?
+ * @param count The number of cells.
+ */
+void proxy_addcells_in(struct proxy *p, struct cell **cells, const int *types,
+                       int count) {
+
+  /* Do we need to grow the number of in cells? */
+  if (p->nr_cells_in + count > p->size_cells_in) {
+
+    while (p->nr_cells_in + count > p->size_cells_in)
+      p->size_cells_in *= proxy_buffgrow;
+
+    struct cell **temp_cell;
+    if ((temp_cell = (struct cell **)malloc(sizeof(struct cell *) *
+                                            p->size_cells_in)) == NULL)
+      error("Failed to allocate incoming cell list.");
+    memcpy(temp_cell, p->cells_in, sizeof(struct cell *) * p->nr_cells_in);
+    free(p->cells_in);
+    p->cells_in = temp_cell;
+
+    int *temp_type;
+    if ((temp_type = (int *)malloc(sizeof(int) * p->size_cells_in)) == NULL)
+      error("Failed to allocate incoming cell type list.");
+    memcpy(temp_type, p->cells_in_type, sizeof(int) * p->nr_cells_in);
+    free(p->cells_in_type);
+    p->cells_in_type = temp_type;
+  }
+
+  /* Add the cells. */
+  for (int k = 0; k < count; k++) {
+    if (types[k] == proxy_cell_type_none) error("Invalid type for proxy");
+    p->cells_in[p->nr_cells_in] = cells[k];
+    p->cells_in_type[p->nr_cells_in] = types[k];
+    p->nr_cells_in += 1;
+  }
+}
+
+/**
+ * @brief Add a list of cells to the given proxy's output list.
+ *
+ * The cells must be distinct and not already in the proxy, this
+ * skips the search for duplicates done by proxy_addcell_out().
+ *
+ * @param p The #proxy.
+ * @param cells The #cell%s.
+ * @param types Why is each cell in the proxy (hydro, gravity, ...) ?
+ * @param count The number of cells.
+ */
+void proxy_addcells_out(struct proxy *p, struct cell **cells, const int *types,
+                        int count) {
+
+  /* Do we need to grow the number of out cells? */
+  if (p->nr_cells_out + count > p->size_cells_out) {
+
+    while (p->nr_cells_out + count > p->size_cells_out)
+      p->size_cells_out *= proxy_buffgrow;
+
+    struct cell **temp_cell;
+    if ((temp_cell = (struct cell **)malloc(sizeof(struct cell *) *
+                                            p->size_cells_out)) == NULL)
+      error("Failed to allocate outgoing cell list.");
+    memcpy(temp_cell, p->cells_out, sizeof(struct cell *) * p->nr_cells_out);
+    free(p->cells_out);
+    p->cells_out = temp_cell;
+
+    int *temp_type;
+    if ((temp_type = (int *)malloc(sizeof(int) * p->size_cells_out)) == NULL)
+      error("Failed to allocate outgoing cell type list.");
+    memcpy(temp_type, p->cells_out_type, sizeof(int) * p->nr_cells_out);
+    free(p->cells_out_type);
+    p->cells_out_type = temp_type;
+  }
+
+  /* Add the cells. */
+  for (int k = 0; k < count; k++) {
+    if (types[k] == proxy_cell_type_none) error("Invalid type for proxy");
+    p->cells_out[p->nr_cells_out] = cells[k];
+    p->cells_out_type[p->nr_cells_out] = types[k];
+    p->nr_cells_out += 1;
+  }
+}
+
 /**
  * @brief Exchange particles with a remote node.
  *
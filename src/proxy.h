@@ -43,6 +43,7 @@ enum proxy_cell_type {
   proxy_cell_type_none = 0,
   proxy_cell_type_hydro = (1 << 0),
   proxy_cell_type_gravity = (1 << 1),
+  proxy_cell_type_gravity_mpole = (1 << 2),
 };
 
 /* Data structure for the proxy. */
@@ -100,6 +101,10 @@ void proxy_parts_exch1(struct proxy *p);
 void proxy_parts_exch2(struct proxy *p);
 void proxy_addcell_in(struct proxy *p, struct cell *c, int type);
 void proxy_addcell_out(struct proxy *p, struct cell *c, int type);
+void proxy_addcells_in(struct proxy *p, struct cell **cells, const int *types,
+                       int count);
+void proxy_addcells_out(struct proxy *p, struct cell **cells, const int *types,
+                        int count);
 void proxy_cells_exch1(struct proxy *p);
 void proxy_cells_exch2(struct proxy *p);
 
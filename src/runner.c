@@ -719,8 +719,15 @@ void runner_do_ghost(struct runner *r, struct cell *c, int timer) {
 
   /* Recurse? */
   if (c->split) {
+    float h_max = 0.f;
     for (int k = 0; k < 8; k++)
-      if (c->progeny[k] != NULL) runner_do_ghost(r, c->progeny[k], 0);
+      if (c->progeny[k] != NULL) {
+        runner_do_ghost(r, c->progeny[k], 0);
+        h_max = max(h_max, c->progeny[k]->h_max);
+      }
+
+    /* Keep h_max an upper bound for the pruning of the force loop. */
+    c->h_max = h_max;
   } else {
 
     /* Init the list of active particles that have to be updated. */
@@ -960,6 +967,11 @@ void runner_do_ghost(struct runner *r, struct cell *c, int timer) {
 
     /* Be clean */
     free(pid);
+
+    /* The smoothing lengths may have grown beyond the drifted h_max. */
+    float h_max = 0.f;
+    for (int k = 0; k < c->count; k++) h_max = max(h_max, parts[k].h);
+    c->h_max = h_max;
   }
 
   if (timer) TIMER_TOC(timer_do_ghost);
@@ -1019,7 +1031,8 @@ static void runner_do_unskip_gravity(struct cell *c, struct engine *e) {
   }
 
   /* Unskip any active tasks. */
-  cell_unskip_gravity_tasks(c, &e->sched);
+  const int forcerebuild = cell_unskip_gravity_tasks(c, &e->sched);
+  if (forcerebuild) atomic_inc(&e->forcerebuild);
 }
 
 /**
@@ -1066,6 +1079,35 @@ void runner_do_drift_part(struct runner *r, struct cell *c, int timer) {
   if (timer) TIMER_TOC(timer_drift_part);
 }
 
+/**
+ * @brief Drift the cells of a task that needs up-to-date #part, when there
+ * are no drift tasks to do it.
+ *
+ * The sorts and the density loops are the first tasks to use the #part of a
+ * cell in a step. Whichever of them runs first on a given super-cell drifts
+ * it.
+ *
+ * @param r The runner thread.
+ * @param t The #task about to be run.
+ */
+static void runner_do_drift_part_on_demand(struct runner *r,
+                                           const struct task *t) {
+
+  const int is_density_loop =
+      (t->type == task_type_self || t->type == task_type_pair ||
+       t->type == task_type_sub_self || t->type == task_type_sub_pair) &&
+      t->subtype == task_subtype_density;
+  if (t->type != task_type_sort && !is_density_loop) return;
+
+  TIMER_TIC;
+
+  int drifted = cell_drift_part_on_demand(t->ci, r->e);
+  if (t->cj != NULL) drifted |= cell_drift_part_on_demand(t->cj, r->e);
+
+  /* Only time the calls that did the work of a drift task. */
+  if (drifted) TIMER_TOC(timer_drift_part);
+}
+
 /**
  * @brief Drift all gpart in a cell.
  *
@@ -1082,6 +1124,60 @@ void runner_do_drift_gpart(struct runner *r, struct cell *c, int timer) {
   if (timer) TIMER_TOC(timer_drift_gpart);
 }
 
+/**
+ * @brief Returns the time intervals of a half-kick of the particles in a
+ * given time-bin.
+ *
+ * All the particles of a bin share the same kick interval in a given step,
+ * so the intervals are only computed the first time a runner needs them in
+ * that step. This saves the integer divisions of the time-line functions
+ * and the cosmology integrals for every single particle.
+ *
+ * @param r The runner thread.
+ * @param time_bin The time-bin of the particles.
+ * @param first_half Is this the first (kick1) or second (kick2) half-kick?
+ */
+static const struct runner_kick_factors *runner_get_kick_factors(
+    struct runner *r, timebin_t time_bin, int first_half) {
+
+  const struct engine *e = r->e;
+  const integertime_t ti_current = e->ti_current;
+  struct runner_kick_factors *f = &r->kick_factors[first_half][(int)time_bin];
+
+  /* Already done in this step? */
+  if (f->ti_current == ti_current) return f;
+
+  const integertime_t ti_step = get_integer_timestep(time_bin);
+  if (first_half) {
+    f->ti_start = get_integer_time_begin(ti_current + 1, time_bin);
+    f->ti_end = f->ti_start + ti_step / 2;
+  } else {
+    const integertime_t ti_begin = get_integer_time_begin(ti_current, time_bin);
+    f->ti_start = ti_begin + ti_step / 2;
+    f->ti_end = ti_begin + ti_step;
+  }
+
+  if (e->policy & engine_policy_cosmology) {
+    const struct cosmology *cosmo = e->cosmology;
+    f->dt_kick_hydro =
+        cosmology_get_hydro_kick_factor(cosmo, f->ti_start, f->ti_end);
+    f->dt_kick_grav =
+        cosmology_get_grav_kick_factor(cosmo, f->ti_start, f->ti_end);
+    f->dt_kick_therm =
+        cosmology_get_therm_kick_factor(cosmo, f->ti_start, f->ti_end);
+    f->dt_kick_corr =
+        cosmology_get_corr_kick_factor(cosmo, f->ti_start, f->ti_end);
+  } else {
+    f->dt_kick_hydro = (ti_step / 2) * e->time_base;
+    f->dt_kick_grav = (ti_step / 2) * e->time_base;
+    f->dt_kick_therm = (ti_step / 2) * e->time_base;
+    f->dt_kick_corr = (ti_step / 2) * e->time_base;
+  }
+
+  f->ti_current = ti_current;
+  return f;
+}
+
 /**
  * @brief Perform the first half-kick on all the active particles in a cell.
  *
@@ -1094,7 +1190,6 @@ void runner_do_kick1(struct runner *r, struct cell *c, int timer) {
   const struct engine *e = r->e;
   const struct cosmology *cosmo = e->cosmology;
   const struct hydro_props *hydro_props = e->hydro_properties;
-  const int with_cosmology = (e->policy & engine_policy_cosmology);
   struct part *restrict parts = c->parts;
   struct xpart *restrict xparts = c->xparts;
   struct gpart *restrict gparts = c->gparts;
@@ -1102,8 +1197,9 @@ void runner_do_kick1(struct runner *r, struct cell *c, int timer) {
   const int count = c->count;
   const int gcount = c->gcount;
   const int scount = c->scount;
+#ifdef SWIFT_DEBUG_CHECKS
   const integertime_t ti_current = e->ti_current;
-  const double time_base = e->time_base;
+#endif
 
   TIMER_TIC;
 
@@ -1126,43 +1222,21 @@ void runner_do_kick1(struct runner *r, struct cell *c, int timer) {
       /* If particle needs to be kicked */
       if (part_is_starting(p, e)) {
 
-        const integertime_t ti_step = get_integer_timestep(p->time_bin);
-        const integertime_t ti_begin =
-            get_integer_time_begin(ti_current + 1, p->time_bin);
+        /* Time interval for this half-kick */
+        const struct runner_kick_factors *f =
+            runner_get_kick_factors(r, p->time_bin, 1);
 
 #ifdef SWIFT_DEBUG_CHECKS
-        const integertime_t ti_end =
-            get_integer_time_end(ti_current + 1, p->time_bin);
-
-        if (ti_begin != ti_current)
+        if (f->ti_start != ti_current)
           error(
-              "Particle in wrong time-bin, ti_end=%lld, ti_begin=%lld, "
-              "ti_step=%lld time_bin=%d ti_current=%lld",
-              ti_end, ti_begin, ti_step, p->time_bin, ti_current);
+              "Particle in wrong time-bin, ti_begin=%lld, time_bin=%d "
+              "ti_current=%lld",
+              f->ti_start, p->time_bin, ti_current);
 #endif
 
-        /* Time interval for this half-kick */
-        double dt_kick_grav, dt_kick_hydro, dt_kick_therm, dt_kick_corr;
-        if (with_cosmology) {
-          dt_kick_hydro = cosmology_get_hydro_kick_factor(
-              cosmo, ti_begin, ti_begin + ti_step / 2);
-          dt_kick_grav = cosmology_get_grav_kick_factor(cosmo, ti_begin,
-                                                        ti_begin + ti_step / 2);
-          dt_kick_therm = cosmology_get_therm_kick_factor(
-              cosmo, ti_begin, ti_begin + ti_step / 2);
-          dt_kick_corr = cosmology_get_corr_kick_factor(cosmo, ti_begin,
-                                                        ti_begin + ti_step / 2);
-        } else {
-          dt_kick_hydro = (ti_step / 2) * time_base;
-          dt_kick_grav = (ti_step / 2) * time_base;
-          dt_kick_therm = (ti_step / 2) * time_base;
-          dt_kick_corr = (ti_step / 2) * time_base;
-        }
-
         /* do the kick */
-        kick_part(p, xp, dt_kick_hydro, dt_kick_grav, dt_kick_therm,
-                  dt_kick_corr, cosmo, hydro_props, ti_begin,
-                  ti_begin + ti_step / 2);
+        kick_part(p, xp, f->dt_kick_hydro, f->dt_kick_grav, f->dt_kick_therm,
+                  f->dt_kick_corr, cosmo, hydro_props, f->ti_start, f->ti_end);
 
         /* Update the accelerations to be used in the drift for hydro */
         if (p->gpart != NULL) {
@@ -1183,32 +1257,20 @@ void runner_do_kick1(struct runner *r, struct cell *c, int timer) {
       /* If the g-particle has no counterpart and needs to be kicked */
       if (gp->type == swift_type_dark_matter && gpart_is_starting(gp, e)) {
 
-        const integertime_t ti_step = get_integer_timestep(gp->time_bin);
-        const integertime_t ti_begin =
-            get_integer_time_begin(ti_current + 1, gp->time_bin);
+        /* Time interval for this half-kick */
+        const struct runner_kick_factors *f =
+            runner_get_kick_factors(r, gp->time_bin, 1);
 
 #ifdef SWIFT_DEBUG_CHECKS
-        const integertime_t ti_end =
-            get_integer_time_end(ti_current + 1, gp->time_bin);
-
-        if (ti_begin != ti_current)
+        if (f->ti_start != ti_current)
           error(
-              "Particle in wrong time-bin, ti_end=%lld, ti_begin=%lld, "
-              "ti_step=%lld time_bin=%d ti_current=%lld",
-              ti_end, ti_begin, ti_step, gp->time_bin, ti_current);
+              "Particle in wrong time-bin, ti_begin=%lld, time_bin=%d "
+              "ti_current=%lld",
+              f->ti_start, gp->time_bin, ti_current);
 #endif
 
-        /* Time interval for this half-kick */
-        double dt_kick_grav;
-        if (with_cosmology) {
-          dt_kick_grav = cosmology_get_grav_kick_factor(cosmo, ti_begin,
-                                                        ti_begin + ti_step / 2);
-        } else {
-          dt_kick_grav = (ti_step / 2) * time_base;
-        }
-
         /* do the kick */
-        kick_gpart(gp, dt_kick_grav, ti_begin, ti_begin + ti_step / 2);
+        kick_gpart(gp, f->dt_kick_grav, f->ti_start, f->ti_end);
       }
     }
 
@@ -1221,32 +1283,20 @@ void runner_do_kick1(struct runner *r, struct cell *c, int timer) {
       /* If particle needs to be kicked */
       if (spart_is_starting(sp, e)) {
 
-        const integertime_t ti_step = get_integer_timestep(sp->time_bin);
-        const integertime_t ti_begin =
-            get_integer_time_begin(ti_current + 1, sp->time_bin);
+        /* Time interval for this half-kick */
+        const struct runner_kick_factors *f =
+            runner_get_kick_factors(r, sp->time_bin, 1);
 
 #ifdef SWIFT_DEBUG_CHECKS
-        const integertime_t ti_end =
-            get_integer_time_end(ti_current + 1, sp->time_bin);
-
-        if (ti_begin != ti_current)
+        if (f->ti_start != ti_current)
           error(
-              "Particle in wrong time-bin, ti_end=%lld, ti_begin=%lld, "
-              "ti_step=%lld time_bin=%d ti_current=%lld",
-              ti_end, ti_begin, ti_step, sp->time_bin, ti_current);
+              "Particle in wrong time-bin, ti_begin=%lld, time_bin=%d "
+              "ti_current=%lld",
+              f->ti_start, sp->time_bin, ti_current);
 #endif
 
-        /* Time interval for this half-kick */
-        double dt_kick_grav;
-        if (with_cosmology) {
-          dt_kick_grav = cosmology_get_grav_kick_factor(cosmo, ti_begin,
-                                                        ti_begin + ti_step / 2);
-        } else {
-          dt_kick_grav = (ti_step / 2) * time_base;
-        }
-
         /* do the kick */
-        kick_spart(sp, dt_kick_grav, ti_begin, ti_begin + ti_step / 2);
+        kick_spart(sp, f->dt_kick_grav, f->ti_start, f->ti_end);
       }
     }
   }
@@ -1268,7 +1318,6 @@ void runner_do_kick2(struct runner *r, struct cell *c, int timer) {
   const struct engine *e = r->e;
   const struct cosmology *cosmo = e->cosmology;
   const struct hydro_props *hydro_props = e->hydro_properties;
-  const int with_cosmology = (e->policy & engine_policy_cosmology);
   const int count = c->count;
   const int gcount = c->gcount;
   const int scount = c->scount;
@@ -1276,8 +1325,9 @@ void runner_do_kick2(struct runner *r, struct cell *c, int timer) {
   struct xpart *restrict xparts = c->xparts;
   struct gpart *restrict gparts = c->gparts;
   struct spart *restrict sparts = c->sparts;
+#ifdef SWIFT_DEBUG_CHECKS
   const integertime_t ti_current = e->ti_current;
-  const double time_base = e->time_base;
+#endif
 
   TIMER_TIC;
 
@@ -1300,39 +1350,21 @@ void runner_do_kick2(struct runner *r, struct cell *c, int timer) {
       /* If particle needs to be kicked */
       if (part_is_active(p, e)) {
 
-        const integertime_t ti_step = get_integer_timestep(p->time_bin);
-        const integertime_t ti_begin =
-            get_integer_time_begin(ti_current, p->time_bin);
+        /* Time interval for this half-kick */
+        const struct runner_kick_factors *f =
+            runner_get_kick_factors(r, p->time_bin, 0);
 
 #ifdef SWIFT_DEBUG_CHECKS
-        if (ti_begin + ti_step != ti_current)
+        if (f->ti_end != ti_current)
           error(
-              "Particle in wrong time-bin, ti_begin=%lld, ti_step=%lld "
-              "time_bin=%d ti_current=%lld",
-              ti_begin, ti_step, p->time_bin, ti_current);
+              "Particle in wrong time-bin, ti_end=%lld, time_bin=%d "
+              "ti_current=%lld",
+              f->ti_end, p->time_bin, ti_current);
 #endif
-        /* Time interval for this half-kick */
-        double dt_kick_grav, dt_kick_hydro, dt_kick_therm, dt_kick_corr;
-        if (with_cosmology) {
-          dt_kick_hydro = cosmology_get_hydro_kick_factor(
-              cosmo, ti_begin + ti_step / 2, ti_begin + ti_step);
-          dt_kick_grav = cosmology_get_grav_kick_factor(
-              cosmo, ti_begin + ti_step / 2, ti_begin + ti_step);
-          dt_kick_therm = cosmology_get_therm_kick_factor(
-              cosmo, ti_begin + ti_step / 2, ti_begin + ti_step);
-          dt_kick_corr = cosmology_get_corr_kick_factor(
-              cosmo, ti_begin + ti_step / 2, ti_begin + ti_step);
-        } else {
-          dt_kick_hydro = (ti_step / 2) * time_base;
-          dt_kick_grav = (ti_step / 2) * time_base;
-          dt_kick_therm = (ti_step / 2) * time_base;
-          dt_kick_corr = (ti_step / 2) * time_base;
-        }
 
         /* Finish the time-step with a second half-kick */
-        kick_part(p, xp, dt_kick_hydro, dt_kick_grav, dt_kick_therm,
-                  dt_kick_corr, cosmo, hydro_props, ti_begin + ti_step / 2,
-                  ti_begin + ti_step);
+        kick_part(p, xp, f->dt_kick_hydro, f->dt_kick_grav, f->dt_kick_therm,
+                  f->dt_kick_corr, cosmo, hydro_props, f->ti_start, f->ti_end);
 
 #ifdef SWIFT_DEBUG_CHECKS
         /* Check that kick and the drift are synchronized */
@@ -1353,27 +1385,16 @@ void runner_do_kick2(struct runner *r, struct cell *c, int timer) {
       /* If the g-particle has no counterpart and needs to be kicked */
       if (gp->type == swift_type_dark_matter && gpart_is_active(gp, e)) {
 
-        const integertime_t ti_step = get_integer_timestep(gp->time_bin);
-        const integertime_t ti_begin =
-            get_integer_time_begin(ti_current, gp->time_bin);
+        /* Time interval for this half-kick */
+        const struct runner_kick_factors *f =
+            runner_get_kick_factors(r, gp->time_bin, 0);
 
 #ifdef SWIFT_DEBUG_CHECKS
-        if (ti_begin + ti_step != ti_current)
-          error("Particle in wrong time-bin");
+        if (f->ti_end != ti_current) error("Particle in wrong time-bin");
 #endif
 
-        /* Time interval for this half-kick */
-        double dt_kick_grav;
-        if (with_cosmology) {
-          dt_kick_grav = cosmology_get_grav_kick_factor(
-              cosmo, ti_begin + ti_step / 2, ti_begin + ti_step);
-        } else {
-          dt_kick_grav = (ti_step / 2) * time_base;
-        }
-
         /* Finish the time-step with a second half-kick */
-        kick_gpart(gp, dt_kick_grav, ti_begin + ti_step / 2,
-                   ti_begin + ti_step);
+        kick_gpart(gp, f->dt_kick_grav, f->ti_start, f->ti_end);
 
 #ifdef SWIFT_DEBUG_CHECKS
         /* Check that kick and the drift are synchronized */
@@ -1395,27 +1416,16 @@ void runner_do_kick2(struct runner *r, struct cell *c, int timer) {
       /* If particle needs to be kicked */
       if (spart_is_active(sp, e)) {
 
-        const integertime_t ti_step = get_integer_timestep(sp->time_bin);
-        const integertime_t ti_begin =
-            get_integer_time_begin(ti_current, sp->time_bin);
+        /* Time interval for this half-kick */
+        const struct runner_kick_factors *f =
+            runner_get_kick_factors(r, sp->time_bin, 0);
 
 #ifdef SWIFT_DEBUG_CHECKS
-        if (ti_begin + ti_step != ti_current)
-          error("Particle in wrong time-bin");
+        if (f->ti_end != ti_current) error("Particle in wrong time-bin");
 #endif
 
-        /* Time interval for this half-kick */
-        double dt_kick_grav;
-        if (with_cosmology) {
-          dt_kick_grav = cosmology_get_grav_kick_factor(
-              cosmo, ti_begin + ti_step / 2, ti_begin + ti_step);
-        } else {
-          dt_kick_grav = (ti_step / 2) * time_base;
-        }
-
         /* Finish the time-step with a second half-kick */
-        kick_spart(sp, dt_kick_grav, ti_begin + ti_step / 2,
-                   ti_begin + ti_step);
+        kick_spart(sp, f->dt_kick_grav, f->ti_start, f->ti_end);
 
 #ifdef SWIFT_DEBUG_CHECKS
         /* Check that kick and the drift are synchronized */
@@ -1692,6 +1702,83 @@ void runner_do_timestep(struct runner *r, struct cell *c, int timer) {
   if (timer) TIMER_TOC(timer_timestep);
 }
 
+/**
+ * @brief Finishes the time-step of all active particles in a cell, computes
+ * their next time-step and starts it.
+ *
+ * This does the work of the kick2, timestep and kick1 tasks in a single walk
+ * of the tree. Each leaf goes through the three operations back to back, so
+ * that its particles are only brought into cache once.
+ *
+ * @param r The runner thread.
+ * @param c The cell.
+ * @param timer Are we timing this ?
+ */
+void runner_do_kick2_timestep_kick1(struct runner *r, struct cell *c,
+                                    int timer) {
+
+  const struct engine *e = r->e;
+
+  TIMER_TIC;
+
+  /* Anything to do here? */
+  if (!cell_is_active_hydro(c, e) && !cell_is_active_gravity(c, e)) {
+    c->updated = 0;
+    c->g_updated = 0;
+    c->s_updated = 0;
+    return;
+  }
+
+  /* No children? */
+  if (!c->split) {
+
+    runner_do_kick2(r, c, 0);
+    runner_do_timestep(r, c, 0);
+    runner_do_kick1(r, c, 0);
+
+  } else {
+
+    int updated = 0, g_updated = 0, s_updated = 0;
+    integertime_t ti_hydro_end_min = max_nr_timesteps, ti_hydro_end_max = 0,
+                  ti_hydro_beg_max = 0;
+    integertime_t ti_gravity_end_min = max_nr_timesteps,
+                  ti_gravity_end_max = 0, ti_gravity_beg_max = 0;
+
+    /* Loop over the progeny. */
+    for (int k = 0; k < 8; k++)
+      if (c->progeny[k] != NULL) {
+        struct cell *restrict cp = c->progeny[k];
+
+        /* Recurse */
+        runner_do_kick2_timestep_kick1(r, cp, 0);
+
+        /* And aggregate */
+        updated += cp->updated;
+        g_updated += cp->g_updated;
+        s_updated += cp->s_updated;
+        ti_hydro_end_min = min(cp->ti_hydro_end_min, ti_hydro_end_min);
+        ti_hydro_end_max = max(cp->ti_hydro_end_max, ti_hydro_end_max);
+        ti_hydro_beg_max = max(cp->ti_hydro_beg_max, ti_hydro_beg_max);
+        ti_gravity_end_min = min(cp->ti_gravity_end_min, ti_gravity_end_min);
+        ti_gravity_end_max = max(cp->ti_gravity_end_max, ti_gravity_end_max);
+        ti_gravity_beg_max = max(cp->ti_gravity_beg_max, ti_gravity_beg_max);
+      }
+
+    /* Store the values. */
+    c->updated = updated;
+    c->g_updated = g_updated;
+    c->s_updated = s_updated;
+    c->ti_hydro_end_min = ti_hydro_end_min;
+    c->ti_hydro_end_max = ti_hydro_end_max;
+    c->ti_hydro_beg_max = ti_hydro_beg_max;
+    c->ti_gravity_end_min = ti_gravity_end_min;
+    c->ti_gravity_end_max = ti_gravity_end_max;
+    c->ti_gravity_beg_max = ti_gravity_beg_max;
+  }
+
+  if (timer) TIMER_TOC(timer_kick2_timestep_kick1);
+}
+
 /**
  * @brief End the force calculation of all active particles in a cell
  * by multiplying the acccelerations by the relevant constants
@@ -1862,6 +1949,9 @@ void runner_do_recv_part(struct runner *r, struct cell *c, int clear_sorts,
   /* Clear this cell's sorted mask. */
   if (clear_sorts) c->sorted = 0;
 
+  /* The extent of the particles is rebuilt from the received data. */
+  cell_part_bbox_empty(c);
+
   /* If this cell is a leaf, collect the particle data. */
   if (!c->split) {
 
@@ -1871,6 +1961,7 @@ void runner_do_recv_part(struct runner *r, struct cell *c, int clear_sorts,
       time_bin_min = min(time_bin_min, parts[k].time_bin);
       time_bin_max = max(time_bin_max, parts[k].time_bin);
       h_max = max(h_max, parts[k].h);
+      cell_part_bbox_add(c, parts[k].x);
     }
 
     /* Convert into a time */
@@ -1888,6 +1979,7 @@ void runner_do_recv_part(struct runner *r, struct cell *c, int clear_sorts,
         ti_hydro_end_max =
             max(ti_hydro_end_max, c->progeny[k]->ti_hydro_end_max);
         h_max = max(h_max, c->progeny[k]->h_max);
+        cell_part_bbox_merge(c, c->progeny[k]);
       }
     }
   }
@@ -2083,6 +2175,10 @@ void *runner_main(void *data) {
   struct scheduler *sched = &e->sched;
   unsigned int seed = r->id;
   pthread_setspecific(sched->local_seed_pointer, &seed);
+
+  /* Start the hardware counters of this thread. */
+  if (e->hardware_counters) timers_hw_thread_init();
+
   /* Main loop. */
   while (1) {
 
@@ -2132,6 +2228,13 @@ void *runner_main(void *data) {
       t->ti_run = e->ti_current;
 #endif
 
+      /* Read the hardware counters before the task. */
+      struct timers_hw hw_tic;
+      if (e->hardware_counters) timers_hw_tic(&hw_tic);
+
+      /* Drift the cells first if this was not left to the drift tasks. */
+      if (e->drift_on_demand) runner_do_drift_part_on_demand(r, t);
+
       /* Different types of tasks... */
       switch (t->type) {
         case task_type_self:
@@ -2226,15 +2329,22 @@ void *runner_main(void *data) {
           runner_do_end_force(r, ci, 1);
           break;
         case task_type_timestep:
-          runner_do_timestep(r, ci, 1);
+          if (e->fused_end_of_step)
+            runner_do_kick2_timestep_kick1(r, ci, 1);
+          else
+            runner_do_timestep(r, ci, 1);
           break;
 #ifdef WITH_MPI
         case task_type_send:
-          if (t->subtype == task_subtype_tend) {
+          if (t->subtype == task_subtype_tend ||
+              t->subtype == task_subtype_multipole ||
+              scheduler_mpi_compressed(&e->sched, t)) {
             free(t->buff);
+            t->buff = NULL;
           }
           break;
         case task_type_recv:
+          scheduler_mpi_decompress(&e->sched, t);
           if (t->subtype == task_subtype_tend) {
             cell_unpack_end_step(ci, (struct pcell_step *)t->buff);
             free(t->buff);
@@ -2278,6 +2388,9 @@ void *runner_main(void *data) {
           error("Unknown/invalid task type (%d).", t->type);
       }
 
+      /* Add the hardware counts of this task to its type. */
+      if (e->hardware_counters) timers_hw_toc(t->type, &hw_tic);
+
 /* Mark that we have run this task on these cells */
 #ifdef SWIFT_DEBUG_CHECKS
       if (ci != NULL) {
@@ -29,10 +29,31 @@
 /* Includes. */
 #include "cache.h"
 #include "gravity_cache.h"
+#include "timeline.h"
 
 struct cell;
 struct engine;
 
+/**
+ * @brief The time intervals of a half-kick for the particles of one time-bin.
+ *
+ * Only the intervals are shared by the particles of a bin. The kicks
+ * themselves are still applied one particle at a time by the kick_part(),
+ * kick_gpart() and kick_spart() functions of each scheme.
+ */
+struct runner_kick_factors {
+
+  /*! The integer time these were computed at (-1 if never). */
+  integertime_t ti_current;
+
+  /*! Integer start and end times of the kick. */
+  integertime_t ti_start, ti_end;
+
+  /*! The kick time-steps for the hydro, gravity and thermal terms and for
+   * the gizmo-mfv gravity correction. */
+  double dt_kick_hydro, dt_kick_grav, dt_kick_therm, dt_kick_corr;
+};
+
 /**
  * @brief A struct representing a runner's thread and its data.
  */
@@ -56,6 +77,10 @@ struct runner {
   /*! The particle gravity_cache of cell cj. */
   struct gravity_cache cj_gravity_cache;
 
+  /*! The second (index 0) and first (index 1) half-kick intervals of each
+   * time-bin, filled the first time they are needed in a step. */
+  struct runner_kick_factors kick_factors[2][num_time_bins + 1];
+
 #ifdef WITH_VECTORIZATION
 
   /*! The particle cache of cell ci. */
@@ -75,6 +100,8 @@ void runner_do_drift_part(struct runner *r, struct cell *c, int timer);
 void runner_do_drift_gpart(struct runner *r, struct cell *c, int timer);
 void runner_do_kick1(struct runner *r, struct cell *c, int timer);
 void runner_do_kick2(struct runner *r, struct cell *c, int timer);
+void runner_do_kick2_timestep_kick1(struct runner *r, struct cell *c,
+                                    int timer);
 void runner_do_end_force(struct runner *r, struct cell *c, int timer);
 void runner_do_init(struct runner *r, struct cell *c, int timer);
 void runner_do_cooling(struct runner *r, struct cell *c, int timer);
@@ -769,6 +769,18 @@ void DOPAIR_SUBSET_BRANCH(struct runner *r, struct cell *restrict ci,
       shift[k] = -e->s->dim[k];
   }
 
+  /* Can any of the particles reach the particles of cj ? */
+  const double bbox_pad = cell_part_bbox_margin * cj->dmin;
+  int reach = 0;
+  for (int pid = 0; pid < count && !reach; pid++) {
+    const struct part *restrict pi = &parts_i[ind[pid]];
+    const double xi[3] = {pi->x[0] - shift[0], pi->x[1] - shift[1],
+                          pi->x[2] - shift[2]};
+    const double ri = pi->h * kernel_gamma + bbox_pad;
+    reach = cell_part_bbox_dist2(cj, xi) <= ri * ri;
+  }
+  if (!reach) return;
+
 #if !defined(SWIFT_USE_NAIVE_INTERACTIONS)
   /* Get the sorting index. */
   int sid = 0;
@@ -942,6 +954,7 @@ void DOPAIR1(struct runner *r, struct cell *ci, struct cell *cj, const int sid,
   const double di_max = sort_i[count_i - 1].d - rshift;
   const double dj_min = sort_j[0].d;
   const float dx_max = (ci->dx_max_sort + cj->dx_max_sort);
+  const double bbox_pad = cell_part_bbox_margin * ci->dmin;
 
   /* Cosmological terms */
   const float a = cosmo->a;
@@ -964,6 +977,12 @@ void DOPAIR1(struct runner *r, struct cell *ci, struct cell *cj, const int sid,
       const double di = sort_i[pid].d + hi * kernel_gamma + dx_max - rshift;
       if (di < dj_min) continue;
 
+      /* Can pi reach the particles of cj at all ? */
+      const double xi[3] = {pi->x[0] - shift[0], pi->x[1] - shift[1],
+                            pi->x[2] - shift[2]};
+      const double ri = hi * kernel_gamma + bbox_pad;
+      if (cell_part_bbox_dist2(cj, xi) > ri * ri) continue;
+
       /* Get some additional information about pi */
       const float hig2 = hi * hi * kernel_gamma2;
       const float pix = pi->x[0] - (cj->loc[0] + shift[0]);
@@ -1047,6 +1066,12 @@ void DOPAIR1(struct runner *r, struct cell *ci, struct cell *cj, const int sid,
       const double dj = sort_j[pjd].d - hj * kernel_gamma - dx_max + rshift;
       if (dj - rshift > di_max) continue;
 
+      /* Can pj reach the particles of ci at all ? */
+      const double xj[3] = {pj->x[0] + shift[0], pj->x[1] + shift[1],
+                            pj->x[2] + shift[2]};
+      const double rj = hj * kernel_gamma + bbox_pad;
+      if (cell_part_bbox_dist2(ci, xj) > rj * rj) continue;
+
       /* Get some additional information about pj */
       const float hjg2 = hj * hj * kernel_gamma2;
       const float pjx = pj->x[0] - cj->loc[0];
@@ -1148,6 +1173,9 @@ void DOPAIR1_BRANCH(struct runner *r, struct cell *ci, struct cell *cj) {
       cj->dx_max_sort_old > space_maxreldx * cj->dmin)
     error("Interacting unsorted cells.");
 
+  /* Are the particles of the two cells close enough to interact at all? */
+  if (!cell_can_interact_hydro(ci, cj, shift)) return;
+
 #ifdef SWIFT_DEBUG_CHECKS
   /* Pick-out the sorted lists. */
   const struct entry *restrict sort_i = ci->sort[sid];
@@ -1661,6 +1689,9 @@ void DOPAIR2_BRANCH(struct runner *r, struct cell *ci, struct cell *cj) {
       cj->dx_max_sort_old > space_maxreldx * cj->dmin)
     error("Interacting unsorted cells.");
 
+  /* Are the particles of the two cells close enough to interact at all? */
+  if (!cell_can_interact_hydro(ci, cj, shift)) return;
+
 #ifdef SWIFT_DEBUG_CHECKS
   /* Pick-out the sorted lists. */
   const struct entry *restrict sort_i = ci->sort[sid];
@@ -2085,6 +2116,9 @@ void DOSUB_PAIR1(struct runner *r, struct cell *ci, struct cell *cj, int sid,
   double shift[3];
   sid = space_getsid(s, &ci, &cj, shift);
 
+  /* Are the particles of the two cells too far apart to interact? */
+  if (!cell_can_interact_hydro(ci, cj, shift)) return;
+
   /* Recurse? */
   if (cell_can_recurse_in_pair_hydro_task(ci) &&
       cell_can_recurse_in_pair_hydro_task(cj)) {
@@ -2382,6 +2416,9 @@ void DOSUB_PAIR2(struct runner *r, struct cell *ci, struct cell *cj, int sid,
   double shift[3];
   sid = space_getsid(s, &ci, &cj, shift);
 
+  /* Are the particles of the two cells too far apart to interact? */
+  if (!cell_can_interact_hydro(ci, cj, shift)) return;
+
   /* Recurse? */
   if (cell_can_recurse_in_pair_hydro_task(ci) &&
       cell_can_recurse_in_pair_hydro_task(cj)) {
@@ -698,12 +698,27 @@ static INLINE void runner_dopair_grav_pp(struct runner *r, struct cell *ci,
 #endif
 
   /* Fill the caches */
-  gravity_cache_populate(e->max_active_bin, allow_mpole, periodic, dim,
-                         ci_cache, ci->gparts, gcount_i, gcount_padded_i,
-                         shift_i, CoM_j, rmax2_j, ci, e->gravity_properties);
-  gravity_cache_populate(e->max_active_bin, allow_mpole, periodic, dim,
-                         cj_cache, cj->gparts, gcount_j, gcount_padded_j,
-                         shift_j, CoM_i, rmax2_i, cj, e->gravity_properties);
+  if (e->gravity_properties->use_cell_caches) {
+
+    /* Copy the per-step data of each cell, filled at most once per step */
+    const struct gravity_cell_cache *cc_i = gravity_cell_cache_get(
+        ci, e->max_active_bin, e->ti_current, e->gravity_properties);
+    const struct gravity_cell_cache *cc_j = gravity_cell_cache_get(
+        cj, e->max_active_bin, e->ti_current, e->gravity_properties);
+    gravity_cache_populate_from_cell_cache(
+        allow_mpole, 0, periodic, dim, ci_cache, cc_i, gcount_i,
+        gcount_padded_i, CoM_j, rmax2_j, e->gravity_properties);
+    gravity_cache_populate_from_cell_cache(
+        allow_mpole, 0, periodic, dim, cj_cache, cc_j, gcount_j,
+        gcount_padded_j, CoM_i, rmax2_i, e->gravity_properties);
+  } else {
+    gravity_cache_populate(e->max_active_bin, allow_mpole, periodic, dim,
+                           ci_cache, ci->gparts, gcount_i, gcount_padded_i,
+                           shift_i, CoM_j, rmax2_j, ci, e->gravity_properties);
+    gravity_cache_populate(e->max_active_bin, allow_mpole, periodic, dim,
+                           cj_cache, cj->gparts, gcount_j, gcount_padded_j,
+                           shift_j, CoM_i, rmax2_i, cj, e->gravity_properties);
+  }
 
   /* Can we use the Newtonian version or do we need the truncated one ? */
   if (!periodic) {
@@ -1232,9 +1247,17 @@ static INLINE void runner_dopair_recursive_grav_pm(struct runner *r,
                             (float)(cj->multipole->CoM[2])};
 
     /* Fill the cache */
-    gravity_cache_populate_all_mpole(
-        e->max_active_bin, periodic, dim, ci_cache, ci->gparts, gcount_i,
-        gcount_padded_i, ci, CoM_j, r_max * r_max, e->gravity_properties);
+    if (e->gravity_properties->use_cell_caches) {
+      const struct gravity_cell_cache *cc_i = gravity_cell_cache_get(
+          ci, e->max_active_bin, e->ti_current, e->gravity_properties);
+      gravity_cache_populate_from_cell_cache(
+          1, 1, periodic, dim, ci_cache, cc_i, gcount_i, gcount_padded_i,
+          CoM_j, r_max * r_max, e->gravity_properties);
+    } else {
+      gravity_cache_populate_all_mpole(
+          e->max_active_bin, periodic, dim, ci_cache, ci->gparts, gcount_i,
+          gcount_padded_i, ci, CoM_j, r_max * r_max, e->gravity_properties);
+    }
 
     /* Can we use the Newtonian version or do we need the truncated one ? */
     if (!periodic) {
@@ -1351,7 +1374,11 @@ static INLINE void runner_dopair_recursive_grav(struct runner *r,
 
   } else if (!ci->split && !cj->split) {
 
-    /* We have two leaves. Go P-P. */
+    /* We have two leaves. Go P-P. The activation of the tasks asked for a
+     * rebuild if we only have the multipole of one of them. */
+    if (ci->mpole_only || cj->mpole_only)
+      error("Particle-particle interaction with a multipole-only cell.");
+
     runner_dopair_grav_pp(r, ci, cj, /*symmetric*/ 1, /*allow_mpoles*/ 1);
 
   } else {
@@ -40,6 +40,8 @@
 
 /* Local headers. */
 #include "atomic.h"
+#include "clocks.h"
+#include "compress.h"
 #include "cycle.h"
 #include "engine.h"
 #include "error.h"
@@ -1488,6 +1490,148 @@ void scheduler_start(struct scheduler *s) {
   pthread_mutex_unlock(&s->sleep_mutex);
 }
 
+#ifdef WITH_MPI
+/**
+ * @brief Size and record size of the data exchanged by a send/recv #task.
+ *
+ * @param t The #task.
+ * @param record_size (return) The size of one record of the data in bytes.
+ *
+ * @return The size of the data in bytes or 0 if it is never compressed.
+ */
+static size_t scheduler_mpi_message_size(const struct task *t,
+                                         size_t *record_size) {
+
+  switch (t->subtype) {
+    case task_subtype_xv:
+    case task_subtype_rho:
+    case task_subtype_gradient:
+      *record_size = sizeof(struct part);
+      return t->ci->count * sizeof(struct part);
+    case task_subtype_gpart:
+      *record_size = sizeof(struct gpart);
+      return t->ci->gcount * sizeof(struct gpart);
+    case task_subtype_spart:
+      *record_size = sizeof(struct spart);
+      return t->ci->scount * sizeof(struct spart);
+    case task_subtype_multipole:
+      *record_size = sizeof(struct gravity_tensors);
+      return t->ci->pcell_size * sizeof(struct gravity_tensors);
+    default:
+      *record_size = 0;
+      return 0;
+  }
+}
+
+/**
+ * @brief Is the message of a send/recv #task compressed?
+ *
+ * @param s The #scheduler.
+ * @param t The #task.
+ */
+int scheduler_mpi_compressed(const struct scheduler *s, const struct task *t) {
+
+  size_t record_size;
+  const size_t size = scheduler_mpi_message_size(t, &record_size);
+  return s->mpi_compression_limit > 0 && size > s->mpi_compression_limit;
+}
+
+/**
+ * @brief Decompresses the message received by a recv #task.
+ *
+ * Particles are written straight into the foreign cell, while the buffer
+ * of multipoles is replaced by its decompressed version for the unpacking.
+ * Does nothing if the message was not compressed.
+ *
+ * @param s The #scheduler.
+ * @param t The #task.
+ */
+void scheduler_mpi_decompress(struct scheduler *s, struct task *t) {
+
+  if (!scheduler_mpi_compressed(s, t)) return;
+
+  size_t record_size;
+  const size_t size = scheduler_mpi_message_size(t, &record_size);
+
+  switch (t->subtype) {
+    case task_subtype_xv:
+    case task_subtype_rho:
+    case task_subtype_gradient:
+      decompress_buffer(t->buff, t->ci->parts, size);
+      break;
+    case task_subtype_gpart:
+      decompress_buffer(t->buff, t->ci->gparts, size);
+      break;
+    case task_subtype_spart:
+      decompress_buffer(t->buff, t->ci->sparts, size);
+      break;
+    case task_subtype_multipole: {
+      void *raw = malloc(size);
+      if (raw == NULL) error("Failed to allocate the multipole buffer.");
+      decompress_buffer(t->buff, raw, size);
+      free(t->buff);
+      t->buff = raw;
+      return;
+    }
+    default:
+      error("Unknown communication sub-type");
+  }
+  free(t->buff);
+  t->buff = NULL;
+}
+
+/**
+ * @brief Compresses the message of a send #task and sends it.
+ *
+ * @param s The #scheduler.
+ * @param t The #task.
+ *
+ * @return The MPI error code.
+ */
+static int scheduler_isend_compressed(struct scheduler *s, struct task *t) {
+
+  size_t record_size;
+  const size_t raw_size = scheduler_mpi_message_size(t, &record_size);
+
+  /* Get the raw data, packing the multipoles first. */
+  const void *raw = NULL;
+  void *packed = NULL;
+  switch (t->subtype) {
+    case task_subtype_xv:
+    case task_subtype_rho:
+    case task_subtype_gradient:
+      raw = t->ci->parts;
+      break;
+    case task_subtype_gpart:
+      raw = t->ci->gparts;
+      break;
+    case task_subtype_spart:
+      raw = t->ci->sparts;
+      break;
+    case task_subtype_multipole:
+      packed = malloc(raw_size);
+      if (packed == NULL) error("Failed to allocate the multipole buffer.");
+      cell_pack_multipoles(t->ci, (struct gravity_tensors *)packed);
+      raw = packed;
+      break;
+    default:
+      error("Unknown communication sub-type");
+  }
+
+  t->buff = malloc(compress_bound(raw_size));
+  if (t->buff == NULL) error("Failed to allocate the compression buffer.");
+  const size_t size = compress_buffer(raw, raw_size, record_size, t->buff);
+  free(packed);
+
+  if (size > s->mpi_message_limit)
+    return MPI_Isend(t->buff, size, MPI_BYTE, t->cj->nodeID, t->flags,
+                     subtaskMPI_comms[t->subtype], &t->req);
+  else
+    return MPI_Issend(t->buff, size, MPI_BYTE, t->cj->nodeID, t->flags,
+                      subtaskMPI_comms[t->subtype], &t->req);
+}
+#endif
+
 /**
  * @brief Put a task on one of the queues.
  *
@@ -1506,6 +1650,9 @@ void scheduler_enqueue(struct scheduler *s, struct task *t) {
   if (t->implicit) {
 #ifdef SWIFT_DEBUG_CHECKS
     t->ti_run = s->space->e->ti_current;
+#endif
+#ifdef SWIFT_DEBUG_TASKS
+    t->tic = t->toc = getticks();
 #endif
     t->skip = 1;
     for (int j = 0; j < t->nr_unlock_tasks; j++) {
@@ -1559,6 +1706,15 @@ void scheduler_enqueue(struct scheduler *s, struct task *t) {
           err = MPI_Irecv(
               t->buff, t->ci->pcell_size * sizeof(struct pcell_step), MPI_BYTE,
               t->ci->nodeID, t->flags, subtaskMPI_comms[t->subtype], &t->req);
+        } else if (scheduler_mpi_compressed(s, t)) {
+          size_t record_size;
+          const size_t size = compress_bound(
+              scheduler_mpi_message_size(t, &record_size));
+          t->buff = malloc(size);
+          if (t->buff == NULL)
+            error("Failed to allocate the compressed message buffer.");
+          err = MPI_Irecv(t->buff, size, MPI_BYTE, t->ci->nodeID, t->flags,
+                          subtaskMPI_comms[t->subtype], &t->req);
         } else if (t->subtype == task_subtype_xv ||
                    t->subtype == task_subtype_rho ||
                    t->subtype == task_subtype_gradient) {
@@ -1611,6 +1767,8 @@ void scheduler_enqueue(struct scheduler *s, struct task *t) {
                              t->ci->pcell_size * sizeof(struct pcell_step),
                              MPI_BYTE, t->cj->nodeID, t->flags,
                              subtaskMPI_comms[t->subtype], &t->req);
+        } else if (scheduler_mpi_compressed(s, t)) {
+          err = scheduler_isend_compressed(s, t);
         } else if (t->subtype == task_subtype_xv ||
                    t->subtype == task_subtype_rho ||
                    t->subtype == task_subtype_gradient) {
@@ -1675,6 +1833,10 @@ void scheduler_enqueue(struct scheduler *s, struct task *t) {
     /* Increase the waiting counter. */
     atomic_inc(&s->waiting);
 
+#ifdef SWIFT_DEBUG_TASKS
+    t->qid = qid;
+#endif
+
     /* Insert the task into that queue. */
     queue_insert(&s->queues[qid], t);
   }
@@ -1931,6 +2093,75 @@ void scheduler_print_tasks(const struct scheduler *s, const char *fileName) {
   fclose(file);
 }
 
+#ifdef SWIFT_DEBUG_TASKS
+/**
+ * @brief Writes the graph of the tasks run during the last step, with their
+ * measured costs, for an offline replay of the scheduling.
+ *
+ * Each line describes one task run during the step: its index, type,
+ * subtype, whether it is implicit, the queue it was inserted in, its weight,
+ * its start and end ticks, the position, width and particle counts of its
+ * two cells (zeros when absent) and the indices of the tasks it unlocks.
+ * See tests/testTaskReplay.c for a reader.
+ *
+ * @param s The #scheduler.
+ * @param fileName Name of the file to write to.
+ */
+void scheduler_dump_task_graph(const struct scheduler *s,
+                               const char *fileName) {
+
+  const int nr_tasks = s->nr_tasks;
+  const struct task *tasks = s->tasks;
+
+  /* Number the tasks run during the step, i.e. those with a end time. */
+  int *index = (int *)malloc(nr_tasks * sizeof(int));
+  if (index == NULL) error("Failed to allocate the task indices.");
+  int count = 0;
+  for (int k = 0; k < nr_tasks; k++)
+    index[k] = tasks[k].toc != 0 ? count++ : -1;
+
+  FILE *file = fopen(fileName, "w");
+  if (file == NULL) error("Could not open file '%s'.", fileName);
+
+  fprintf(file, "# %d %d %llu\n", count, s->nr_queues, clocks_get_cpufreq());
+  fprintf(file,
+          "# index type subtype implicit qid weight tic toc "
+          "ci[loc[3] width count gcount] cj[loc[3] width count gcount] "
+          "nr_unlocks unlocks\n");
+
+  for (int k = 0; k < nr_tasks; k++) {
+    const struct task *t = &tasks[k];
+    if (index[k] < 0) continue;
+
+    fprintf(file, "%d %d %d %d %d %e %lld %lld", index[k], t->type,
+            t->subtype, t->implicit, t->implicit ? -1 : t->qid, t->weight,
+            t->implicit ? 0 : t->tic, t->implicit ? 0 : t->toc);
+
+    const struct cell *cells[2] = {t->ci, t->cj};
+    for (int i = 0; i < 2; i++) {
+      const struct cell *c = cells[i];
+      if (c != NULL)
+        fprintf(file, " %.17e %.17e %.17e %.17e %d %d", c->loc[0], c->loc[1],
+                c->loc[2], c->width[0], c->count, c->gcount);
+      else
+        fprintf(file, " 0 0 0 0 0 0");
+    }
+
+    int nr_unlocks = 0;
+    for (int j = 0; j < t->nr_unlock_tasks; j++)
+      if (index[t->unlock_tasks[j] - tasks] >= 0) nr_unlocks++;
+    fprintf(file, " %d", nr_unlocks);
+    for (int j = 0; j < t->nr_unlock_tasks; j++)
+      if (index[t->unlock_tasks[j] - tasks] >= 0)
+        fprintf(file, " %d", index[t->unlock_tasks[j] - tasks]);
+    fprintf(file, "\n");
+  }
+
+  fclose(file);
+  free(index);
+}
+#endif
+
 /**
  * @brief Frees up the memory allocated for this #scheduler
  */
@@ -107,6 +107,10 @@ struct scheduler {
    * MPI. */
   size_t mpi_message_limit;
 
+  /* Minimal size of task messages, in bytes, to compress before sending
+   * them. Zero to never compress. */
+  size_t mpi_compression_limit;
+
   /* 'Pointer' to the seed for the random number generator */
   pthread_key_t local_seed_pointer;
 };
@@ -148,6 +152,28 @@ scheduler_activate_send(struct scheduler *s, struct link *link, int nodeID) {
   return l;
 }
 
+/**
+ * @brief Search and add an MPI send task to the list of active tasks, if the
+ * cell sends anything to that node.
+ *
+ * @param s The #scheduler.
+ * @param link The first element in the linked list of links for the task of
+ * interest.
+ * @param nodeID The nodeID of the foreign cell.
+ *
+ * @return The #link to the MPI send task or NULL if there is none.
+ */
+__attribute__((always_inline)) INLINE static struct link *
+scheduler_activate_send_if_any(struct scheduler *s, struct link *link,
+                               int nodeID) {
+
+  struct link *l = NULL;
+  for (l = link; l != NULL && l->t->cj->nodeID != nodeID; l = l->next)
+    ;
+  if (l != NULL) scheduler_activate(s, l->t);
+  return l;
+}
+
 /* Function prototypes. */
 void scheduler_clear_active(struct scheduler *s);
 void scheduler_init(struct scheduler *s, struct space *space, int nr_tasks,
@@ -170,8 +196,14 @@ void scheduler_addunlock(struct scheduler *s, struct task *ta, struct task *tb);
 void scheduler_set_unlocks(struct scheduler *s);
 void scheduler_dump_queue(struct scheduler *s);
 void scheduler_print_tasks(const struct scheduler *s, const char *fileName);
+#ifdef SWIFT_DEBUG_TASKS
+void scheduler_dump_task_graph(const struct scheduler *s,
+                               const char *fileName);
+#endif
 void scheduler_clean(struct scheduler *s);
 void scheduler_free_tasks(struct scheduler *s);
 void scheduler_write_dependencies(struct scheduler *s, int verbose);
+int scheduler_mpi_compressed(const struct scheduler *s, const struct task *t);
+void scheduler_mpi_decompress(struct scheduler *s, struct task *t);
 
 #endif /* SWIFT_SCHEDULER_H */
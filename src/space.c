@@ -48,6 +48,7 @@
 #include "engine.h"
 #include "error.h"
 #include "gravity.h"
+#include "gravity_cache.h"
 #include "hydro.h"
 #include "kernel_hydro.h"
 #include "lock.h"
@@ -68,6 +69,7 @@ int space_subsize_pair_grav = space_subsize_pair_grav_default;
 int space_subsize_self_grav = space_subsize_self_grav_default;
 int space_subdepth_grav = space_subdepth_grav_default;
 int space_maxsize = space_maxsize_default;
+int space_splitsize_parallel = space_splitsize_parallel_default;
 #ifdef SWIFT_DEBUG_CHECKS
 int last_cell_id;
 #endif
@@ -146,6 +148,44 @@ void space_rebuild_recycle_rec(struct space *s, struct cell *c,
       }
 }
 
+/**
+ * @brief Clear all the task-related information attached to a cell.
+ *
+ * @param c The #cell to clear.
+ */
+void space_clear_cell_tasks(struct cell *c) {
+
+  c->tasks = NULL;
+  c->nr_tasks = 0;
+  c->density = NULL;
+  c->gradient = NULL;
+  c->force = NULL;
+  c->grav = NULL;
+  c->init_grav_out = NULL;
+  c->ghost = NULL;
+  c->grav_down_in = NULL;
+  c->do_sort = 0;
+  c->requires_sorts = 0;
+  c->do_sub_sort = 0;
+  c->do_drift = 0;
+  c->do_sub_drift = 0;
+  c->do_grav_drift = 0;
+  c->do_grav_sub_drift = 0;
+#if WITH_MPI
+  c->recv_xv = NULL;
+  c->recv_rho = NULL;
+  c->recv_gradient = NULL;
+  c->recv_grav = NULL;
+  c->recv_ti = NULL;
+
+  c->send_xv = NULL;
+  c->send_rho = NULL;
+  c->send_gradient = NULL;
+  c->send_grav = NULL;
+  c->send_ti = NULL;
+#endif
+}
+
 void space_rebuild_recycle_mapper(void *map_data, int num_elements,
                                   void *extra_data) {
 
@@ -162,65 +202,29 @@ void space_rebuild_recycle_mapper(void *map_data, int num_elements,
     if (cell_rec_begin != NULL)
       space_recycle_list(s, cell_rec_begin, cell_rec_end, multipole_rec_begin,
                          multipole_rec_end);
-    c->sorts = NULL;
-    c->nr_tasks = 0;
-    c->density = NULL;
-    c->gradient = NULL;
-    c->force = NULL;
-    c->grav = NULL;
+    space_clear_cell_tasks(c);
     c->dx_max_part = 0.0f;
     c->dx_max_sort = 0.0f;
     c->sorted = 0;
     c->count = 0;
     c->gcount = 0;
     c->scount = 0;
-    c->init_grav = NULL;
-    c->init_grav_out = NULL;
-    c->extra_ghost = NULL;
-    c->ghost_in = NULL;
-    c->ghost_out = NULL;
-    c->ghost = NULL;
-    c->kick1 = NULL;
-    c->kick2 = NULL;
-    c->timestep = NULL;
-    c->end_force = NULL;
-    c->drift_part = NULL;
-    c->drift_gpart = NULL;
-    c->cooling = NULL;
-    c->sourceterms = NULL;
-    c->grav_long_range = NULL;
-    c->grav_down_in = NULL;
-    c->grav_down = NULL;
-    c->grav_mesh = NULL;
     c->super = c;
     c->super_hydro = c;
     c->super_gravity = c;
+    c->mpole_only = 0;
     c->parts = NULL;
     c->xparts = NULL;
     c->gparts = NULL;
     c->sparts = NULL;
-    c->do_sub_sort = 0;
-    c->do_grav_sub_drift = 0;
-    c->do_sub_drift = 0;
     if (s->gravity) bzero(c->multipole, sizeof(struct gravity_tensors));
     for (int i = 0; i < 13; i++)
       if (c->sort[i] != NULL) {
         free(c->sort[i]);
         c->sort[i] = NULL;
       }
-#if WITH_MPI
-    c->recv_xv = NULL;
-    c->recv_rho = NULL;
-    c->recv_gradient = NULL;
-    c->recv_grav = NULL;
-    c->recv_ti = NULL;
-
-    c->send_xv = NULL;
-    c->send_rho = NULL;
-    c->send_gradient = NULL;
-    c->send_grav = NULL;
-    c->send_ti = NULL;
-#endif
+    gravity_cell_cache_free(c->grav_cache);
+    c->grav_cache = NULL;
   }
 }
 
@@ -234,19 +238,19 @@ void space_free_cells(struct space *s) {
 }
 
 /**
- * @brief Re-build the top-level cell grid.
+ * @brief Compute the top-level grid dimensions required by the current
+ * smoothing lengths.
  *
  * @param s The #space.
+ * @param cdim (return) The number of top-level cells along each axis.
  * @param verbose Print messages to stdout or not.
  */
-void space_regrid(struct space *s, int verbose) {
+void space_get_required_cdim(const struct space *s, int cdim[3],
+                             int verbose) {
 
   const size_t nr_parts = s->nr_parts;
-  const ticks tic = getticks();
-  const integertime_t ti_current = (s->e != NULL) ? s->e->ti_current : 0;
 
   /* Run through the cells and get the current h_max. */
-  // tic = getticks();
   float h_max = s->cell_min / kernel_gamma / space_stretch;
   if (nr_parts > 0) {
     if (s->cells_top != NULL) {
@@ -277,13 +281,127 @@ void space_regrid(struct space *s, int verbose) {
   if (verbose) message("h_max is %.3e (cell_min=%.3e).", h_max, s->cell_min);
 
   /* Get the new putative cell dimensions. */
-  const int cdim[3] = {
-      (int)floor(s->dim[0] /
-                 fmax(h_max * kernel_gamma * space_stretch, s->cell_min)),
-      (int)floor(s->dim[1] /
-                 fmax(h_max * kernel_gamma * space_stretch, s->cell_min)),
-      (int)floor(s->dim[2] /
-                 fmax(h_max * kernel_gamma * space_stretch, s->cell_min))};
+  for (int k = 0; k < 3; k++)
+    cdim[k] = (int)floor(
+        s->dim[k] / fmax(h_max * kernel_gamma * space_stretch, s->cell_min));
+}
+
+/**
+ * @brief Interleave the bits of the grid coordinates of a top-level cell.
+ *
+ * @param i The cell's position along x.
+ * @param j The cell's position along y.
+ * @param k The cell's position along z.
+ */
+unsigned long long space_morton_key(int i, int j, int k) {
+
+  unsigned long long key = 0;
+  for (int b = 0; b < 21; b++) {
+    key |= ((unsigned long long)((i >> b) & 1)) << (3 * b + 2);
+    key |= ((unsigned long long)((j >> b) & 1)) << (3 * b + 1);
+    key |= ((unsigned long long)((k >> b) & 1)) << (3 * b);
+  }
+  return key;
+}
+
+/**
+ * @brief Compare two top-level cells by Morton key (for qsort()).
+ */
+int space_compare_morton_keys(const void *a, const void *b) {
+
+  const unsigned long long ka = ((const unsigned long long *)a)[0];
+  const unsigned long long kb = ((const unsigned long long *)b)[0];
+  return (ka > kb) - (ka < kb);
+}
+
+/**
+ * @brief Set the order in which the particles of the top-level cells are
+ * stored.
+ *
+ * By default this is the order of the cells in the #space (i-j-k). With
+ * Scheduler:top_cells_morton_order, the particles of the cells are laid out
+ * along a Morton curve instead, such that the particles of neighbouring
+ * cells are mostly close in memory.
+ *
+ * @param s The #space.
+ */
+void space_set_top_cells_order(struct space *s) {
+
+  const int nr_cells = s->nr_cells;
+
+  free(s->cells_top_order);
+  free(s->cells_top_rank);
+  if ((s->cells_top_order = (int *)malloc(sizeof(int) * nr_cells)) == NULL ||
+      (s->cells_top_rank = (int *)malloc(sizeof(int) * nr_cells)) == NULL)
+    error("Failed to allocate the order of the top-level cells.");
+
+  if (s->morton_order) {
+
+    /* Sort the (key, cid) pairs by key. */
+    unsigned long long *keys = NULL;
+    if ((keys = (unsigned long long *)malloc(sizeof(unsigned long long) * 2 *
+                                             nr_cells)) == NULL)
+      error("Failed to allocate the Morton keys.");
+    for (int i = 0; i < s->cdim[0]; i++)
+      for (int j = 0; j < s->cdim[1]; j++)
+        for (int k = 0; k < s->cdim[2]; k++) {
+          const int cid = cell_getid(s->cdim, i, j, k);
+          keys[2 * cid] = space_morton_key(i, j, k);
+          keys[2 * cid + 1] = cid;
+        }
+    qsort(keys, nr_cells, 2 * sizeof(unsigned long long),
+          space_compare_morton_keys);
+    for (int r = 0; r < nr_cells; r++)
+      s->cells_top_order[r] = (int)keys[2 * r + 1];
+    free(keys);
+
+  } else {
+    for (int r = 0; r < nr_cells; r++) s->cells_top_order[r] = r;
+  }
+
+  for (int r = 0; r < nr_cells; r++)
+    s->cells_top_rank[s->cells_top_order[r]] = r;
+}
+
+/**
+ * @brief Turn the top-level cell indices of some particles into the rank of
+ * their cell in the storage order.
+ *
+ * @param s The #space.
+ * @param ind The cell indices to convert.
+ * @param N The number of indices.
+ * @param counts The number of particles per cell, re-ordered too.
+ */
+void space_cell_index_to_rank(const struct space *s, int *ind, size_t N,
+                              int *counts) {
+
+  /* Nothing to do if the cells are stored in order. */
+  if (!s->morton_order) return;
+
+  const int *rank = s->cells_top_rank;
+  for (size_t k = 0; k < N; k++) ind[k] = rank[ind[k]];
+
+  int *temp = (int *)malloc(sizeof(int) * s->nr_cells);
+  if (temp == NULL) error("Failed to allocate temporary cell counts.");
+  for (int k = 0; k < s->nr_cells; k++) temp[rank[k]] = counts[k];
+  memcpy(counts, temp, sizeof(int) * s->nr_cells);
+  free(temp);
+}
+
+/**
+ * @brief Re-build the top-level cell grid.
+ *
+ * @param s The #space.
+ * @param verbose Print messages to stdout or not.
+ */
+void space_regrid(struct space *s, int verbose) {
+
+  const ticks tic = getticks();
+  const integertime_t ti_current = (s->e != NULL) ? s->e->ti_current : 0;
+
+  /* Get the new putative cell dimensions. */
+  int cdim[3];
+  space_get_required_cdim(s, cdim, verbose);
 
   /* Check if we have enough cells for periodicity. */
   if (s->periodic && (cdim[0] < 3 || cdim[1] < 3 || cdim[2] < 3))
@@ -425,6 +543,9 @@ void space_regrid(struct space *s, int verbose) {
           if (s->gravity) c->multipole = &s->multipoles_top[cid];
         }
 
+    /* Decide in which order the particles of the cells are stored. */
+    space_set_top_cells_order(s);
+
     /* Be verbose about the change. */
     if (verbose)
       message("set cell dimensions to [ %i %i %i ].", cdim[0], cdim[1],
@@ -495,6 +616,275 @@ void space_regrid(struct space *s, int verbose) {
             clocks_getunit());
 }
 
+#ifdef WITH_MPI
+
+/**
+ * @brief Information required to move the non-local particles to the end of
+ * their array in parallel.
+ */
+struct space_nonlocal_data {
+
+  /*! The #space. */
+  struct space *s;
+
+  /*! The top-level cell index of each particle. */
+  int *ind;
+
+  /*! Number of particles in the local cells. */
+  size_t nr_local;
+
+  /*! Positions of the non-local particles in [0, nr_local). */
+  size_t *front;
+
+  /*! Positions of the local particles in [nr_local, N). */
+  size_t *back;
+
+  /*! Number of entries in the two lists above. */
+  size_t nr_front, nr_back;
+};
+
+/**
+ * @brief #threadpool mapper function counting the particles in local cells.
+ *
+ * @param map_data Pointer towards the cell indices.
+ * @param num_elements The number of indices to treat.
+ * @param extra_data Pointer to the #space_nonlocal_data.
+ */
+void space_count_local_mapper(void *map_data, int num_elements,
+                              void *extra_data) {
+
+  struct space_nonlocal_data *data = (struct space_nonlocal_data *)extra_data;
+  const struct cell *cells_top = data->s->cells_top;
+  const int nodeID = data->s->e->nodeID;
+  const int *ind = (const int *)map_data;
+
+  size_t count = 0;
+  for (int k = 0; k < num_elements; k++)
+    if (cells_top[ind[k]].nodeID == nodeID) count++;
+
+  atomic_add(&data->nr_local, count);
+}
+
+/**
+ * @brief Append a block of positions to one of the shared lists.
+ *
+ * @param list The shared list.
+ * @param count The shared counter of the list.
+ * @param buff The positions to append.
+ * @param num The number of positions to append.
+ */
+void space_flush_positions(size_t *list, size_t *count, const size_t *buff,
+                           int num) {
+  const size_t offset = atomic_add(count, num);
+  memcpy(&list[offset], buff, sizeof(size_t) * num);
+}
+
+/**
+ * @brief #threadpool mapper function listing the particles that are on the
+ * wrong side of the local/non-local boundary.
+ *
+ * @param map_data Pointer towards the cell indices.
+ * @param num_elements The number of indices to treat.
+ * @param extra_data Pointer to the #space_nonlocal_data.
+ */
+void space_find_misplaced_mapper(void *map_data, int num_elements,
+                                 void *extra_data) {
+
+  struct space_nonlocal_data *data = (struct space_nonlocal_data *)extra_data;
+  const struct cell *cells_top = data->s->cells_top;
+  const int nodeID = data->s->e->nodeID;
+  const int *ind = (const int *)map_data;
+  const size_t offset = ind - data->ind;
+  const size_t nr_local = data->nr_local;
+
+  /* Collect the positions locally and reserve space in the lists by block. */
+  const int buff_size = 256;
+  size_t front[buff_size], back[buff_size];
+  int nr_front = 0, nr_back = 0;
+
+  for (int k = 0; k < num_elements; k++) {
+    const size_t pos = offset + k;
+    const int local = (cells_top[ind[k]].nodeID == nodeID);
+    if (pos < nr_local && !local) {
+      front[nr_front++] = pos;
+      if (nr_front == buff_size) {
+        space_flush_positions(data->front, &data->nr_front, front, nr_front);
+        nr_front = 0;
+      }
+    } else if (pos >= nr_local && local) {
+      back[nr_back++] = pos;
+      if (nr_back == buff_size) {
+        space_flush_positions(data->back, &data->nr_back, back, nr_back);
+        nr_back = 0;
+      }
+    }
+  }
+
+  if (nr_front > 0)
+    space_flush_positions(data->front, &data->nr_front, front, nr_front);
+  if (nr_back > 0)
+    space_flush_positions(data->back, &data->nr_back, back, nr_back);
+}
+
+/**
+ * @brief #threadpool mapper function swapping misplaced #part and fixing
+ * their links.
+ *
+ * @param map_data Pointer towards the positions in the front list.
+ * @param num_elements The number of pairs to swap.
+ * @param extra_data Pointer to the #space_nonlocal_data.
+ */
+void space_swap_parts_mapper(void *map_data, int num_elements,
+                             void *extra_data) {
+
+  struct space_nonlocal_data *data = (struct space_nonlocal_data *)extra_data;
+  struct space *s = data->s;
+  const size_t *front = (const size_t *)map_data;
+  const size_t *back = &data->back[front - data->front];
+
+  for (int k = 0; k < num_elements; k++) {
+    const size_t i = front[k], j = back[k];
+
+    /* Swap the particles and their index */
+    memswap(&s->parts[i], &s->parts[j], sizeof(struct part));
+    memswap(&s->xparts[i], &s->xparts[j], sizeof(struct xpart));
+    memswap(&data->ind[i], &data->ind[j], sizeof(int));
+
+    /* Fix the links with the gparts */
+    if (s->parts[i].gpart != NULL) s->parts[i].gpart->id_or_neg_offset = -i;
+    if (s->parts[j].gpart != NULL) s->parts[j].gpart->id_or_neg_offset = -j;
+  }
+}
+
+/**
+ * @brief #threadpool mapper function swapping misplaced #spart and fixing
+ * their links.
+ *
+ * @param map_data Pointer towards the positions in the front list.
+ * @param num_elements The number of pairs to swap.
+ * @param extra_data Pointer to the #space_nonlocal_data.
+ */
+void space_swap_sparts_mapper(void *map_data, int num_elements,
+                              void *extra_data) {
+
+  struct space_nonlocal_data *data = (struct space_nonlocal_data *)extra_data;
+  struct space *s = data->s;
+  const size_t *front = (const size_t *)map_data;
+  const size_t *back = &data->back[front - data->front];
+
+  for (int k = 0; k < num_elements; k++) {
+    const size_t i = front[k], j = back[k];
+
+    /* Swap the particles and their index */
+    memswap(&s->sparts[i], &s->sparts[j], sizeof(struct spart));
+    memswap(&data->ind[i], &data->ind[j], sizeof(int));
+
+    /* Fix the links with the gparts */
+    if (s->sparts[i].gpart != NULL) s->sparts[i].gpart->id_or_neg_offset = -i;
+    if (s->sparts[j].gpart != NULL) s->sparts[j].gpart->id_or_neg_offset = -j;
+  }
+}
+
+/**
+ * @brief #threadpool mapper function swapping misplaced #gpart and fixing
+ * their links.
+ *
+ * @param map_data Pointer towards the positions in the front list.
+ * @param num_elements The number of pairs to swap.
+ * @param extra_data Pointer to the #space_nonlocal_data.
+ */
+void space_swap_gparts_mapper(void *map_data, int num_elements,
+                              void *extra_data) {
+
+  struct space_nonlocal_data *data = (struct space_nonlocal_data *)extra_data;
+  struct space *s = data->s;
+  const size_t *front = (const size_t *)map_data;
+  const size_t *back = &data->back[front - data->front];
+
+  for (int k = 0; k < num_elements; k++) {
+    const size_t i = front[k], j = back[k];
+
+    /* Swap the particles and their index */
+    memswap(&s->gparts[i], &s->gparts[j], sizeof(struct gpart));
+    memswap(&data->ind[i], &data->ind[j], sizeof(int));
+
+    /* Fix the links with the parts/sparts */
+    const size_t pos[2] = {i, j};
+    for (int n = 0; n < 2; n++) {
+      struct gpart *gp = &s->gparts[pos[n]];
+      if (gp->type == swift_type_gas) {
+        s->parts[-gp->id_or_neg_offset].gpart = gp;
+      } else if (gp->type == swift_type_star) {
+        s->sparts[-gp->id_or_neg_offset].gpart = gp;
+      }
+    }
+  }
+}
+
+/**
+ * @brief Move the particles that do not belong to a local top-level cell to
+ * the end of their array, in parallel.
+ *
+ * The particles in [0, N) are partitioned such that the ones in local cells
+ * come first. The number of particles in local cells is counted first, the
+ * particles on the wrong side of that boundary are then listed and swapped
+ * pairwise, fixing the links to the other particle types as they go. The
+ * order of the particles is not preserved.
+ *
+ * @param s The #space.
+ * @param ind The top-level cell index of the particles, re-ordered too.
+ * @param N The number of particles.
+ * @param swap_mapper The #threadpool mapper swapping two particles.
+ *
+ * @return The number of particles in local cells.
+ */
+size_t space_move_nonlocal(struct space *s, int *ind, size_t N,
+                           threadpool_map_function swap_mapper) {
+
+  if (N == 0) return 0;
+
+  struct space_nonlocal_data data;
+  data.s = s;
+  data.ind = ind;
+  data.nr_local = 0;
+  data.front = NULL;
+  data.back = NULL;
+  data.nr_front = 0;
+  data.nr_back = 0;
+
+  /* How many particles belong here? */
+  threadpool_map(&s->e->threadpool, space_count_local_mapper, ind, N,
+                 sizeof(int), 0, &data);
+
+  /* At most that many particles can be on the wrong side. */
+  const size_t max_misplaced = min(data.nr_local, N - data.nr_local);
+  if (max_misplaced == 0) return data.nr_local;
+  if ((data.front = (size_t *)malloc(sizeof(size_t) * max_misplaced)) ==
+          NULL ||
+      (data.back = (size_t *)malloc(sizeof(size_t) * max_misplaced)) == NULL)
+    error("Failed to allocate the lists of misplaced particles.");
+
+  /* Find the particles on the wrong side of the boundary. */
+  threadpool_map(&s->e->threadpool, space_find_misplaced_mapper, ind, N,
+                 sizeof(int), 0, &data);
+
+#ifdef SWIFT_DEBUG_CHECKS
+  if (data.nr_front != data.nr_back)
+    error("Mismatched number of misplaced particles (%zd vs. %zd).",
+          data.nr_front, data.nr_back);
+#endif
+
+  /* Swap them over and fix the links. */
+  threadpool_map(&s->e->threadpool, swap_mapper, data.front, data.nr_front,
+                 sizeof(size_t), 0, &data);
+
+  free(data.front);
+  free(data.back);
+  return data.nr_local;
+}
+
+#endif /* WITH_MPI */
+
 /**
  * @brief Re-build the cells as well as the tasks.
  *
@@ -512,6 +902,14 @@ void space_rebuild(struct space *s, int verbose) {
   fflush(stdout);
 #endif
 
+  /* Can we get away with only updating the existing cells? */
+  if (s->incremental_rebuild && space_rebuild_incremental(s, verbose)) {
+    if (verbose)
+      message("took %.3f %s.", clocks_from_ticks(getticks() - tic),
+              clocks_getunit());
+    return;
+  }
+
   /* Re-grid if necessary, or just re-set the cell data. */
   space_regrid(s, verbose);
 
@@ -557,27 +955,7 @@ void space_rebuild(struct space *s, int verbose) {
   const int local_nodeID = s->e->nodeID;
 
   /* Move non-local parts to the end of the list. */
-  for (size_t k = 0; k < nr_parts;) {
-    if (cells_top[ind[k]].nodeID != local_nodeID) {
-      nr_parts -= 1;
-      /* Swap the particle */
-      memswap(&s->parts[k], &s->parts[nr_parts], sizeof(struct part));
-      /* Swap the link with the gpart */
-      if (s->parts[k].gpart != NULL) {
-        s->parts[k].gpart->id_or_neg_offset = -k;
-      }
-      if (s->parts[nr_parts].gpart != NULL) {
-        s->parts[nr_parts].gpart->id_or_neg_offset = -nr_parts;
-      }
-      /* Swap the xpart */
-      memswap(&s->xparts[k], &s->xparts[nr_parts], sizeof(struct xpart));
-      /* Swap the index */
-      memswap(&ind[k], &ind[nr_parts], sizeof(int));
-    } else {
-      /* Increment when not exchanging otherwise we need to retest "k".*/
-      k++;
-    }
-  }
+  nr_parts = space_move_nonlocal(s, ind, nr_parts, space_swap_parts_mapper);
 
 #ifdef SWIFT_DEBUG_CHECKS
   /* Check that all parts are in the correct places. */
@@ -594,25 +972,8 @@ void space_rebuild(struct space *s, int verbose) {
 #endif
 
   /* Move non-local sparts to the end of the list. */
-  for (size_t k = 0; k < nr_sparts;) {
-    if (cells_top[sind[k]].nodeID != local_nodeID) {
-      nr_sparts -= 1;
-      /* Swap the particle */
-      memswap(&s->sparts[k], &s->sparts[nr_sparts], sizeof(struct spart));
-      /* Swap the link with the gpart */
-      if (s->sparts[k].gpart != NULL) {
-        s->sparts[k].gpart->id_or_neg_offset = -k;
-      }
-      if (s->sparts[nr_sparts].gpart != NULL) {
-        s->sparts[nr_sparts].gpart->id_or_neg_offset = -nr_sparts;
-      }
-      /* Swap the index */
-      memswap(&sind[k], &sind[nr_sparts], sizeof(int));
-    } else {
-      /* Increment when not exchanging otherwise we need to retest "k".*/
-      k++;
-    }
-  }
+  nr_sparts =
+      space_move_nonlocal(s, sind, nr_sparts, space_swap_sparts_mapper);
 
 #ifdef SWIFT_DEBUG_CHECKS
   /* Check that all sparts are in the correct place (untested). */
@@ -629,31 +990,8 @@ void space_rebuild(struct space *s, int verbose) {
 #endif
 
   /* Move non-local gparts to the end of the list. */
-  for (size_t k = 0; k < nr_gparts;) {
-    if (cells_top[gind[k]].nodeID != local_nodeID) {
-      nr_gparts -= 1;
-      /* Swap the particle */
-      memswap(&s->gparts[k], &s->gparts[nr_gparts], sizeof(struct gpart));
-      /* Swap the link with part/spart */
-      if (s->gparts[k].type == swift_type_gas) {
-        s->parts[-s->gparts[k].id_or_neg_offset].gpart = &s->gparts[k];
-      } else if (s->gparts[k].type == swift_type_star) {
-        s->sparts[-s->gparts[k].id_or_neg_offset].gpart = &s->gparts[k];
-      }
-      if (s->gparts[nr_gparts].type == swift_type_gas) {
-        s->parts[-s->gparts[nr_gparts].id_or_neg_offset].gpart =
-            &s->gparts[nr_gparts];
-      } else if (s->gparts[nr_gparts].type == swift_type_star) {
-        s->sparts[-s->gparts[nr_gparts].id_or_neg_offset].gpart =
-            &s->gparts[nr_gparts];
-      }
-      /* Swap the index */
-      memswap(&gind[k], &gind[nr_gparts], sizeof(int));
-    } else {
-      /* Increment when not exchanging otherwise we need to retest "k".*/
-      k++;
-    }
-  }
+  nr_gparts =
+      space_move_nonlocal(s, gind, nr_gparts, space_swap_gparts_mapper);
 
 #ifdef SWIFT_DEBUG_CHECKS
   /* Check that all gparts are in the correct place (untested). */
@@ -745,6 +1083,10 @@ void space_rebuild(struct space *s, int verbose) {
 
 #endif /* WITH_MPI */
 
+  /* Sort the particles in the storage order of their cells. */
+  space_cell_index_to_rank(s, ind, nr_parts, cell_part_counts);
+  space_cell_index_to_rank(s, sind, nr_sparts, cell_spart_counts);
+
   /* Sort the parts according to their cells. */
   if (nr_parts > 0)
     space_parts_sort(s->parts, s->xparts, ind, cell_part_counts, s->nr_cells,
@@ -763,7 +1105,7 @@ void space_rebuild(struct space *s, int verbose) {
     /* New cell of this part */
     const struct cell *c = &s->cells_top[new_ind];
 
-    if (ind[k] != new_ind)
+    if (ind[k] != s->cells_top_rank[new_ind])
       error("part's new cell index not matching sorted index.");
 
     if (p->x[0] < c->loc[0] || p->x[0] > c->loc[0] + c->width[0] ||
@@ -790,7 +1132,7 @@ void space_rebuild(struct space *s, int verbose) {
     /* New cell of this spart */
     const struct cell *c = &s->cells_top[new_sind];
 
-    if (sind[k] != new_sind)
+    if (sind[k] != s->cells_top_rank[new_sind])
       error("spart's new cell index not matching sorted index.");
 
     if (sp->x[0] < c->loc[0] || sp->x[0] > c->loc[0] + c->width[0] ||
@@ -805,7 +1147,7 @@ void space_rebuild(struct space *s, int verbose) {
   ind[nr_parts] = s->nr_cells;  // sentinel.
   for (size_t k = 0; k < nr_parts; k++) {
     if (ind[k] < ind[k + 1]) {
-      cells_top[ind[k]].count = k - last_index + 1;
+      cells_top[s->cells_top_order[ind[k]]].count = k - last_index + 1;
       last_index = k + 1;
     }
   }
@@ -815,7 +1157,7 @@ void space_rebuild(struct space *s, int verbose) {
   sind[nr_sparts] = s->nr_cells;  // sentinel.
   for (size_t k = 0; k < nr_sparts; k++) {
     if (sind[k] < sind[k + 1]) {
-      cells_top[sind[k]].scount = k - last_sindex + 1;
+      cells_top[s->cells_top_order[sind[k]]].scount = k - last_sindex + 1;
       last_sindex = k + 1;
     }
   }
@@ -855,6 +1197,7 @@ void space_rebuild(struct space *s, int verbose) {
 #endif /* WITH_MPI */
 
   /* Sort the gparts according to their cells. */
+  space_cell_index_to_rank(s, gind, nr_gparts, cell_gpart_counts);
   if (nr_gparts > 0)
     space_gparts_sort(s->gparts, s->parts, s->sparts, gind, cell_gpart_counts,
                       s->nr_cells);
@@ -872,7 +1215,7 @@ void space_rebuild(struct space *s, int verbose) {
     /* New cell of this gpart */
     const struct cell *c = &s->cells_top[new_gind];
 
-    if (gind[k] != new_gind)
+    if (gind[k] != s->cells_top_rank[new_gind])
       error("gpart's new cell index not matching sorted index.");
 
     if (gp->x[0] < c->loc[0] || gp->x[0] > c->loc[0] + c->width[0] ||
@@ -887,7 +1230,7 @@ void space_rebuild(struct space *s, int verbose) {
   gind[nr_gparts] = s->nr_cells;
   for (size_t k = 0; k < nr_gparts; k++) {
     if (gind[k] < gind[k + 1]) {
-      cells_top[gind[k]].gcount = k - last_gindex + 1;
+      cells_top[s->cells_top_order[gind[k]]].gcount = k - last_gindex + 1;
       last_gindex = k + 1;
     }
   }
@@ -910,7 +1253,7 @@ void space_rebuild(struct space *s, int verbose) {
   struct gpart *gfinger = s->gparts;
   struct spart *sfinger = s->sparts;
   for (int k = 0; k < s->nr_cells; k++) {
-    struct cell *restrict c = &cells_top[k];
+    struct cell *restrict c = &cells_top[s->cells_top_order[k]];
     c->ti_old_part = ti_current;
     c->ti_old_gpart = ti_current;
     c->ti_old_multipole = ti_current;
@@ -947,29 +1290,6 @@ void space_rebuild(struct space *s, int verbose) {
             clocks_getunit());
 }
 
-/**
- * @brief Split particles between cells of a hierarchy
- *
- * This is done in parallel using threads in the #threadpool.
- *
- * @param s The #space.
- * @param cells The cell hierarchy.
- * @param nr_cells The number of cells.
- * @param verbose Are we talkative ?
- */
-void space_split(struct space *s, struct cell *cells, int nr_cells,
-                 int verbose) {
-
-  const ticks tic = getticks();
-
-  threadpool_map(&s->e->threadpool, space_split_mapper, cells, nr_cells,
-                 sizeof(struct cell), 0, s);
-
-  if (verbose)
-    message("took %.3f %s.", clocks_from_ticks(getticks() - tic),
-            clocks_getunit());
-}
-
 /**
  * @brief #threadpool mapper function to sanitize the cells
  *
@@ -1713,423 +2033,1431 @@ void space_map_cells_pre(struct space *s, int full,
 }
 
 /**
- * @brief Recursively split a cell.
+ * @brief Collect the time-step, smoothing length and multipole information of
+ * a split cell from its progeny.
+ *
+ * The progeny must already have been constructed.
  *
  * @param s The #space in which the cell lives.
- * @param c The #cell to split recursively.
- * @param buff A buffer for particle sorting, should be of size at least
- *        c->count or @c NULL.
- * @param sbuff A buffer for particle sorting, should be of size at least
- *        c->scount or @c NULL.
- * @param gbuff A buffer for particle sorting, should be of size at least
- *        c->gcount or @c NULL.
+ * @param c The split #cell to update.
  */
-void space_split_recursive(struct space *s, struct cell *c,
-                           struct cell_buff *buff, struct cell_buff *sbuff,
-                           struct cell_buff *gbuff) {
+void space_split_collect_progeny(struct space *s, struct cell *c) {
 
-  const int count = c->count;
-  const int gcount = c->gcount;
-  const int scount = c->scount;
-  const int with_gravity = s->gravity;
-  const int depth = c->depth;
-  int maxdepth = 0;
+  int maxdepth = c->depth;
   float h_max = 0.0f;
   integertime_t ti_hydro_end_min = max_nr_timesteps, ti_hydro_end_max = 0,
                 ti_hydro_beg_max = 0;
   integertime_t ti_gravity_end_min = max_nr_timesteps, ti_gravity_end_max = 0,
                 ti_gravity_beg_max = 0;
-  struct part *parts = c->parts;
-  struct gpart *gparts = c->gparts;
-  struct spart *sparts = c->sparts;
-  struct xpart *xparts = c->xparts;
-  struct engine *e = s->e;
-  const integertime_t ti_current = e->ti_current;
-
-  /* If the buff is NULL, allocate it, and remember to free it. */
-  const int allocate_buffer = (buff == NULL && gbuff == NULL && sbuff == NULL);
-  if (allocate_buffer) {
-    if (count > 0) {
-      if (posix_memalign((void **)&buff, SWIFT_STRUCT_ALIGNMENT,
-                         sizeof(struct cell_buff) * count) != 0)
-        error("Failed to allocate temporary indices.");
-      for (int k = 0; k < count; k++) {
-        buff[k].x[0] = parts[k].x[0];
-        buff[k].x[1] = parts[k].x[1];
-        buff[k].x[2] = parts[k].x[2];
-      }
-    }
-    if (gcount > 0) {
-      if (posix_memalign((void **)&gbuff, SWIFT_STRUCT_ALIGNMENT,
-                         sizeof(struct cell_buff) * gcount) != 0)
-        error("Failed to allocate temporary indices.");
-      for (int k = 0; k < gcount; k++) {
-        gbuff[k].x[0] = gparts[k].x[0];
-        gbuff[k].x[1] = gparts[k].x[1];
-        gbuff[k].x[2] = gparts[k].x[2];
-      }
-    }
-    if (scount > 0) {
-      if (posix_memalign((void **)&sbuff, SWIFT_STRUCT_ALIGNMENT,
-                         sizeof(struct cell_buff) * scount) != 0)
-        error("Failed to allocate temporary indices.");
-      for (int k = 0; k < scount; k++) {
-        sbuff[k].x[0] = sparts[k].x[0];
-        sbuff[k].x[1] = sparts[k].x[1];
-        sbuff[k].x[2] = sparts[k].x[2];
-      }
-    }
-  }
 
-  /* Check the depth. */
-  while (depth > (maxdepth = s->maxdepth)) {
-    atomic_cas(&s->maxdepth, maxdepth, depth);
-  }
+  cell_part_bbox_empty(c);
 
-  /* If the depth is too large, we have a problem and should stop. */
-  if (maxdepth > space_cell_maxdepth) {
-    error("Exceeded maximum depth (%d) when splitting cells, aborting",
-          space_cell_maxdepth);
+  for (int k = 0; k < 8; k++) {
+
+    /* Get the progenitor */
+    const struct cell *cp = c->progeny[k];
+    if (cp == NULL) continue;
+
+    /* Update the cell-wide properties */
+    h_max = max(h_max, cp->h_max);
+    cell_part_bbox_merge(c, cp);
+    ti_hydro_end_min = min(ti_hydro_end_min, cp->ti_hydro_end_min);
+    ti_hydro_end_max = max(ti_hydro_end_max, cp->ti_hydro_end_max);
+    ti_hydro_beg_max = max(ti_hydro_beg_max, cp->ti_hydro_beg_max);
+    ti_gravity_end_min = min(ti_gravity_end_min, cp->ti_gravity_end_min);
+    ti_gravity_end_max = max(ti_gravity_end_max, cp->ti_gravity_end_max);
+    ti_gravity_beg_max = max(ti_gravity_beg_max, cp->ti_gravity_beg_max);
+
+    /* Increase the depth */
+    if (cp->maxdepth > maxdepth) maxdepth = cp->maxdepth;
   }
 
-  /* Split or let it be? */
-  if ((with_gravity && gcount > space_splitsize) ||
-      (!with_gravity &&
-       (count > space_splitsize || scount > space_splitsize))) {
+  /* Deal with the multipole */
+  if (s->gravity) {
 
-    /* No longer just a leaf. */
-    c->split = 1;
+    /* Reset everything */
+    gravity_reset(c->multipole);
 
-    /* Create the cell's progeny. */
-    space_getcells(s, 8, c->progeny);
-    for (int k = 0; k < 8; k++) {
-      struct cell *cp = c->progeny[k];
-      cp->count = 0;
-      cp->gcount = 0;
-      cp->scount = 0;
-      cp->ti_old_part = c->ti_old_part;
-      cp->ti_old_gpart = c->ti_old_gpart;
-      cp->ti_old_multipole = c->ti_old_multipole;
-      cp->loc[0] = c->loc[0];
-      cp->loc[1] = c->loc[1];
-      cp->loc[2] = c->loc[2];
-      cp->width[0] = c->width[0] / 2;
-      cp->width[1] = c->width[1] / 2;
-      cp->width[2] = c->width[2] / 2;
-      cp->dmin = c->dmin / 2;
-      if (k & 4) cp->loc[0] += cp->width[0];
-      if (k & 2) cp->loc[1] += cp->width[1];
-      if (k & 1) cp->loc[2] += cp->width[2];
-      cp->depth = c->depth + 1;
-      cp->split = 0;
-      cp->h_max = 0.f;
-      cp->dx_max_part = 0.f;
-      cp->dx_max_sort = 0.f;
-      cp->nodeID = c->nodeID;
-      cp->parent = c;
-      cp->super = NULL;
-      cp->super_hydro = NULL;
-      cp->super_gravity = NULL;
-      cp->do_sub_sort = 0;
-      cp->do_grav_sub_drift = 0;
-      cp->do_sub_drift = 0;
-#ifdef SWIFT_DEBUG_CHECKS
-      cp->cellID = last_cell_id++;
-#endif
-    }
+    /* Compute CoM and bulk velocity from all progenies */
+    double CoM[3] = {0., 0., 0.};
+    double vel[3] = {0., 0., 0.};
+    float max_delta_vel[3] = {0.f, 0.f, 0.f};
+    float min_delta_vel[3] = {0.f, 0.f, 0.f};
+    double mass = 0.;
 
-    /* Split the cell's partcle data. */
-    cell_split(c, c->parts - s->parts, c->sparts - s->sparts, buff, sbuff,
-               gbuff);
+    for (int k = 0; k < 8; ++k) {
+      if (c->progeny[k] != NULL) {
+        const struct gravity_tensors *m = c->progeny[k]->multipole;
 
-    /* Buffers for the progenitors */
-    struct cell_buff *progeny_buff = buff, *progeny_gbuff = gbuff,
-                     *progeny_sbuff = sbuff;
+        mass += m->m_pole.M_000;
 
-    for (int k = 0; k < 8; k++) {
+        CoM[0] += m->CoM[0] * m->m_pole.M_000;
+        CoM[1] += m->CoM[1] * m->m_pole.M_000;
+        CoM[2] += m->CoM[2] * m->m_pole.M_000;
+
+        vel[0] += m->m_pole.vel[0] * m->m_pole.M_000;
+        vel[1] += m->m_pole.vel[1] * m->m_pole.M_000;
+        vel[2] += m->m_pole.vel[2] * m->m_pole.M_000;
+
+        max_delta_vel[0] = max(m->m_pole.max_delta_vel[0], max_delta_vel[0]);
+        max_delta_vel[1] = max(m->m_pole.max_delta_vel[1], max_delta_vel[1]);
+        max_delta_vel[2] = max(m->m_pole.max_delta_vel[2], max_delta_vel[2]);
+
+        min_delta_vel[0] = min(m->m_pole.min_delta_vel[0], min_delta_vel[0]);
+        min_delta_vel[1] = min(m->m_pole.min_delta_vel[1], min_delta_vel[1]);
+        min_delta_vel[2] = min(m->m_pole.min_delta_vel[2], min_delta_vel[2]);
+      }
+    }
+
+    /* Final operation on the CoM and bulk velocity */
+    const double inv_mass = 1. / mass;
+    c->multipole->CoM[0] = CoM[0] * inv_mass;
+    c->multipole->CoM[1] = CoM[1] * inv_mass;
+    c->multipole->CoM[2] = CoM[2] * inv_mass;
+    c->multipole->m_pole.vel[0] = vel[0] * inv_mass;
+    c->multipole->m_pole.vel[1] = vel[1] * inv_mass;
+    c->multipole->m_pole.vel[2] = vel[2] * inv_mass;
+
+    /* Min max velocity along each axis */
+    c->multipole->m_pole.max_delta_vel[0] = max_delta_vel[0];
+    c->multipole->m_pole.max_delta_vel[1] = max_delta_vel[1];
+    c->multipole->m_pole.max_delta_vel[2] = max_delta_vel[2];
+    c->multipole->m_pole.min_delta_vel[0] = min_delta_vel[0];
+    c->multipole->m_pole.min_delta_vel[1] = min_delta_vel[1];
+    c->multipole->m_pole.min_delta_vel[2] = min_delta_vel[2];
+
+    /* Now shift progeny multipoles and add them up */
+    struct multipole temp;
+    double r_max = 0.;
+    for (int k = 0; k < 8; ++k) {
+      if (c->progeny[k] != NULL) {
+        const struct cell *cp = c->progeny[k];
+        const struct multipole *m = &cp->multipole->m_pole;
+
+        /* Contribution to multipole */
+        gravity_M2M(&temp, m, c->multipole->CoM, cp->multipole->CoM);
+        gravity_multipole_add(&c->multipole->m_pole, &temp);
+
+        /* Upper limit of max CoM<->gpart distance */
+        const double dx = c->multipole->CoM[0] - cp->multipole->CoM[0];
+        const double dy = c->multipole->CoM[1] - cp->multipole->CoM[1];
+        const double dz = c->multipole->CoM[2] - cp->multipole->CoM[2];
+        const double r2 = dx * dx + dy * dy + dz * dz;
+        r_max = max(r_max, cp->multipole->r_max + sqrt(r2));
+      }
+    }
+
+    /* Alternative upper limit of max CoM<->gpart distance */
+    const double dx = c->multipole->CoM[0] > c->loc[0] + c->width[0] / 2.
+                          ? c->multipole->CoM[0] - c->loc[0]
+                          : c->loc[0] + c->width[0] - c->multipole->CoM[0];
+    const double dy = c->multipole->CoM[1] > c->loc[1] + c->width[1] / 2.
+                          ? c->multipole->CoM[1] - c->loc[1]
+                          : c->loc[1] + c->width[1] - c->multipole->CoM[1];
+    const double dz = c->multipole->CoM[2] > c->loc[2] + c->width[2] / 2.
+                          ? c->multipole->CoM[2] - c->loc[2]
+                          : c->loc[2] + c->width[2] - c->multipole->CoM[2];
+
+    /* Take minimum of both limits */
+    c->multipole->r_max = min(r_max, sqrt(dx * dx + dy * dy + dz * dz));
+
+    /* Store the value at rebuild time */
+    c->multipole->r_max_rebuild = c->multipole->r_max;
+    c->multipole->CoM_rebuild[0] = c->multipole->CoM[0];
+    c->multipole->CoM_rebuild[1] = c->multipole->CoM[1];
+    c->multipole->CoM_rebuild[2] = c->multipole->CoM[2];
+
+    /* We know the first-order multipole (dipole) is 0. */
+    c->multipole->m_pole.M_100 = 0.f;
+    c->multipole->m_pole.M_010 = 0.f;
+    c->multipole->m_pole.M_001 = 0.f;
+
+  } /* Deal with gravity */
+
+  /* Set the values for this cell. */
+  c->h_max = h_max;
+  c->ti_hydro_end_min = ti_hydro_end_min;
+  c->ti_hydro_end_max = ti_hydro_end_max;
+  c->ti_hydro_beg_max = ti_hydro_beg_max;
+  c->ti_gravity_end_min = ti_gravity_end_min;
+  c->ti_gravity_end_max = ti_gravity_end_max;
+  c->ti_gravity_beg_max = ti_gravity_beg_max;
+  c->maxdepth = maxdepth;
+}
+
+/**
+ * @brief Collect the time-step, smoothing length and multipole information of
+ * a leaf cell from its particles.
+ *
+ * Also resets the displacement of the #part since the last rebuild.
+ *
+ * @param s The #space in which the cell lives.
+ * @param c The leaf #cell to update.
+ */
+void space_split_collect_leaf(struct space *s, struct cell *c) {
+
+  const int count = c->count;
+  const int gcount = c->gcount;
+  const int scount = c->scount;
+  struct part *parts = c->parts;
+  struct gpart *gparts = c->gparts;
+  struct spart *sparts = c->sparts;
+  struct xpart *xparts = c->xparts;
+  const integertime_t ti_current = s->e->ti_current;
+  float h_max = 0.0f;
+
+  timebin_t hydro_time_bin_min = num_time_bins, hydro_time_bin_max = 0;
+  timebin_t gravity_time_bin_min = num_time_bins, gravity_time_bin_max = 0;
+
+  /* parts: Get dt_min/dt_max, h_max and the bounding box. */
+  cell_part_bbox_empty(c);
+  for (int k = 0; k < count; k++) {
+#ifdef SWIFT_DEBUG_CHECKS
+    if (parts[k].time_bin == time_bin_inhibited)
+      error("Inhibited particle present in space_split()");
+#endif
+    hydro_time_bin_min = min(hydro_time_bin_min, parts[k].time_bin);
+    hydro_time_bin_max = max(hydro_time_bin_max, parts[k].time_bin);
+    h_max = max(h_max, parts[k].h);
+    cell_part_bbox_add(c, parts[k].x);
+  }
+
+  /* xparts: Reset x_diff */
+  for (int k = 0; k < count; k++) {
+    xparts[k].x_diff[0] = 0.f;
+    xparts[k].x_diff[1] = 0.f;
+    xparts[k].x_diff[2] = 0.f;
+  }
+
+  /* gparts: Get dt_min/dt_max. */
+  for (int k = 0; k < gcount; k++) {
+#ifdef SWIFT_DEBUG_CHECKS
+    if (gparts[k].time_bin == time_bin_inhibited)
+      error("Inhibited g-particle present in space_split()");
+#endif
+    gravity_time_bin_min = min(gravity_time_bin_min, gparts[k].time_bin);
+    gravity_time_bin_max = max(gravity_time_bin_max, gparts[k].time_bin);
+  }
+
+  /* sparts: Get dt_min/dt_max */
+  for (int k = 0; k < scount; k++) {
+#ifdef SWIFT_DEBUG_CHECKS
+    if (sparts[k].time_bin == time_bin_inhibited)
+      error("Inhibited s-particle present in space_split()");
+#endif
+    gravity_time_bin_min = min(gravity_time_bin_min, sparts[k].time_bin);
+    gravity_time_bin_max = max(gravity_time_bin_max, sparts[k].time_bin);
+  }
+
+  /* Convert into integer times */
+  c->ti_hydro_end_min = get_integer_time_end(ti_current, hydro_time_bin_min);
+  c->ti_hydro_end_max = get_integer_time_end(ti_current, hydro_time_bin_max);
+  c->ti_hydro_beg_max =
+      get_integer_time_begin(ti_current + 1, hydro_time_bin_max);
+  c->ti_gravity_end_min =
+      get_integer_time_end(ti_current, gravity_time_bin_min);
+  c->ti_gravity_end_max =
+      get_integer_time_end(ti_current, gravity_time_bin_max);
+  c->ti_gravity_beg_max =
+      get_integer_time_begin(ti_current + 1, gravity_time_bin_max);
+
+  /* Construct the multipole and the centre of mass*/
+  if (s->gravity) {
+    if (gcount > 0) {
+
+      gravity_P2M(c->multipole, c->gparts, c->gcount);
+
+    } else {
+
+      /* No gparts in that leaf cell */
+
+      /* Set the values to something sensible */
+      gravity_multipole_init(&c->multipole->m_pole);
+      if (c->nodeID == engine_rank) {
+        c->multipole->CoM[0] = c->loc[0] + c->width[0] / 2.;
+        c->multipole->CoM[1] = c->loc[1] + c->width[1] / 2.;
+        c->multipole->CoM[2] = c->loc[2] + c->width[2] / 2.;
+        c->multipole->r_max = 0.;
+      }
+    }
+
+    /* Store the value at rebuild time */
+    c->multipole->r_max_rebuild = c->multipole->r_max;
+    c->multipole->CoM_rebuild[0] = c->multipole->CoM[0];
+    c->multipole->CoM_rebuild[1] = c->multipole->CoM[1];
+    c->multipole->CoM_rebuild[2] = c->multipole->CoM[2];
+  }
+
+  /* Set the values for this cell. */
+  c->h_max = h_max;
+  c->maxdepth = c->depth;
+}
+
+/**
+ * @brief Set the owner of a cell according to the start of its particle
+ * arrays.
+ *
+ * @param s The #space in which the cell lives.
+ * @param c The #cell.
+ */
+void space_split_set_owner(const struct space *s, struct cell *c) {
+
+  if (s->nr_parts > 0)
+    c->owner =
+        ((c->parts - s->parts) % s->nr_parts) * s->nr_queues / s->nr_parts;
+  else if (s->nr_sparts > 0)
+    c->owner =
+        ((c->sparts - s->sparts) % s->nr_sparts) * s->nr_queues / s->nr_sparts;
+  else if (s->nr_gparts > 0)
+    c->owner =
+        ((c->gparts - s->gparts) % s->nr_gparts) * s->nr_queues / s->nr_gparts;
+  else
+    c->owner = 0; /* Ok, there is really nothing on this rank... */
+}
+
+/**
+ * @brief Does a cell contain enough particles to be split?
+ *
+ * @param s The #space in which the cell lives.
+ * @param c The #cell.
+ */
+int space_cell_needs_split(const struct space *s, const struct cell *c) {
+
+  if (s->gravity)
+    return c->gcount > space_splitsize;
+  else
+    return c->count > space_splitsize || c->scount > space_splitsize;
+}
+
+/**
+ * @brief Split a cell into its eight progeny, without recursing.
+ *
+ * Progeny that end up without any particles are returned to the buffer.
+ *
+ * @param s The #space in which the cell lives.
+ * @param c The #cell to split.
+ * @param buff A buffer for particle sorting, of size at least c->count.
+ * @param sbuff A buffer for particle sorting, of size at least c->scount.
+ * @param gbuff A buffer for particle sorting, of size at least c->gcount.
+ */
+void space_split_make_progeny(struct space *s, struct cell *c,
+                              struct cell_buff *buff, struct cell_buff *sbuff,
+                              struct cell_buff *gbuff) {
+
+  /* No longer just a leaf. */
+  c->split = 1;
+
+  /* Create the cell's progeny. */
+  space_getcells(s, 8, c->progeny);
+  for (int k = 0; k < 8; k++) {
+    struct cell *cp = c->progeny[k];
+    cp->count = 0;
+    cp->gcount = 0;
+    cp->scount = 0;
+    cp->ti_old_part = c->ti_old_part;
+    cp->ti_old_gpart = c->ti_old_gpart;
+    cp->ti_old_multipole = c->ti_old_multipole;
+    cp->loc[0] = c->loc[0];
+    cp->loc[1] = c->loc[1];
+    cp->loc[2] = c->loc[2];
+    cp->width[0] = c->width[0] / 2;
+    cp->width[1] = c->width[1] / 2;
+    cp->width[2] = c->width[2] / 2;
+    cp->dmin = c->dmin / 2;
+    if (k & 4) cp->loc[0] += cp->width[0];
+    if (k & 2) cp->loc[1] += cp->width[1];
+    if (k & 1) cp->loc[2] += cp->width[2];
+    cp->depth = c->depth + 1;
+    cp->split = 0;
+    cp->h_max = 0.f;
+    cp->dx_max_part = 0.f;
+    cp->dx_max_sort = 0.f;
+    cp->nodeID = c->nodeID;
+    cp->parent = c;
+    cp->super = NULL;
+    cp->super_hydro = NULL;
+    cp->super_gravity = NULL;
+    cp->do_sub_sort = 0;
+    cp->do_grav_sub_drift = 0;
+    cp->do_sub_drift = 0;
+#ifdef SWIFT_DEBUG_CHECKS
+    cp->cellID = last_cell_id++;
+#endif
+  }
+
+  /* Split the cell's partcle data. */
+  cell_split(c, c->parts - s->parts, c->sparts - s->sparts, buff, sbuff,
+             gbuff);
+
+  /* Remove any progeny with zero particles. */
+  for (int k = 0; k < 8; k++) {
+    struct cell *cp = c->progeny[k];
+    if (cp->count == 0 && cp->gcount == 0 && cp->scount == 0) {
+      space_recycle(s, cp);
+      c->progeny[k] = NULL;
+    }
+  }
+}
+
+/**
+ * @brief Allocate and fill the position buffers used to split a cell.
+ *
+ * @param c The #cell to split.
+ * @param buff (return) The buffer for the #part or @c NULL.
+ * @param sbuff (return) The buffer for the #spart or @c NULL.
+ * @param gbuff (return) The buffer for the #gpart or @c NULL.
+ */
+void space_split_alloc_buffers(const struct cell *c, struct cell_buff **buff,
+                               struct cell_buff **sbuff,
+                               struct cell_buff **gbuff) {
+
+  const int count = c->count;
+  const int gcount = c->gcount;
+  const int scount = c->scount;
+  const struct part *parts = c->parts;
+  const struct gpart *gparts = c->gparts;
+  const struct spart *sparts = c->sparts;
+
+  *buff = NULL;
+  *gbuff = NULL;
+  *sbuff = NULL;
+  if (count > 0) {
+    if (posix_memalign((void **)buff, SWIFT_STRUCT_ALIGNMENT,
+                       sizeof(struct cell_buff) * count) != 0)
+      error("Failed to allocate temporary indices.");
+    for (int k = 0; k < count; k++) {
+      (*buff)[k].x[0] = parts[k].x[0];
+      (*buff)[k].x[1] = parts[k].x[1];
+      (*buff)[k].x[2] = parts[k].x[2];
+    }
+  }
+  if (gcount > 0) {
+    if (posix_memalign((void **)gbuff, SWIFT_STRUCT_ALIGNMENT,
+                       sizeof(struct cell_buff) * gcount) != 0)
+      error("Failed to allocate temporary indices.");
+    for (int k = 0; k < gcount; k++) {
+      (*gbuff)[k].x[0] = gparts[k].x[0];
+      (*gbuff)[k].x[1] = gparts[k].x[1];
+      (*gbuff)[k].x[2] = gparts[k].x[2];
+    }
+  }
+  if (scount > 0) {
+    if (posix_memalign((void **)sbuff, SWIFT_STRUCT_ALIGNMENT,
+                       sizeof(struct cell_buff) * scount) != 0)
+      error("Failed to allocate temporary indices.");
+    for (int k = 0; k < scount; k++) {
+      (*sbuff)[k].x[0] = sparts[k].x[0];
+      (*sbuff)[k].x[1] = sparts[k].x[1];
+      (*sbuff)[k].x[2] = sparts[k].x[2];
+    }
+  }
+}
+
+/**
+ * @brief Update the maximal depth of the tree and check it is not too large.
+ *
+ * @param s The #space.
+ * @param depth The depth of the cell being constructed.
+ */
+void space_split_check_depth(struct space *s, int depth) {
+
+  int maxdepth = 0;
+  while (depth > (maxdepth = s->maxdepth)) {
+    atomic_cas(&s->maxdepth, maxdepth, depth);
+  }
+
+  /* If the depth is too large, we have a problem and should stop. */
+  if (maxdepth > space_cell_maxdepth) {
+    error("Exceeded maximum depth (%d) when splitting cells, aborting",
+          space_cell_maxdepth);
+  }
+}
+
+/**
+ * @brief Recursively split a cell.
+ *
+ * @param s The #space in which the cell lives.
+ * @param c The #cell to split recursively.
+ * @param buff A buffer for particle sorting, should be of size at least
+ *        c->count or @c NULL.
+ * @param sbuff A buffer for particle sorting, should be of size at least
+ *        c->scount or @c NULL.
+ * @param gbuff A buffer for particle sorting, should be of size at least
+ *        c->gcount or @c NULL.
+ */
+void space_split_recursive(struct space *s, struct cell *c,
+                           struct cell_buff *buff, struct cell_buff *sbuff,
+                           struct cell_buff *gbuff) {
+
+  /* Check the depth. */
+  space_split_check_depth(s, c->depth);
+
+  /* Split or let it be? */
+  if (space_cell_needs_split(s, c)) {
+
+    /* If the buff is NULL, allocate it, and remember to free it. */
+    const int allocate_buffer =
+        (buff == NULL && gbuff == NULL && sbuff == NULL);
+    if (allocate_buffer) space_split_alloc_buffers(c, &buff, &sbuff, &gbuff);
+
+    /* Create the progeny and split the particles between them. */
+    space_split_make_progeny(s, c, buff, sbuff, gbuff);
+
+    /* Buffers for the progenitors */
+    struct cell_buff *progeny_buff = buff, *progeny_gbuff = gbuff,
+                     *progeny_sbuff = sbuff;
+
+    for (int k = 0; k < 8; k++) {
 
       /* Get the progenitor */
       struct cell *cp = c->progeny[k];
+      if (cp == NULL) continue;
 
-      /* Remove any progeny with zero particles. */
-      if (cp->count == 0 && cp->gcount == 0 && cp->scount == 0) {
+      /* Recurse */
+      space_split_recursive(s, cp, progeny_buff, progeny_sbuff, progeny_gbuff);
 
-        space_recycle(s, cp);
-        c->progeny[k] = NULL;
+      /* Update the pointers in the buffers */
+      progeny_buff += cp->count;
+      progeny_gbuff += cp->gcount;
+      progeny_sbuff += cp->scount;
+    }
 
-      } else {
+    /* Clean up. */
+    if (allocate_buffer) {
+      if (buff != NULL) free(buff);
+      if (gbuff != NULL) free(gbuff);
+      if (sbuff != NULL) free(sbuff);
+    }
+
+    /* Collect the information from the progeny. */
+    space_split_collect_progeny(s, c);
 
-        /* Recurse */
-        space_split_recursive(s, cp, progeny_buff, progeny_sbuff,
-                              progeny_gbuff);
-
-        /* Update the pointers in the buffers */
-        progeny_buff += cp->count;
-        progeny_gbuff += cp->gcount;
-        progeny_sbuff += cp->scount;
-
-        /* Update the cell-wide properties */
-        h_max = max(h_max, cp->h_max);
-        ti_hydro_end_min = min(ti_hydro_end_min, cp->ti_hydro_end_min);
-        ti_hydro_end_max = max(ti_hydro_end_max, cp->ti_hydro_end_max);
-        ti_hydro_beg_max = max(ti_hydro_beg_max, cp->ti_hydro_beg_max);
-        ti_gravity_end_min = min(ti_gravity_end_min, cp->ti_gravity_end_min);
-        ti_gravity_end_max = max(ti_gravity_end_max, cp->ti_gravity_end_max);
-        ti_gravity_beg_max = max(ti_gravity_beg_max, cp->ti_gravity_beg_max);
-
-        /* Increase the depth */
-        if (cp->maxdepth > maxdepth) maxdepth = cp->maxdepth;
+  } /* Split or let it be? */
+
+  /* Otherwise, collect the data from the particles this cell. */
+  else {
+
+    /* Clear the progeny. */
+    bzero(c->progeny, sizeof(struct cell *) * 8);
+    c->split = 0;
+
+    space_split_collect_leaf(s, c);
+  }
+
+  /* Set ownership according to the start of the parts array. */
+  space_split_set_owner(s, c);
+}
+
+/**
+ * @brief Is a cell large enough for its progeny to be split in parallel?
+ *
+ * @param s The #space in which the cell lives.
+ * @param c The #cell.
+ */
+int space_cell_split_in_parallel(const struct space *s, const struct cell *c) {
+
+  const int size = s->gravity ? c->gcount : max(c->count, c->scount);
+  return size > space_splitsize_parallel && space_cell_needs_split(s, c);
+}
+
+/**
+ * @brief Information required to split the large cells in parallel.
+ */
+struct space_split_data {
+
+  /*! The #space. */
+  struct space *s;
+
+  /*! The cells left to split recursively. */
+  struct cell **cells;
+
+  /*! Number of cells in the list and size of the list. */
+  int nr_cells, size_cells;
+
+  /*! Lock protecting the list. */
+  swift_lock_type lock;
+};
+
+/**
+ * @brief Split the top levels of a large cell, deferring the construction of
+ * the sub-trees below #space_splitsize_parallel particles.
+ *
+ * @param data The #space_split_data collecting the deferred cells.
+ * @param c The #cell to split.
+ * @param buff A buffer for particle sorting, of size at least c->count.
+ * @param sbuff A buffer for particle sorting, of size at least c->scount.
+ * @param gbuff A buffer for particle sorting, of size at least c->gcount.
+ */
+void space_split_upper_recursive(struct space_split_data *data,
+                                 struct cell *c, struct cell_buff *buff,
+                                 struct cell_buff *sbuff,
+                                 struct cell_buff *gbuff) {
+
+  struct space *s = data->s;
+
+  /* Small enough? Leave it to the second pass. */
+  if (!space_cell_split_in_parallel(s, c)) {
+    lock_lock(&data->lock);
+    if (data->nr_cells == data->size_cells) {
+      data->size_cells = data->size_cells > 0 ? 2 * data->size_cells : 64;
+      struct cell **cells = (struct cell **)realloc(
+          data->cells, sizeof(struct cell *) * data->size_cells);
+      if (cells == NULL) error("Failed to re-allocate the list of cells.");
+      data->cells = cells;
+    }
+    data->cells[data->nr_cells++] = c;
+    if (lock_unlock(&data->lock) != 0) error("Failed to unlock the list.");
+    return;
+  }
+
+  /* Check the depth. */
+  space_split_check_depth(s, c->depth);
+
+  /* Create the progeny and split the particles between them. */
+  space_split_make_progeny(s, c, buff, sbuff, gbuff);
+
+  /* Recurse */
+  for (int k = 0; k < 8; k++) {
+    struct cell *cp = c->progeny[k];
+    if (cp == NULL) continue;
+    space_split_upper_recursive(data, cp, buff, sbuff, gbuff);
+    buff += cp->count;
+    gbuff += cp->gcount;
+    sbuff += cp->scount;
+  }
+}
+
+/**
+ * @brief Collect the information from the progeny of the cells split by
+ * space_split_upper_recursive(), once all the sub-trees have been built.
+ *
+ * @param s The #space.
+ * @param c The #cell.
+ */
+void space_split_upper_collect(struct space *s, struct cell *c) {
+
+  if (!space_cell_split_in_parallel(s, c)) return;
+
+  for (int k = 0; k < 8; k++)
+    if (c->progeny[k] != NULL) space_split_upper_collect(s, c->progeny[k]);
+
+  space_split_collect_progeny(s, c);
+  space_split_set_owner(s, c);
+}
+
+/**
+ * @brief #threadpool mapper function to split cells if they contain
+ *        too many particles.
+ *
+ * @param map_data Pointer towards the top-cells.
+ * @param num_cells The number of cells to treat.
+ * @param extra_data Pointers to the #space.
+ */
+void space_split_mapper(void *map_data, int num_cells, void *extra_data) {
+
+  /* Unpack the inputs. */
+  struct space_split_data *data = (struct space_split_data *)extra_data;
+  struct space *s = data->s;
+  struct cell *restrict cells_top = (struct cell *)map_data;
+
+  for (int ind = 0; ind < num_cells; ind++) {
+    struct cell *c = &cells_top[ind];
+
+    /* Only split the top of the large cells, their sub-trees are built in
+     * parallel later. */
+    if (space_cell_split_in_parallel(s, c)) {
+      struct cell_buff *buff, *sbuff, *gbuff;
+      space_split_alloc_buffers(c, &buff, &sbuff, &gbuff);
+      space_split_upper_recursive(data, c, buff, sbuff, gbuff);
+      if (buff != NULL) free(buff);
+      if (gbuff != NULL) free(gbuff);
+      if (sbuff != NULL) free(sbuff);
+    } else {
+      space_split_recursive(s, c, NULL, NULL, NULL);
+    }
+  }
+
+#ifdef SWIFT_DEBUG_CHECKS
+  /* All cells and particles should have consistent h_max values. */
+  for (int ind = 0; ind < num_cells; ind++) {
+    if (space_cell_split_in_parallel(s, &cells_top[ind])) continue;
+    int depth = 0;
+    if (!checkCellhdxmax(&cells_top[ind], &depth))
+      message("    at cell depth %d", depth);
+  }
+#endif
+}
+
+/**
+ * @brief #threadpool mapper function to build the sub-trees deferred by
+ * space_split_upper_recursive().
+ *
+ * @param map_data Pointer towards the list of cells.
+ * @param num_cells The number of cells to treat.
+ * @param extra_data Pointers to the #space.
+ */
+void space_split_deferred_mapper(void *map_data, int num_cells,
+                                 void *extra_data) {
+
+  /* Unpack the inputs. */
+  struct space *s = (struct space *)extra_data;
+  struct cell **cells = (struct cell **)map_data;
+
+  for (int ind = 0; ind < num_cells; ind++)
+    space_split_recursive(s, cells[ind], NULL, NULL, NULL);
+}
+
+/**
+ * @brief #threadpool mapper function to finish the top levels of the cells
+ * split in parallel.
+ *
+ * @param map_data Pointer towards the top-cells.
+ * @param num_cells The number of cells to treat.
+ * @param extra_data Pointers to the #space.
+ */
+void space_split_collect_mapper(void *map_data, int num_cells,
+                                void *extra_data) {
+
+  /* Unpack the inputs. */
+  struct space *s = (struct space *)extra_data;
+  struct cell *restrict cells_top = (struct cell *)map_data;
+
+  for (int ind = 0; ind < num_cells; ind++)
+    space_split_upper_collect(s, &cells_top[ind]);
+
+#ifdef SWIFT_DEBUG_CHECKS
+  /* All cells and particles should have consistent h_max values. */
+  for (int ind = 0; ind < num_cells; ind++) {
+    if (!space_cell_split_in_parallel(s, &cells_top[ind])) continue;
+    int depth = 0;
+    if (!checkCellhdxmax(&cells_top[ind], &depth))
+      message("    at cell depth %d", depth);
+  }
+#endif
+}
+
+/**
+ * @brief Split particles between cells of a hierarchy
+ *
+ * This is done in parallel using threads in the #threadpool. Cells with more
+ * than #space_splitsize_parallel particles are only split down to that size
+ * first, such that their sub-trees can then be built in parallel too.
+ *
+ * @param s The #space.
+ * @param cells The cell hierarchy.
+ * @param nr_cells The number of cells.
+ * @param verbose Are we talkative ?
+ */
+void space_split(struct space *s, struct cell *cells, int nr_cells,
+                 int verbose) {
+
+  const ticks tic = getticks();
+
+  struct space_split_data data;
+  data.s = s;
+  data.cells = NULL;
+  data.nr_cells = 0;
+  data.size_cells = 0;
+  lock_init(&data.lock);
+
+  /* Split the cells, stopping at the top of the sub-trees of large cells. */
+  threadpool_map(&s->e->threadpool, space_split_mapper, cells, nr_cells,
+                 sizeof(struct cell), 0, &data);
+
+  /* Build the deferred sub-trees in parallel and finish their parents. */
+  if (data.nr_cells > 0) {
+    threadpool_map(&s->e->threadpool, space_split_deferred_mapper, data.cells,
+                   data.nr_cells, sizeof(struct cell *), 1, s);
+    threadpool_map(&s->e->threadpool, space_split_collect_mapper, cells,
+                   nr_cells, sizeof(struct cell), 0, s);
+
+    if (verbose)
+      message("built %d sub-trees of large cells in parallel.",
+              data.nr_cells);
+  }
+
+  free(data.cells);
+  if (lock_destroy(&data.lock) != 0) error("Failed to destroy lock.");
+
+  if (verbose)
+    message("took %.3f %s.", clocks_from_ticks(getticks() - tic),
+            clocks_getunit());
+}
+
+/**
+ * @brief Information required to update the cell tree incrementally.
+ */
+struct incremental_data {
+  struct space *s;
+  const int *ind, *gind, *sind;
+  int *dirty;
+  size_t nr_moved, nr_gmoved, nr_smoved;
+  int nr_resplit;
+};
+
+/**
+ * @brief #threadpool mapper function flagging the top-level cells that lost
+ * or gained particles since the last rebuild.
+ *
+ * @param map_data Pointer towards the top-level cells.
+ * @param num_cells The number of cells to treat.
+ * @param extra_data Pointer to the #incremental_data.
+ */
+void space_rebuild_incremental_flag_mapper(void *map_data, int num_cells,
+                                           void *extra_data) {
+
+  struct incremental_data *data = (struct incremental_data *)extra_data;
+  struct space *s = data->s;
+  struct cell *cells = (struct cell *)map_data;
+  size_t nr_moved = 0, nr_gmoved = 0, nr_smoved = 0;
+
+  for (int ind = 0; ind < num_cells; ind++) {
+    const struct cell *c = &cells[ind];
+    const int cid = c - s->cells_top;
+
+    /* parts that left this cell. */
+    const ptrdiff_t offset = c->parts - s->parts;
+    for (int k = 0; k < c->count; k++) {
+      const int target = data->ind[offset + k];
+      if (target != cid) {
+        atomic_or(&data->dirty[cid], 1);
+        atomic_or(&data->dirty[target], 1);
+        nr_moved++;
       }
     }
 
-    /* Deal with the multipole */
-    if (s->gravity) {
+    /* gparts that left this cell. */
+    const ptrdiff_t goffset = c->gparts - s->gparts;
+    for (int k = 0; k < c->gcount; k++) {
+      const int target = data->gind[goffset + k];
+      if (target != cid) {
+        atomic_or(&data->dirty[cid], 1);
+        atomic_or(&data->dirty[target], 1);
+        nr_gmoved++;
+      }
+    }
+
+    /* sparts that left this cell. */
+    const ptrdiff_t soffset = c->sparts - s->sparts;
+    for (int k = 0; k < c->scount; k++) {
+      const int target = data->sind[soffset + k];
+      if (target != cid) {
+        atomic_or(&data->dirty[cid], 1);
+        atomic_or(&data->dirty[target], 1);
+        nr_smoved++;
+      }
+    }
+  }
 
-      /* Reset everything */
-      gravity_reset(c->multipole);
+  atomic_add(&data->nr_moved, nr_moved);
+  atomic_add(&data->nr_gmoved, nr_gmoved);
+  atomic_add(&data->nr_smoved, nr_smoved);
+}
+
+/**
+ * @brief Move the particles that changed top-level cell to their new cell,
+ * leaving the relative order of all the other particles untouched.
+ *
+ * On entry, the particles of each top-level cell are contiguous in memory.
+ * On exit, they are grouped according to their new cell index and the
+ * particles that stayed in their cell are still in the same relative order,
+ * such that the tree of an unaffected cell remains valid. Only the particles
+ * that moved are copied through a temporary buffer, the others are moved as
+ * whole blocks.
+ *
+ * @param arrays The particle arrays to re-order (e.g. #part and #xpart).
+ * @param sizes The size of one element of each of the arrays.
+ * @param nr_arrays The number of arrays.
+ * @param ind The new top-level cell of each particle, given as its rank in the
+ * storage order of the cells, re-ordered too.
+ * @param old_counts The number of particles in each cell on entry.
+ * @param new_counts The number of particles in each cell on exit.
+ * @param dirty Flags indicating which cells lost particles.
+ * @param nr_cells The number of top-level cells.
+ * @param nr_moved The number of particles that changed cell.
+ */
+void space_reshuffle_incremental(char **arrays, const size_t *sizes,
+                                 int nr_arrays, int *ind,
+                                 const int *old_counts, const int *new_counts,
+                                 const int *dirty, int nr_cells,
+                                 size_t nr_moved) {
+
+  /* Create the offsets arrays. */
+  size_t *old_offsets = NULL, *new_offsets = NULL;
+  if (posix_memalign((void **)&old_offsets, SWIFT_STRUCT_ALIGNMENT,
+                     sizeof(size_t) * (nr_cells + 1)) != 0 ||
+      posix_memalign((void **)&new_offsets, SWIFT_STRUCT_ALIGNMENT,
+                     sizeof(size_t) * (nr_cells + 1)) != 0)
+    error("Failed to allocate temporary cell offsets arrays.");
+  old_offsets[0] = 0;
+  new_offsets[0] = 0;
+  for (int k = 1; k <= nr_cells; k++) {
+    old_offsets[k] = old_offsets[k - 1] + old_counts[k - 1];
+    new_offsets[k] = new_offsets[k - 1] + new_counts[k - 1];
+  }
+  int *stay_counts = (int *)malloc(sizeof(int) * nr_cells);
+  int *fill_counts = (int *)calloc(nr_cells, sizeof(int));
+  if (stay_counts == NULL || fill_counts == NULL)
+    error("Failed to allocate temporary cell counts.");
+
+  /* Buffers for the particles that changed cell. */
+  char *buffs[nr_arrays];
+  for (int a = 0; a < nr_arrays; a++)
+    if ((buffs[a] = (char *)malloc(sizes[a] * nr_moved)) == NULL)
+      error("Failed to allocate the moving particles buffer.");
+  int *buff_ind = (int *)malloc(sizeof(int) * nr_moved);
+  if (buff_ind == NULL) error("Failed to allocate the moving indices buffer.");
+
+  /* Extract the particles that left their cell and compact the others. */
+  size_t nr_extracted = 0;
+  for (int cid = 0; cid < nr_cells; cid++) {
+    if (!dirty[cid]) {
+      stay_counts[cid] = old_counts[cid];
+      continue;
+    }
+    size_t w = old_offsets[cid];
+    for (size_t k = old_offsets[cid]; k < old_offsets[cid + 1]; k++) {
+      const int target = ind[k];
+      if (target == cid) {
+        if (w != k) {
+          for (int a = 0; a < nr_arrays; a++)
+            memcpy(arrays[a] + w * sizes[a], arrays[a] + k * sizes[a],
+                   sizes[a]);
+          ind[w] = target;
+        }
+        w++;
+      } else {
+        for (int a = 0; a < nr_arrays; a++)
+          memcpy(buffs[a] + nr_extracted * sizes[a], arrays[a] + k * sizes[a],
+                 sizes[a]);
+        buff_ind[nr_extracted] = target;
+        nr_extracted++;
+      }
+    }
+    stay_counts[cid] = w - old_offsets[cid];
+  }
 
-      /* Compute CoM and bulk velocity from all progenies */
-      double CoM[3] = {0., 0., 0.};
-      double vel[3] = {0., 0., 0.};
-      float max_delta_vel[3] = {0.f, 0.f, 0.f};
-      float min_delta_vel[3] = {0.f, 0.f, 0.f};
-      double mass = 0.;
+#ifdef SWIFT_DEBUG_CHECKS
+  if (nr_extracted != nr_moved)
+    error("Extracted %zd particles instead of %zd.", nr_extracted, nr_moved);
+#endif
 
-      for (int k = 0; k < 8; ++k) {
-        if (c->progeny[k] != NULL) {
-          const struct gravity_tensors *m = c->progeny[k]->multipole;
+  /* Move the blocks that shift to lower addresses, in increasing order... */
+  for (int cid = 0; cid < nr_cells; cid++) {
+    if (new_offsets[cid] < old_offsets[cid] && stay_counts[cid] > 0) {
+      for (int a = 0; a < nr_arrays; a++)
+        memmove(arrays[a] + new_offsets[cid] * sizes[a],
+                arrays[a] + old_offsets[cid] * sizes[a],
+                stay_counts[cid] * sizes[a]);
+      memmove(&ind[new_offsets[cid]], &ind[old_offsets[cid]],
+              stay_counts[cid] * sizeof(int));
+    }
+  }
 
-          mass += m->m_pole.M_000;
+  /* ...and the ones that shift to higher addresses, in decreasing order. */
+  for (int cid = nr_cells - 1; cid >= 0; cid--) {
+    if (new_offsets[cid] > old_offsets[cid] && stay_counts[cid] > 0) {
+      for (int a = 0; a < nr_arrays; a++)
+        memmove(arrays[a] + new_offsets[cid] * sizes[a],
+                arrays[a] + old_offsets[cid] * sizes[a],
+                stay_counts[cid] * sizes[a]);
+      memmove(&ind[new_offsets[cid]], &ind[old_offsets[cid]],
+              stay_counts[cid] * sizeof(int));
+    }
+  }
 
-          CoM[0] += m->CoM[0] * m->m_pole.M_000;
-          CoM[1] += m->CoM[1] * m->m_pole.M_000;
-          CoM[2] += m->CoM[2] * m->m_pole.M_000;
+  /* Insert the particles that moved at the end of their new cell. */
+  for (size_t k = 0; k < nr_extracted; k++) {
+    const int target = buff_ind[k];
+    const size_t j =
+        new_offsets[target] + stay_counts[target] + fill_counts[target]++;
+    for (int a = 0; a < nr_arrays; a++)
+      memcpy(arrays[a] + j * sizes[a], buffs[a] + k * sizes[a], sizes[a]);
+    ind[j] = target;
+  }
 
-          vel[0] += m->m_pole.vel[0] * m->m_pole.M_000;
-          vel[1] += m->m_pole.vel[1] * m->m_pole.M_000;
-          vel[2] += m->m_pole.vel[2] * m->m_pole.M_000;
+#ifdef SWIFT_DEBUG_CHECKS
+  for (int cid = 0; cid < nr_cells; cid++)
+    if (stay_counts[cid] + fill_counts[cid] != new_counts[cid])
+      error("Bad counts after incremental shuffle.");
+#endif
 
-          max_delta_vel[0] = max(m->m_pole.max_delta_vel[0], max_delta_vel[0]);
-          max_delta_vel[1] = max(m->m_pole.max_delta_vel[1], max_delta_vel[1]);
-          max_delta_vel[2] = max(m->m_pole.max_delta_vel[2], max_delta_vel[2]);
+  /* Clean up. */
+  for (int a = 0; a < nr_arrays; a++) free(buffs[a]);
+  free(buff_ind);
+  free(stay_counts);
+  free(fill_counts);
+  free(old_offsets);
+  free(new_offsets);
+}
 
-          min_delta_vel[0] = min(m->m_pole.min_delta_vel[0], min_delta_vel[0]);
-          min_delta_vel[1] = min(m->m_pole.min_delta_vel[1], min_delta_vel[1]);
-          min_delta_vel[2] = min(m->m_pole.min_delta_vel[2], min_delta_vel[2]);
-        }
-      }
+/**
+ * @brief #threadpool mapper function to re-link the #gpart to their #part.
+ *
+ * @param map_data Pointer towards the #part.
+ * @param num_parts The number of #part to treat.
+ * @param extra_data Pointer to the #space.
+ */
+void space_relink_gparts_to_parts_mapper(void *map_data, int num_parts,
+                                         void *extra_data) {
 
-      /* Final operation on the CoM and bulk velocity */
-      const double inv_mass = 1. / mass;
-      c->multipole->CoM[0] = CoM[0] * inv_mass;
-      c->multipole->CoM[1] = CoM[1] * inv_mass;
-      c->multipole->CoM[2] = CoM[2] * inv_mass;
-      c->multipole->m_pole.vel[0] = vel[0] * inv_mass;
-      c->multipole->m_pole.vel[1] = vel[1] * inv_mass;
-      c->multipole->m_pole.vel[2] = vel[2] * inv_mass;
-
-      /* Min max velocity along each axis */
-      c->multipole->m_pole.max_delta_vel[0] = max_delta_vel[0];
-      c->multipole->m_pole.max_delta_vel[1] = max_delta_vel[1];
-      c->multipole->m_pole.max_delta_vel[2] = max_delta_vel[2];
-      c->multipole->m_pole.min_delta_vel[0] = min_delta_vel[0];
-      c->multipole->m_pole.min_delta_vel[1] = min_delta_vel[1];
-      c->multipole->m_pole.min_delta_vel[2] = min_delta_vel[2];
-
-      /* Now shift progeny multipoles and add them up */
-      struct multipole temp;
-      double r_max = 0.;
-      for (int k = 0; k < 8; ++k) {
-        if (c->progeny[k] != NULL) {
-          const struct cell *cp = c->progeny[k];
-          const struct multipole *m = &cp->multipole->m_pole;
-
-          /* Contribution to multipole */
-          gravity_M2M(&temp, m, c->multipole->CoM, cp->multipole->CoM);
-          gravity_multipole_add(&c->multipole->m_pole, &temp);
-
-          /* Upper limit of max CoM<->gpart distance */
-          const double dx = c->multipole->CoM[0] - cp->multipole->CoM[0];
-          const double dy = c->multipole->CoM[1] - cp->multipole->CoM[1];
-          const double dz = c->multipole->CoM[2] - cp->multipole->CoM[2];
-          const double r2 = dx * dx + dy * dy + dz * dz;
-          r_max = max(r_max, cp->multipole->r_max + sqrt(r2));
-        }
-      }
+  struct space *s = (struct space *)extra_data;
+  struct part *parts = (struct part *)map_data;
 
-      /* Alternative upper limit of max CoM<->gpart distance */
-      const double dx = c->multipole->CoM[0] > c->loc[0] + c->width[0] / 2.
-                            ? c->multipole->CoM[0] - c->loc[0]
-                            : c->loc[0] + c->width[0] - c->multipole->CoM[0];
-      const double dy = c->multipole->CoM[1] > c->loc[1] + c->width[1] / 2.
-                            ? c->multipole->CoM[1] - c->loc[1]
-                            : c->loc[1] + c->width[1] - c->multipole->CoM[1];
-      const double dz = c->multipole->CoM[2] > c->loc[2] + c->width[2] / 2.
-                            ? c->multipole->CoM[2] - c->loc[2]
-                            : c->loc[2] + c->width[2] - c->multipole->CoM[2];
-
-      /* Take minimum of both limits */
-      c->multipole->r_max = min(r_max, sqrt(dx * dx + dy * dy + dz * dz));
-
-      /* Store the value at rebuild time */
-      c->multipole->r_max_rebuild = c->multipole->r_max;
-      c->multipole->CoM_rebuild[0] = c->multipole->CoM[0];
-      c->multipole->CoM_rebuild[1] = c->multipole->CoM[1];
-      c->multipole->CoM_rebuild[2] = c->multipole->CoM[2];
-
-      /* We know the first-order multipole (dipole) is 0. */
-      c->multipole->m_pole.M_100 = 0.f;
-      c->multipole->m_pole.M_010 = 0.f;
-      c->multipole->m_pole.M_001 = 0.f;
-
-    } /* Deal with gravity */
-  }   /* Split or let it be? */
+  part_relink_gparts_to_parts(parts, num_parts, parts - s->parts);
+}
 
-  /* Otherwise, collect the data from the particles this cell. */
-  else {
+/**
+ * @brief #threadpool mapper function to re-link the #gpart to their #spart.
+ *
+ * @param map_data Pointer towards the #spart.
+ * @param num_sparts The number of #spart to treat.
+ * @param extra_data Pointer to the #space.
+ */
+void space_relink_gparts_to_sparts_mapper(void *map_data, int num_sparts,
+                                          void *extra_data) {
 
-    /* Clear the progeny. */
-    bzero(c->progeny, sizeof(struct cell *) * 8);
-    c->split = 0;
-    maxdepth = c->depth;
+  struct space *s = (struct space *)extra_data;
+  struct spart *sparts = (struct spart *)map_data;
 
-    timebin_t hydro_time_bin_min = num_time_bins, hydro_time_bin_max = 0;
-    timebin_t gravity_time_bin_min = num_time_bins, gravity_time_bin_max = 0;
+  part_relink_gparts_to_sparts(sparts, num_sparts, sparts - s->sparts);
+}
 
-    /* parts: Get dt_min/dt_max and h_max. */
-    for (int k = 0; k < count; k++) {
-#ifdef SWIFT_DEBUG_CHECKS
-      if (parts[k].time_bin == time_bin_inhibited)
-        error("Inhibited particle present in space_split()");
-#endif
-      hydro_time_bin_min = min(hydro_time_bin_min, parts[k].time_bin);
-      hydro_time_bin_max = max(hydro_time_bin_max, parts[k].time_bin);
-      h_max = max(h_max, parts[k].h);
-    }
+/**
+ * @brief #threadpool mapper function to re-link the #part and #spart to their
+ * #gpart.
+ *
+ * @param map_data Pointer towards the #gpart.
+ * @param num_gparts The number of #gpart to treat.
+ * @param extra_data Pointer to the #space.
+ */
+void space_relink_all_parts_to_gparts_mapper(void *map_data, int num_gparts,
+                                             void *extra_data) {
 
-    /* xparts: Reset x_diff */
-    for (int k = 0; k < count; k++) {
-      xparts[k].x_diff[0] = 0.f;
-      xparts[k].x_diff[1] = 0.f;
-      xparts[k].x_diff[2] = 0.f;
-    }
+  struct space *s = (struct space *)extra_data;
+  struct gpart *gparts = (struct gpart *)map_data;
 
-    /* gparts: Get dt_min/dt_max. */
-    for (int k = 0; k < gcount; k++) {
-#ifdef SWIFT_DEBUG_CHECKS
-      if (gparts[k].time_bin == time_bin_inhibited)
-        error("Inhibited g-particle present in space_split()");
-#endif
-      gravity_time_bin_min = min(gravity_time_bin_min, gparts[k].time_bin);
-      gravity_time_bin_max = max(gravity_time_bin_max, gparts[k].time_bin);
-    }
+  part_relink_all_parts_to_gparts(gparts, num_gparts, s->parts, s->sparts);
+}
 
-    /* sparts: Get dt_min/dt_max */
-    for (int k = 0; k < scount; k++) {
-#ifdef SWIFT_DEBUG_CHECKS
-      if (sparts[k].time_bin == time_bin_inhibited)
-        error("Inhibited s-particle present in space_split()");
-#endif
-      gravity_time_bin_min = min(gravity_time_bin_min, sparts[k].time_bin);
-      gravity_time_bin_max = max(gravity_time_bin_max, sparts[k].time_bin);
-    }
+/**
+ * @brief Shift the particle pointers of a whole cell hierarchy.
+ *
+ * @param c The #cell.
+ * @param dp The shift of the #part and #xpart pointers.
+ * @param dg The shift of the #gpart pointers.
+ * @param ds The shift of the #spart pointers.
+ */
+void space_shift_cell_pointers(struct cell *c, ptrdiff_t dp, ptrdiff_t dg,
+                               ptrdiff_t ds) {
 
-    /* Convert into integer times */
-    ti_hydro_end_min = get_integer_time_end(ti_current, hydro_time_bin_min);
-    ti_hydro_end_max = get_integer_time_end(ti_current, hydro_time_bin_max);
-    ti_hydro_beg_max =
-        get_integer_time_begin(ti_current + 1, hydro_time_bin_max);
-    ti_gravity_end_min = get_integer_time_end(ti_current, gravity_time_bin_min);
-    ti_gravity_end_max = get_integer_time_end(ti_current, gravity_time_bin_max);
-    ti_gravity_beg_max =
-        get_integer_time_begin(ti_current + 1, gravity_time_bin_max);
-
-    /* Construct the multipole and the centre of mass*/
-    if (s->gravity) {
-      if (gcount > 0) {
+  c->parts += dp;
+  c->xparts += dp;
+  c->gparts += dg;
+  c->sparts += ds;
 
-        gravity_P2M(c->multipole, c->gparts, c->gcount);
+  if (c->split)
+    for (int k = 0; k < 8; k++)
+      if (c->progeny[k] != NULL)
+        space_shift_cell_pointers(c->progeny[k], dp, dg, ds);
+}
 
-      } else {
+/**
+ * @brief Are all the particles of a cell within the given bounds?
+ *
+ * The bounds are the pivots used by cell_split() along the cell's ancestry,
+ * such that a particle is within them if and only if a fresh split would
+ * place it in this cell.
+ *
+ * @param c The #cell.
+ * @param lower The lower bounds (inclusive).
+ * @param upper The upper bounds (exclusive).
+ */
+int space_cell_is_within(const struct cell *c, const double lower[3],
+                         const double upper[3]) {
+
+  for (int k = 0; k < c->count; k++) {
+    const double *x = c->parts[k].x;
+    if (x[0] < lower[0] || x[0] >= upper[0] || x[1] < lower[1] ||
+        x[1] >= upper[1] || x[2] < lower[2] || x[2] >= upper[2])
+      return 0;
+  }
+  for (int k = 0; k < c->gcount; k++) {
+    const double *x = c->gparts[k].x;
+    if (x[0] < lower[0] || x[0] >= upper[0] || x[1] < lower[1] ||
+        x[1] >= upper[1] || x[2] < lower[2] || x[2] >= upper[2])
+      return 0;
+  }
+  for (int k = 0; k < c->scount; k++) {
+    const double *x = c->sparts[k].x;
+    if (x[0] < lower[0] || x[0] >= upper[0] || x[1] < lower[1] ||
+        x[1] >= upper[1] || x[2] < lower[2] || x[2] >= upper[2])
+      return 0;
+  }
+  return 1;
+}
 
-        /* No gparts in that leaf cell */
+/**
+ * @brief Recursively update a cell hierarchy whose particles did not leave
+ * the top-level cell since the last rebuild.
+ *
+ * The sub-trees in which no particle crossed a cell boundary are kept along
+ * with their sorts, only their time-step information and multipoles are
+ * re-computed. The smallest cells containing all the particles that crossed a
+ * boundary are split again from scratch.
+ *
+ * @param s The #space.
+ * @param c The #cell to update.
+ * @param lower The lower bounds of the region covered by this cell.
+ * @param upper The upper bounds of the region covered by this cell.
+ * @param nr_resplit (return) Incremented by the number of cells re-split.
+ *
+ * @return 1 if the cell has been updated, 0 if some of its particles have left
+ * it and the parent needs to be split again.
+ */
+int space_rebuild_incremental_recursive(struct space *s, struct cell *c,
+                                        const double lower[3],
+                                        const double upper[3],
+                                        int *nr_resplit) {
 
-        /* Set the values to something sensible */
-        gravity_multipole_init(&c->multipole->m_pole);
-        if (c->nodeID == engine_rank) {
-          c->multipole->CoM[0] = c->loc[0] + c->width[0] / 2.;
-          c->multipole->CoM[1] = c->loc[1] + c->width[1] / 2.;
-          c->multipole->CoM[2] = c->loc[2] + c->width[2] / 2.;
-          c->multipole->r_max = 0.;
-        }
-      }
+  const integertime_t ti_current = s->e->ti_current;
+  const int depth = c->depth;
+  int maxdepth = 0;
 
-      /* Store the value at rebuild time */
-      c->multipole->r_max_rebuild = c->multipole->r_max;
-      c->multipole->CoM_rebuild[0] = c->multipole->CoM[0];
-      c->multipole->CoM_rebuild[1] = c->multipole->CoM[1];
-      c->multipole->CoM_rebuild[2] = c->multipole->CoM[2];
-    }
+  /* Check the depth. */
+  while (depth > (maxdepth = s->maxdepth)) {
+    atomic_cas(&s->maxdepth, maxdepth, depth);
   }
 
-  /* Set the values for this cell. */
-  c->h_max = h_max;
-  c->ti_hydro_end_min = ti_hydro_end_min;
-  c->ti_hydro_end_max = ti_hydro_end_max;
-  c->ti_hydro_beg_max = ti_hydro_beg_max;
-  c->ti_gravity_end_min = ti_gravity_end_min;
-  c->ti_gravity_end_max = ti_gravity_end_max;
-  c->ti_gravity_beg_max = ti_gravity_beg_max;
-  c->maxdepth = maxdepth;
+  /* Start from a clean slate for everything but the tree and the sorts. */
+  space_clear_cell_tasks(c);
+  c->dx_max_part = 0.f;
+  c->ti_old_part = ti_current;
+  c->ti_old_gpart = ti_current;
+  c->ti_old_multipole = ti_current;
+
+  /* Leaf: just verify that it still holds its particles. */
+  if (!c->split) {
+    if (!space_cell_is_within(c, lower, upper)) return 0;
+    space_split_collect_leaf(s, c);
+    space_split_set_owner(s, c);
+    return 1;
+  }
 
-  /* Set ownership according to the start of the parts array. */
-  if (s->nr_parts > 0)
-    c->owner =
-        ((c->parts - s->parts) % s->nr_parts) * s->nr_queues / s->nr_parts;
-  else if (s->nr_sparts > 0)
-    c->owner =
-        ((c->sparts - s->sparts) % s->nr_sparts) * s->nr_queues / s->nr_sparts;
-  else if (s->nr_gparts > 0)
-    c->owner =
-        ((c->gparts - s->gparts) % s->nr_gparts) * s->nr_queues / s->nr_gparts;
-  else
-    c->owner = 0; /* Ok, there is really nothing on this rank... */
+  /* Update the progeny first. */
+  const double pivot[3] = {c->loc[0] + c->width[0] / 2,
+                           c->loc[1] + c->width[1] / 2,
+                           c->loc[2] + c->width[2] / 2};
+  int intact = 1;
+  for (int k = 0; k < 8; k++) {
+    struct cell *cp = c->progeny[k];
+    if (cp == NULL) continue;
+    const double lower_p[3] = {(k & 4) ? pivot[0] : lower[0],
+                               (k & 2) ? pivot[1] : lower[1],
+                               (k & 1) ? pivot[2] : lower[2]};
+    const double upper_p[3] = {(k & 4) ? upper[0] : pivot[0],
+                               (k & 2) ? upper[1] : pivot[1],
+                               (k & 1) ? upper[2] : pivot[2]};
+    if (!space_rebuild_incremental_recursive(s, cp, lower_p, upper_p,
+                                             nr_resplit))
+      intact = 0;
+  }
 
-  /* Clean up. */
-  if (allocate_buffer) {
-    if (buff != NULL) free(buff);
-    if (gbuff != NULL) free(gbuff);
-    if (sbuff != NULL) free(sbuff);
+  /* Nothing crossed a boundary below this cell, collect the progeny. */
+  if (intact) {
+    space_split_collect_progeny(s, c);
+    space_split_set_owner(s, c);
+    return 1;
   }
+
+  /* Some particles left their sub-cell. Are they still in this cell? */
+  if (!space_cell_is_within(c, lower, upper)) return 0;
+
+  /* Dismantle the sub-tree and split the cell again from scratch. */
+  struct cell *cell_rec_begin = NULL, *cell_rec_end = NULL;
+  struct gravity_tensors *multipole_rec_begin = NULL,
+                         *multipole_rec_end = NULL;
+  space_rebuild_recycle_rec(s, c, &cell_rec_begin, &cell_rec_end,
+                            &multipole_rec_begin, &multipole_rec_end);
+  if (cell_rec_begin != NULL)
+    space_recycle_list(s, cell_rec_begin, cell_rec_end, multipole_rec_begin,
+                       multipole_rec_end);
+  c->split = 0;
+  space_split_recursive(s, c, NULL, NULL, NULL);
+  *nr_resplit += 1;
+
+  /* The particles have been re-ordered, the sorts of this cell and of all
+   * its parents are no longer valid. */
+  for (struct cell *finger = c; finger != NULL; finger = finger->parent)
+    finger->sorted = 0;
+
+  return 1;
 }
 
 /**
- * @brief #threadpool mapper function to split cells if they contain
- *        too many particles.
+ * @brief #threadpool mapper function to update the top-level cells
+ * incrementally.
  *
- * @param map_data Pointer towards the top-cells.
+ * Cells that lost or gained particles are split from scratch, the others
+ * re-use their existing tree where possible.
+ *
+ * @param map_data Pointer towards the top-level cells.
  * @param num_cells The number of cells to treat.
- * @param extra_data Pointers to the #space.
+ * @param extra_data Pointer to the #incremental_data.
  */
-void space_split_mapper(void *map_data, int num_cells, void *extra_data) {
+void space_rebuild_incremental_mapper(void *map_data, int num_cells,
+                                      void *extra_data) {
 
-  /* Unpack the inputs. */
-  struct space *s = (struct space *)extra_data;
-  struct cell *restrict cells_top = (struct cell *)map_data;
+  struct incremental_data *data = (struct incremental_data *)extra_data;
+  struct space *s = data->s;
+  struct cell *cells = (struct cell *)map_data;
+  const double lower[3] = {-DBL_MAX, -DBL_MAX, -DBL_MAX};
+  const double upper[3] = {DBL_MAX, DBL_MAX, DBL_MAX};
+  int nr_resplit = 0;
 
   for (int ind = 0; ind < num_cells; ind++) {
-    struct cell *c = &cells_top[ind];
-    space_split_recursive(s, c, NULL, NULL, NULL);
+    struct cell *c = &cells[ind];
+
+    if (data->dirty[c - s->cells_top]) {
+      space_split_recursive(s, c, NULL, NULL, NULL);
+      nr_resplit++;
+    } else {
+      space_rebuild_incremental_recursive(s, c, lower, upper, &nr_resplit);
+    }
   }
 
 #ifdef SWIFT_DEBUG_CHECKS
   /* All cells and particles should have consistent h_max values. */
   for (int ind = 0; ind < num_cells; ind++) {
     int depth = 0;
-    if (!checkCellhdxmax(&cells_top[ind], &depth))
+    if (!checkCellhdxmax(&cells[ind], &depth))
       message("    at cell depth %d", depth);
   }
 #endif
+
+  atomic_add(&data->nr_resplit, nr_resplit);
+}
+
+/**
+ * @brief Re-build the cells by only moving the particles that changed
+ * top-level cell and re-splitting the parts of the tree they affect.
+ *
+ * This is only possible if the top-level grid does not change, if the current
+ * tree describes the particle arrays and if no particles need to be exchanged
+ * with other nodes. Otherwise nothing is done and a full rebuild is needed.
+ *
+ * @param s The #space in which to update the cells.
+ * @param verbose Print messages to stdout or not.
+ *
+ * @return 1 if the cells have been re-built, 0 if a full rebuild is needed.
+ */
+int space_rebuild_incremental(struct space *s, int verbose) {
+
+  const ticks tic = getticks();
+  struct cell *cells_top = s->cells_top;
+  const int nr_cells = s->nr_cells;
+
+  if (cells_top == NULL || s->e == NULL) return 0;
+
+  /* Particles could need to go to another node. */
+  if (s->e->nr_nodes > 1) return 0;
+
+  /* Changing the top-level grid requires a full rebuild. */
+  int cdim[3];
+  space_get_required_cdim(s, cdim, verbose);
+  if (cdim[0] < s->cdim[0] || cdim[1] < s->cdim[1] || cdim[2] < s->cdim[2])
+    return 0;
+
+  /* Is the current tree describing the particle arrays? The counts are
+   * collected in the storage order of the cells. */
+  int *old_counts = (int *)malloc(sizeof(int) * nr_cells);
+  int *old_gcounts = (int *)malloc(sizeof(int) * nr_cells);
+  int *old_scounts = (int *)malloc(sizeof(int) * nr_cells);
+  if (old_counts == NULL || old_gcounts == NULL || old_scounts == NULL)
+    error("Failed to allocate cell count buffers.");
+  size_t offset = 0, goffset = 0, soffset = 0;
+  for (int k = 0; k < nr_cells; k++) {
+    const struct cell *c = &cells_top[s->cells_top_order[k]];
+    if ((c->count > 0 && c->parts != &s->parts[offset]) ||
+        (c->gcount > 0 && c->gparts != &s->gparts[goffset]) ||
+        (c->scount > 0 && c->sparts != &s->sparts[soffset]))
+      break;
+    old_counts[k] = c->count;
+    old_gcounts[k] = c->gcount;
+    old_scounts[k] = c->scount;
+    offset += c->count;
+    goffset += c->gcount;
+    soffset += c->scount;
+  }
+  if (offset != s->nr_parts || goffset != s->nr_gparts ||
+      soffset != s->nr_sparts) {
+    free(old_counts);
+    free(old_gcounts);
+    free(old_scounts);
+    return 0;
+  }
+
+  /* Get the new top-level cell index of all the particles. */
+  int *ind = (int *)malloc(sizeof(int) * (s->nr_parts + 1));
+  int *gind = (int *)malloc(sizeof(int) * (s->nr_gparts + 1));
+  int *sind = (int *)malloc(sizeof(int) * (s->nr_sparts + 1));
+  int *cell_part_counts = (int *)calloc(nr_cells, sizeof(int));
+  int *cell_gpart_counts = (int *)calloc(nr_cells, sizeof(int));
+  int *cell_spart_counts = (int *)calloc(nr_cells, sizeof(int));
+  int *dirty = (int *)calloc(nr_cells, sizeof(int));
+  if (ind == NULL || gind == NULL || sind == NULL || cell_part_counts == NULL ||
+      cell_gpart_counts == NULL || cell_spart_counts == NULL || dirty == NULL)
+    error("Failed to allocate temporary particle indices.");
+  if (s->nr_parts > 0)
+    space_parts_get_cell_index(s, ind, cell_part_counts, cells_top, verbose);
+  if (s->nr_gparts > 0)
+    space_gparts_get_cell_index(s, gind, cell_gpart_counts, cells_top,
+                                verbose);
+  if (s->nr_sparts > 0)
+    space_sparts_get_cell_index(s, sind, cell_spart_counts, cells_top,
+                                verbose);
+
+  /* Find the cells that lost or gained particles. */
+  struct incremental_data data;
+  data.s = s;
+  data.ind = ind;
+  data.gind = gind;
+  data.sind = sind;
+  data.dirty = dirty;
+  data.nr_moved = 0;
+  data.nr_gmoved = 0;
+  data.nr_smoved = 0;
+  data.nr_resplit = 0;
+  threadpool_map(&s->e->threadpool, space_rebuild_incremental_flag_mapper,
+                 cells_top, nr_cells, sizeof(struct cell), 0, &data);
+
+  /* Move the particles in the storage order of the cells. */
+  space_cell_index_to_rank(s, ind, s->nr_parts, cell_part_counts);
+  space_cell_index_to_rank(s, gind, s->nr_gparts, cell_gpart_counts);
+  space_cell_index_to_rank(s, sind, s->nr_sparts, cell_spart_counts);
+  int *dirty_rank = dirty;
+  if (s->morton_order) {
+    if ((dirty_rank = (int *)malloc(sizeof(int) * nr_cells)) == NULL)
+      error("Failed to allocate temporary cell flags.");
+    for (int k = 0; k < nr_cells; k++)
+      dirty_rank[k] = dirty[s->cells_top_order[k]];
+  }
+
+  /* Move the particles that changed cell and fix the links. */
+  if (data.nr_moved > 0) {
+    char *arrays[2] = {(char *)s->parts, (char *)s->xparts};
+    const size_t sizes[2] = {sizeof(struct part), sizeof(struct xpart)};
+    space_reshuffle_incremental(arrays, sizes, 2, ind, old_counts,
+                                cell_part_counts, dirty_rank, nr_cells,
+                                data.nr_moved);
+    if (s->nr_gparts > 0)
+      threadpool_map(&s->e->threadpool, space_relink_gparts_to_parts_mapper,
+                     s->parts, s->nr_parts, sizeof(struct part), 0, s);
+  }
+  if (data.nr_smoved > 0) {
+    char *arrays[1] = {(char *)s->sparts};
+    const size_t sizes[1] = {sizeof(struct spart)};
+    space_reshuffle_incremental(arrays, sizes, 1, sind, old_scounts,
+                                cell_spart_counts, dirty_rank, nr_cells,
+                                data.nr_smoved);
+    if (s->nr_gparts > 0)
+      threadpool_map(&s->e->threadpool, space_relink_gparts_to_sparts_mapper,
+                     s->sparts, s->nr_sparts, sizeof(struct spart), 0, s);
+  }
+  if (data.nr_gmoved > 0) {
+    char *arrays[1] = {(char *)s->gparts};
+    const size_t sizes[1] = {sizeof(struct gpart)};
+    space_reshuffle_incremental(arrays, sizes, 1, gind, old_gcounts,
+                                cell_gpart_counts, dirty_rank, nr_cells,
+                                data.nr_gmoved);
+    threadpool_map(&s->e->threadpool, space_relink_all_parts_to_gparts_mapper,
+                   s->gparts, s->nr_gparts, sizeof(struct gpart), 0, s);
+  }
+
+#ifdef SWIFT_DEBUG_CHECKS
+  /* Verify that the links are correct */
+  if ((s->nr_gparts > 0 && s->nr_parts > 0) ||
+      (s->nr_gparts > 0 && s->nr_sparts > 0))
+    part_verify_links(s->parts, s->gparts, s->sparts, s->nr_parts,
+                      s->nr_gparts, s->nr_sparts, verbose);
+#endif
+
+  /* Hook the top-level cells up to the parts. */
+  const integertime_t ti_current = s->e->ti_current;
+  offset = 0;
+  goffset = 0;
+  soffset = 0;
+  size_t old_offset = 0, old_goffset = 0, old_soffset = 0;
+  for (int k = 0; k < nr_cells; k++) {
+    struct cell *restrict c = &cells_top[s->cells_top_order[k]];
+
+    /* Empty the cells that lost or gained particles. */
+    if (dirty_rank[k]) space_rebuild_recycle_mapper(c, 1, s);
+
+    /* Move the rest of the tree along with its particles. */
+    else
+      space_shift_cell_pointers(c, offset - old_offset, goffset - old_goffset,
+                                soffset - old_soffset);
+
+    c->ti_old_part = ti_current;
+    c->ti_old_gpart = ti_current;
+    c->ti_old_multipole = ti_current;
+    c->count = cell_part_counts[k];
+    c->gcount = cell_gpart_counts[k];
+    c->scount = cell_spart_counts[k];
+    c->parts = &s->parts[offset];
+    c->xparts = &s->xparts[offset];
+    c->gparts = &s->gparts[goffset];
+    c->sparts = &s->sparts[soffset];
+    old_offset += old_counts[k];
+    old_goffset += old_gcounts[k];
+    old_soffset += old_scounts[k];
+    offset += c->count;
+    goffset += c->gcount;
+    soffset += c->scount;
+  }
+
+  /* We no longer need the indices as of here. */
+  free(ind);
+  free(gind);
+  free(sind);
+  free(cell_part_counts);
+  free(cell_gpart_counts);
+  free(cell_spart_counts);
+  free(old_counts);
+  free(old_gcounts);
+  free(old_scounts);
+  if (dirty_rank != dirty) free(dirty_rank);
+
+  /* Now update the trees, splitting again only where needed. */
+  const ticks tic2 = getticks();
+  s->maxdepth = 0;
+  threadpool_map(&s->e->threadpool, space_rebuild_incremental_mapper,
+                 cells_top, nr_cells, sizeof(struct cell), 0, &data);
+
+  if (verbose)
+    message("updating the trees took %.3f %s.",
+            clocks_from_ticks(getticks() - tic2), clocks_getunit());
+
+#ifdef SWIFT_DEBUG_CHECKS
+  /* Check that the multipole construction went OK */
+  if (s->gravity)
+    for (int k = 0; k < nr_cells; k++)
+      cell_check_multipole(&cells_top[k], NULL);
+#endif
+
+  /* Clean up any stray sort indices in the cell buffer. */
+  space_free_buff_sort_indices(s);
+
+  if (verbose)
+    message(
+        "moved %zd parts, %zd gparts and %zd sparts, re-split %d cells, took "
+        "%.3f %s.",
+        data.nr_moved, data.nr_gmoved, data.nr_smoved, data.nr_resplit,
+        clocks_from_ticks(getticks() - tic), clocks_getunit());
+
+  free(dirty);
+  return 1;
 }
 
 /**
@@ -2282,6 +3610,7 @@ void space_getcells(struct space *s, int nr_cells, struct cell **cells) {
   for (int j = 0; j < nr_cells; j++) {
     for (int k = 0; k < 13; k++)
       if (cells[j]->sort[k] != NULL) free(cells[j]->sort[k]);
+    gravity_cell_cache_free(cells[j]->grav_cache);
     struct gravity_tensors *temp = cells[j]->multipole;
     bzero(cells[j], sizeof(struct cell));
     cells[j]->multipole = temp;
@@ -2308,6 +3637,147 @@ void space_free_buff_sort_indices(struct space *s) {
   }
 }
 
+/**
+ * @brief Is a cell at the top of any of its task hierarchies?
+ *
+ * @param c The #cell.
+ */
+__attribute__((always_inline)) INLINE static int space_cell_is_super(
+    const struct cell *c) {
+  return c->super == c || c->super_hydro == c || c->super_gravity == c;
+}
+
+/**
+ * @brief Count the super-cells in a hierarchy.
+ *
+ * @param c The #cell.
+ */
+int space_count_super_cells(const struct cell *c) {
+
+  int count = space_cell_is_super(c);
+  if (c->split)
+    for (int k = 0; k < 8; k++)
+      if (c->progeny[k] != NULL)
+        count += space_count_super_cells(c->progeny[k]);
+  return count;
+}
+
+/**
+ * @brief #threadpool mapper function counting the super-cells.
+ *
+ * @param map_data Pointer towards the top-level cells.
+ * @param num_cells The number of cells to treat.
+ * @param extra_data Pointer to the #space.
+ */
+void space_count_super_cells_mapper(void *map_data, int num_cells,
+                                    void *extra_data) {
+
+  struct space *s = (struct space *)extra_data;
+  const struct cell *cells = (const struct cell *)map_data;
+
+  int count = 0;
+  for (int ind = 0; ind < num_cells; ind++)
+    count += space_count_super_cells(&cells[ind]);
+
+  atomic_add(&s->nr_super_tasks, count);
+}
+
+/**
+ * @brief Give a task record to each super-cell of a hierarchy.
+ *
+ * @param s The #space.
+ * @param c The #cell.
+ * @param next (in/out) The next free record.
+ */
+void space_set_super_tasks(struct space *s, struct cell *c,
+                           struct cell_super_tasks **next) {
+
+  if (space_cell_is_super(c)) {
+    c->tasks = (*next)++;
+    if (lock_init(&c->tasks->drift_lock) != 0)
+      error("Failed to initialize the super-cell drift lock.");
+  } else {
+    c->tasks = NULL;
+  }
+
+  if (c->split)
+    for (int k = 0; k < 8; k++)
+      if (c->progeny[k] != NULL)
+        space_set_super_tasks(s, c->progeny[k], next);
+}
+
+/**
+ * @brief #threadpool mapper function handing out the super-cell task records.
+ *
+ * Each call reserves the records it needs for its chunk of top-level cells in
+ * one go.
+ *
+ * @param map_data Pointer towards the top-level cells.
+ * @param num_cells The number of cells to treat.
+ * @param extra_data Pointer to the #space.
+ */
+void space_set_super_tasks_mapper(void *map_data, int num_cells,
+                                  void *extra_data) {
+
+  struct space *s = (struct space *)extra_data;
+  struct cell *cells = (struct cell *)map_data;
+
+  int count = 0;
+  for (int ind = 0; ind < num_cells; ind++)
+    count += space_count_super_cells(&cells[ind]);
+
+  struct cell_super_tasks *next =
+      &s->super_tasks[atomic_add(&s->nr_super_tasks, count)];
+  for (int ind = 0; ind < num_cells; ind++)
+    space_set_super_tasks(s, &cells[ind], &next);
+}
+
+/**
+ * @brief Allocate the task records of the super-cells and hook them up.
+ *
+ * Only the super-cells get a #cell_super_tasks, such that the hierarchical
+ * task pointers do not have to be carried by every single cell. This must
+ * be called once the super-pointers have been set.
+ *
+ * @param s The #space.
+ * @param verbose Are we talkative?
+ */
+void space_make_super_tasks(struct space *s, int verbose) {
+
+  const ticks tic = getticks();
+
+  /* Count the super-cells. */
+  s->nr_super_tasks = 0;
+  threadpool_map(&s->e->threadpool, space_count_super_cells_mapper,
+                 s->cells_top, s->nr_cells, sizeof(struct cell), 0, s);
+  const int nr_super_tasks = s->nr_super_tasks;
+
+  /* Get enough records. */
+  if (nr_super_tasks > s->size_super_tasks) {
+    free(s->super_tasks);
+    s->size_super_tasks = nr_super_tasks * engine_parts_size_grow;
+    if ((s->super_tasks = (struct cell_super_tasks *)malloc(
+             sizeof(struct cell_super_tasks) * s->size_super_tasks)) == NULL)
+      error("Failed to allocate the super-cell task records.");
+  }
+  bzero(s->super_tasks, sizeof(struct cell_super_tasks) * nr_super_tasks);
+
+  /* Hook them up. */
+  s->nr_super_tasks = 0;
+  threadpool_map(&s->e->threadpool, space_set_super_tasks_mapper, s->cells_top,
+                 s->nr_cells, sizeof(struct cell), 0, s);
+
+#ifdef SWIFT_DEBUG_CHECKS
+  if (s->nr_super_tasks != nr_super_tasks)
+    error("Handed out %d super-cell task records instead of %d.",
+          s->nr_super_tasks, nr_super_tasks);
+#endif
+
+  if (verbose)
+    message("%d super-cells, took %.3f %s.", nr_super_tasks,
+            clocks_from_ticks(getticks() - tic), clocks_getunit());
+}
+
 /**
  * @brief Construct the list of top-level cells that have any tasks in
  * their hierarchy.
@@ -2795,15 +4265,27 @@ void space_init(struct space *s, struct swift_params *params,
       params, "Scheduler:cell_split_size", space_splitsize_default);
   space_subdepth_grav = parser_get_opt_param_int(
       params, "Scheduler:cell_subdepth_grav", space_subdepth_grav_default);
+  space_splitsize_parallel =
+      parser_get_opt_param_int(params, "Scheduler:cell_split_parallel_size",
+                               space_splitsize_parallel_default);
+  s->incremental_rebuild =
+      parser_get_opt_param_int(params, "Scheduler:incremental_rebuild",
+                               space_incremental_rebuild_default);
+  s->morton_order =
+      parser_get_opt_param_int(params, "Scheduler:top_cells_morton_order",
+                               space_morton_order_default);
 
   if (verbose) {
     message("max_size set to %d split_size set to %d", space_maxsize,
             space_splitsize);
     message("subdepth_grav set to %d", space_subdepth_grav);
+    message("split_parallel_size set to %d", space_splitsize_parallel);
     message("sub_size_pair_hydro set to %d, sub_size_self_hydro set to %d",
             space_subsize_pair_hydro, space_subsize_self_hydro);
     message("sub_size_pair_grav set to %d, sub_size_self_grav set to %d",
             space_subsize_pair_grav, space_subsize_self_grav);
+    if (s->incremental_rebuild) message("incremental rebuilds enabled");
+    if (s->morton_order) message("top-level cells stored in Morton order");
   }
 
   /* Apply h scaling */
@@ -3256,6 +4738,9 @@ void space_clean(struct space *s) {
   free(s->cells_top);
   free(s->multipoles_top);
   free(s->local_cells_top);
+  free(s->super_tasks);
+  free(s->cells_top_order);
+  free(s->cells_top_rank);
   free(s->parts);
   free(s->xparts);
   free(s->gparts);
@@ -3307,6 +4792,11 @@ void space_struct_restore(struct space *s, FILE *stream) {
   s->multipoles_top = NULL;
   s->multipoles_sub = NULL;
   s->local_cells_top = NULL;
+  s->super_tasks = NULL;
+  s->cells_top_order = NULL;
+  s->cells_top_rank = NULL;
+  s->nr_super_tasks = 0;
+  s->size_super_tasks = 0;
   s->grav_top_level = NULL;
 #ifdef WITH_MPI
   s->parts_foreign = NULL;
@@ -38,18 +38,22 @@
 
 /* Avoid cyclic inclusions */
 struct cell;
+struct cell_super_tasks;
 struct cosmology;
 
 /* Some constants. */
 #define space_cellallocchunk 1000
 #define space_splitsize_default 400
 #define space_maxsize_default 8000000
+#define space_splitsize_parallel_default 100000
 #define space_subsize_pair_hydro_default 256000000
 #define space_subsize_self_hydro_default 32000
 #define space_subsize_pair_grav_default 256000000
 #define space_subsize_self_grav_default 32000
 #define space_subdepth_grav_default 2
 #define space_max_top_level_cells_default 12
+#define space_incremental_rebuild_default 0
+#define space_morton_order_default 0
 #define space_stretch 1.10f
 #define space_maxreldx 0.1f
 
@@ -59,6 +63,7 @@ struct cosmology;
 /* Split size. */
 extern int space_splitsize;
 extern int space_maxsize;
+extern int space_splitsize_parallel;
 extern int space_subsize_pair_hydro;
 extern int space_subsize_self_hydro;
 extern int space_subsize_pair_grav;
@@ -106,6 +111,9 @@ struct space {
   /*! Total number of cells (top- and sub-) */
   int tot_cells;
 
+  /*! Do we re-use the existing cell tree when rebuilding? */
+  int incremental_rebuild;
+
   /*! Number of *local* top-level cells with tasks */
   int nr_local_cells;
 
@@ -124,6 +132,21 @@ struct space {
   /*! The indices of the *local* top-level cells with tasks */
   int *local_cells_top;
 
+  /*! Are the particles of the top-level cells stored in Morton order? */
+  int morton_order;
+
+  /*! The top-level cells in the order their particles are stored. */
+  int *cells_top_order;
+
+  /*! The rank of each top-level cell in the storage order. */
+  int *cells_top_rank;
+
+  /*! The hierarchical task records of the super-cells. */
+  struct cell_super_tasks *super_tasks;
+
+  /*! Number of super-cell task records in use and allocated. */
+  int nr_super_tasks, size_super_tasks;
+
   /*! The total number of parts in the space. */
   size_t nr_parts, size_parts;
 
@@ -220,6 +243,8 @@ void space_map_parts_xparts(struct space *s,
 void space_map_cells_post(struct space *s, int full,
                           void (*fun)(struct cell *c, void *data), void *data);
 void space_rebuild(struct space *s, int verbose);
+int space_rebuild_incremental(struct space *s, int verbose);
+void space_get_required_cdim(const struct space *s, int cdim[3], int verbose);
 void space_recycle(struct space *s, struct cell *c);
 void space_recycle_list(struct space *s, struct cell *cell_list_begin,
                         struct cell *cell_list_end,
@@ -229,6 +254,7 @@ void space_split(struct space *s, struct cell *cells, int nr_cells,
                  int verbose);
 void space_split_mapper(void *map_data, int num_elements, void *extra_data);
 void space_list_cells_with_tasks(struct space *s);
+void space_make_super_tasks(struct space *s, int verbose);
 void space_parts_get_cell_index(struct space *s, int *ind, int *cell_counts,
                                 struct cell *cells, int verbose);
 void space_gparts_get_cell_index(struct space *s, int *gind, int *cell_counts,
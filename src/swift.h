@@ -25,11 +25,13 @@
 /* Local headers. */
 #include "active.h"
 #include "atomic.h"
+#include "benchmark.h"
 #include "cache.h"
 #include "cell.h"
 #include "chemistry.h"
 #include "clocks.h"
 #include "common_io.h"
+#include "compress.h"
 #include "const.h"
 #include "cooling.h"
 #include "cooling_struct.h"
@@ -39,11 +41,13 @@
 #include "dump.h"
 #include "engine.h"
 #include "error.h"
+#include "fof.h"
 #include "gravity.h"
 #include "gravity_derivatives.h"
 #include "gravity_properties.h"
 #include "hydro.h"
 #include "hydro_properties.h"
+#include "lightcone.h"
 #include "lock.h"
 #include "logger.h"
 #include "map.h"
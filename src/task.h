@@ -174,6 +174,9 @@ struct task {
   /*! ID of the queue or runner owning this task */
   short int rid;
 
+  /*! ID of the queue the task was inserted in */
+  short int qid;
+
   /*! Information about the direction of the pair task */
   short int sid;
 
@@ -27,13 +27,52 @@
 
 /* Some standard headers. */
 #include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef HAVE_LINUX_PERF_EVENT_H
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
 
 /* Local includes. */
 #include "clocks.h"
+#include "error.h"
+#include "task.h"
 
-/* The timers. */
+/* The timers, summed over the threads. */
 ticks timers[timer_count];
 
+/* The timers of each thread. */
+struct timers_thread timers_threads[timers_max_threads];
+
+/* Index of the timers of the calling thread. */
+__thread int timers_thread_id = -1;
+
+/* Number of threads with their own timers. */
+static int timers_nr_threads = 0;
+
+/**
+ * @brief The hardware counters of one thread, per task type.
+ */
+struct timers_hw_thread {
+  unsigned long long counts[task_type_count][timers_hw_count];
+} __attribute__((aligned(64)));
+
+/* The hardware counters of each thread. */
+static struct timers_hw_thread timers_hw_threads[timers_max_threads];
+
+/* File descriptor of the counters of the calling thread (-1 if none). */
+static __thread int timers_hw_fd = -1;
+
+/* Hardware counter names. */
+const char* timers_hw_names[timers_hw_count] = {"cycles", "instructions",
+                                                "llc_misses"};
+
+/* File to store the hardware counters */
+static FILE* timers_hw_file = NULL;
+
 /* Timer names. */
 const char* timers_names[timer_count] = {
     "none",
@@ -45,6 +84,7 @@ const char* timers_names[timer_count] = {
     "kick1",
     "kick2",
     "timestep",
+    "kick2_timestep_kick1",
     "endforce",
     "dosort",
     "doself_density",
@@ -101,8 +141,23 @@ static FILE* timers_file;
 void timers_reset(unsigned long long mask) {
 
   /* Loop over the timers and set the masked ones to zero. */
+  const int nr_threads = timers_nr_threads;
   for (int k = 0; k < timer_count; k++)
-    if (mask & (1ull << k)) timers[k] = 0;
+    if (mask & (1ull << k)) {
+      timers[k] = 0;
+      for (int i = 0; i < nr_threads; i++) timers_threads[i].t[k] = 0;
+    }
+}
+
+/**
+ * @brief Give the calling thread its own set of timers.
+ */
+void timers_assign_thread(void) {
+
+  const int id = atomic_inc(&timers_nr_threads);
+  if (id >= timers_max_threads)
+    error("Too many threads for the timers (max %d).", timers_max_threads);
+  timers_thread_id = id;
 }
 
 /**
@@ -117,6 +172,14 @@ void timers_reset_all(void) { timers_reset(timers_mask_all); }
  * @param step The current step.
  */
 void timers_print(int step) {
+
+  /* Sum the timers of all the threads. */
+  const int nr_threads = timers_nr_threads;
+  for (int k = 0; k < timer_count; k++) {
+    timers[k] = 0;
+    for (int i = 0; i < nr_threads; i++) timers[k] += timers_threads[i].t[k];
+  }
+
   fprintf(timers_file, "%d\t", step);
   for (int k = 0; k < timer_count; k++)
     fprintf(timers_file, "%18.3f ", clocks_from_ticks(timers[k]));
@@ -145,3 +208,163 @@ void timers_open_file(int rank) {
  * @brief Close the file containing the timer info.
  */
 void timers_close_file(void) { fclose(timers_file); }
+
+#ifdef HAVE_LINUX_PERF_EVENT_H
+/**
+ * @brief Open one hardware counter of the calling thread.
+ *
+ * @param config The #perf_event_attr config of the counter.
+ * @param group_fd The leader of the group (-1 for the leader itself).
+ */
+static int timers_hw_open(unsigned long long config, int group_fd) {
+
+  struct perf_event_attr attr;
+  bzero(&attr, sizeof(struct perf_event_attr));
+  attr.size = sizeof(struct perf_event_attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = config;
+  attr.read_format = PERF_FORMAT_GROUP;
+  attr.disabled = (group_fd == -1);
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+
+  /* Count the calling thread on any CPU. */
+  return syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+#endif
+
+/**
+ * @brief Start the hardware counters of the calling thread.
+ *
+ * The cycles, instructions and last-level cache misses are read together
+ * as one group. If the counters cannot be opened (e.g. because of the
+ * perf_event_paranoid setting), the thread simply counts nothing.
+ */
+void timers_hw_thread_init(void) {
+
+#ifdef HAVE_LINUX_PERF_EVENT_H
+  if (timers_thread_id < 0) timers_assign_thread();
+  if (timers_hw_fd >= 0) return;
+
+  const int leader = timers_hw_open(PERF_COUNT_HW_CPU_CYCLES, -1);
+  if (leader < 0) {
+    message("Could not open the hardware counters of thread %d.",
+            timers_thread_id);
+    return;
+  }
+  if (timers_hw_open(PERF_COUNT_HW_INSTRUCTIONS, leader) < 0 ||
+      timers_hw_open(PERF_COUNT_HW_CACHE_MISSES, leader) < 0) {
+    message("Could not open all the hardware counters of thread %d.",
+            timers_thread_id);
+    close(leader);
+    return;
+  }
+
+  ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+  ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  timers_hw_fd = leader;
+#else
+  error("SWIFT was not compiled with support for the hardware counters.");
+#endif
+}
+
+/**
+ * @brief Read the hardware counters of the calling thread.
+ *
+ * @param hw (return) The #timers_hw reading.
+ */
+void timers_hw_tic(struct timers_hw* hw) {
+
+#ifdef HAVE_LINUX_PERF_EVENT_H
+  /* The group is read as the number of counters followed by their values. */
+  unsigned long long buffer[timers_hw_count + 1];
+  if (timers_hw_fd < 0 ||
+      read(timers_hw_fd, buffer, sizeof(buffer)) != sizeof(buffer)) {
+    bzero(hw, sizeof(struct timers_hw));
+    return;
+  }
+  for (int k = 0; k < timers_hw_count; k++) hw->values[k] = buffer[k + 1];
+#else
+  bzero(hw, sizeof(struct timers_hw));
+#endif
+}
+
+/**
+ * @brief Add the hardware counts since a reading to a type of task.
+ *
+ * @param type The type of the task.
+ * @param tic The #timers_hw reading at the start of the task.
+ */
+void timers_hw_toc(int type, const struct timers_hw* tic) {
+
+  if (timers_hw_fd < 0) return;
+
+  struct timers_hw toc;
+  timers_hw_tic(&toc);
+  struct timers_hw_thread* counts = &timers_hw_threads[timers_thread_id];
+  for (int k = 0; k < timers_hw_count; k++)
+    counts->counts[type][k] += toc.values[k] - tic->values[k];
+}
+
+/**
+ * @brief Re-set the hardware counts of all the threads.
+ */
+void timers_hw_reset(void) {
+
+  const int nr_threads = timers_nr_threads;
+  for (int i = 0; i < nr_threads; i++)
+    bzero(&timers_hw_threads[i], sizeof(struct timers_hw_thread));
+}
+
+/**
+ * @brief Opens the file to contain the hardware counters and print a header.
+ *
+ * @param rank The MPI rank of the file.
+ */
+void timers_hw_open_file(int rank) {
+
+  char buff[100];
+  sprintf(buff, "timers_hw_%d.txt", rank);
+  timers_hw_file = fopen(buff, "w");
+  if (timers_hw_file == NULL) error("Could not open the file '%s'.", buff);
+
+  fprintf(timers_hw_file, "# hardware counters per task type: \n");
+  fprintf(timers_hw_file, "# %6s %20s", "step", "task");
+  for (int k = 0; k < timers_hw_count; k++)
+    fprintf(timers_hw_file, " %18s", timers_hw_names[k]);
+  fprintf(timers_hw_file, " %8s\n", "IPC");
+}
+
+/**
+ * @brief Outputs the hardware counts of the step, summed over the threads,
+ * for each type of task that ran.
+ *
+ * @param step The current step.
+ */
+void timers_hw_print(int step) {
+
+  const int nr_threads = timers_nr_threads;
+  for (int type = 0; type < task_type_count; type++) {
+
+    unsigned long long sum[timers_hw_count] = {0};
+    for (int i = 0; i < nr_threads; i++)
+      for (int k = 0; k < timers_hw_count; k++)
+        sum[k] += timers_hw_threads[i].counts[type][k];
+    if (sum[timers_hw_cycles] == 0) continue;
+
+    fprintf(timers_hw_file, "  %6d %20s", step, taskID_names[type]);
+    for (int k = 0; k < timers_hw_count; k++)
+      fprintf(timers_hw_file, " %18llu", sum[k]);
+    fprintf(timers_hw_file, " %8.3f\n",
+            (double)sum[timers_hw_instructions] / sum[timers_hw_cycles]);
+  }
+  fflush(timers_hw_file);
+}
+
+/**
+ * @brief Close the file containing the hardware counters.
+ */
+void timers_hw_close_file(void) {
+  if (timers_hw_file != NULL) fclose(timers_hw_file);
+  timers_hw_file = NULL;
+}
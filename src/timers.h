@@ -46,6 +46,7 @@ enum {
   timer_kick1,
   timer_kick2,
   timer_timestep,
+  timer_kick2_timestep_kick1,
   timer_endforce,
   timer_dosort,
   timer_doself_density,
@@ -90,15 +91,56 @@ enum {
   timer_count,
 };
 
-/* The timers. */
+/* Maximal number of threads with their own timers. */
+#define timers_max_threads 512
+
+/**
+ * @brief The timers of one thread.
+ *
+ * Each thread only adds to its own timers, which sit on their own cache
+ * lines. They are summed into #timers when printed.
+ */
+struct timers_thread {
+  ticks t[timer_count];
+} __attribute__((aligned(64)));
+
+/* The timers, summed over the threads. */
 extern ticks timers[timer_count];
 
+/* The timers of each thread. */
+extern struct timers_thread timers_threads[timers_max_threads];
+
+/* Index of the timers of the calling thread (-1 if not assigned yet). */
+extern __thread int timers_thread_id;
+
+/**
+ * @brief The hardware counters.
+ *
+ * If you modify this list, be sure to change timers_hw_names in timers.c as
+ * well!
+ */
+enum {
+  timers_hw_cycles = 0,
+  timers_hw_instructions,
+  timers_hw_llc_misses,
+  timers_hw_count,
+};
+
+/**
+ * @brief A reading of the hardware counters of a thread.
+ */
+struct timers_hw {
+  unsigned long long values[timers_hw_count];
+};
+
 /* The timer names. */
 extern const char *timers_names[];
 
 /* Mask for all timers. */
 #define timers_mask_all ((1ull << timer_count) - 1)
 
+void timers_assign_thread(void);
+
 /* Define the timer macros. */
 #ifdef SWIFT_USE_TIMERS
 #define TIMER_TIC const ticks tic = getticks();
@@ -107,7 +149,8 @@ extern const char *timers_names[];
 #define TIMER_TOC2(t) timers_toc(t, tic2)
 INLINE static ticks timers_toc(unsigned int t, ticks tic) {
   const ticks d = (getticks() - tic);
-  atomic_add(&timers[t], d);
+  if (timers_thread_id < 0) timers_assign_thread();
+  timers_threads[timers_thread_id].t[t] += d;
   return d;
 }
 #else
@@ -124,4 +167,13 @@ void timers_open_file(int rank);
 void timers_close_file(void);
 void timers_print(int step);
 
+/* Hardware counters. */
+void timers_hw_thread_init(void);
+void timers_hw_tic(struct timers_hw *hw);
+void timers_hw_toc(int type, const struct timers_hw *tic);
+void timers_hw_reset(void);
+void timers_hw_open_file(int rank);
+void timers_hw_close_file(void);
+void timers_hw_print(int step);
+
 #endif /* SWIFT_TIMERS_H */
@@ -0,0 +1,120 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "swift.h"
+
+/**
+ * @brief Compresses and decompresses a buffer and checks the round trip.
+ *
+ * @param data The records to compress.
+ * @param size The size of the records in bytes.
+ * @param record_size The size of one record in bytes.
+ *
+ * @return The size of the compressed buffer.
+ */
+size_t round_trip(const void *data, size_t size, size_t record_size) {
+
+  void *compressed = malloc(compress_bound(size));
+  void *out = malloc(size);
+  const size_t compressed_size =
+      compress_buffer(data, size, record_size, compressed);
+  if (compressed_size > compress_bound(size))
+    error("Compressed buffer larger than its bound.");
+  decompress_buffer(compressed, out, size);
+  if (memcmp(data, out, size) != 0) error("Round trip changed the data.");
+  free(compressed);
+  free(out);
+  return compressed_size;
+}
+
+/**
+ * @brief Test the lossless compression of MPI messages
+ */
+int main(int argc, char *argv[]) {
+
+  const int n = 10000;
+  struct gpart *gparts = (struct gpart *)malloc(n * sizeof(struct gpart));
+  bzero(gparts, n * sizeof(struct gpart));
+
+  // Particles on a lattice, as in a cell of a glass
+  srand(42);
+  for (int i = 0; i < n; i++) {
+    gparts[i].x[0] = 12.5 + 0.01 * (i % 22);
+    gparts[i].x[1] = 3.25 + 0.01 * ((i / 22) % 22);
+    gparts[i].x[2] = 7.75 + 0.01 * (i / 484);
+    gparts[i].mass = 1.f;
+    gparts[i].id_or_neg_offset = i;
+  }
+  const size_t size = n * sizeof(struct gpart);
+  if (round_trip(gparts, size, sizeof(struct gpart)) >= size)
+    error("Particles were not compressed.");
+
+  // Random data, stored as a plain copy
+  unsigned char *noise = (unsigned char *)gparts;
+  for (size_t i = 0; i < size; i++) noise[i] = rand() % 256;
+  if (round_trip(noise, size, sizeof(struct gpart)) !=
+      sizeof(struct compress_header) + size)
+    error("Random data was not stored as a copy.");
+
+  // Gas particles, with a number of records that is not a multiple of the
+  // 4-byte matches and planes longer than the match window
+  const int n_parts = 70001;
+  struct part *parts = (struct part *)malloc(n_parts * sizeof(struct part));
+  bzero(parts, n_parts * sizeof(struct part));
+  for (int i = 0; i < n_parts; i++) {
+    parts[i].x[0] = 0.5 + 0.013 * (i % 41);
+    parts[i].x[1] = 1.5 + 0.013 * ((i / 41) % 41);
+    parts[i].x[2] = 2.5 + 0.013 * (i / 1681);
+    parts[i].v[0] = 0.1f * (rand() % 100);
+    parts[i].h = 0.02f;
+    parts[i].mass = 1.f;
+    parts[i].id = 3 * i + 1;
+    parts[i].time_bin = 20 + i % 3;
+  }
+  const size_t parts_size = n_parts * sizeof(struct part);
+  if (round_trip(parts, parts_size, sizeof(struct part)) >= parts_size)
+    error("Gas particles were not compressed.");
+  free(parts);
+
+  // The same for the gravity particles
+  const int n_gparts = 9973;
+  for (int i = 0; i < n_gparts; i++) {
+    gparts[i].x[0] = 12.5 + 0.01 * (i % 22);
+    gparts[i].x[1] = 3.25 + 0.01 * ((i / 22) % 22);
+    gparts[i].x[2] = 7.75 + 0.01 * (i / 484);
+    gparts[i].mass = 1.f;
+    gparts[i].id_or_neg_offset = i;
+    gparts[i].time_bin = 20 + i % 5;
+  }
+  const size_t gparts_size = n_gparts * sizeof(struct gpart);
+  if (round_trip(gparts, gparts_size, sizeof(struct gpart)) >= gparts_size)
+    error("Gravity particles were not compressed.");
+
+  // Degenerate sizes
+  round_trip(noise, 0, 1);
+  round_trip(noise, 1, 1);
+  round_trip(noise, 7, 7);
+  memset(noise, 0, size);
+  round_trip(noise, size, 1);
+
+  free(gparts);
+  return 0;
+}
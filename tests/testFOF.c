@@ -0,0 +1,191 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+/* Some standard headers. */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Local headers. */
+#include "swift.h"
+
+/* Size of the box. */
+#define box_size 10.
+
+/* Linking length. */
+#define linking_length 0.3
+
+/* Spacing of the lattices, below the linking length. */
+#define spacing 0.25
+
+/* Number of particles on a side of the two lattices. */
+#define n_side_a 6
+#define n_side_b 5
+
+/* The isolated particles. */
+#define nr_isolated 9
+const double isolated[nr_isolated][3] = {
+    {7., 7., 7.}, {7., 2., 7.}, {2., 7., 7.}, {2., 2., 7.}, {7., 7., 2.},
+    {7., 2., 2.}, {2., 7., 2.}, {5., 8., 5.}, {5., 5., 8.}};
+
+/**
+ * @brief Distance between two coordinates in a periodic box.
+ */
+double periodic_dist(double a, double b) {
+
+  double d = fabs(a - b);
+  if (d > 0.5 * box_size) d = box_size - d;
+  return d;
+}
+
+/**
+ * @brief Builds two well separated lattices, one of them across the edge of
+ * the box, and some isolated particles then checks the groups found by the
+ * friends-of-friends.
+ */
+int main(int argc, char *argv[]) {
+
+  /* Initialize CPU frequency, this also starts time. */
+  unsigned long long cpufreq = 0;
+  clocks_set_cpufreq(cpufreq);
+
+  const int n_a = n_side_a * n_side_a * n_side_a;
+  const int n_b = n_side_b * n_side_b * n_side_b;
+  const int n_gparts = n_a + n_b + nr_isolated;
+  double dim[3] = {box_size, box_size, box_size};
+
+  struct gpart *gparts = NULL;
+  if (posix_memalign((void **)&gparts, gpart_align,
+                     n_gparts * sizeof(struct gpart)) != 0)
+    error("Failed to allocate the particles.");
+  bzero(gparts, n_gparts * sizeof(struct gpart));
+
+  /* A lattice around (2.5, 2.5, 2.5). */
+  int count = 0;
+  for (int i = 0; i < n_side_a; i++)
+    for (int j = 0; j < n_side_a; j++)
+      for (int k = 0; k < n_side_a; k++) {
+        gparts[count].x[0] = 2.5 + (i - 0.5 * (n_side_a - 1)) * spacing;
+        gparts[count].x[1] = 2.5 + (j - 0.5 * (n_side_a - 1)) * spacing;
+        gparts[count].x[2] = 2.5 + (k - 0.5 * (n_side_a - 1)) * spacing;
+        count++;
+      }
+
+  /* A lattice around (0, 5, 5), only linked across the edge of the box. */
+  for (int i = 0; i < n_side_b; i++)
+    for (int j = 0; j < n_side_b; j++)
+      for (int k = 0; k < n_side_b; k++) {
+        const double x = (i - 0.5 * (n_side_b - 1)) * spacing;
+        gparts[count].x[0] = x < 0. ? x + box_size : x;
+        gparts[count].x[1] = 5. + (j - 0.5 * (n_side_b - 1)) * spacing;
+        gparts[count].x[2] = 5. + (k - 0.5 * (n_side_b - 1)) * spacing;
+        count++;
+      }
+
+  for (int i = 0; i < nr_isolated; i++) {
+    for (int k = 0; k < 3; k++) gparts[count].x[k] = isolated[i][k];
+    count++;
+  }
+
+  for (int i = 0; i < n_gparts; i++) {
+    gparts[i].mass = 1.f;
+    gparts[i].id_or_neg_offset = i;
+    gparts[i].type = swift_type_dark_matter;
+  }
+
+  /* The run-time parameters. */
+  struct swift_params params;
+  parser_init("", &params);
+  char param[PARSER_MAX_LINE_SIZE];
+  sprintf(param, "StructureFinding:fof_linking_length_ratio:%.17e",
+          linking_length / cbrt(box_size * box_size * box_size / n_gparts));
+  parser_set_param(&params, param);
+  parser_set_param(&params, "StructureFinding:fof_min_group_size:1");
+  parser_set_param(&params, "StructureFinding:basename:testFOF");
+
+  struct cosmology cosmo;
+  cosmology_init_no_cosmo(&cosmo);
+
+  struct space s;
+  space_init(&s, &params, &cosmo, dim, NULL, gparts, NULL, 0, n_gparts, 0,
+             /*periodic=*/1, /*replicate=*/1, /*generate_gas_in_ics=*/0,
+             /*self_gravity=*/1, /*verbose=*/0, /*dry_run=*/0);
+
+  struct engine e;
+  bzero(&e, sizeof(struct engine));
+  e.s = &s;
+  e.nr_threads = 2;
+  e.nr_nodes = 1;
+  e.nodeID = 0;
+  e.total_nr_gparts = n_gparts;
+  e.max_active_bin = num_time_bins;
+  threadpool_init(&e.threadpool, e.nr_threads);
+  s.e = &e;
+  engine_rank = 0;
+
+  space_rebuild(&s, 0);
+
+  struct fof_props props;
+  fof_init(&props, &params);
+  fof_search_tree(&props, &e);
+
+  if (e.fof_output_count != 1) error("The catalogue count was not updated.");
+
+  /* Read the catalogue back. */
+  FILE *file = fopen("testFOF_fof_0000.txt", "r");
+  if (file == NULL) error("Could not open the FoF catalogue.");
+  char line[PARSER_MAX_LINE_SIZE];
+  long long sizes[n_gparts];
+  double centres[n_gparts][3];
+  int nr_groups = 0;
+  while (fgets(line, sizeof(line), file) != NULL) {
+    if (line[0] == '#') continue;
+    long long id, size;
+    double mass;
+    if (sscanf(line, "%lld %lld %lf %lf %lf %lf", &id, &size, &mass,
+               &centres[nr_groups][0], &centres[nr_groups][1],
+               &centres[nr_groups][2]) != 6)
+      error("Could not read the line '%s'.", line);
+    sizes[nr_groups++] = size;
+  }
+  fclose(file);
+
+  /* The two lattices then the isolated particles. */
+  if (nr_groups != 2 + nr_isolated)
+    error("Found %d groups instead of %d.", nr_groups, 2 + nr_isolated);
+  if (sizes[0] != n_a || sizes[1] != n_b)
+    error("Wrong sizes of the lattices: %lld and %lld.", sizes[0], sizes[1]);
+  for (int i = 2; i < nr_groups; i++)
+    if (sizes[i] != 1) error("Wrong size of an isolated particle.");
+
+  /* The centres of mass, including the one across the edge of the box. */
+  const double expected[2][3] = {{2.5, 2.5, 2.5}, {0., 5., 5.}};
+  for (int i = 0; i < 2; i++)
+    for (int k = 0; k < 3; k++)
+      if (periodic_dist(centres[i][k], expected[i][k]) > 1e-5)
+        error("Wrong centre of mass of group %d: %e instead of %e.", i,
+              centres[i][k], expected[i][k]);
+
+  message("Found the %d expected groups.", nr_groups);
+
+  threadpool_clean(&e.threadpool);
+  space_clean(&s);
+
+  return 0;
+}
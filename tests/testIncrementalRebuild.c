@@ -0,0 +1,237 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+/* Some standard headers. */
+#include <stdlib.h>
+#include <string.h>
+
+/* Local headers. */
+#include "swift.h"
+
+/**
+ * @brief Displacement of a particle along one axis in a given round.
+ *
+ * One particle in five jumps far enough to change top-level cell, one in five
+ * moves by about the size of the leaves and the others stay where they are.
+ */
+double displacement(long long id, int axis, int round) {
+
+  const double r =
+      ((id * 7919 + axis * 104729 + round * 1299709) % 2001) / 1000. - 1.;
+  switch (id % 5) {
+    case 0:
+      return 0.05 * r;
+    case 1:
+      return 0.01 * r;
+    default:
+      return 0.;
+  }
+}
+
+/**
+ * @brief Moves the particles of a #space and keeps them in the box.
+ */
+void move_particles(struct space *s, int round) {
+
+  for (size_t k = 0; k < s->nr_parts; k++) {
+    struct part *p = &s->parts[k];
+    for (int j = 0; j < 3; j++) {
+      p->x[j] += displacement(p->id, j, round);
+      if (p->x[j] < 0.) p->x[j] += s->dim[j];
+      if (p->x[j] >= s->dim[j]) p->x[j] -= s->dim[j];
+    }
+  }
+  for (size_t k = 0; k < s->nr_gparts; k++) {
+    struct gpart *gp = &s->gparts[k];
+    for (int j = 0; j < 3; j++) {
+      gp->x[j] += displacement(gp->id_or_neg_offset, j, round);
+      if (gp->x[j] < 0.) gp->x[j] += s->dim[j];
+      if (gp->x[j] >= s->dim[j]) gp->x[j] -= s->dim[j];
+    }
+  }
+}
+
+/**
+ * @brief Sum of the IDs of the particles of a cell.
+ */
+long long sum_ids(const struct cell *c) {
+
+  long long sum = 0;
+  for (int k = 0; k < c->count; k++) sum += c->parts[k].id;
+  for (int k = 0; k < c->gcount; k++) sum += c->gparts[k].id_or_neg_offset;
+  return sum;
+}
+
+/**
+ * @brief Checks that two cell trees hold the same particles and the same
+ * information.
+ */
+void compare_cells(const struct space *s_inc, const struct cell *c_inc,
+                   const struct space *s_full, const struct cell *c_full) {
+
+  if (c_inc->count != c_full->count || c_inc->gcount != c_full->gcount)
+    error("Different counts: count=%d/%d gcount=%d/%d at depth %d.",
+          c_inc->count, c_full->count, c_inc->gcount, c_full->gcount,
+          c_inc->depth);
+  if (c_inc->parts - s_inc->parts != c_full->parts - s_full->parts ||
+      c_inc->gparts - s_inc->gparts != c_full->gparts - s_full->gparts)
+    error("Different particle ranges at depth %d.", c_inc->depth);
+  if (sum_ids(c_inc) != sum_ids(c_full))
+    error("Different particles at depth %d.", c_inc->depth);
+  if (c_inc->h_max != c_full->h_max)
+    error("Different h_max: %e/%e at depth %d.", c_inc->h_max, c_full->h_max,
+          c_inc->depth);
+  if (c_inc->ti_hydro_end_min != c_full->ti_hydro_end_min ||
+      c_inc->ti_hydro_end_max != c_full->ti_hydro_end_max ||
+      c_inc->ti_hydro_beg_max != c_full->ti_hydro_beg_max ||
+      c_inc->ti_gravity_end_min != c_full->ti_gravity_end_min ||
+      c_inc->ti_gravity_end_max != c_full->ti_gravity_end_max ||
+      c_inc->ti_gravity_beg_max != c_full->ti_gravity_beg_max ||
+      c_inc->ti_old_part != c_full->ti_old_part ||
+      c_inc->ti_old_gpart != c_full->ti_old_gpart)
+    error("Different time-steps at depth %d.", c_inc->depth);
+  if (c_inc->split != c_full->split)
+    error("Different splits at depth %d.", c_inc->depth);
+
+  if (c_inc->split)
+    for (int k = 0; k < 8; k++) {
+      if ((c_inc->progeny[k] == NULL) != (c_full->progeny[k] == NULL))
+        error("Different progeny at depth %d.", c_inc->depth);
+      if (c_inc->progeny[k] != NULL)
+        compare_cells(s_inc, c_inc->progeny[k], s_full, c_full->progeny[k]);
+    }
+}
+
+/**
+ * @brief Checks that an incremental rebuild after moving particles gives the
+ * same cells as a full rebuild.
+ */
+int main(int argc, char *argv[]) {
+
+  /* Initialize CPU frequency, this also starts time. */
+  unsigned long long cpufreq = 0;
+  clocks_set_cpufreq(cpufreq);
+
+  const int n_side = 16;
+  const int n_parts = n_side * n_side * n_side;
+  const int n_gparts = n_parts / 2;
+  const int nr_rounds = 4;
+  double dim[3] = {1., 1., 1.};
+
+  /* The run-time parameters. */
+  struct swift_params params;
+  parser_init("", &params);
+  parser_set_param(&params, "Scheduler:max_top_level_cells:8");
+  parser_set_param(&params, "Scheduler:cell_split_size:20");
+  parser_set_param(&params, "Scheduler:incremental_rebuild:1");
+
+  struct cosmology cosmo;
+  cosmology_init_no_cosmo(&cosmo);
+
+  /* A perturbed lattice of gas and a random set of dark matter, twice. */
+  struct space spaces[2];
+  struct engine engines[2];
+  srand(1234);
+  double *positions = (double *)malloc(3 * n_gparts * sizeof(double));
+  for (int k = 0; k < 3 * n_gparts; k++)
+    positions[k] = rand() / ((double)RAND_MAX + 1.);
+  for (int i = 0; i < 2; i++) {
+    struct part *parts = NULL;
+    struct gpart *gparts = NULL;
+    if (posix_memalign((void **)&parts, part_align,
+                       n_parts * sizeof(struct part)) != 0 ||
+        posix_memalign((void **)&gparts, gpart_align,
+                       n_gparts * sizeof(struct gpart)) != 0)
+      error("Failed to allocate the particles.");
+    bzero(parts, n_parts * sizeof(struct part));
+    bzero(gparts, n_gparts * sizeof(struct gpart));
+
+    for (int k = 0; k < n_parts; k++) {
+      parts[k].x[0] = ((k % n_side) + 0.5 + 0.2 * displacement(k, 0, -1)) /
+                      n_side;
+      parts[k].x[1] =
+          (((k / n_side) % n_side) + 0.5 + 0.2 * displacement(k, 1, -1)) /
+          n_side;
+      parts[k].x[2] =
+          ((k / (n_side * n_side)) + 0.5 + 0.2 * displacement(k, 2, -1)) /
+          n_side;
+      parts[k].h = 0.02f + 0.0001f * (k % 7);
+      parts[k].mass = 1.f;
+      parts[k].id = k;
+      parts[k].gpart = NULL;
+      parts[k].time_bin = 1 + k % 4;
+    }
+    for (int k = 0; k < n_gparts; k++) {
+      for (int j = 0; j < 3; j++) gparts[k].x[j] = positions[3 * k + j];
+      gparts[k].mass = 1.f;
+      gparts[k].id_or_neg_offset = n_parts + k;
+      gparts[k].type = swift_type_dark_matter;
+      gparts[k].time_bin = 2 + k % 3;
+    }
+
+    space_init(&spaces[i], &params, &cosmo, dim, parts, gparts, NULL, n_parts,
+               n_gparts, 0, /*periodic=*/1, /*replicate=*/1,
+               /*generate_gas_in_ics=*/0, /*self_gravity=*/0, /*verbose=*/0,
+               /*dry_run=*/0);
+
+    bzero(&engines[i], sizeof(struct engine));
+    engines[i].s = &spaces[i];
+    engines[i].nr_threads = 4;
+    engines[i].nr_nodes = 1;
+    engines[i].nodeID = 0;
+    engines[i].ti_current = 0;
+    engines[i].max_active_bin = num_time_bins;
+    threadpool_init(&engines[i].threadpool, engines[i].nr_threads);
+    spaces[i].e = &engines[i];
+  }
+  free(positions);
+  engine_rank = 0;
+
+  /* Only the first space is re-built incrementally. */
+  struct space *s_inc = &spaces[0];
+  struct space *s_full = &spaces[1];
+  s_full->incremental_rebuild = 0;
+
+  /* Build the first trees from scratch. */
+  space_rebuild(s_inc, 0);
+  space_rebuild(s_full, 0);
+
+  for (int round = 0; round < nr_rounds; round++) {
+
+    move_particles(s_inc, round);
+    move_particles(s_full, round);
+
+    if (!space_rebuild_incremental(s_inc, 0))
+      error("The incremental rebuild was not used.");
+    space_rebuild(s_full, 0);
+
+    if (s_inc->nr_cells != s_full->nr_cells)
+      error("Different number of top-level cells.");
+    for (int k = 0; k < s_inc->nr_cells; k++)
+      compare_cells(s_inc, &s_inc->cells_top[k], s_full, &s_full->cells_top[k]);
+
+    message("Round %d: incremental and full rebuilds agree.", round);
+  }
+
+  for (int i = 0; i < 2; i++) {
+    threadpool_clean(&engines[i].threadpool);
+    space_clean(&spaces[i]);
+  }
+
+  return 0;
+}
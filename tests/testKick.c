@@ -0,0 +1,298 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+/* Some standard headers. */
+#include <stdlib.h>
+#include <string.h>
+
+/* Local headers. */
+#include "swift.h"
+
+/* The kick functions are not part of the library interface. */
+#include "kick.h"
+
+/* Number of particles of each type. */
+#define nr_particles (1 << 18)
+
+/* Number of repetitions of each timing, the fastest one is kept. */
+#define nr_repeats 5
+
+/* Number of time-bins the particles are spread over. */
+#define nr_bins 20
+
+/**
+ * @brief First half-kick of a leaf cell computing the kick intervals and
+ * factors of every particle, as runner_do_kick1() used to.
+ */
+void kick1_per_particle(const struct engine *e, struct cell *c) {
+
+  const struct cosmology *cosmo = e->cosmology;
+  const struct hydro_props *hydro_props = e->hydro_properties;
+  const integertime_t ti_current = e->ti_current;
+  const int with_cosmology = (e->policy & engine_policy_cosmology);
+  const double time_base = e->time_base;
+
+  for (int k = 0; k < c->count; k++) {
+    struct part *p = &c->parts[k];
+    struct xpart *xp = &c->xparts[k];
+    if (!part_is_starting(p, e)) continue;
+
+    const integertime_t ti_step = get_integer_timestep(p->time_bin);
+    const integertime_t ti_begin =
+        get_integer_time_begin(ti_current + 1, p->time_bin);
+    const integertime_t ti_end = ti_begin + ti_step / 2;
+
+    double dt_kick_hydro, dt_kick_grav, dt_kick_therm, dt_kick_corr;
+    if (with_cosmology) {
+      dt_kick_hydro = cosmology_get_hydro_kick_factor(cosmo, ti_begin, ti_end);
+      dt_kick_grav = cosmology_get_grav_kick_factor(cosmo, ti_begin, ti_end);
+      dt_kick_therm = cosmology_get_therm_kick_factor(cosmo, ti_begin, ti_end);
+      dt_kick_corr = cosmology_get_corr_kick_factor(cosmo, ti_begin, ti_end);
+    } else {
+      dt_kick_hydro = (ti_step / 2) * time_base;
+      dt_kick_grav = (ti_step / 2) * time_base;
+      dt_kick_therm = (ti_step / 2) * time_base;
+      dt_kick_corr = (ti_step / 2) * time_base;
+    }
+
+    kick_part(p, xp, dt_kick_hydro, dt_kick_grav, dt_kick_therm, dt_kick_corr,
+              cosmo, hydro_props, ti_begin, ti_end);
+  }
+
+  for (int k = 0; k < c->gcount; k++) {
+    struct gpart *gp = &c->gparts[k];
+    if (gp->type != swift_type_dark_matter || !gpart_is_starting(gp, e))
+      continue;
+
+    const integertime_t ti_step = get_integer_timestep(gp->time_bin);
+    const integertime_t ti_begin =
+        get_integer_time_begin(ti_current + 1, gp->time_bin);
+    const integertime_t ti_end = ti_begin + ti_step / 2;
+
+    const double dt_kick_grav =
+        with_cosmology ? cosmology_get_grav_kick_factor(cosmo, ti_begin, ti_end)
+                       : (ti_step / 2) * time_base;
+
+    kick_gpart(gp, dt_kick_grav, ti_begin, ti_end);
+  }
+}
+
+/**
+ * @brief Fills a leaf cell with gas and dark matter in various time-bins.
+ */
+void make_cell(struct cell *c, integertime_t ti_current) {
+
+  bzero(c, sizeof(struct cell));
+  if (posix_memalign((void **)&c->parts, part_align,
+                     nr_particles * sizeof(struct part)) != 0 ||
+      posix_memalign((void **)&c->xparts, xpart_align,
+                     nr_particles * sizeof(struct xpart)) != 0 ||
+      posix_memalign((void **)&c->gparts, gpart_align,
+                     nr_particles * sizeof(struct gpart)) != 0)
+    error("Failed to allocate the particles.");
+  bzero(c->parts, nr_particles * sizeof(struct part));
+  bzero(c->xparts, nr_particles * sizeof(struct xpart));
+  bzero(c->gparts, nr_particles * sizeof(struct gpart));
+  c->count = nr_particles;
+  c->gcount = nr_particles;
+  c->ti_hydro_beg_max = ti_current;
+  c->ti_gravity_beg_max = ti_current;
+
+  for (int k = 0; k < nr_particles; k++) {
+    struct part *p = &c->parts[k];
+    struct xpart *xp = &c->xparts[k];
+    struct gpart *gp = &c->gparts[k];
+    p->time_bin = 1 + k % nr_bins;
+    p->rho = 1.f + 0.001f * (k % 97);
+    p->entropy_dt = 0.01f * ((k % 13) - 6);
+    xp->entropy_full = 1.f;
+    for (int j = 0; j < 3; j++) {
+      p->a_hydro[j] = 0.1f * ((k + j) % 17 - 8);
+      xp->v_full[j] = 0.01f * ((k + 2 * j) % 23);
+    }
+    gp->type = swift_type_dark_matter;
+    gp->time_bin = 1 + (k / 3) % nr_bins;
+    for (int j = 0; j < 3; j++) {
+      gp->a_grav[j] = 0.1f * ((k + j) % 19 - 9);
+      gp->v_full[j] = 0.01f * ((k + 3 * j) % 29);
+    }
+  }
+}
+
+/**
+ * @brief Compares the particles of two cells bit for bit.
+ */
+void compare_cells(const struct cell *a, const struct cell *b) {
+
+  if (memcmp(a->parts, b->parts, nr_particles * sizeof(struct part)) != 0 ||
+      memcmp(a->xparts, b->xparts, nr_particles * sizeof(struct xpart)) != 0 ||
+      memcmp(a->gparts, b->gparts, nr_particles * sizeof(struct gpart)) != 0)
+    error("The kicks do not give the same particles.");
+}
+
+/**
+ * @brief Checks that the per-bin kick factors of the runners give the same
+ * particles as computing them per particle and times both. Also times the
+ * gravity kick of the #gpart against the smallest update touching the same
+ * memory and against the same kick on contiguous arrays.
+ */
+int main(int argc, char *argv[]) {
+
+  /* Initialize CPU frequency, this also starts time. */
+  unsigned long long cpufreq = 0;
+  clocks_set_cpufreq(cpufreq);
+
+  struct swift_params params;
+  parser_init("", &params);
+  parser_set_param(&params, "Cosmology:Omega_m:0.3075");
+  parser_set_param(&params, "Cosmology:Omega_lambda:0.6910");
+  parser_set_param(&params, "Cosmology:Omega_b:0.0486");
+  parser_set_param(&params, "Cosmology:h:0.6774");
+  parser_set_param(&params, "Cosmology:a_begin:0.1");
+  parser_set_param(&params, "Cosmology:a_end:1.0");
+
+  struct unit_system us;
+  units_init_cgs(&us);
+  struct phys_const phys_const;
+  phys_const_init(&us, &params, &phys_const);
+  /* The kick factors are integrals over the expansion history when GSL is
+   * available, plain time-steps otherwise. */
+  struct cosmology cosmo;
+#ifdef HAVE_LIBGSL
+  cosmology_init(&params, &us, &phys_const, &cosmo);
+  const int policy = engine_policy_cosmology;
+  const double time_base = cosmo.time_base;
+#else
+  cosmology_init_no_cosmo(&cosmo);
+  const int policy = 0;
+  const double time_base = 1. / max_nr_timesteps;
+#endif
+
+  struct hydro_props hydro_props;
+  bzero(&hydro_props, sizeof(struct hydro_props));
+
+  /* A time at which all the time-bins in use start a step. */
+  const integertime_t ti_current =
+      3 * get_integer_timestep(nr_bins) + max_nr_timesteps / 2;
+
+  struct engine e;
+  bzero(&e, sizeof(struct engine));
+  e.policy = policy;
+  e.cosmology = &cosmo;
+  e.hydro_properties = &hydro_props;
+  e.ti_current = ti_current;
+  e.max_active_bin = num_time_bins;
+  e.time_base = time_base;
+
+  struct runner r;
+  bzero(&r, sizeof(struct runner));
+  r.e = &e;
+
+  struct cell c_ref, c_bin;
+  make_cell(&c_ref, ti_current);
+  make_cell(&c_bin, ti_current);
+
+  /* Kick both cells several times and keep the fastest pass of each. */
+  ticks t_ref = 0, t_bin = 0;
+  for (int n = 0; n < nr_repeats; n++) {
+
+    ticks tic = getticks();
+    kick1_per_particle(&e, &c_ref);
+    const ticks dt_ref = getticks() - tic;
+    if (n == 0 || dt_ref < t_ref) t_ref = dt_ref;
+
+    /* The runners fill their tables once per step. */
+    for (int i = 0; i < 2; i++)
+      for (int bin = 0; bin <= num_time_bins; bin++)
+        r.kick_factors[i][bin].ti_current = -1;
+
+    tic = getticks();
+    runner_do_kick1(&r, &c_bin, 0);
+    const ticks dt_bin = getticks() - tic;
+    if (n == 0 || dt_bin < t_bin) t_bin = dt_bin;
+
+    compare_cells(&c_ref, &c_bin);
+  }
+
+  message("First half-kick of %d parts and %d gparts in %d time-bins (%s):",
+          nr_particles, nr_particles, nr_bins,
+          (policy & engine_policy_cosmology) ? "cosmological" : "static");
+  message("  factors per particle: %.3f %s", clocks_from_ticks(t_ref),
+          clocks_getunit());
+  message("  factors per time-bin: %.3f %s", clocks_from_ticks(t_bin),
+          clocks_getunit());
+
+  /* The gravity kick of the gparts against the smallest update of the same
+   * cache lines and against the same kick on contiguous arrays. */
+  float *v = (float *)malloc(3 * nr_particles * sizeof(float));
+  float *a = (float *)malloc(3 * nr_particles * sizeof(float));
+  if (v == NULL || a == NULL) error("Failed to allocate the arrays.");
+  for (int k = 0; k < 3 * nr_particles; k++) {
+    v[k] = c_bin.gparts[k / 3].v_full[k % 3];
+    a[k] = c_bin.gparts[k / 3].a_grav[k % 3];
+  }
+
+  const double dt_kick = 1e-3;
+  struct gpart *gparts = c_bin.gparts;
+  ticks t_kick = 0, t_touch = 0, t_soa = 0;
+  for (int n = 0; n < nr_repeats; n++) {
+
+    ticks tic = getticks();
+    for (int k = 0; k < nr_particles; k++)
+      kick_gpart(&gparts[k], dt_kick, ti_current, ti_current);
+    const ticks dt_kick_aos = getticks() - tic;
+    if (n == 0 || dt_kick_aos < t_kick) t_kick = dt_kick_aos;
+
+    tic = getticks();
+    for (int k = 0; k < nr_particles; k++) gparts[k].v_full[0] += 1e-3f;
+    const ticks dt_touch = getticks() - tic;
+    if (n == 0 || dt_touch < t_touch) t_touch = dt_touch;
+
+    tic = getticks();
+    for (int k = 0; k < 3 * nr_particles; k++) v[k] += a[k] * dt_kick;
+    const ticks dt_soa = getticks() - tic;
+    if (n == 0 || dt_soa < t_soa) t_soa = dt_soa;
+  }
+
+  /* Use the results so that the loops are not optimised away. */
+  double sum = 0.;
+  for (int k = 0; k < nr_particles; k++)
+    sum += gparts[k].v_full[0] + v[3 * k];
+  if (sum != sum) error("Invalid velocities.");
+
+  message("Gravity kick of %d gparts (%zu bytes each):", nr_particles,
+          sizeof(struct gpart));
+  message("  scalar kick_gpart(): %.3f %s", clocks_from_ticks(t_kick),
+          clocks_getunit());
+  message("  one add per gpart:   %.3f %s", clocks_from_ticks(t_touch),
+          clocks_getunit());
+  message("  contiguous arrays:   %.3f %s", clocks_from_ticks(t_soa),
+          clocks_getunit());
+
+  free(v);
+  free(a);
+  for (int i = 0; i < 2; i++) {
+    struct cell *c = (i == 0) ? &c_ref : &c_bin;
+    free(c->parts);
+    free(c->xparts);
+    free(c->gparts);
+  }
+  cosmology_clean(&cosmo);
+
+  return 0;
+}
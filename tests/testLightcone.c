@@ -0,0 +1,154 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+/* Some standard headers. */
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Local headers. */
+#include "swift.h"
+
+/**
+ * @brief Checks a crossing recorded in the lightcone.
+ *
+ * The velocities are single precision, hence the tolerance.
+ */
+void check_crossing(const struct lightcone_particle *lp, long long id,
+                    int type, const double x[3], double a) {
+
+  if (lp->id != id || lp->type != type)
+    error("Wrong particle: id=%lld type=%d instead of id=%lld type=%d.",
+          lp->id, lp->type, id, type);
+  for (int k = 0; k < 3; k++)
+    if (fabs(lp->x[k] - x[k]) > 1e-6)
+      error("Wrong position of particle %lld: x[%d]=%.12e instead of %.12e.",
+            id, k, lp->x[k], x[k]);
+  if (fabs(lp->a - a) > 1e-6)
+    error("Wrong time of particle %lld: %.12e instead of %.12e.", id, lp->a,
+          a);
+}
+
+/**
+ * @brief Drifts a few particles through the lightcone of an observer at the
+ * centre of a periodic box and checks the crossings found.
+ *
+ * Light travels 2.4 box sizes per unit of time and the run ends at t=1. The
+ * drift goes from t=1/2 to t=9/16, during which the radius of the lightcone
+ * shrinks from 1.2 to 1.05 box sizes, so the crossings are only found in the
+ * replications of the box.
+ */
+int main(int argc, char *argv[]) {
+
+  /* Initialize CPU frequency, this also starts time. */
+  unsigned long long cpufreq = 0;
+  clocks_set_cpufreq(cpufreq);
+
+  struct swift_params params;
+  parser_init("", &params);
+  parser_set_param(&params, "Lightcone:max_replications:1");
+  parser_set_param(&params, "Lightcone:basename:testLightcone");
+
+  struct part parts[3];
+  struct xpart xparts[3];
+  struct gpart gparts[2];
+  bzero(parts, sizeof(parts));
+  bzero(xparts, sizeof(xparts));
+  bzero(gparts, sizeof(gparts));
+
+  const double dt_drift = 1. / 16.;
+
+  /* Gas without gpart moving out of the lightcone in the +x replication. */
+  parts[0].id = 100;
+  parts[0].x[0] = 0.65;
+  parts[0].x[1] = 0.5;
+  parts[0].x[2] = 0.5;
+  xparts[0].v_full[0] = 1.6f;
+
+  /* Gas with a gpart at rest, swept by the lightcone in the +y replication. */
+  parts[1].id = 101;
+  parts[1].x[0] = 0.5;
+  parts[1].x[1] = 0.625;
+  parts[1].x[2] = 0.5;
+  parts[1].gpart = &gparts[0];
+  gparts[0].x[0] = 0.5;
+  gparts[0].x[1] = 0.625;
+  gparts[0].x[2] = 0.5;
+  gparts[0].type = swift_type_gas;
+  gparts[0].id_or_neg_offset = -1;
+
+  /* Gas and dark matter at rest on the observer. */
+  parts[2].id = 102;
+  for (int k = 0; k < 3; k++) parts[2].x[k] = 0.5;
+  for (int k = 0; k < 3; k++) gparts[1].x[k] = 0.5;
+  gparts[1].type = swift_type_dark_matter;
+  gparts[1].id_or_neg_offset = 200;
+
+  struct space s;
+  bzero(&s, sizeof(struct space));
+  for (int k = 0; k < 3; k++) s.dim[k] = 1.;
+  s.periodic = 1;
+  s.parts = parts;
+  s.gparts = gparts;
+  s.nr_parts = 3;
+  s.nr_gparts = 2;
+
+  struct phys_const phys_const;
+  bzero(&phys_const, sizeof(struct phys_const));
+  phys_const.const_speed_light_c = 2.4;
+
+  struct engine e;
+  bzero(&e, sizeof(struct engine));
+  e.s = &s;
+  e.physical_constants = &phys_const;
+  e.policy = 0;
+  e.time_begin = 0.;
+  e.time_base = 1. / max_nr_timesteps;
+  s.e = &e;
+
+  const integertime_t ti_old = max_nr_timesteps / 2;
+  const integertime_t ti_current = ti_old + max_nr_timesteps / 16;
+
+  struct lightcone_props props;
+  lightcone_init(&props, &params, &s, /*nodeID=*/0, /*nr_threads=*/1,
+                 /*restart=*/0, /*verbose=*/0);
+
+  /* The gas with a gpart is left to the gparts. */
+  lightcone_check_parts(&props, &e, parts, xparts, 3, dt_drift, ti_old,
+                        ti_current);
+  if (props.nr_buffer != 1)
+    error("Found %zu crossings of the gas instead of 1.", props.nr_buffer);
+  const double x_0[3] = {1.61, 0.5, 0.5};
+  check_crossing(&props.buffer[0], 100, swift_type_gas, x_0, 0.5 + 0.6 / 16.);
+
+  /* The gas with a gpart is written once, with the ID of the gas. */
+  lightcone_check_gparts(&props, &e, gparts, 2, dt_drift, ti_old, ti_current);
+  if (props.nr_buffer != 2)
+    error("Found %zu crossings in total instead of 2.", props.nr_buffer);
+  const double x_1[3] = {0.5, 1.625, 0.5};
+  check_crossing(&props.buffer[1], 101, swift_type_gas, x_1, 0.5 + 0.5 / 16.);
+
+  lightcone_flush(&props);
+  if (props.nr_written != 2)
+    error("Wrote %lld crossings instead of 2.", props.nr_written);
+  lightcone_clean(&props);
+
+  message("Found the 2 expected crossings.");
+
+  return 0;
+}
@@ -0,0 +1,206 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+/* Some standard headers. */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Local headers. */
+#include "swift.h"
+
+#if !defined(HAVE_FFTW)
+
+int main(int argc, char *argv[]) { return 0; }
+
+#else
+
+/* Side-length of the mesh. */
+#define mesh_size 64
+
+/* Folding factor of the second set of bins. */
+#define fold_factor 2
+
+/* Maximal number of bins in the file. */
+#define max_bins (2 * mesh_size)
+
+/**
+ * @brief The bins read back from a power spectrum file.
+ */
+struct bins {
+
+  /*! Number of bins. */
+  int count;
+
+  /*! Power, number of modes and folding factor of each bin. */
+  double power[max_bins];
+  long long n_modes[max_bins];
+  int fold[max_bins];
+};
+
+/**
+ * @brief Measures the power spectrum of a set of #gpart and reads it back.
+ */
+void measure(struct space *s, struct pm_mesh *mesh, struct bins *bins) {
+
+  const char *file_name = "testPowerSpectrum.txt";
+  pm_mesh_compute_power_spectrum(mesh, s, fold_factor, file_name, 0., 0, 0);
+
+  FILE *file = fopen(file_name, "r");
+  if (file == NULL) error("Could not open the power spectrum file.");
+  char line[PARSER_MAX_LINE_SIZE];
+  bins->count = 0;
+  while (fgets(line, sizeof(line), file) != NULL) {
+    if (line[0] == '#') continue;
+    if (bins->count == max_bins) error("Too many bins.");
+    double k;
+    const int b = bins->count++;
+    if (sscanf(line, "%lf %lf %lld %d", &k, &bins->power[b], &bins->n_modes[b],
+               &bins->fold[b]) != 4)
+      error("Could not read the line '%s'.", line);
+  }
+  fclose(file);
+
+  /* One bin per wave-number up to the Nyquist frequency of each mesh. */
+  if (bins->count != mesh_size)
+    error("Found %d bins instead of %d.", bins->count, mesh_size);
+}
+
+/**
+ * @brief Mode-weighted mean power of the bins of a given fold in a range of
+ * wave-numbers (in units of the fundamental mode of the box).
+ */
+double mean_power(const struct bins *bins, int fold, int k_min, int k_max) {
+
+  double p_sum = 0.;
+  long long n_sum = 0;
+  for (int b = 0; b < bins->count; b++) {
+    if (bins->fold[b] != fold) continue;
+    const int k = fold * (b % (mesh_size / 2) + 1);
+    if (k < k_min || k > k_max) continue;
+    p_sum += bins->power[b] * bins->n_modes[b];
+    n_sum += bins->n_modes[b];
+  }
+  return p_sum / n_sum;
+}
+
+/**
+ * @brief Checks the shot-noise corrected power spectrum of a uniform lattice
+ * and of a clumped random field, with and without folding.
+ */
+int main(int argc, char *argv[]) {
+
+  /* Initialize CPU frequency, this also starts time. */
+  unsigned long long cpufreq = 0;
+  clocks_set_cpufreq(cpufreq);
+
+  const double box_size = 1.;
+  const double volume = box_size * box_size * box_size;
+
+  struct pm_mesh mesh;
+  bzero(&mesh, sizeof(struct pm_mesh));
+  mesh.N = mesh_size;
+
+  struct space s;
+  bzero(&s, sizeof(struct space));
+  for (int k = 0; k < 3; k++) s.dim[k] = box_size;
+  s.periodic = 1;
+
+  struct bins bins;
+
+  /* A lattice with one particle per cell of the mesh has no power below its
+   * own wave-number, so all that is left in the bins is minus the shot-noise.
+   * Only the folded bins reach the lattice itself. */
+  const int n_lattice = mesh_size * mesh_size * mesh_size;
+  struct gpart *gparts =
+      (struct gpart *)calloc(n_lattice, sizeof(struct gpart));
+  if (gparts == NULL) error("Failed to allocate the particles.");
+  for (int i = 0; i < n_lattice; i++) {
+    gparts[i].x[0] = (i % mesh_size) * box_size / mesh_size;
+    gparts[i].x[1] = ((i / mesh_size) % mesh_size) * box_size / mesh_size;
+    gparts[i].x[2] = (i / (mesh_size * mesh_size)) * box_size / mesh_size;
+    gparts[i].mass = 1.f;
+  }
+  s.gparts = gparts;
+  s.nr_gparts = n_lattice;
+
+  measure(&s, &mesh, &bins);
+  const double p_lattice = -volume / n_lattice;
+  for (int b = 0; b < bins.count; b++) {
+    const int k = bins.fold[b] * (b % (mesh_size / 2) + 1);
+    if (k >= mesh_size) continue;
+    if (fabs(bins.power[b] - p_lattice) > 1e-6 * fabs(p_lattice))
+      error("Wrong power of the lattice in bin %d (fold %d): %e instead of %e.",
+            b, bins.fold[b], bins.power[b], p_lattice);
+  }
+  free(gparts);
+
+  /* Clumps of particles at random positions. Their power is the shot-noise
+   * of the clumps, from which the shot-noise of the particles is removed. */
+  const int n_clumps = 4096;
+  const int clump_size = 8;
+  const int n_clumped = n_clumps * clump_size;
+  gparts = (struct gpart *)calloc(n_clumped, sizeof(struct gpart));
+  if (gparts == NULL) error("Failed to allocate the particles.");
+  srand(1234);
+  for (int c = 0; c < n_clumps; c++) {
+    double x[3];
+    for (int k = 0; k < 3; k++) x[k] = box_size * rand() / (RAND_MAX + 1.);
+    for (int i = c * clump_size; i < (c + 1) * clump_size; i++) {
+      for (int k = 0; k < 3; k++) gparts[i].x[k] = x[k];
+      gparts[i].mass = 1.f;
+    }
+  }
+  s.gparts = gparts;
+  s.nr_gparts = n_clumped;
+
+  measure(&s, &mesh, &bins);
+  const double p_clumps = volume / n_clumps - volume / n_clumped;
+
+  /* Far from the Nyquist frequency of the meshes, where the aliasing of the
+   * CIC assignment can be neglected. */
+  const int k_max = mesh_size / 4;
+  const double p_unfolded = mean_power(&bins, 1, 1, k_max);
+  const double p_folded =
+      mean_power(&bins, fold_factor, fold_factor, fold_factor * k_max);
+  if (fabs(p_unfolded - p_clumps) > 0.05 * p_clumps)
+    error("Wrong power of the clumps: %e instead of %e.", p_unfolded,
+          p_clumps);
+  if (fabs(p_folded - p_clumps) > 0.05 * p_clumps)
+    error("Wrong folded power of the clumps: %e instead of %e.", p_folded,
+          p_clumps);
+
+  /* Where both are valid, the folded bins measure a subset of the modes of
+   * the unfolded ones, hence the larger tolerance. */
+  const double p_both = mean_power(&bins, 1, fold_factor, k_max);
+  const double p_both_folded =
+      mean_power(&bins, fold_factor, fold_factor, k_max);
+  if (fabs(p_both - p_both_folded) > 0.1 * p_clumps)
+    error("The folded (%e) and unfolded (%e) power differ.", p_both_folded,
+          p_both);
+
+  message("Unfolded power: %e, folded: %e, expected: %e.", p_unfolded,
+          p_folded, p_clumps);
+
+  free(gparts);
+
+  return 0;
+}
+
+#endif
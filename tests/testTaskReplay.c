@@ -0,0 +1,996 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+/*
+ * Offline replay of a task graph through a model of the scheduler.
+ *
+ * The graphs are written by scheduler_dump_task_graph() when SWIFT is
+ * configured with --enable-task-debugging and run with -y. Each task keeps
+ * its measured cost and the replay runs it on simulated threads through
+ * pluggable versions of scheduler_gettask() and queue_gettask(), including
+ * the cell locks taken by task_lock(). This allows comparing scheduling
+ * policies on production traces without running the code.
+ *
+ * Without a file, a set of synthetic graphs with known makespans is
+ * replayed as a test of the replay itself.
+ */
+
+#include "../config.h"
+
+/* Some standard headers. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Local headers. */
+#include "swift.h"
+
+/* The data of a cell locked by a task. */
+#define replay_lock_part (1 << 0)
+#define replay_lock_gpart (1 << 1)
+#define replay_lock_mpole (1 << 2)
+
+/**
+ * @brief The geometry and content of a cell used by a task.
+ */
+struct replay_cell {
+
+  /*! Corner and width of the cell, width 0 if the task has no such cell. */
+  double loc[3], width;
+
+  /*! Number of particles in the cell. */
+  int count, gcount;
+};
+
+/**
+ * @brief A task of the replayed graph.
+ */
+struct replay_task {
+
+  /*! Type and subtype of the task. */
+  enum task_types type;
+  enum task_subtypes subtype;
+
+  /*! Is the task implicit, i.e. done as soon as it is enqueued? */
+  int implicit;
+
+  /*! Queue the task was inserted in during the run, -1 if unknown. */
+  int qid;
+
+  /*! Weight of the task, i.e. its priority in the queues. */
+  float weight;
+
+  /*! Measured start and end of the task in ticks. */
+  long long tic, toc;
+
+  /*! The cells of the task. */
+  struct replay_cell ci, cj;
+
+  /*! The tasks this task unlocks. */
+  int nr_unlocks;
+  int *unlocks;
+
+  /*! Number of tasks still to be done before this one can run. */
+  int wait;
+
+  /*! Number of tasks unlocking this one. */
+  int nr_deps;
+
+  /*! Order in which the task was enqueued. */
+  long long order;
+};
+
+/**
+ * @brief A simulated queue: a heap of task indices ordered by key.
+ */
+struct replay_queue {
+  int *tid;
+  float *key;
+  int count, size;
+};
+
+struct replay;
+
+/**
+ * @brief A scheduling policy, i.e. a set of versions of the functions
+ * deciding which task runs where.
+ */
+struct replay_policy {
+
+  /*! Name of the policy on the command line. */
+  const char *name;
+
+  /*! Short description of the policy. */
+  const char *description;
+
+  /*! Picks the queue in which a task is inserted. */
+  int (*enqueue)(const struct replay *r, const struct replay_task *t);
+
+  /*! Priority of a task in a queue, largest first. */
+  float (*key)(const struct replay_task *t);
+
+  /*! Gets a task that can be locked from a queue, -1 if none. */
+  int (*queue_gettask)(struct replay *r, struct replay_queue *q, int prev);
+
+  /*! Gets a task for a thread, -1 if none. */
+  int (*scheduler_gettask)(struct replay *r, int thread, int prev);
+};
+
+/**
+ * @brief The state of a replay.
+ */
+struct replay {
+
+  /*! The tasks. */
+  struct replay_task *tasks;
+  int nr_tasks;
+
+  /*! The queues. */
+  struct replay_queue *queues;
+  int nr_queues;
+
+  /*! Number of simulated threads and their states. */
+  int nr_threads;
+  int *running, *prev;
+  long long *end;
+  unsigned int *seeds;
+
+  /*! Do threads steal tasks from the other queues? */
+  int steal;
+
+  /*! Cost of getting a task in ticks. */
+  long long overhead;
+
+  /*! The policy used. */
+  const struct replay_policy *policy;
+
+  /*! Number of tasks enqueued and done so far. */
+  long long nr_enqueued;
+  int nr_done;
+};
+
+/**
+ * @brief Data locked by a task in its cells, as in task_lock().
+ */
+static int replay_lock_mask(const struct replay_task *t) {
+
+  switch (t->type) {
+    case task_type_end_force:
+    case task_type_kick1:
+    case task_type_kick2:
+    case task_type_timestep:
+      return replay_lock_part | replay_lock_gpart;
+    case task_type_drift_part:
+    case task_type_sort:
+      return replay_lock_part;
+    case task_type_drift_gpart:
+    case task_type_grav_mesh:
+      return replay_lock_gpart;
+    case task_type_self:
+    case task_type_sub_self:
+    case task_type_pair:
+    case task_type_sub_pair:
+      if (t->subtype == task_subtype_grav)
+        return replay_lock_gpart | replay_lock_mpole;
+      else
+        return replay_lock_part;
+    case task_type_grav_down:
+      return replay_lock_gpart | replay_lock_mpole;
+    case task_type_grav_long_range:
+    case task_type_grav_mm:
+      return replay_lock_mpole;
+    default:
+      return 0;
+  }
+}
+
+/**
+ * @brief Particles a task works on, as in task_acts_on().
+ */
+static enum task_actions replay_acts_on(const struct replay_task *t) {
+
+  switch (t->type) {
+    case task_type_drift_part:
+    case task_type_sort:
+    case task_type_ghost:
+    case task_type_extra_ghost:
+    case task_type_cooling:
+    case task_type_sourceterms:
+      return task_action_part;
+    case task_type_self:
+    case task_type_pair:
+    case task_type_sub_self:
+    case task_type_sub_pair:
+      if (t->subtype == task_subtype_grav ||
+          t->subtype == task_subtype_external_grav)
+        return task_action_gpart;
+      else
+        return task_action_part;
+    case task_type_end_force:
+    case task_type_kick1:
+    case task_type_kick2:
+    case task_type_timestep:
+    case task_type_send:
+    case task_type_recv:
+      if (t->ci.count > 0 && t->ci.gcount > 0)
+        return task_action_all;
+      else if (t->ci.count > 0)
+        return task_action_part;
+      else
+        return task_action_gpart;
+    case task_type_init_grav:
+    case task_type_grav_mm:
+      return task_action_multipole;
+    case task_type_drift_gpart:
+    case task_type_grav_down:
+    case task_type_grav_mesh:
+    case task_type_grav_long_range:
+      return task_action_gpart;
+    default:
+      return task_action_none;
+  }
+}
+
+/**
+ * @brief Is one of two cells inside the other one?
+ *
+ * Cells of the tree are either nested or disjoint, so this is true when
+ * they overlap at all.
+ */
+static int replay_cells_nested(const struct replay_cell *a,
+                               const struct replay_cell *b) {
+
+  if (a->width <= 0. || b->width <= 0.) return 0;
+  for (int k = 0; k < 3; k++)
+    if (a->loc[k] >= b->loc[k] + b->width || b->loc[k] >= a->loc[k] + a->width)
+      return 0;
+  return 1;
+}
+
+/**
+ * @brief Number of particles shared by two cells, as in
+ * task_cell_overlap_part() and task_cell_overlap_gpart().
+ */
+static int replay_cells_overlap(const struct replay_cell *a,
+                                const struct replay_cell *b, int gravity) {
+
+  if (!replay_cells_nested(a, b)) return 0;
+  const int na = gravity ? a->gcount : a->count;
+  const int nb = gravity ? b->gcount : b->count;
+  return na < nb ? na : nb;
+}
+
+/**
+ * @brief Overlap of the particles of two tasks, as in task_overlap().
+ */
+static float replay_overlap(const struct replay_task *ta,
+                            const struct replay_task *tb) {
+
+  if (ta == NULL || tb == NULL) return 0.f;
+
+  const enum task_actions ta_act = replay_acts_on(ta);
+  const enum task_actions tb_act = replay_acts_on(tb);
+  if (ta_act == task_action_none || tb_act == task_action_none) return 0.f;
+
+  const int ta_part = (ta_act == task_action_part || ta_act == task_action_all);
+  const int ta_gpart =
+      (ta_act == task_action_gpart || ta_act == task_action_all);
+  const int tb_part = (tb_act == task_action_part || tb_act == task_action_all);
+  const int tb_gpart =
+      (tb_act == task_action_gpart || tb_act == task_action_all);
+
+  int gravity;
+  if (ta_part && tb_part)
+    gravity = 0;
+  else if (ta_gpart && tb_gpart)
+    gravity = 1;
+  else
+    return 0.f;
+
+  const int size_union =
+      (gravity ? ta->ci.gcount + ta->cj.gcount + tb->ci.gcount + tb->cj.gcount
+               : ta->ci.count + ta->cj.count + tb->ci.count + tb->cj.count);
+  const int size_intersect = replay_cells_overlap(&ta->ci, &tb->ci, gravity) +
+                             replay_cells_overlap(&ta->ci, &tb->cj, gravity) +
+                             replay_cells_overlap(&ta->cj, &tb->ci, gravity) +
+                             replay_cells_overlap(&ta->cj, &tb->cj, gravity);
+
+  if (size_union - size_intersect <= 0) return 0.f;
+  return ((float)size_intersect) / (size_union - size_intersect);
+}
+
+/**
+ * @brief Could a task take its locks given the running tasks?
+ */
+static int replay_task_lock(const struct replay *r,
+                            const struct replay_task *t) {
+
+  const int mask = replay_lock_mask(t);
+  if (mask == 0) return 1;
+
+  for (int k = 0; k < r->nr_threads; k++) {
+    if (r->running[k] < 0) continue;
+    const struct replay_task *u = &r->tasks[r->running[k]];
+    if ((mask & replay_lock_mask(u)) == 0) continue;
+    if (replay_cells_nested(&t->ci, &u->ci) ||
+        replay_cells_nested(&t->ci, &u->cj) ||
+        replay_cells_nested(&t->cj, &u->ci) ||
+        replay_cells_nested(&t->cj, &u->cj))
+      return 0;
+  }
+  return 1;
+}
+
+/**
+ * @brief Inserts a task in a queue, as in queue_insert().
+ */
+static void replay_queue_insert(struct replay_queue *q, int tid, float key) {
+
+  if (q->count == q->size) {
+    q->size = q->size > 0 ? 2 * q->size : queue_sizeinit;
+    q->tid = (int *)realloc(q->tid, q->size * sizeof(int));
+    q->key = (float *)realloc(q->key, q->size * sizeof(float));
+    if (q->tid == NULL || q->key == NULL)
+      error("Failed to allocate the queue.");
+  }
+
+  /* Bubble the new entry up the heap. */
+  int k = q->count++;
+  while (k > 0 && key > q->key[(k - 1) / 2]) {
+    q->tid[k] = q->tid[(k - 1) / 2];
+    q->key[k] = q->key[(k - 1) / 2];
+    k = (k - 1) / 2;
+  }
+  q->tid[k] = tid;
+  q->key[k] = key;
+}
+
+/**
+ * @brief Removes the entry at a given position of a queue and re-heaps it.
+ */
+static void replay_queue_remove(struct replay_queue *q, int ind) {
+
+  const int qcount = q->count -= 1;
+  if (ind >= qcount) return;
+
+  /* Move the last entry in the gap and sift it up or down. */
+  const int tid = q->tid[qcount];
+  const float key = q->key[qcount];
+  int k = ind;
+  while (k > 0 && key > q->key[(k - 1) / 2]) {
+    q->tid[k] = q->tid[(k - 1) / 2];
+    q->key[k] = q->key[(k - 1) / 2];
+    k = (k - 1) / 2;
+  }
+  int i;
+  while ((i = 2 * k + 1) < qcount) {
+    if (i + 1 < qcount && q->key[i + 1] > q->key[i]) i += 1;
+    if (q->key[i] > key) {
+      q->tid[k] = q->tid[i];
+      q->key[k] = q->key[i];
+      k = i;
+    } else
+      break;
+  }
+  q->tid[k] = tid;
+  q->key[k] = key;
+}
+
+/**
+ * @brief Queue the task was inserted in during the run.
+ */
+static int replay_enqueue_recorded(const struct replay *r,
+                                   const struct replay_task *t) {
+  if (t->qid >= 0) return t->qid % r->nr_queues;
+  return t->order % r->nr_queues;
+}
+
+/**
+ * @brief A single queue shared by all the threads.
+ */
+static int replay_enqueue_shared(const struct replay *r,
+                                 const struct replay_task *t) {
+  return 0;
+}
+
+/**
+ * @brief Tasks ordered by weight, i.e. by their critical path.
+ */
+static float replay_key_weight(const struct replay_task *t) {
+  return t->weight;
+}
+
+/**
+ * @brief Tasks ordered by the time at which they were enqueued.
+ */
+static float replay_key_fifo(const struct replay_task *t) {
+  return -(float)t->order;
+}
+
+/**
+ * @brief Gets the task with the best overlap with the previous one in a
+ * window of the queue, as in queue_gettask().
+ */
+static int replay_queue_gettask_window(struct replay *r,
+                                       struct replay_queue *q, int prev) {
+
+  const struct replay_task *tprev = prev >= 0 ? &r->tasks[prev] : NULL;
+  struct {
+    int ind;
+    float score;
+  } window[queue_search_window];
+  int window_count = 0;
+
+  for (int k = 0; k < q->count; k++) {
+    if (k < queue_search_window) {
+      window[window_count].ind = k;
+      window[window_count].score =
+          replay_overlap(tprev, &r->tasks[q->tid[k]]);
+      window_count += 1;
+    } else {
+      int ind_max = 0;
+      for (int i = 1; i < window_count; i++)
+        if (window[i].score > window[ind_max].score) ind_max = i;
+      if (replay_task_lock(r, &r->tasks[q->tid[window[ind_max].ind]])) {
+        const int tid = q->tid[window[ind_max].ind];
+        replay_queue_remove(q, window[ind_max].ind);
+        return tid;
+      }
+      window[ind_max].ind = k;
+      window[ind_max].score = replay_overlap(tprev, &r->tasks[q->tid[k]]);
+    }
+  }
+
+  /* Loop through whatever is left in the window. */
+  while (window_count > 0) {
+    int ind_max = 0;
+    for (int i = 1; i < window_count; i++)
+      if (window[i].score > window[ind_max].score) ind_max = i;
+    if (replay_task_lock(r, &r->tasks[q->tid[window[ind_max].ind]])) {
+      const int tid = q->tid[window[ind_max].ind];
+      replay_queue_remove(q, window[ind_max].ind);
+      return tid;
+    }
+    window_count -= 1;
+    window[ind_max] = window[window_count];
+  }
+
+  return -1;
+}
+
+/**
+ * @brief Gets the first task of the queue that can be locked, ignoring the
+ * overlap with the previous task.
+ */
+static int replay_queue_gettask_first(struct replay *r, struct replay_queue *q,
+                                      int prev) {
+
+  for (int k = 0; k < q->count; k++) {
+    if (replay_task_lock(r, &r->tasks[q->tid[k]])) {
+      const int tid = q->tid[k];
+      replay_queue_remove(q, k);
+      return tid;
+    }
+  }
+  return -1;
+}
+
+/**
+ * @brief Gets a task from the queue of the thread or steals one from a
+ * random other queue, as in scheduler_gettask().
+ */
+static int replay_scheduler_gettask_default(struct replay *r, int thread,
+                                            int prev) {
+
+  const struct replay_policy *p = r->policy;
+  const int qid = thread % r->nr_queues;
+
+  /* Try to get a task from the suggested queue. */
+  int tid = p->queue_gettask(r, &r->queues[qid], prev);
+  if (tid >= 0 || !r->steal) return tid;
+
+  /* If unsuccessful, try stealing from the other queues. */
+  int count = 0, qids[r->nr_queues];
+  for (int k = 0; k < r->nr_queues; k++)
+    if (r->queues[k].count > 0) qids[count++] = k;
+  for (int k = 0; k < scheduler_maxsteal && count > 0; k++) {
+    const int ind = rand_r(&r->seeds[thread]) % count;
+    tid = p->queue_gettask(r, &r->queues[qids[ind]], prev);
+    if (tid >= 0) return tid;
+    qids[ind] = qids[--count];
+  }
+  return -1;
+}
+
+/* The available policies, the first one being the default. */
+static const struct replay_policy replay_policies[] = {
+    {"swift", "the scheduler of SWIFT", replay_enqueue_recorded,
+     replay_key_weight, replay_queue_gettask_window,
+     replay_scheduler_gettask_default},
+    {"fifo", "queues in order of insertion instead of by weight",
+     replay_enqueue_recorded, replay_key_fifo, replay_queue_gettask_window,
+     replay_scheduler_gettask_default},
+    {"nooverlap", "first lockable task, ignoring the cache overlap",
+     replay_enqueue_recorded, replay_key_weight, replay_queue_gettask_first,
+     replay_scheduler_gettask_default},
+    {"shared", "a single queue shared by all the threads",
+     replay_enqueue_shared, replay_key_weight, replay_queue_gettask_window,
+     replay_scheduler_gettask_default}};
+static const int replay_nr_policies =
+    sizeof(replay_policies) / sizeof(struct replay_policy);
+
+static void replay_done(struct replay *r, int tid);
+
+/**
+ * @brief Makes a task available, completing it right away if it is
+ * implicit, as in scheduler_enqueue().
+ */
+static void replay_enqueue(struct replay *r, int tid) {
+
+  struct replay_task *t = &r->tasks[tid];
+  t->order = r->nr_enqueued++;
+
+  if (t->implicit) {
+    replay_done(r, tid);
+    return;
+  }
+
+  const int qid = r->policy->enqueue(r, t);
+  if (qid < 0 || qid >= r->nr_queues) error("Bad computed qid.");
+  replay_queue_insert(&r->queues[qid], tid, r->policy->key(t));
+}
+
+/**
+ * @brief Completes a task and enqueues the tasks it unlocks, as in
+ * scheduler_done().
+ */
+static void replay_done(struct replay *r, int tid) {
+
+  const struct replay_task *t = &r->tasks[tid];
+  r->nr_done += 1;
+  for (int k = 0; k < t->nr_unlocks; k++) {
+    struct replay_task *u = &r->tasks[t->unlocks[k]];
+    if (--u->wait == 0) replay_enqueue(r, t->unlocks[k]);
+  }
+}
+
+/**
+ * @brief The results of a replay.
+ */
+struct replay_stats {
+
+  /*! Time to run all the tasks in ticks. */
+  long long makespan;
+
+  /*! Time spent in tasks and waiting for tasks, summed over the threads. */
+  long long busy, idle;
+};
+
+/**
+ * @brief Replays a graph of tasks.
+ *
+ * @param tasks The tasks.
+ * @param nr_tasks The number of tasks.
+ * @param nr_threads The number of simulated threads (and queues).
+ * @param policy The scheduling #replay_policy.
+ * @param steal Do the threads steal tasks from the other queues?
+ * @param overhead Time needed to get a task in ticks.
+ * @param stats (return) The results.
+ */
+static void replay_run(struct replay_task *tasks, int nr_tasks, int nr_threads,
+                       const struct replay_policy *policy, int steal,
+                       long long overhead, struct replay_stats *stats) {
+
+  struct replay r;
+  bzero(&r, sizeof(struct replay));
+  r.tasks = tasks;
+  r.nr_tasks = nr_tasks;
+  r.nr_threads = nr_threads;
+  r.nr_queues = nr_threads;
+  r.steal = steal;
+  r.overhead = overhead;
+  r.policy = policy;
+  r.queues = (struct replay_queue *)calloc(r.nr_queues,
+                                           sizeof(struct replay_queue));
+  r.running = (int *)malloc(nr_threads * sizeof(int));
+  r.prev = (int *)malloc(nr_threads * sizeof(int));
+  r.end = (long long *)malloc(nr_threads * sizeof(long long));
+  r.seeds = (unsigned int *)malloc(nr_threads * sizeof(unsigned int));
+  if (r.queues == NULL || r.running == NULL || r.prev == NULL ||
+      r.end == NULL || r.seeds == NULL)
+    error("Failed to allocate the replay.");
+  for (int k = 0; k < nr_threads; k++) {
+    r.running[k] = -1;
+    r.prev[k] = -1;
+    r.seeds[k] = k;
+  }
+
+  /* Enqueue the tasks without dependencies. */
+  for (int k = 0; k < nr_tasks; k++) tasks[k].wait = tasks[k].nr_deps;
+  for (int k = 0; k < nr_tasks; k++)
+    if (tasks[k].nr_deps == 0) replay_enqueue(&r, k);
+
+  long long now = 0, busy = 0;
+  while (1) {
+
+    /* Give a task to the idle threads. */
+    for (int k = 0; k < nr_threads; k++) {
+      if (r.running[k] >= 0) continue;
+      const int tid = policy->scheduler_gettask(&r, k, r.prev[k]);
+      if (tid < 0) continue;
+      const struct replay_task *t = &tasks[tid];
+      const long long cost = t->toc - t->tic;
+      r.running[k] = tid;
+      r.end[k] = now + overhead + cost;
+      busy += cost;
+    }
+
+    /* Move on to the next task to finish. */
+    int next = -1;
+    for (int k = 0; k < nr_threads; k++)
+      if (r.running[k] >= 0 && (next < 0 || r.end[k] < r.end[next])) next = k;
+    if (next < 0) break;
+
+    now = r.end[next];
+    const int tid = r.running[next];
+    r.running[next] = -1;
+    r.prev[next] = tid;
+    replay_done(&r, tid);
+  }
+
+  if (r.nr_done != nr_tasks)
+    error("Only %d of the %d tasks could be run, is the graph cyclic?",
+          r.nr_done, nr_tasks);
+
+  stats->makespan = now;
+  stats->busy = busy;
+  stats->idle = nr_threads * now - busy;
+
+  for (int k = 0; k < r.nr_queues; k++) {
+    free(r.queues[k].tid);
+    free(r.queues[k].key);
+  }
+  free(r.queues);
+  free(r.running);
+  free(r.prev);
+  free(r.end);
+  free(r.seeds);
+}
+
+/**
+ * @brief Length of the critical path of a graph in ticks, i.e. the
+ * makespan with an infinite number of threads and no locks.
+ */
+static long long replay_critical_path(struct replay_task *tasks,
+                                      int nr_tasks) {
+
+  /* Topological order of the tasks. */
+  int *order = (int *)malloc(nr_tasks * sizeof(int));
+  long long *path = (long long *)malloc(nr_tasks * sizeof(long long));
+  if (order == NULL || path == NULL) error("Failed to allocate the paths.");
+  int count = 0;
+  for (int k = 0; k < nr_tasks; k++) {
+    tasks[k].wait = tasks[k].nr_deps;
+    if (tasks[k].nr_deps == 0) order[count++] = k;
+  }
+  for (int i = 0; i < count; i++) {
+    const struct replay_task *t = &tasks[order[i]];
+    for (int j = 0; j < t->nr_unlocks; j++)
+      if (--tasks[t->unlocks[j]].wait == 0) order[count++] = t->unlocks[j];
+  }
+  if (count != nr_tasks) error("The task graph is cyclic.");
+
+  /* Longest path from each task to the end of the graph. */
+  long long max_path = 0;
+  for (int i = nr_tasks - 1; i >= 0; i--) {
+    const struct replay_task *t = &tasks[order[i]];
+    long long p = 0;
+    for (int j = 0; j < t->nr_unlocks; j++)
+      if (path[t->unlocks[j]] > p) p = path[t->unlocks[j]];
+    path[order[i]] = p + t->toc - t->tic;
+    if (path[order[i]] > max_path) max_path = path[order[i]];
+  }
+
+  free(order);
+  free(path);
+  return max_path;
+}
+
+/**
+ * @brief Counts the dependencies of each task.
+ */
+static void replay_count_deps(struct replay_task *tasks, int nr_tasks) {
+
+  for (int k = 0; k < nr_tasks; k++) tasks[k].nr_deps = 0;
+  for (int k = 0; k < nr_tasks; k++)
+    for (int j = 0; j < tasks[k].nr_unlocks; j++) {
+      if (tasks[k].unlocks[j] < 0 || tasks[k].unlocks[j] >= nr_tasks)
+        error("Task %d unlocks a non-existent task.", k);
+      tasks[tasks[k].unlocks[j]].nr_deps += 1;
+    }
+}
+
+/**
+ * @brief Reads a graph written by scheduler_dump_task_graph().
+ *
+ * @param fileName The name of the file.
+ * @param nr_tasks (return) The number of tasks.
+ * @param nr_queues (return) The number of queues of the run.
+ * @param cpufreq (return) The number of ticks per second.
+ */
+static struct replay_task *replay_read(const char *fileName, int *nr_tasks,
+                                       int *nr_queues,
+                                       unsigned long long *cpufreq) {
+
+  FILE *file = fopen(fileName, "r");
+  if (file == NULL) error("Could not open file '%s'.", fileName);
+
+  char line[256];
+  if (fgets(line, sizeof(line), file) == NULL ||
+      sscanf(line, "# %d %d %llu", nr_tasks, nr_queues, cpufreq) != 3)
+    error("File '%s' is not a task graph.", fileName);
+  if (fgets(line, sizeof(line), file) == NULL)
+    error("File '%s' is truncated.", fileName);
+
+  struct replay_task *tasks =
+      (struct replay_task *)calloc(*nr_tasks, sizeof(struct replay_task));
+  if (tasks == NULL) error("Failed to allocate the tasks.");
+
+  for (int k = 0; k < *nr_tasks; k++) {
+    struct replay_task *t = &tasks[k];
+    int index, type, subtype;
+    if (fscanf(file, "%d %d %d %d %d %e %lld %lld", &index, &type, &subtype,
+               &t->implicit, &t->qid, &t->weight, &t->tic, &t->toc) != 8 ||
+        index != k)
+      error("Failed to read task %d from '%s'.", k, fileName);
+    if (type < 0 || type >= task_type_count || subtype < 0 ||
+        subtype >= task_subtype_count)
+      error("Task %d has an invalid type.", k);
+    t->type = (enum task_types)type;
+    t->subtype = (enum task_subtypes)subtype;
+
+    struct replay_cell *cells[2] = {&t->ci, &t->cj};
+    for (int i = 0; i < 2; i++)
+      if (fscanf(file, "%lf %lf %lf %lf %d %d", &cells[i]->loc[0],
+                 &cells[i]->loc[1], &cells[i]->loc[2], &cells[i]->width,
+                 &cells[i]->count, &cells[i]->gcount) != 6)
+        error("Failed to read the cells of task %d.", k);
+
+    if (fscanf(file, "%d", &t->nr_unlocks) != 1 || t->nr_unlocks < 0)
+      error("Failed to read the unlocks of task %d.", k);
+    t->unlocks = (int *)malloc(t->nr_unlocks * sizeof(int));
+    if (t->unlocks == NULL && t->nr_unlocks > 0)
+      error("Failed to allocate the unlocks.");
+    for (int j = 0; j < t->nr_unlocks; j++)
+      if (fscanf(file, "%d", &t->unlocks[j]) != 1)
+        error("Failed to read the unlocks of task %d.", k);
+  }
+
+  fclose(file);
+  replay_count_deps(tasks, *nr_tasks);
+  return tasks;
+}
+
+/**
+ * @brief Frees the tasks of a graph.
+ */
+static void replay_free(struct replay_task *tasks, int nr_tasks) {
+  for (int k = 0; k < nr_tasks; k++) free(tasks[k].unlocks);
+  free(tasks);
+}
+
+/**
+ * @brief Creates a synthetic task of unit cost.
+ *
+ * @param t The #replay_task to fill.
+ * @param type The type of the task.
+ * @param implicit Is the task implicit?
+ * @param cell Index of the cell of the task along x, -1 for none.
+ * @param width Width of the cell.
+ * @param nr_unlocks The number of tasks unlocked.
+ * @param first Index of the first task unlocked, the others following.
+ */
+static void replay_make_task(struct replay_task *t, enum task_types type,
+                             int implicit, int cell, double width,
+                             int nr_unlocks, int first) {
+
+  bzero(t, sizeof(struct replay_task));
+  t->type = type;
+  t->subtype = (type == task_type_self) ? task_subtype_density
+                                        : task_subtype_none;
+  t->implicit = implicit;
+  t->qid = 0;
+  t->toc = implicit ? 0 : 100;
+  if (cell >= 0) {
+    t->ci.loc[0] = cell * width;
+    t->ci.width = width;
+    t->ci.count = 10;
+  }
+  t->nr_unlocks = nr_unlocks;
+  t->unlocks = (int *)malloc(nr_unlocks * sizeof(int));
+  for (int j = 0; j < nr_unlocks; j++) t->unlocks[j] = first + j;
+}
+
+/**
+ * @brief Replays a synthetic graph with every policy and checks the
+ * makespan.
+ */
+static void replay_check(struct replay_task *tasks, int nr_tasks,
+                         int nr_threads, int steal, long long expected,
+                         const char *name) {
+
+  replay_count_deps(tasks, nr_tasks);
+  for (int p = 0; p < replay_nr_policies; p++) {
+    struct replay_stats stats;
+    replay_run(tasks, nr_tasks, nr_threads, &replay_policies[p], steal, 0,
+               &stats);
+    if (stats.makespan != expected)
+      error("Graph '%s' with policy '%s' took %lld ticks instead of %lld.",
+            name, replay_policies[p].name, stats.makespan, expected);
+    if (stats.idle != nr_threads * stats.makespan - stats.busy)
+      error("Inconsistent idle time.");
+  }
+  message("Graph '%s' replayed correctly.", name);
+}
+
+/**
+ * @brief Replays synthetic graphs with known makespans.
+ */
+static void replay_test(void) {
+
+  struct replay_task tasks[65];
+
+  /* A chain of tasks runs one after the other. */
+  for (int k = 0; k < 10; k++)
+    replay_make_task(&tasks[k], task_type_ghost, 0, -1, 0., k < 9, k + 1);
+  replay_check(tasks, 10, 4, 1, 1000, "chain");
+  for (int k = 0; k < 10; k++) free(tasks[k].unlocks);
+
+  /* Independent tasks fill all the threads. */
+  for (int k = 0; k < 64; k++)
+    replay_make_task(&tasks[k], task_type_ghost, 0, -1, 0., 0, 0);
+  replay_check(tasks, 64, 4, 1, 1600, "independent");
+
+  /* Without stealing, only the thread of the queue works. */
+  struct replay_stats stats;
+  replay_run(tasks, 64, 4, &replay_policies[0], 0, 0, &stats);
+  if (stats.makespan != 6400 || stats.idle != 3 * 6400)
+    error("Replay without stealing took %lld ticks instead of 6400.",
+          stats.makespan);
+  for (int k = 0; k < 64; k++) free(tasks[k].unlocks);
+
+  /* Tasks locking the same cell, or nested cells, are serialised. */
+  replay_make_task(&tasks[0], task_type_self, 0, 0, 1., 0, 0);
+  for (int k = 1; k < 8; k++)
+    replay_make_task(&tasks[k], task_type_self, 0, k % 2, 0.5, 0, 0);
+  replay_check(tasks, 8, 4, 1, 500, "nested locks");
+  for (int k = 0; k < 8; k++) free(tasks[k].unlocks);
+
+  /* Tasks locking distinct cells run concurrently. */
+  for (int k = 0; k < 8; k++)
+    replay_make_task(&tasks[k], task_type_self, 0, k, 1., 0, 0);
+  replay_check(tasks, 8, 4, 1, 200, "distinct locks");
+  for (int k = 0; k < 8; k++) free(tasks[k].unlocks);
+
+  /* Implicit tasks take no time. */
+  for (int k = 0; k < 4; k++)
+    replay_make_task(&tasks[k], task_type_ghost, 0, -1, 0., 1, 4);
+  replay_make_task(&tasks[4], task_type_ghost_in, 1, -1, 0., 4, 5);
+  for (int k = 5; k < 9; k++)
+    replay_make_task(&tasks[k], task_type_ghost, 0, -1, 0., 0, 0);
+  replay_check(tasks, 9, 4, 1, 200, "implicit");
+  if (replay_critical_path(tasks, 9) != 200)
+    error("Wrong critical path.");
+  for (int k = 0; k < 9; k++) free(tasks[k].unlocks);
+}
+
+int main(int argc, char *argv[]) {
+
+  int nr_threads = 0, steal = 1;
+  long long overhead = 0;
+  const char *policy_name = replay_policies[0].name;
+  int c;
+
+  while ((c = getopt(argc, argv, "t:p:s:o:h")) != -1) {
+    switch (c) {
+      case 't':
+        if (sscanf(optarg, "%d", &nr_threads) != 1 || nr_threads <= 0)
+          error("Invalid number of threads.");
+        break;
+      case 'p':
+        policy_name = optarg;
+        break;
+      case 's':
+        if (sscanf(optarg, "%d", &steal) != 1) error("Invalid steal flag.");
+        break;
+      case 'o':
+        if (sscanf(optarg, "%lld", &overhead) != 1 || overhead < 0)
+          error("Invalid overhead.");
+        break;
+      case 'h':
+      case '?':
+        printf(
+            "\nUsage: %s [OPTIONS...] [task_graph-stepN.dat]\n"
+            "\nReplays a task graph written with -y by a SWIFT configured"
+            "\nwith --enable-task-debugging through a model of the scheduler."
+            "\nWithout a file, replays synthetic graphs as a test."
+            "\n\nOptions:"
+            "\n-t THREADS    - number of threads, that of the run by default"
+            "\n-p POLICY     - scheduling policy, or 'all' to compare them"
+            "\n-s STEAL=1    - do threads steal tasks from other queues?"
+            "\n-o OVERHEAD=0 - cost of getting a task in ticks\n"
+            "\nPolicies:\n",
+            argv[0]);
+        for (int p = 0; p < replay_nr_policies; p++)
+          printf("%-13s - %s\n", replay_policies[p].name,
+                 replay_policies[p].description);
+        exit(c == 'h' ? 0 : 1);
+    }
+  }
+
+  /* Check the replay itself? */
+  if (optind >= argc) {
+    replay_test();
+    return 0;
+  }
+
+  /* Read the graph. */
+  int nr_tasks, nr_queues;
+  unsigned long long cpufreq;
+  struct replay_task *tasks =
+      replay_read(argv[optind], &nr_tasks, &nr_queues, &cpufreq);
+  if (nr_threads == 0) nr_threads = nr_queues;
+  const double ms = cpufreq > 0 ? 1e3 / cpufreq : 0.;
+
+  /* Measured properties of the graph. */
+  long long tic = -1, toc = 0, work = 0;
+  for (int k = 0; k < nr_tasks; k++) {
+    if (tasks[k].implicit) continue;
+    if (tic < 0 || tasks[k].tic < tic) tic = tasks[k].tic;
+    if (tasks[k].toc > toc) toc = tasks[k].toc;
+    work += tasks[k].toc - tasks[k].tic;
+  }
+  const long long critical = replay_critical_path(tasks, nr_tasks);
+  message("Read %d tasks, run on %d queues, from '%s'.", nr_tasks, nr_queues,
+          argv[optind]);
+  message("Measured: span %lld ticks (%.3f ms), work %lld ticks, critical "
+          "path %lld ticks (%.3f ms).",
+          toc - tic, (toc - tic) * ms, work, critical, critical * ms);
+
+  /* Replay it. */
+  int nr_replayed = 0;
+  for (int p = 0; p < replay_nr_policies; p++) {
+    if (strcmp(policy_name, "all") != 0 &&
+        strcmp(policy_name, replay_policies[p].name) != 0)
+      continue;
+    struct replay_stats stats;
+    replay_run(tasks, nr_tasks, nr_threads, &replay_policies[p], steal,
+               overhead, &stats);
+    message("Policy '%s' on %d threads%s: makespan %lld ticks (%.3f ms), "
+            "idle %.2f%%.",
+            replay_policies[p].name, nr_threads, steal ? "" : " (no stealing)",
+            stats.makespan, stats.makespan * ms,
+            100. * stats.idle / ((double)nr_threads * stats.makespan));
+    nr_replayed++;
+  }
+  if (nr_replayed == 0) error("Unknown policy '%s'.", policy_name);
+
+  replay_free(tasks, nr_tasks);
+  return 0;
+}